@@ -0,0 +1,453 @@
+/*
+ * blktrace.c - record block io traces and report io latencies
+ *
+ * Recording:
+ *
+ *	blktrace -d /dev/sda [-r /relay] [-w seconds] [-o prefix]
+ *
+ * sets up tracing on the device, copies the per-cpu relayfs trace files
+ * to <prefix>.blktrace.<cpu> until interrupted or the given number of
+ * seconds has passed, and tears the trace down again.
+ *
+ * Reporting:
+ *
+ *	blktrace -p sda.blktrace.0 sda.blktrace.1 ...
+ *
+ * merges the per-cpu files by time, pairs every queued bio (Q) with the
+ * completion (C) of the request that carried it, and prints histograms
+ * of the queue-to-completion latency for reads and writes.
+ *
+ * Build with: gcc -O2 -Wall -o blktrace Documentation/block/blktrace.c
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * These must match include/linux/blktrace_api.h
+ */
+#define BDEVNAME_SIZE		32
+#define BLK_IO_TRACE_MAGIC	0x65617400
+#define BLK_IO_TRACE_VERSION	0x07
+
+#define BLK_TC_SHIFT		16
+#define BLK_TC_WRITE		(1 << 1)
+#define BLK_TC_FS		(1 << 8)
+
+#define __BLK_TA_QUEUE		1
+#define __BLK_TA_COMPLETE	8
+
+struct blk_io_trace {
+	uint32_t magic;
+	uint32_t sequence;
+	uint64_t time;
+	uint64_t sector;
+	uint32_t bytes;
+	uint32_t action;
+	uint32_t pid;
+	uint32_t device;
+	uint32_t cpu;
+	uint16_t error;
+	uint16_t pdu_len;
+};
+
+struct blk_user_trace_setup {
+	char name[BDEVNAME_SIZE];
+	uint16_t act_mask;
+	uint32_t buf_size;
+	uint32_t buf_nr;
+	uint64_t start_lba;
+	uint64_t end_lba;
+	uint32_t pid;
+};
+
+#define BLKTRACESETUP		_IOWR(0x12, 115, struct blk_user_trace_setup)
+#define BLKTRACESTART		_IO(0x12, 116)
+#define BLKTRACESTOP		_IO(0x12, 117)
+#define BLKTRACETEARDOWN	_IO(0x12, 118)
+
+#define MAX_CPUS		256
+#define BUF_SIZE		(512 * 1024)
+#define BUF_NR			4
+
+static volatile int done;
+
+static void handle_sigint(int sig)
+{
+	done = 1;
+}
+
+static int record(const char *dev, const char *relay_path, int seconds,
+		  const char *prefix)
+{
+	struct blk_user_trace_setup buts;
+	struct pollfd pfds[MAX_CPUS];
+	int ofds[MAX_CPUS];
+	char path[512], buf[65536];
+	int fd, ncpus, i;
+
+	fd = open(dev, O_RDONLY | O_NONBLOCK);
+	if (fd < 0) {
+		perror(dev);
+		return 1;
+	}
+
+	memset(&buts, 0, sizeof(buts));
+	buts.buf_size = BUF_SIZE;
+	buts.buf_nr = BUF_NR;
+	if (ioctl(fd, BLKTRACESETUP, &buts) < 0) {
+		perror("BLKTRACESETUP");
+		return 1;
+	}
+	if (!prefix)
+		prefix = buts.name;
+
+	ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+	for (i = 0; i < ncpus && i < MAX_CPUS; i++) {
+		snprintf(path, sizeof(path), "%s/block/%s/trace%d",
+			 relay_path, buts.name, i);
+		pfds[i].fd = open(path, O_RDONLY | O_NONBLOCK);
+		if (pfds[i].fd < 0) {
+			perror(path);
+			goto teardown;
+		}
+		pfds[i].events = POLLIN;
+
+		snprintf(path, sizeof(path), "%s.blktrace.%d", prefix, i);
+		ofds[i] = open(path, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+		if (ofds[i] < 0) {
+			perror(path);
+			goto teardown;
+		}
+	}
+
+	signal(SIGINT, handle_sigint);
+	signal(SIGTERM, handle_sigint);
+	if (seconds) {
+		signal(SIGALRM, handle_sigint);
+		alarm(seconds);
+	}
+
+	if (ioctl(fd, BLKTRACESTART) < 0) {
+		perror("BLKTRACESTART");
+		goto teardown;
+	}
+
+	while (!done) {
+		if (poll(pfds, ncpus, 500) < 0 && errno != EINTR)
+			break;
+		for (i = 0; i < ncpus; i++) {
+			ssize_t ret;
+
+			while ((ret = read(pfds[i].fd, buf, sizeof(buf))) > 0)
+				if (write(ofds[i], buf, ret) != ret)
+					done = 1;
+		}
+	}
+
+	ioctl(fd, BLKTRACESTOP);
+
+	/*
+	 * pick up what was flushed on stop
+	 */
+	for (i = 0; i < ncpus; i++) {
+		ssize_t ret;
+
+		while ((ret = read(pfds[i].fd, buf, sizeof(buf))) > 0)
+			if (write(ofds[i], buf, ret) != ret)
+				break;
+		close(pfds[i].fd);
+		close(ofds[i]);
+	}
+
+	snprintf(path, sizeof(path), "%s/block/%s/dropped", relay_path,
+		 buts.name);
+	i = open(path, O_RDONLY);
+	if (i >= 0) {
+		ssize_t ret = read(i, buf, sizeof(buf) - 1);
+
+		if (ret > 0) {
+			buf[ret] = '\0';
+			if (atoi(buf))
+				fprintf(stderr, "%s: %d events dropped, "
+					"consider a larger buffer\n",
+					buts.name, atoi(buf));
+		}
+		close(i);
+	}
+
+teardown:
+	ioctl(fd, BLKTRACETEARDOWN);
+	close(fd);
+	return 0;
+}
+
+/*
+ * Reporting
+ */
+struct trace {
+	struct blk_io_trace t;
+};
+
+struct pending {
+	uint64_t sector;
+	uint64_t time;
+	uint32_t device;
+	struct pending *next;
+};
+
+#define HASH_SIZE	65536
+#define NR_BUCKETS	32	/* log2 of the latency in usecs */
+
+static struct pending *hash[HASH_SIZE];
+
+struct latency {
+	unsigned long count;
+	uint64_t min, max, total;
+	unsigned long buckets[NR_BUCKETS];
+};
+
+static struct latency lat[2];
+
+static unsigned int hash_sector(uint32_t dev, uint64_t sector)
+{
+	return (unsigned int)((sector ^ (sector >> 16) ^ dev) % HASH_SIZE);
+}
+
+static void queue_event(struct blk_io_trace *t)
+{
+	struct pending *p = malloc(sizeof(*p));
+	unsigned int h = hash_sector(t->device, t->sector);
+
+	if (!p)
+		return;
+	p->sector = t->sector;
+	p->time = t->time;
+	p->device = t->device;
+	p->next = hash[h];
+	hash[h] = p;
+}
+
+static void account(int rw, uint64_t nsecs)
+{
+	struct latency *l = &lat[rw];
+	uint64_t usecs = nsecs / 1000;
+	int b = 0;
+
+	while (usecs && b < NR_BUCKETS - 1) {
+		usecs >>= 1;
+		b++;
+	}
+
+	if (!l->count || nsecs < l->min)
+		l->min = nsecs;
+	if (nsecs > l->max)
+		l->max = nsecs;
+	l->total += nsecs;
+	l->count++;
+	l->buckets[b]++;
+}
+
+/*
+ * A completion covers every bio queued against the sectors of its
+ * request, find and retire them.
+ */
+static void complete_event(struct blk_io_trace *t)
+{
+	int rw = (t->action >> BLK_TC_SHIFT) & BLK_TC_WRITE ? 1 : 0;
+	uint64_t s, end = t->sector + (t->bytes >> 9);
+
+	for (s = t->sector; s < end; s++) {
+		struct pending **pp = &hash[hash_sector(t->device, s)];
+
+		while (*pp) {
+			struct pending *p = *pp;
+
+			if (p->sector == s && p->device == t->device) {
+				if (t->time >= p->time)
+					account(rw, t->time - p->time);
+				*pp = p->next;
+				free(p);
+				continue;
+			}
+			pp = &p->next;
+		}
+	}
+}
+
+static int cmp_time(const void *a, const void *b)
+{
+	const struct trace *ta = a, *tb = b;
+
+	if (ta->t.time < tb->t.time)
+		return -1;
+	return ta->t.time > tb->t.time;
+}
+
+static struct trace *traces;
+static unsigned long nr_traces, max_traces;
+
+static int read_file(const char *name)
+{
+	struct blk_io_trace t;
+	FILE *f = fopen(name, "r");
+
+	if (!f) {
+		perror(name);
+		return 1;
+	}
+
+	while (fread(&t, sizeof(t), 1, f) == 1) {
+		if ((t.magic & 0xffffff00) != BLK_IO_TRACE_MAGIC ||
+		    (t.magic & 0xff) != BLK_IO_TRACE_VERSION) {
+			fprintf(stderr, "%s: bad trace magic %x\n", name,
+				t.magic);
+			break;
+		}
+		if (t.pdu_len)
+			fseek(f, t.pdu_len, SEEK_CUR);
+
+		if (nr_traces == max_traces) {
+			max_traces = max_traces ? max_traces * 2 : 65536;
+			traces = realloc(traces, max_traces * sizeof(*traces));
+			if (!traces) {
+				fprintf(stderr, "out of memory\n");
+				exit(1);
+			}
+		}
+		traces[nr_traces++].t = t;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void print_latency(const char *name, struct latency *l)
+{
+	unsigned long max = 0;
+	int i, first = -1, last = 0;
+
+	printf("%s: %lu ios", name, l->count);
+	if (!l->count) {
+		printf("\n\n");
+		return;
+	}
+	printf(", latency min %llu avg %llu max %llu usecs\n",
+	       (unsigned long long) l->min / 1000,
+	       (unsigned long long) (l->total / l->count) / 1000,
+	       (unsigned long long) l->max / 1000);
+
+	for (i = 0; i < NR_BUCKETS; i++) {
+		if (!l->buckets[i])
+			continue;
+		if (first < 0)
+			first = i;
+		last = i;
+		if (l->buckets[i] > max)
+			max = l->buckets[i];
+	}
+
+	for (i = first; i <= last; i++) {
+		int j, stars = (int) ((l->buckets[i] * 50) / max);
+
+		printf("  < %10lu usecs %10lu |", 1UL << i, l->buckets[i]);
+		for (j = 0; j < stars; j++)
+			putchar('*');
+		putchar('\n');
+	}
+	putchar('\n');
+}
+
+static int report(int argc, char **argv)
+{
+	unsigned long i, unmatched = 0;
+
+	for (i = 0; i < argc; i++)
+		if (read_file(argv[i]))
+			return 1;
+
+	qsort(traces, nr_traces, sizeof(*traces), cmp_time);
+
+	for (i = 0; i < nr_traces; i++) {
+		struct blk_io_trace *t = &traces[i].t;
+
+		switch (t->action & 0xffff) {
+		case __BLK_TA_QUEUE:
+			queue_event(t);
+			break;
+		case __BLK_TA_COMPLETE:
+			if ((t->action >> BLK_TC_SHIFT) & BLK_TC_FS)
+				complete_event(t);
+			break;
+		}
+	}
+
+	for (i = 0; i < HASH_SIZE; i++) {
+		struct pending *p;
+
+		for (p = hash[i]; p; p = p->next)
+			unmatched++;
+	}
+
+	printf("%lu events, %lu queued ios without completion\n\n",
+	       nr_traces, unmatched);
+	print_latency("reads", &lat[0]);
+	print_latency("writes", &lat[1]);
+	return 0;
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s -d <device> [-r <relayfs mount>] [-w <seconds>] "
+		"[-o <prefix>]\n"
+		"       %s -p <trace file>...\n", prog, prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *dev = NULL, *relay_path = "/relay", *prefix = NULL;
+	int c, seconds = 0, parse = 0;
+
+	while ((c = getopt(argc, argv, "d:r:w:o:p")) != -1) {
+		switch (c) {
+		case 'd':
+			dev = optarg;
+			break;
+		case 'r':
+			relay_path = optarg;
+			break;
+		case 'w':
+			seconds = atoi(optarg);
+			break;
+		case 'o':
+			prefix = optarg;
+			break;
+		case 'p':
+			parse = 1;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	if (parse) {
+		if (optind == argc)
+			usage(argv[0]);
+		return report(argc - optind, argv + optind);
+	}
+
+	if (!dev)
+		usage(argv[0]);
+	return record(dev, relay_path, seconds, prefix);
+}
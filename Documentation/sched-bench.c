@@ -0,0 +1,360 @@
+/*
+ * sched-bench.c - measure scheduler wakeup latency and fairness
+ *
+ *	sched-bench [-t seconds] [-h hogs] [-n nice] [-l sleepers]
+ *		    [-i interval ms] [-a cpu]
+ *
+ * starts a number of cpu hogs and a number of sleepers.  Every interval
+ * the parent stamps the current time into a pipe to each sleeper, and
+ * the sleeper accounts the time from the stamp to the moment it got to
+ * run after the read.  This is the wakeup latency seen by an interactive
+ * task while the hogs keep the cpus busy.
+ *
+ * Every other hog runs at the given nice level.  At the end the cpu time
+ * of each hog is compared against its share by load weight.  The shares
+ * are only meaningful if the hogs compete for the same cpus: pin the
+ * whole run to one cpu with -a, or start many more hogs than cpus.
+ *
+ * The report prints a log2 histogram of the wakeup latencies, the cpu
+ * time of each hog with the ratio to its fair share, and Jain's fairness
+ * index over those ratios (1.0 is perfectly fair, 1/hogs is worst).
+ *
+ * Build with: gcc -O2 -Wall -o sched-bench Documentation/sched-bench.c -lrt
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_TASKS	256
+#define NR_BUCKETS	32	/* log2 of the latency in usecs */
+
+/*
+ * This must match prio_to_weight[] in kernel/sched.c
+ */
+static const int prio_to_weight[40] = {
+ /* -20 */     88761,     71755,     56483,     46273,     36291,
+ /* -15 */     29154,     23254,     18705,     14949,     11916,
+ /* -10 */      9548,      7620,      6100,      4904,      3906,
+ /*  -5 */      3121,      2501,      1991,      1586,      1277,
+ /*   0 */      1024,       820,       655,       526,       423,
+ /*   5 */       335,       272,       215,       172,       137,
+ /*  10 */       110,        87,        70,        56,        45,
+ /*  15 */        36,        29,        23,        18,        15,
+};
+
+struct latency {
+	unsigned long count;
+	uint64_t min, max, total;
+	unsigned long buckets[NR_BUCKETS];
+};
+
+struct hog {
+	pid_t pid;
+	int nice;
+	uint64_t cpu_ns;
+};
+
+static struct hog hogs[MAX_TASKS];
+static pid_t sleepers[MAX_TASKS];
+static int pipes[MAX_TASKS];
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void account(struct latency *l, uint64_t nsecs)
+{
+	uint64_t usecs = nsecs / 1000;
+	int b = 0;
+
+	while (usecs && b < NR_BUCKETS - 1) {
+		usecs >>= 1;
+		b++;
+	}
+
+	if (!l->count || nsecs < l->min)
+		l->min = nsecs;
+	if (nsecs > l->max)
+		l->max = nsecs;
+	l->total += nsecs;
+	l->count++;
+	l->buckets[b]++;
+}
+
+static void pin(int cpu)
+{
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		perror("sched_setaffinity");
+		exit(1);
+	}
+}
+
+static void run_hog(int nice_level)
+{
+	volatile unsigned long loops = 0;
+
+	if (nice_level && setpriority(PRIO_PROCESS, 0, nice_level) < 0)
+		perror("setpriority");
+	for (;;)
+		loops++;
+}
+
+static void run_sleeper(int fd, struct latency *l)
+{
+	uint64_t stamp;
+
+	while (read(fd, &stamp, sizeof(stamp)) == sizeof(stamp))
+		account(l, now_ns() - stamp);
+	exit(0);
+}
+
+static void print_latency(struct latency *l)
+{
+	unsigned long max = 0;
+	int i, first = -1, last = 0;
+
+	printf("wakeups: %lu", l->count);
+	if (!l->count) {
+		printf("\n\n");
+		return;
+	}
+	printf(", latency min %llu avg %llu max %llu usecs\n",
+	       (unsigned long long) l->min / 1000,
+	       (unsigned long long) (l->total / l->count) / 1000,
+	       (unsigned long long) l->max / 1000);
+
+	for (i = 0; i < NR_BUCKETS; i++) {
+		if (!l->buckets[i])
+			continue;
+		if (first < 0)
+			first = i;
+		last = i;
+		if (l->buckets[i] > max)
+			max = l->buckets[i];
+	}
+
+	for (i = first; i <= last; i++) {
+		int j, stars = (int) ((l->buckets[i] * 50) / max);
+
+		printf("  < %10lu usecs %10lu |", 1UL << i, l->buckets[i]);
+		for (j = 0; j < stars; j++)
+			putchar('*');
+		putchar('\n');
+	}
+	putchar('\n');
+}
+
+static void print_fairness(int nr_hogs)
+{
+	uint64_t total = 0, weights = 0;
+	double sum = 0, sum_sq = 0;
+	int i;
+
+	if (!nr_hogs)
+		return;
+
+	for (i = 0; i < nr_hogs; i++) {
+		total += hogs[i].cpu_ns;
+		weights += prio_to_weight[hogs[i].nice + 20];
+	}
+
+	printf("hogs: %d, cpu time %llu msecs\n", nr_hogs,
+	       (unsigned long long) total / 1000000);
+	for (i = 0; i < nr_hogs; i++) {
+		double fair = (double) total *
+			      prio_to_weight[hogs[i].nice + 20] / weights;
+		double ratio = fair ? hogs[i].cpu_ns / fair : 0;
+
+		printf("  hog %3d nice %3d %10llu msecs, %6.3f of fair share\n",
+		       i, hogs[i].nice,
+		       (unsigned long long) hogs[i].cpu_ns / 1000000, ratio);
+		sum += ratio;
+		sum_sq += ratio * ratio;
+	}
+	if (sum_sq)
+		printf("fairness index %.4f\n", sum * sum / (nr_hogs * sum_sq));
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-t <seconds>] [-h <hogs>] [-n <nice>] "
+		"[-l <sleepers>] [-i <interval ms>] [-a <cpu>]\n", prog);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int c, i, seconds = 10, nr_hogs = 4, nice_level = 0;
+	int nr_sleepers = 1, interval = 10, cpu = -1;
+	struct latency *lat, total;
+	struct timespec next;
+	uint64_t end;
+
+	while ((c = getopt(argc, argv, "t:h:n:l:i:a:")) != -1) {
+		switch (c) {
+		case 't':
+			seconds = atoi(optarg);
+			break;
+		case 'h':
+			nr_hogs = atoi(optarg);
+			break;
+		case 'n':
+			nice_level = atoi(optarg);
+			break;
+		case 'l':
+			nr_sleepers = atoi(optarg);
+			break;
+		case 'i':
+			interval = atoi(optarg);
+			break;
+		case 'a':
+			cpu = atoi(optarg);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (seconds <= 0 || interval <= 0 ||
+	    nr_hogs < 0 || nr_hogs > MAX_TASKS ||
+	    nr_sleepers < 0 || nr_sleepers > MAX_TASKS ||
+	    nice_level < -20 || nice_level > 19)
+		usage(argv[0]);
+
+	/*
+	 * one histogram per sleeper, merged at the end
+	 */
+	lat = mmap(NULL, (nr_sleepers + 1) * sizeof(*lat),
+		   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (lat == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	memset(lat, 0, nr_sleepers * sizeof(*lat));
+
+	pin(cpu);
+
+	for (i = 0; i < nr_sleepers; i++) {
+		int fds[2], j;
+
+		if (pipe(fds) < 0) {
+			perror("pipe");
+			goto kill;
+		}
+		sleepers[i] = fork();
+		if (sleepers[i] < 0) {
+			perror("fork");
+			goto kill;
+		}
+		if (!sleepers[i]) {
+			/*
+			 * drop the write ends of the other sleepers, or they
+			 * would never see the end of their pipes
+			 */
+			for (j = 0; j < i; j++)
+				close(pipes[j]);
+			close(fds[1]);
+			run_sleeper(fds[0], &lat[i]);
+		}
+		close(fds[0]);
+		pipes[i] = fds[1];
+	}
+
+	for (i = 0; i < nr_hogs; i++) {
+		hogs[i].nice = (i & 1) ? nice_level : 0;
+		hogs[i].pid = fork();
+		if (hogs[i].pid < 0) {
+			perror("fork");
+			goto kill;
+		}
+		if (!hogs[i].pid)
+			run_hog(hogs[i].nice);
+	}
+
+	end = now_ns() + (uint64_t) seconds * 1000000000ULL;
+	clock_gettime(CLOCK_MONOTONIC, &next);
+	while (now_ns() < end) {
+		next.tv_nsec += interval * 1000000L;
+		while (next.tv_nsec >= 1000000000L) {
+			next.tv_nsec -= 1000000000L;
+			next.tv_sec++;
+		}
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next,
+				       NULL) == EINTR)
+			;
+
+		for (i = 0; i < nr_sleepers; i++) {
+			uint64_t stamp = now_ns();
+
+			if (write(pipes[i], &stamp, sizeof(stamp)) !=
+			    sizeof(stamp)) {
+				perror("write");
+				goto kill;
+			}
+		}
+	}
+
+kill:
+	for (i = 0; i < nr_hogs && hogs[i].pid > 0; i++)
+		kill(hogs[i].pid, SIGKILL);
+	for (i = 0; i < nr_hogs && hogs[i].pid > 0; i++) {
+		struct rusage ru;
+
+		if (wait4(hogs[i].pid, NULL, 0, &ru) < 0)
+			continue;
+		hogs[i].cpu_ns =
+			(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) *
+				1000000000ULL +
+			(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ULL;
+	}
+
+	/*
+	 * a sleeper exits when it sees the end of its pipe
+	 */
+	for (i = 0; i < nr_sleepers && sleepers[i] > 0; i++) {
+		close(pipes[i]);
+		waitpid(sleepers[i], NULL, 0);
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < nr_sleepers; i++) {
+		int b;
+
+		if (!lat[i].count)
+			continue;
+		if (!total.count || lat[i].min < total.min)
+			total.min = lat[i].min;
+		if (lat[i].max > total.max)
+			total.max = lat[i].max;
+		total.total += lat[i].total;
+		total.count += lat[i].count;
+		for (b = 0; b < NR_BUCKETS; b++)
+			total.buckets[b] += lat[i].buckets[b];
+	}
+
+	print_latency(&total);
+	print_fairness(nr_hogs);
+	return 0;
+}
@@ -476,6 +476,11 @@ void nmi_watchdog_tick (struct pt_regs * regs, unsigned reason)
 		__get_cpu_var(nmi_touch) = 0;
 		touched = 1;
 	}
+#ifdef CONFIG_NO_HZ
+	/* An idle cpu with its tick stopped takes no timer interrupts */
+	if (cpu_isset(smp_processor_id(), nohz_cpu_mask))
+		touched = 1;
+#endif
 	if (!touched && __get_cpu_var(last_irq_sum) == sum) {
 		/*
 		 * Ayiee, looks like this CPU is stuck ...
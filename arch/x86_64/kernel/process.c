@@ -37,6 +37,7 @@
 #include <linux/random.h>
 #include <linux/kprobes.h>
 #include <linux/notifier.h>
+#include <linux/tick.h>
 
 #include <asm/uaccess.h>
 #include <asm/pgtable.h>
@@ -226,11 +227,13 @@ void cpu_idle (void)
 				idle = default_idle;
 			if (cpu_is_offline(smp_processor_id()))
 				play_dead();
+			tick_nohz_stop_sched_tick();
 			enter_idle();
 			idle();
 			__exit_idle();
 		}
 
+		tick_nohz_restart_sched_tick();
 		preempt_enable_no_resched();
 		schedule();
 		preempt_disable();
@@ -26,6 +26,7 @@
 #include <linux/bcd.h>
 #include <linux/kallsyms.h>
 #include <linux/acpi.h>
+#include <linux/clocksource.h>
 #ifdef CONFIG_ACPI
 #include <acpi/achware.h>	/* for PM timer frequency */
 #endif
@@ -45,6 +46,7 @@
 #ifdef CONFIG_CPU_FREQ
 static void cpufreq_delayed_get(void);
 #endif
+static struct clocksource clocksource_tsc;
 extern void i8254_timer_resume(void);
 extern int using_apic_timer;
 
@@ -79,107 +81,6 @@ static inline void rdtscll_sync(unsigned long *tsc)
 	rdtscll(*tsc);
 }
 
-/*
- * do_gettimeoffset() returns microseconds since last timer interrupt was
- * triggered by hardware. A memory read of HPET is slower than a register read
- * of TSC, but much more reliable. It's also synchronized to the timer
- * interrupt. Note that do_gettimeoffset() may return more than hpet_tick, if a
- * timer interrupt has happened already, but vxtime.trigger wasn't updated yet.
- * This is not a problem, because jiffies hasn't updated either. They are bound
- * together by xtime_lock.
- */
-
-static inline unsigned int do_gettimeoffset_tsc(void)
-{
-	unsigned long t;
-	unsigned long x;
-	rdtscll_sync(&t);
-	if (t < vxtime.last_tsc) t = vxtime.last_tsc; /* hack */
-	x = ((t - vxtime.last_tsc) * vxtime.tsc_quot) >> 32;
-	return x;
-}
-
-static inline unsigned int do_gettimeoffset_hpet(void)
-{
-	/* cap counter read to one tick to avoid inconsistencies */
-	unsigned long counter = hpet_readl(HPET_COUNTER) - vxtime.last;
-	return (min(counter,hpet_tick) * vxtime.quot) >> 32;
-}
-
-unsigned int (*do_gettimeoffset)(void) = do_gettimeoffset_tsc;
-
-/*
- * This version of gettimeofday() has microsecond resolution and better than
- * microsecond precision, as we're using at least a 10 MHz (usually 14.31818
- * MHz) HPET timer.
- */
-
-void do_gettimeofday(struct timeval *tv)
-{
-	unsigned long seq, t;
- 	unsigned int sec, usec;
-
-	do {
-		seq = read_seqbegin(&xtime_lock);
-
-		sec = xtime.tv_sec;
-		usec = xtime.tv_nsec / 1000;
-
-		/* i386 does some correction here to keep the clock 
-		   monotonous even when ntpd is fixing drift.
-		   But they didn't work for me, there is a non monotonic
-		   clock anyways with ntp.
-		   I dropped all corrections now until a real solution can
-		   be found. Note when you fix it here you need to do the same
-		   in arch/x86_64/kernel/vsyscall.c and export all needed
-		   variables in vmlinux.lds. -AK */ 
-
-		t = (jiffies - wall_jiffies) * (1000000L / HZ) +
-			do_gettimeoffset();
-		usec += t;
-
-	} while (read_seqretry(&xtime_lock, seq));
-
-	tv->tv_sec = sec + usec / 1000000;
-	tv->tv_usec = usec % 1000000;
-}
-
-EXPORT_SYMBOL(do_gettimeofday);
-
-/*
- * settimeofday() first undoes the correction that gettimeofday would do
- * on the time, and then saves it. This is ugly, but has been like this for
- * ages already.
- */
-
-int do_settimeofday(struct timespec *tv)
-{
-	time_t wtm_sec, sec = tv->tv_sec;
-	long wtm_nsec, nsec = tv->tv_nsec;
-
-	if ((unsigned long)tv->tv_nsec >= NSEC_PER_SEC)
-		return -EINVAL;
-
-	write_seqlock_irq(&xtime_lock);
-
-	nsec -= do_gettimeoffset() * 1000 +
-		(jiffies - wall_jiffies) * (NSEC_PER_SEC/HZ);
-
-	wtm_sec  = wall_to_monotonic.tv_sec + (xtime.tv_sec - sec);
-	wtm_nsec = wall_to_monotonic.tv_nsec + (xtime.tv_nsec - nsec);
-
-	set_normalized_timespec(&xtime, sec, nsec);
-	set_normalized_timespec(&wall_to_monotonic, wtm_sec, wtm_nsec);
-
-	ntp_clear();
-
-	write_sequnlock_irq(&xtime_lock);
-	clock_was_set();
-	return 0;
-}
-
-EXPORT_SYMBOL(do_settimeofday);
-
 unsigned long profile_pc(struct pt_regs *regs)
 {
 	unsigned long pc = instruction_pointer(regs);
@@ -340,7 +241,7 @@ static noinline void handle_lost_ticks(int lost, struct pt_regs *regs)
 		    printk(KERN_WARNING "Falling back to HPET\n");
 		    vxtime.last = hpet_readl(HPET_T0_CMP) - hpet_tick;
 		    vxtime.mode = VXTIME_HPET;
-		    do_gettimeoffset = do_gettimeoffset_hpet;
+		    clocksource_change_rating(&clocksource_tsc, 0);
 	    }
 	    /* else should fall back to PIT, but code missing. */
 	    warned = 1;
@@ -438,17 +339,15 @@ static irqreturn_t timer_interrupt(int irq, void *dev_id, struct pt_regs *regs)
  */
 
 	do_timer(regs);
-#ifndef CONFIG_SMP
-	update_process_times(user_mode(regs));
-#endif
 
 /*
- * In the SMP case we use the local APIC timer interrupt to do the profiling,
- * except when we simulate SMP mode on a uniprocessor system, in that case we
- * have to call the local interrupt handler.
+ * The per cpu tick (process accounting and profiling) is driven by the
+ * local APIC timers through the clock event layer. When they are not
+ * in use, we have to call the local interrupt handler.
  */
 
 #ifndef CONFIG_X86_LOCAL_APIC
+	update_process_times(user_mode(regs));
 	profile_tick(CPU_PROFILING, regs);
 #else
 	if (!using_apic_timer)
@@ -652,8 +551,11 @@ static int time_cpufreq_notifier(struct notifier_block *nb, unsigned long val,
 		cpufreq_scale(loops_per_jiffy_ref, ref_freq, freq->new);
 
 		cpu_khz = cpufreq_scale(cpu_khz_ref, ref_freq, freq->new);
-		if (!(freq->flags & CPUFREQ_CONST_LOOPS))
+		if (!(freq->flags & CPUFREQ_CONST_LOOPS)) {
 			vxtime.tsc_quot = (1000L << 32) / cpu_khz;
+			/* The TSC no longer runs at a known rate */
+			clocksource_change_rating(&clocksource_tsc, 0);
+		}
 	}
 	
 	set_cyc2ns_scale(cpu_khz_ref);
@@ -949,6 +851,110 @@ void __init time_init(void)
 #endif
 }
 
+/*
+ * Clocksources for the generic timekeeping code. The TSC is the
+ * fastest to read and is used when it is synchronized over all CPUs
+ * and runs at a constant rate; the HPET and the PIT (or the PM timer)
+ * are the fallbacks. The TSC and HPET ones can be read from the
+ * vsyscall page, see vsyscall.c.
+ */
+static cycle_t read_tsc(void)
+{
+	unsigned long ret;
+
+	rdtscll_sync(&ret);
+	/*
+	 * The TSCs of the cpus might be a little bit off, do not go
+	 * back behind the last wall time update:
+	 */
+	return (cycle_t)ret < clocksource_tsc.cycle_last ?
+		clocksource_tsc.cycle_last : (cycle_t)ret;
+}
+
+static cycle_t __vsyscall_fn vread_tsc(void)
+{
+	cycle_t ret;
+
+	sync_core();
+	rdtscll(ret);
+	return ret;
+}
+
+static struct clocksource clocksource_tsc = {
+	.name		= "tsc",
+	.rating		= 300,
+	.read		= read_tsc,
+	.mask		= CLOCKSOURCE_MASK(64),
+	.shift		= 22,
+	.is_continuous	= 1,
+	.vread		= vread_tsc,
+};
+
+static void __init init_tsc_clocksource(void)
+{
+	clocksource_tsc.mult = clocksource_khz2mult(cpu_khz,
+						    clocksource_tsc.shift);
+	clocksource_register(&clocksource_tsc);
+}
+
+static cycle_t read_hpet(void)
+{
+	return (cycle_t)hpet_readl(HPET_COUNTER);
+}
+
+static cycle_t __vsyscall_fn vread_hpet(void)
+{
+	return readl((void __iomem *)fix_to_virt(VSYSCALL_HPET) + 0xf0);
+}
+
+static struct clocksource clocksource_hpet = {
+	.name		= "hpet",
+	.rating		= 250,
+	.read		= read_hpet,
+	.mask		= CLOCKSOURCE_MASK(32),
+	.shift		= 20,
+	.is_continuous	= 1,
+	.vread		= vread_hpet,
+};
+
+static void __init init_hpet_clocksource(void)
+{
+	clocksource_hpet.mult = clocksource_hz2mult(vxtime_hz,
+						    clocksource_hpet.shift);
+	clocksource_register(&clocksource_hpet);
+}
+
+/*
+ * The PIT counts down from LATCH once per tick, extend it with jiffies.
+ * It is only good enough for interpolating between two ticks, so it is
+ * not continuous.
+ */
+static cycle_t read_pit(void)
+{
+	unsigned long flags;
+	unsigned long j;
+	int count;
+
+	spin_lock_irqsave(&i8253_lock, flags);
+	outb_p(0x00, 0x43);
+	count = inb_p(0x40);
+	count |= inb_p(0x40) << 8;
+	j = jiffies;
+	spin_unlock_irqrestore(&i8253_lock, flags);
+
+	count = LATCH - 1 - count;
+	return (cycle_t)(j * LATCH) + count;
+}
+
+static struct clocksource clocksource_pit = {
+	.name		= "pit",
+	.rating		= 110,
+	.read		= read_pit,
+	.mask		= CLOCKSOURCE_MASK(64),
+	.shift		= 20,
+	.is_continuous	= 0,
+};
+
 /*
  * Make an educated guess if the TSC is trustworthy and synchronized
  * over all CPUs.
@@ -980,16 +986,12 @@ void __init time_init_gtod(void)
 		timetype = hpet_use_timer ? "HPET" : "PIT/HPET";
 		vxtime.last = hpet_readl(HPET_T0_CMP) - hpet_tick;
 		vxtime.mode = VXTIME_HPET;
-		do_gettimeoffset = do_gettimeoffset_hpet;
 #ifdef CONFIG_X86_PM_TIMER
 	/* Using PM for gettimeofday is quite slow, but we have no other
 	   choice because the TSC is too unreliable on some systems. */
 	} else if (pmtmr_ioport && !vxtime.hpet_address && notsc) {
 		timetype = "PM";
-		do_gettimeoffset = do_gettimeoffset_pm;
 		vxtime.mode = VXTIME_PMTMR;
-		sysctl_vsyscall = 0;
-		printk(KERN_INFO "Disabling vsyscall due to use of PM timer\n");
 #endif
 	} else {
 		timetype = hpet_use_timer ? "HPET/TSC" : "PIT/TSC";
@@ -997,6 +999,20 @@ void __init time_init_gtod(void)
 	}
 
 	printk(KERN_INFO "time.c: Using %s based timekeeping.\n", timetype);
+
+	/*
+	 * The clocksource code picks the best rated of them; the PM
+	 * timer registers itself in drivers/clocksource/acpi_pm.c.
+	 */
+	if (!notsc)
+		init_tsc_clocksource();
+	if (vxtime.hpet_address)
+		init_hpet_clocksource();
+	else {
+		clocksource_pit.mult = clocksource_hz2mult(PIT_TICK_RATE,
+							   clocksource_pit.shift);
+		clocksource_register(&clocksource_pit);
+	}
 }
 
 __setup("report_lost_ticks", time_setup);
@@ -26,6 +26,7 @@
 #include <linux/seqlock.h>
 #include <linux/jiffies.h>
 #include <linux/sysctl.h>
+#include <linux/clocksource.h>
 
 #include <asm/vsyscall.h>
 #include <asm/pgtable.h>
@@ -40,6 +41,31 @@
 int __sysctl_vsyscall __section_sysctl_vsyscall = 1;
 seqlock_t __xtime_lock __section_xtime_lock = SEQLOCK_UNLOCKED;
 
+/*
+ * The clocksource state gettimeofday() needs, copied over by
+ * update_vsyscall() on every wall time update. Protected by xtime_lock
+ * like xtime itself.
+ */
+struct vsyscall_gtod_data_t {
+	cycle_t (*vread)(void);
+	cycle_t cycle_last;
+	cycle_t mask;
+	u32 mult;
+	u32 shift;
+};
+
+struct vsyscall_gtod_data_t __vsyscall_gtod_data __section_vsyscall_gtod_data;
+
+void update_vsyscall(struct timespec *wall_time, struct clocksource *clock)
+{
+	/* Called with xtime_lock held for writing */
+	vsyscall_gtod_data.vread = clock->vread;
+	vsyscall_gtod_data.cycle_last = clock->cycle_last;
+	vsyscall_gtod_data.mask = clock->mask;
+	vsyscall_gtod_data.mult = clock->mult;
+	vsyscall_gtod_data.shift = clock->shift;
+}
+
 #include <asm/unistd.h>
 
 static force_inline void timeval_normalize(struct timeval * tv)
@@ -53,36 +79,6 @@ static force_inline void timeval_normalize(struct timeval * tv)
 	}
 }
 
-static force_inline void do_vgettimeofday(struct timeval * tv)
-{
-	long sequence, t;
-	unsigned long sec, usec;
-
-	do {
-		sequence = read_seqbegin(&__xtime_lock);
-		
-		sec = __xtime.tv_sec;
-		usec = (__xtime.tv_nsec / 1000) +
-			(__jiffies - __wall_jiffies) * (1000000 / HZ);
-
-		if (__vxtime.mode != VXTIME_HPET) {
-			sync_core();
-			rdtscll(t);
-			if (t < __vxtime.last_tsc)
-				t = __vxtime.last_tsc;
-			usec += ((t - __vxtime.last_tsc) *
-				 __vxtime.tsc_quot) >> 32;
-			/* See comment in x86_64 do_gettimeofday. */
-		} else {
-			usec += ((readl((void *)fix_to_virt(VSYSCALL_HPET) + 0xf0) -
-				  __vxtime.last) * __vxtime.quot) >> 32;
-		}
-	} while (read_seqretry(&__xtime_lock, sequence));
-
-	tv->tv_sec = sec + usec / 1000000;
-	tv->tv_usec = usec % 1000000;
-}
-
 /* RED-PEN may want to readd seq locking, but then the variable should be write-once. */
 static force_inline void do_get_tz(struct timezone * tz)
 {
@@ -107,12 +103,66 @@ static force_inline long time_syscall(long *t)
 	return secs;
 }
 
+/*
+ * Not patched by the vsyscall64 sysctl, for clocksources which can
+ * not be read from user space.
+ */
+static force_inline int gettimeofday_fallback(struct timeval *tv)
+{
+	int ret;
+	asm volatile("syscall"
+		: "=a" (ret)
+		: "0" (__NR_gettimeofday),"D" (tv),"S" (NULL) : __syscall_clobber );
+	return ret;
+}
+
+static force_inline int do_vgettimeofday(struct timeval * tv)
+{
+	cycle_t (*vread)(void);
+	cycle_t now, base, mask, cycle_delta;
+	unsigned long sequence, mult, shift, nsec;
+	time_t sec;
+
+	do {
+		sequence = read_seqbegin(&__xtime_lock);
+
+		vread = __vsyscall_gtod_data.vread;
+		if (unlikely(!vread))
+			return gettimeofday_fallback(tv);
+
+		now = vread();
+		base = __vsyscall_gtod_data.cycle_last;
+		mask = __vsyscall_gtod_data.mask;
+		mult = __vsyscall_gtod_data.mult;
+		shift = __vsyscall_gtod_data.shift;
+
+		sec = __xtime.tv_sec;
+		nsec = __xtime.tv_nsec;
+	} while (read_seqretry(&__xtime_lock, sequence));
+
+	/* calculate interval: */
+	cycle_delta = (now - base) & mask;
+	/* convert to nsecs: */
+	nsec += (cycle_delta * mult) >> shift;
+
+	while (nsec >= NSEC_PER_SEC) {
+		sec += 1;
+		nsec -= NSEC_PER_SEC;
+	}
+	tv->tv_sec = sec;
+	tv->tv_usec = nsec / NSEC_PER_USEC;
+	return 0;
+}
+
 int __vsyscall(0) vgettimeofday(struct timeval * tv, struct timezone * tz)
 {
 	if (unlikely(!__sysctl_vsyscall))
 		return gettimeofday(tv,tz);
-	if (tv)
-		do_vgettimeofday(tv);
+	if (tv) {
+		int ret = do_vgettimeofday(tv);
+		if (unlikely(ret))
+			return ret;
+	}
 	if (tz)
 		do_get_tz(tz);
 	return 0;
@@ -0,0 +1,505 @@
+/*
+ * Multi-queue block layer
+ *
+ * Fast devices with several hardware submission queues are limited by
+ * the single q->queue_lock which __make_request and the io schedulers
+ * serialize on.  In multi-queue mode every cpu gets its own software
+ * queue (struct blk_mq_ctx), and each software queue is mapped to one of
+ * the hardware dispatch queues of the device (struct blk_mq_hw_ctx).
+ * Each hardware queue owns a preallocated pool of requests, indexed by a
+ * tag which is allocated from a bitmap without taking any lock.  There is
+ * no merging, no io scheduler and no plugging: a request is built from
+ * the bio and handed to the driver right away.
+ */
+#include <linux/config.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/blk-mq.h>
+#include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/percpu.h>
+#include <linux/writeback.h>
+#include <linux/blktrace_api.h>
+
+#include "blk.h"
+
+/*
+ * Grab a free tag.  find_first_zero_bit() is only a hint, the bit is ours
+ * once test_and_set_bit() says so.  Returns -1 if the queue is full.
+ */
+static int blk_mq_get_tag(struct blk_mq_hw_ctx *hctx)
+{
+	unsigned int depth = hctx->queue_depth;
+	int tag;
+
+	do {
+		tag = find_first_zero_bit(hctx->tag_map, depth);
+		if (tag >= depth)
+			return -1;
+	} while (test_and_set_bit(tag, hctx->tag_map));
+
+	return tag;
+}
+
+static void blk_mq_put_tag(struct blk_mq_hw_ctx *hctx, int tag)
+{
+	clear_bit(tag, hctx->tag_map);
+	smp_mb__after_clear_bit();
+	if (waitqueue_active(&hctx->tag_wait))
+		wake_up(&hctx->tag_wait);
+}
+
+/*
+ * Get a request from the pool of the hardware queue that @ctx maps to,
+ * sleeping until one is freed if the pool is empty.  Like
+ * get_request_wait() this can not fail.
+ */
+static struct request *blk_mq_get_request(request_queue_t *q,
+					  struct blk_mq_ctx *ctx, int rw)
+{
+	struct blk_mq_hw_ctx *hctx = ctx->hctx;
+	struct request *rq;
+	int tag;
+
+	tag = blk_mq_get_tag(hctx);
+	if (unlikely(tag < 0)) {
+		DEFINE_WAIT(wait);
+
+		for (;;) {
+			prepare_to_wait_exclusive(&hctx->tag_wait, &wait,
+						  TASK_UNINTERRUPTIBLE);
+			tag = blk_mq_get_tag(hctx);
+			if (tag >= 0)
+				break;
+			io_schedule();
+		}
+		finish_wait(&hctx->tag_wait, &wait);
+	}
+
+	rq = hctx->rqs[tag];
+	rq_init(q, rq);
+	rq->flags = rw;
+	rq->tag = tag;
+	rq->mq_ctx = ctx;
+	return rq;
+}
+
+static void blk_mq_free_request(struct request *rq)
+{
+	struct blk_mq_hw_ctx *hctx = rq->mq_ctx->hctx;
+
+	rq->rq_status = RQ_INACTIVE;
+	rq->bio = rq->biotail = NULL;
+	blk_mq_put_tag(hctx, rq->tag);
+}
+
+/**
+ * blk_mq_end_io - end I/O on a multi-queue request
+ * @rq:       the request being completed
+ * @error:    0 for success, < 0 for an error
+ *
+ * Description:
+ *     Ends all I/O on @rq and gives its tag back to the hardware queue.
+ *     Unlike end_that_request_last() no lock needs to be held.
+ **/
+void blk_mq_end_io(struct request *rq, int error)
+{
+	struct blk_mq_hw_ctx *hctx = rq->mq_ctx->hctx;
+	struct gendisk *disk = rq->rq_disk;
+
+	if (end_that_request_chunk(rq, error ? error : 1, rq->hard_nr_sectors << 9))
+		printk(KERN_ERR "blk-mq: request not completed, tag %d\n",
+		       rq->tag);
+
+	if (unlikely(laptop_mode) && blk_fs_request(rq))
+		laptop_io_completion();
+
+	if (disk && blk_fs_request(rq)) {
+		unsigned long duration = jiffies - rq->start_time;
+		const int rw = rq_data_dir(rq);
+
+		disk_stat_inc(disk, ios[rw]);
+		disk_stat_add(disk, ticks[rw], duration);
+	}
+
+	blk_mq_free_request(rq);
+
+	/*
+	 * the driver bounced requests because it was out of resources,
+	 * now that one has completed try them again.  Pairs with the
+	 * nr_active check in __blk_mq_run_hw_queue(): atomic_dec_return()
+	 * orders the decrement before the list_empty() test.
+	 */
+	atomic_dec_return(&hctx->nr_active);
+	if (!list_empty(&hctx->dispatch))
+		kblockd_schedule_work(&hctx->run_work);
+}
+
+EXPORT_SYMBOL(blk_mq_end_io);
+
+/*
+ * Pull the requests off the software queues mapped to @hctx and start
+ * them.  Requests the driver can't take yet are parked on hctx->dispatch
+ * and go first on the next run.
+ */
+static void __blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	request_queue_t *q = hctx->queue;
+	struct request *rq;
+	LIST_HEAD(rq_list);
+	int bit;
+
+	if (unlikely(test_bit(BLK_MQ_S_STOPPED, &hctx->state)))
+		return;
+
+	if (!list_empty(&hctx->dispatch)) {
+		spin_lock(&hctx->lock);
+		list_splice_init(&hctx->dispatch, &rq_list);
+		spin_unlock(&hctx->lock);
+	}
+
+	for (bit = find_first_bit(hctx->ctx_map, hctx->nr_ctx);
+	     bit < hctx->nr_ctx;
+	     bit = find_next_bit(hctx->ctx_map, hctx->nr_ctx, bit + 1)) {
+		struct blk_mq_ctx *ctx = hctx->ctxs[bit];
+
+		clear_bit(bit, hctx->ctx_map);
+		spin_lock(&ctx->lock);
+		list_splice_init(&ctx->rq_list, rq_list.prev);
+		spin_unlock(&ctx->lock);
+	}
+
+	while (!list_empty(&rq_list)) {
+		int ret;
+
+		rq = list_entry_rq(rq_list.next);
+		list_del_init(&rq->queuelist);
+
+		blk_add_trace_rq(q, rq, BLK_TA_ISSUE);
+		atomic_inc(&hctx->nr_active);
+		ret = q->mq_ops->queue_rq(hctx, rq);
+		if (ret == BLK_MQ_RQ_QUEUE_OK)
+			continue;
+		if (ret == BLK_MQ_RQ_QUEUE_BUSY) {
+			atomic_dec(&hctx->nr_active);
+			list_add(&rq->queuelist, &rq_list);
+			break;
+		}
+
+		printk(KERN_ERR "blk-mq: bad return %d on queue %u\n", ret,
+		       hctx->queue_num);
+		blk_mq_end_io(rq, -EIO);
+	}
+
+	if (!list_empty(&rq_list)) {
+		spin_lock(&hctx->lock);
+		list_splice(&rq_list, &hctx->dispatch);
+		spin_unlock(&hctx->lock);
+
+		/*
+		 * If the last request in flight completed before the
+		 * requests above were parked, blk_mq_end_io() found
+		 * hctx->dispatch empty and nobody will restart the queue.
+		 * Do it ourselves.
+		 */
+		smp_mb();
+		if (!atomic_read(&hctx->nr_active))
+			kblockd_schedule_work(&hctx->run_work);
+	}
+}
+
+static void blk_mq_run_work_fn(void *data)
+{
+	__blk_mq_run_hw_queue(data);
+}
+
+/**
+ * blk_mq_run_hw_queue - start the pending requests of a hardware queue
+ * @hctx:     the hardware queue
+ * @async:    punt the work to kblockd
+ *
+ * Description:
+ *     Must be called from process context unless @async is set.
+ **/
+void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *hctx, int async)
+{
+	if (unlikely(test_bit(BLK_MQ_S_STOPPED, &hctx->state)))
+		return;
+
+	if (async)
+		kblockd_schedule_work(&hctx->run_work);
+	else
+		__blk_mq_run_hw_queue(hctx);
+}
+
+EXPORT_SYMBOL(blk_mq_run_hw_queue);
+
+void blk_mq_run_queues(request_queue_t *q, int async)
+{
+	unsigned int i;
+
+	for (i = 0; i < q->nr_hw_queues; i++)
+		blk_mq_run_hw_queue(q->queue_hw_ctx[i], async);
+}
+
+EXPORT_SYMBOL(blk_mq_run_queues);
+
+/**
+ * blk_mq_stop_hw_queue - stop feeding requests to a hardware queue
+ * @hctx:     the hardware queue
+ *
+ * Description:
+ *     Like blk_stop_queue(), for a driver that has run out of resources
+ *     on one of its queues.  Restart it with blk_mq_start_hw_queue().
+ **/
+void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	set_bit(BLK_MQ_S_STOPPED, &hctx->state);
+}
+
+EXPORT_SYMBOL(blk_mq_stop_hw_queue);
+
+/**
+ * blk_mq_start_hw_queue - restart a stopped hardware queue
+ * @hctx:     the hardware queue
+ *
+ * Description:
+ *     May be called from interrupt context, the queue is run by kblockd.
+ **/
+void blk_mq_start_hw_queue(struct blk_mq_hw_ctx *hctx)
+{
+	clear_bit(BLK_MQ_S_STOPPED, &hctx->state);
+	kblockd_schedule_work(&hctx->run_work);
+}
+
+EXPORT_SYMBOL(blk_mq_start_hw_queue);
+
+static int blk_mq_make_request(request_queue_t *q, struct bio *bio)
+{
+	const int rw = bio_data_dir(bio);
+	struct blk_mq_ctx *ctx;
+	struct blk_mq_hw_ctx *hctx;
+	struct request *rq;
+
+	blk_queue_bounce(q, &bio);
+
+	/*
+	 * nothing orders requests between the hardware queues
+	 */
+	if (unlikely(bio_barrier(bio))) {
+		bio_endio(bio, bio->bi_size, -EOPNOTSUPP);
+		return 0;
+	}
+
+	ctx = per_cpu_ptr(q->queue_ctx, get_cpu());
+	put_cpu();
+	hctx = ctx->hctx;
+
+	rq = blk_mq_get_request(q, ctx, rw);
+	init_request_from_bio(rq, bio);
+
+	spin_lock(&ctx->lock);
+	list_add_tail(&rq->queuelist, &ctx->rq_list);
+	spin_unlock(&ctx->lock);
+	set_bit(ctx->index_hw, hctx->ctx_map);
+
+	__blk_mq_run_hw_queue(hctx);
+	return 0;
+}
+
+static void blk_mq_unplug(request_queue_t *q)
+{
+	blk_mq_run_queues(q, 1);
+}
+
+/**
+ * blk_mq_map_queue - default cpu to hardware queue mapping
+ * @q:        the request queue
+ * @cpu:      the submitting cpu
+ *
+ * Description:
+ *     Neighbouring cpus share a hardware queue, drivers with no better
+ *     idea should use this as their ->map_queue.
+ **/
+struct blk_mq_hw_ctx *blk_mq_map_queue(request_queue_t *q, int cpu)
+{
+	return q->queue_hw_ctx[q->mq_map[cpu]];
+}
+
+EXPORT_SYMBOL(blk_mq_map_queue);
+
+static void blk_mq_update_map(request_queue_t *q)
+{
+	unsigned int nr_cpus = num_possible_cpus(), i = 0;
+	int cpu;
+
+	for_each_cpu(cpu) {
+		q->mq_map[cpu] = (i * q->nr_hw_queues) / nr_cpus;
+		i++;
+	}
+}
+
+static struct blk_mq_hw_ctx *blk_mq_alloc_hctx(request_queue_t *q,
+					       struct blk_mq_reg *reg,
+					       unsigned int index)
+{
+	struct blk_mq_hw_ctx *hctx;
+	unsigned int i;
+
+	hctx = kmalloc_node(sizeof(*hctx), GFP_KERNEL, reg->numa_node);
+	if (!hctx)
+		return NULL;
+
+	memset(hctx, 0, sizeof(*hctx));
+	spin_lock_init(&hctx->lock);
+	INIT_LIST_HEAD(&hctx->dispatch);
+	hctx->queue = q;
+	hctx->queue_num = index;
+	cpus_clear(hctx->cpumask);
+	init_waitqueue_head(&hctx->tag_wait);
+	INIT_WORK(&hctx->run_work, blk_mq_run_work_fn, hctx);
+
+	hctx->ctxs = kzalloc(NR_CPUS * sizeof(struct blk_mq_ctx *), GFP_KERNEL);
+	hctx->ctx_map = kzalloc(BITS_TO_LONGS(NR_CPUS) * sizeof(long),
+				GFP_KERNEL);
+	hctx->tag_map = kzalloc(BITS_TO_LONGS(reg->queue_depth) * sizeof(long),
+				GFP_KERNEL);
+	hctx->rqs = kzalloc(reg->queue_depth * sizeof(struct request *),
+			    GFP_KERNEL);
+	if (!hctx->ctxs || !hctx->ctx_map || !hctx->tag_map || !hctx->rqs)
+		return hctx;
+
+	for (i = 0; i < reg->queue_depth; i++) {
+		struct request *rq;
+
+		rq = kmalloc_node(sizeof(*rq), GFP_KERNEL, reg->numa_node);
+		if (!rq)
+			return hctx;
+		memset(rq, 0, sizeof(*rq));
+		rq->q = q;
+		rq->tag = i;
+		rq->rq_status = RQ_INACTIVE;
+		hctx->rqs[i] = rq;
+		hctx->queue_depth++;
+	}
+
+	return hctx;
+}
+
+static void blk_mq_free_hctx(struct blk_mq_hw_ctx *hctx)
+{
+	unsigned int i;
+
+	for (i = 0; i < hctx->queue_depth; i++)
+		kfree(hctx->rqs[i]);
+
+	kfree(hctx->rqs);
+	kfree(hctx->tag_map);
+	kfree(hctx->ctx_map);
+	kfree(hctx->ctxs);
+	kfree(hctx);
+}
+
+/*
+ * called from blk_cleanup_queue() once the last reference is gone, also
+ * tears down a partially set up queue
+ */
+void blk_mq_free_queue(request_queue_t *q)
+{
+	unsigned int i;
+
+	if (q->queue_hw_ctx) {
+		for (i = 0; i < q->nr_hw_queues; i++)
+			if (q->queue_hw_ctx[i])
+				blk_mq_free_hctx(q->queue_hw_ctx[i]);
+		kfree(q->queue_hw_ctx);
+	}
+
+	if (q->queue_ctx)
+		free_percpu(q->queue_ctx);
+
+	kfree(q->mq_map);
+}
+
+/**
+ * blk_mq_init_queue - prepare a multi-queue request queue
+ * @reg:         number and depth of the hardware queues, driver operations
+ * @driver_data: stored in ->queuedata and in every hardware queue
+ *
+ * Description:
+ *     The multi-queue counterpart of blk_init_queue().  The driver is
+ *     handed fully built requests through ->queue_rq() on its hardware
+ *     queues, with rq->tag already allocated from the queue's pool, and
+ *     completes them with blk_mq_end_io().  Release the queue with
+ *     blk_cleanup_queue().
+ **/
+request_queue_t *blk_mq_init_queue(struct blk_mq_reg *reg, void *driver_data)
+{
+	struct blk_mq_hw_ctx *hctx;
+	request_queue_t *q;
+	unsigned int i;
+	int cpu;
+
+	if (!reg->nr_hw_queues || !reg->ops->queue_rq || !reg->ops->map_queue)
+		return NULL;
+	if (!reg->queue_depth || reg->queue_depth > BLK_MQ_MAX_DEPTH)
+		return NULL;
+
+	q = blk_alloc_queue_node(GFP_KERNEL, reg->numa_node);
+	if (!q)
+		return NULL;
+
+	q->mq_ops = reg->ops;
+	q->nr_hw_queues = reg->nr_hw_queues;
+	q->queue_ctx = alloc_percpu(struct blk_mq_ctx);
+	q->queue_hw_ctx = kzalloc(reg->nr_hw_queues * sizeof(hctx), GFP_KERNEL);
+	q->mq_map = kzalloc(NR_CPUS * sizeof(unsigned int), GFP_KERNEL);
+	if (!q->queue_ctx || !q->queue_hw_ctx || !q->mq_map)
+		goto out;
+
+	blk_mq_update_map(q);
+
+	for (i = 0; i < reg->nr_hw_queues; i++) {
+		hctx = blk_mq_alloc_hctx(q, reg, i);
+		if (!hctx)
+			goto out;
+		q->queue_hw_ctx[i] = hctx;
+		if (hctx->queue_depth != reg->queue_depth)
+			goto out;
+
+		hctx->driver_data = driver_data;
+		if (reg->ops->init_hctx &&
+		    reg->ops->init_hctx(hctx, driver_data, i))
+			goto out;
+	}
+
+	for_each_cpu(cpu) {
+		struct blk_mq_ctx *ctx = per_cpu_ptr(q->queue_ctx, cpu);
+
+		spin_lock_init(&ctx->lock);
+		INIT_LIST_HEAD(&ctx->rq_list);
+		ctx->cpu = cpu;
+
+		hctx = q->mq_ops->map_queue(q, cpu);
+		cpu_set(cpu, hctx->cpumask);
+		ctx->hctx = hctx;
+		ctx->index_hw = hctx->nr_ctx;
+		hctx->ctxs[hctx->nr_ctx++] = ctx;
+	}
+
+	blk_queue_make_request(q, blk_mq_make_request);
+	q->unplug_fn = blk_mq_unplug;
+	q->queuedata = driver_data;
+
+	spin_lock_init(&q->__queue_lock);
+	q->queue_lock = &q->__queue_lock;
+
+	return q;
+out:
+	blk_cleanup_queue(q);
+	return NULL;
+}
+
+EXPORT_SYMBOL(blk_mq_init_queue);
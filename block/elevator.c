@@ -33,6 +33,7 @@
 #include <linux/init.h>
 #include <linux/compiler.h>
 #include <linux/delay.h>
+#include <linux/blktrace_api.h>
 
 #include <asm/uaccess.h>
 
@@ -303,6 +304,7 @@ void elv_requeue_request(request_queue_t *q, struct request *rq)
 
 	rq->flags &= ~REQ_STARTED;
 
+	blk_add_trace_rq(q, rq, BLK_TA_REQUEUE);
 	__elv_add_request(q, rq, ELEVATOR_INSERT_REQUEUE, 0);
 }
 
@@ -326,6 +328,8 @@ void __elv_add_request(request_queue_t *q, struct request *rq, int where,
 	struct list_head *pos;
 	unsigned ordseq;
 
+	blk_add_trace_rq(q, rq, BLK_TA_INSERT);
+
 	if (q->ordcolor)
 		rq->flags |= REQ_ORDERED_COLOR;
 
@@ -484,6 +488,7 @@ struct request *elv_next_request(request_queue_t *q)
 			 * not be passed by new incoming requests
 			 */
 			rq->flags |= REQ_STARTED;
+			blk_add_trace_rq(q, rq, BLK_TA_ISSUE);
 		}
 
 		if (!q->boundary_rq || q->boundary_rq == rq) {
@@ -201,6 +201,8 @@ void add_disk(struct gendisk *disk)
 			    disk->minors, NULL, exact_match, exact_lock, disk);
 	register_disk(disk);
 	blk_register_queue(disk);
+	if (disk->queue)
+		bdi_register(&disk->queue->backing_dev_info, disk->disk_name);
 }
 
 EXPORT_SYMBOL(add_disk);
@@ -208,6 +210,8 @@ EXPORT_SYMBOL(del_gendisk);	/* in partitions/check.c */
 
 void unlink_gendisk(struct gendisk *disk)
 {
+	if (disk->queue)
+		bdi_unregister(&disk->queue->backing_dev_info);
 	blk_unregister_queue(disk);
 	blk_unregister_region(MKDEV(disk->major, disk->first_minor),
 			      disk->minors);
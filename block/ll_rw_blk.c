@@ -28,16 +28,18 @@
 #include <linux/writeback.h>
 #include <linux/interrupt.h>
 #include <linux/cpu.h>
+#include <linux/blktrace_api.h>
 
 /*
  * for max sense size
  */
 #include <scsi/scsi_cmnd.h>
 
+#include "blk.h"
+
 static void blk_unplug_work(void *data);
 static void blk_unplug_timeout(unsigned long data);
 static void drive_stat_acct(struct request *rq, int nr_sectors, int new_io);
-static void init_request_from_bio(struct request *req, struct bio *bio);
 static int __make_request(request_queue_t *q, struct bio *bio);
 
 /*
@@ -70,7 +72,17 @@ unsigned long blk_max_low_pfn, blk_max_pfn;
 EXPORT_SYMBOL(blk_max_low_pfn);
 EXPORT_SYMBOL(blk_max_pfn);
 
-static DEFINE_PER_CPU(struct list_head, blk_cpu_done);
+/*
+ * Requests completed through blk_complete_request().  The lock is only
+ * needed because other cpus queue completions here for requests that
+ * were submitted on this cpu.
+ */
+struct blk_done_queue {
+	spinlock_t		lock;
+	struct list_head	list;
+};
+
+static DEFINE_PER_CPU(struct blk_done_queue, blk_cpu_done);
 
 /* Amount of time in which a process may batch requests */
 #define BLK_BATCH_TIME	(HZ/50UL)
@@ -277,29 +289,6 @@ void blk_queue_make_request(request_queue_t * q, make_request_fn * mfn)
 
 EXPORT_SYMBOL(blk_queue_make_request);
 
-static inline void rq_init(request_queue_t *q, struct request *rq)
-{
-	INIT_LIST_HEAD(&rq->queuelist);
-	INIT_LIST_HEAD(&rq->donelist);
-
-	rq->errors = 0;
-	rq->rq_status = RQ_ACTIVE;
-	rq->bio = rq->biotail = NULL;
-	rq->ioprio = 0;
-	rq->buffer = NULL;
-	rq->ref_count = 1;
-	rq->q = q;
-	rq->waiting = NULL;
-	rq->special = NULL;
-	rq->data_len = 0;
-	rq->data = NULL;
-	rq->nr_phys_segments = 0;
-	rq->sense = NULL;
-	rq->end_io = NULL;
-	rq->end_io_data = NULL;
-	rq->completion_data = NULL;
-}
-
 /**
  * blk_queue_ordered - does this queue support ordered writes
  * @q:        the request queue
@@ -1555,8 +1544,10 @@ void blk_plug_device(request_queue_t *q)
 	if (test_bit(QUEUE_FLAG_STOPPED, &q->queue_flags))
 		return;
 
-	if (!test_and_set_bit(QUEUE_FLAG_PLUGGED, &q->queue_flags))
+	if (!test_and_set_bit(QUEUE_FLAG_PLUGGED, &q->queue_flags)) {
 		mod_timer(&q->unplug_timer, jiffies + q->unplug_delay);
+		blk_add_trace_generic(q, NULL, 0, BLK_TA_PLUG);
+	}
 }
 
 EXPORT_SYMBOL(blk_plug_device);
@@ -1620,14 +1611,21 @@ static void blk_backing_dev_unplug(struct backing_dev_info *bdi,
 	/*
 	 * devices don't necessarily have an ->unplug_fn defined
 	 */
-	if (q->unplug_fn)
+	if (q->unplug_fn) {
+		blk_add_trace_pdu_int(q, BLK_TA_UNPLUG_IO, NULL,
+					q->rq.count[READ] + q->rq.count[WRITE]);
+
 		q->unplug_fn(q);
+	}
 }
 
 static void blk_unplug_work(void *data)
 {
 	request_queue_t *q = data;
 
+	blk_add_trace_pdu_int(q, BLK_TA_UNPLUG_IO, NULL,
+				q->rq.count[READ] + q->rq.count[WRITE]);
+
 	q->unplug_fn(q);
 }
 
@@ -1635,6 +1633,9 @@ static void blk_unplug_timeout(unsigned long data)
 {
 	request_queue_t *q = (request_queue_t *)data;
 
+	blk_add_trace_pdu_int(q, BLK_TA_UNPLUG_TIMER, NULL,
+				q->rq.count[READ] + q->rq.count[WRITE]);
+
 	kblockd_schedule_work(&q->unplug_work);
 }
 
@@ -1757,6 +1758,11 @@ void blk_cleanup_queue(request_queue_t * q)
 	if (q->queue_tags)
 		__blk_queue_free_tags(q);
 
+	if (q->mq_ops)
+		blk_mq_free_queue(q);
+
+	blk_trace_shutdown(q);
+
 	kmem_cache_free(requestq_cachep, q);
 }
 
@@ -2108,6 +2114,7 @@ rq_starved:
 	
 	rq_init(q, rq);
 	rq->rl = rl;
+	blk_add_trace_generic(q, bio, rw, BLK_TA_GETRQ);
 out:
 	return rq;
 }
@@ -2136,6 +2143,8 @@ static struct request *get_request_wait(request_queue_t *q, int rw,
 		if (!rq) {
 			struct io_context *ioc;
 
+			blk_add_trace_generic(q, bio, rw, BLK_TA_SLEEPRQ);
+
 			__generic_unplug_device(q);
 			spin_unlock_irq(q->queue_lock);
 			io_schedule();
@@ -2747,7 +2756,7 @@ static inline int attempt_front_merge(request_queue_t *q, struct request *rq)
 	return 0;
 }
 
-static void init_request_from_bio(struct request *req, struct bio *bio)
+void init_request_from_bio(struct request *req, struct bio *bio)
 {
 	req->flags |= REQ_CMD;
 
@@ -2775,6 +2784,7 @@ static void init_request_from_bio(struct request *req, struct bio *bio)
 	req->ioprio = bio_prio(bio);
 	req->rq_disk = bio->bi_bdev->bd_disk;
 	req->start_time = jiffies;
+	req->cpu = raw_smp_processor_id();
 }
 
 static int __make_request(request_queue_t *q, struct bio *bio)
@@ -2825,6 +2835,7 @@ static int __make_request(request_queue_t *q, struct bio *bio)
 			req->nr_sectors = req->hard_nr_sectors += nr_sectors;
 			req->ioprio = ioprio_best(req->ioprio, prio);
 			drive_stat_acct(req, nr_sectors, 0);
+			blk_add_trace_bio(q, bio, BLK_TA_BACKMERGE);
 			if (!attempt_back_merge(q, req))
 				elv_merged_request(q, req);
 			goto out;
@@ -2850,6 +2861,7 @@ static int __make_request(request_queue_t *q, struct bio *bio)
 			req->nr_sectors = req->hard_nr_sectors += nr_sectors;
 			req->ioprio = ioprio_best(req->ioprio, prio);
 			drive_stat_acct(req, nr_sectors, 0);
+			blk_add_trace_bio(q, bio, BLK_TA_FRONTMERGE);
 			if (!attempt_front_merge(q, req))
 				elv_merged_request(q, req);
 			goto out;
@@ -2980,6 +2992,8 @@ void generic_make_request(struct bio *bio)
 	 */
 	do {
 		char b[BDEVNAME_SIZE];
+		sector_t old_sector;
+		dev_t old_dev;
 
 		q = bdev_get_queue(bio->bi_bdev);
 		if (!q) {
@@ -3008,8 +3022,17 @@ end_io:
 		 * If this device has partitions, remap block n
 		 * of partition p to block n+start(p) of the disk.
 		 */
+		old_sector = bio->bi_sector;
+		old_dev = bio->bi_bdev->bd_dev;
+
 		blk_partition_remap(bio);
 
+		if (old_dev != bio->bi_bdev->bd_dev)
+			blk_add_trace_remap(q, bio, old_dev, bio->bi_sector,
+					    old_sector);
+
+		blk_add_trace_bio(q, bio, BLK_TA_QUEUE);
+
 		ret = q->make_request_fn(q, bio);
 	} while (ret);
 }
@@ -3129,6 +3152,8 @@ static int __end_that_request_first(struct request *req, int uptodate,
 	int total_bytes, bio_nbytes, error, next_idx = 0;
 	struct bio *bio;
 
+	blk_add_trace_rq(req->q, req, BLK_TA_COMPLETE);
+
 	/*
 	 * extend uptodate bool to allow < 0 value to be direct io error
 	 */
@@ -3280,12 +3305,14 @@ EXPORT_SYMBOL(end_that_request_chunk);
  */
 static void blk_done_softirq(struct softirq_action *h)
 {
-	struct list_head *cpu_list;
+	struct blk_done_queue *done;
 	LIST_HEAD(local_list);
 
 	local_irq_disable();
-	cpu_list = &__get_cpu_var(blk_cpu_done);
-	list_splice_init(cpu_list, &local_list);
+	done = &__get_cpu_var(blk_cpu_done);
+	spin_lock(&done->lock);
+	list_splice_init(&done->list, &local_list);
+	spin_unlock(&done->lock);
 	local_irq_enable();
 
 	while (!list_empty(&local_list)) {
@@ -3307,10 +3334,16 @@ static int blk_cpu_notify(struct notifier_block *self, unsigned long action,
 	 */
 	if (action == CPU_DEAD) {
 		int cpu = (unsigned long) hcpu;
+		struct blk_done_queue *dead = &per_cpu(blk_cpu_done, cpu);
+		struct blk_done_queue *done;
 
 		local_irq_disable();
-		list_splice_init(&per_cpu(blk_cpu_done, cpu),
-				 &__get_cpu_var(blk_cpu_done));
+		done = &__get_cpu_var(blk_cpu_done);
+		spin_lock(&dead->lock);
+		spin_lock(&done->lock);
+		list_splice_init(&dead->list, &done->list);
+		spin_unlock(&done->lock);
+		spin_unlock(&dead->lock);
 		raise_softirq_irqoff(BLOCK_SOFTIRQ);
 		local_irq_enable();
 	}
@@ -3335,20 +3368,35 @@ static struct notifier_block __devinitdata blk_cpu_notifier = {
  *     through requeueing. Theh actual completion happens out-of-order,
  *     through a softirq handler. The user must have registered a completion
  *     callback through blk_queue_softirq_done().
+ *
+ *     If the queue has rq_affinity set, the softirq runs on the cpu that
+ *     submitted the request, where the bios and their waiters are still
+ *     cache hot, rather than on the cpu that took the interrupt.
+ *     No IPI kicks the softirq over there: a busy submitting cpu only
+ *     picks the request up at its next softirq run, up to a tick later,
+ *     which is why rq_affinity is off by default.
  **/
 
 void blk_complete_request(struct request *req)
 {
-	struct list_head *cpu_list;
+	struct blk_done_queue *done;
 	unsigned long flags;
+	int cpu;
 
 	BUG_ON(!req->q->softirq_done_fn);
 		
 	local_irq_save(flags);
 
-	cpu_list = &__get_cpu_var(blk_cpu_done);
-	list_add_tail(&req->donelist, cpu_list);
-	raise_softirq_irqoff(BLOCK_SOFTIRQ);
+	cpu = smp_processor_id();
+	if (blk_queue_same_comp(req->q) && req->cpu >= 0 &&
+	    req->cpu != cpu && cpu_online(req->cpu))
+		cpu = req->cpu;
+
+	done = &per_cpu(blk_cpu_done, cpu);
+	spin_lock(&done->lock);
+	list_add_tail(&req->donelist, &done->list);
+	spin_unlock(&done->lock);
+	raise_softirq_on_cpu(cpu, BLOCK_SOFTIRQ);
 
 	local_irq_restore(flags);
 }
@@ -3448,8 +3496,10 @@ int __init blk_dev_init(void)
 	iocontext_cachep = kmem_cache_create("blkdev_ioc",
 			sizeof(struct io_context), 0, SLAB_PANIC, NULL, NULL);
 
-	for (i = 0; i < NR_CPUS; i++)
-		INIT_LIST_HEAD(&per_cpu(blk_cpu_done, i));
+	for (i = 0; i < NR_CPUS; i++) {
+		spin_lock_init(&per_cpu(blk_cpu_done, i).lock);
+		INIT_LIST_HEAD(&per_cpu(blk_cpu_done, i).list);
+	}
 
 	open_softirq(BLOCK_SOFTIRQ, blk_done_softirq, NULL);
 #ifdef CONFIG_HOTPLUG_CPU
@@ -3709,6 +3759,40 @@ static ssize_t queue_max_hw_sectors_show(struct request_queue *q, char *page)
 	return queue_var_show(max_hw_sectors_kb, (page));
 }
 
+static ssize_t queue_dirty_show(struct request_queue *q, char *page)
+{
+	unsigned long dirty = bdi_stat(&q->backing_dev_info, BDI_RECLAIMABLE);
+
+	return queue_var_show(dirty << (PAGE_CACHE_SHIFT - 10), (page));
+}
+
+static ssize_t queue_writeback_show(struct request_queue *q, char *page)
+{
+	unsigned long wb = bdi_stat(&q->backing_dev_info, BDI_WRITEBACK);
+
+	return queue_var_show(wb << (PAGE_CACHE_SHIFT - 10), (page));
+}
+
+static ssize_t queue_rq_affinity_show(struct request_queue *q, char *page)
+{
+	return queue_var_show(blk_queue_same_comp(q), (page));
+}
+
+static ssize_t
+queue_rq_affinity_store(struct request_queue *q, const char *page, size_t count)
+{
+	unsigned long val;
+	ssize_t ret = queue_var_store(&val, page, count);
+
+	spin_lock_irq(q->queue_lock);
+	if (val)
+		set_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags);
+	else
+		clear_bit(QUEUE_FLAG_SAME_COMP, &q->queue_flags);
+	spin_unlock_irq(q->queue_lock);
+
+	return ret;
+}
 
 static struct queue_sysfs_entry queue_requests_entry = {
 	.attr = {.name = "nr_requests", .mode = S_IRUGO | S_IWUSR },
@@ -3733,6 +3817,22 @@ static struct queue_sysfs_entry queue_max_hw_sectors_entry = {
 	.show = queue_max_hw_sectors_show,
 };
 
+static struct queue_sysfs_entry queue_dirty_entry = {
+	.attr = {.name = "dirty_kb", .mode = S_IRUGO },
+	.show = queue_dirty_show,
+};
+
+static struct queue_sysfs_entry queue_writeback_entry = {
+	.attr = {.name = "writeback_kb", .mode = S_IRUGO },
+	.show = queue_writeback_show,
+};
+
+static struct queue_sysfs_entry queue_rq_affinity_entry = {
+	.attr = {.name = "rq_affinity", .mode = S_IRUGO | S_IWUSR },
+	.show = queue_rq_affinity_show,
+	.store = queue_rq_affinity_store,
+};
+
 static struct queue_sysfs_entry queue_iosched_entry = {
 	.attr = {.name = "scheduler", .mode = S_IRUGO | S_IWUSR },
 	.show = elv_iosched_show,
@@ -3744,6 +3844,9 @@ static struct attribute *default_attrs[] = {
 	&queue_ra_entry.attr,
 	&queue_max_hw_sectors_entry.attr,
 	&queue_max_sectors_entry.attr,
+	&queue_dirty_entry.attr,
+	&queue_writeback_entry.attr,
+	&queue_rq_affinity_entry.attr,
 	&queue_iosched_entry.attr,
 	NULL,
 };
@@ -0,0 +1,525 @@
+/*
+ * zram.c - compressed RAM block device.
+ *
+ * Each page written to a zram device is compressed and kept in memory,
+ * and decompressed again when it is read back.  It is meant as a swap
+ * device: swapping to it costs a compression instead of disk I/O, and
+ * the memory given up is only what the pages compress to.
+ *
+ * The driver has the shape of rd.c, with a make_request function doing
+ * all the work, but does not go through the page cache.  A table with
+ * a slot for every page of the device points at the compressed data,
+ * which lives in slab caches with a size class every ZRAM_CLASS_SIZE
+ * bytes, so that it is packed far tighter than kmalloc's power of two
+ * sizes would.  Pages which do not compress well enough are kept as
+ * they are, and pages of zeroes take no memory at all.
+ *
+ * The capacity of a device is what it appears to hold; the memory it
+ * may use is limited separately, by mem_limit, and writes fail once
+ * that is reached.  Statistics are in /sys/block/zram<n>/.
+ *
+ * Only whole, aligned pages can be read or written, which is all swap
+ * ever does.
+ */
+
+#include <linux/config.h>
+#include <linux/string.h>
+#include <linux/slab.h>
+#include <linux/bio.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/init.h>
+#include <linux/devfs_fs_kernel.h>
+#include <linux/highmem.h>
+#include <linux/blkdev.h>
+#include <linux/genhd.h>
+#include <linux/mutex.h>
+#include <linux/vmalloc.h>
+#include <linux/crypto.h>
+#include <linux/swap.h>
+
+#define ZRAM_SECTORS_PER_PAGE	(PAGE_SIZE >> 9)
+
+/* Compressed data is kept in caches of ZRAM_CLASS_SIZE steps */
+#define ZRAM_CLASS_SIZE		256
+/* Pages which compress to more than this are kept uncompressed */
+#define ZRAM_MAX_COMPRESSED	(PAGE_SIZE / 4 * 3)
+#define ZRAM_NR_CLASSES		(ZRAM_MAX_COMPRESSED / ZRAM_CLASS_SIZE)
+
+/* Slot flags */
+#define ZRAM_ZERO		0x01	/* page of zeroes, nothing stored */
+#define ZRAM_UNCOMPRESSED	0x02	/* handle is a struct page */
+
+struct zram_slot {
+	void *handle;
+	unsigned short size;		/* compressed size */
+	unsigned char flags;
+};
+
+struct zram {
+	struct mutex lock;		/* serializes all I/O */
+	struct zram_slot *table;
+	unsigned long nr_pages;
+	struct crypto_tfm *tfm;
+	void *buffer;			/* compression output */
+	struct request_queue *queue;
+	struct gendisk *disk;
+
+	/* Statistics */
+	unsigned long num_reads;
+	unsigned long num_writes;
+	unsigned long failed_writes;
+	unsigned long pages_stored;	/* pages holding data, bar zeroes */
+	unsigned long pages_zero;
+	unsigned long pages_uncompressed;
+	unsigned long compr_data_size;	/* bytes the pages compressed to */
+	unsigned long mem_used;		/* bytes taken to store them */
+};
+
+static int zram_major;
+static struct zram *zram_devices;
+static kmem_cache_t *zram_caches[ZRAM_NR_CLASSES];
+
+static int zram_num_devices = 1;
+static unsigned long zram_disksize;	/* in kB, 0 for a quarter of RAM */
+static unsigned long zram_mem_limit;	/* in kB, 0 for half the disk size */
+static char *zram_compressor = "deflate";
+
+static inline int zram_class(unsigned int size)
+{
+	return (size - 1) / ZRAM_CLASS_SIZE;
+}
+
+static inline unsigned int zram_class_size(int class)
+{
+	return (class + 1) * ZRAM_CLASS_SIZE;
+}
+
+static inline unsigned long zram_limit_bytes(struct zram *zram)
+{
+	if (zram_mem_limit)
+		return zram_mem_limit << 10;
+	return zram->nr_pages << (PAGE_SHIFT - 1);
+}
+
+static int page_zero_filled(void *ptr)
+{
+	unsigned long *page = ptr;
+	unsigned int pos;
+
+	for (pos = 0; pos < PAGE_SIZE / sizeof(*page); pos++)
+		if (page[pos])
+			return 0;
+	return 1;
+}
+
+/* Memory the data of a slot takes */
+static unsigned int zram_slot_mem(struct zram_slot *slot)
+{
+	if (slot->flags & ZRAM_ZERO)
+		return 0;
+	if (slot->flags & ZRAM_UNCOMPRESSED)
+		return PAGE_SIZE;
+	return zram_class_size(zram_class(slot->size));
+}
+
+static void zram_free_slot(struct zram *zram, struct zram_slot *slot)
+{
+	if (slot->flags & ZRAM_ZERO) {
+		zram->pages_zero--;
+	} else if (slot->handle) {
+		zram->mem_used -= zram_slot_mem(slot);
+		zram->compr_data_size -= slot->size;
+		zram->pages_stored--;
+		if (slot->flags & ZRAM_UNCOMPRESSED) {
+			__free_page(slot->handle);
+			zram->pages_uncompressed--;
+		} else
+			kmem_cache_free(zram_caches[zram_class(slot->size)],
+					slot->handle);
+	}
+	slot->handle = NULL;
+	slot->size = 0;
+	slot->flags = 0;
+}
+
+static int zram_read(struct zram *zram, struct page *page, unsigned long index)
+{
+	struct zram_slot *slot = &zram->table[index];
+	unsigned int dlen = PAGE_SIZE;
+	void *dst, *src;
+	int err = 0;
+
+	zram->num_reads++;
+
+	/* Never written pages read as zeroes, like a fresh rd.c disk */
+	if (!slot->handle) {
+		dst = kmap_atomic(page, KM_USER0);
+		memset(dst, 0, PAGE_SIZE);
+		kunmap_atomic(dst, KM_USER0);
+		goto out;
+	}
+
+	dst = kmap_atomic(page, KM_USER0);
+	if (slot->flags & ZRAM_UNCOMPRESSED) {
+		src = kmap_atomic(slot->handle, KM_USER1);
+		memcpy(dst, src, PAGE_SIZE);
+		kunmap_atomic(src, KM_USER1);
+	} else {
+		err = crypto_comp_decompress(zram->tfm, slot->handle,
+					     slot->size, dst, &dlen);
+		if (!err && dlen != PAGE_SIZE)
+			err = -EIO;
+	}
+	kunmap_atomic(dst, KM_USER0);
+
+	if (err)
+		printk(KERN_ERR "zram: cannot decompress page %lu\n", index);
+out:
+	flush_dcache_page(page);
+	return err;
+}
+
+static int zram_write(struct zram *zram, struct page *page, unsigned long index)
+{
+	struct zram_slot *slot = &zram->table[index];
+	unsigned int clen = PAGE_SIZE;
+	unsigned int mem;
+	void *src, *handle;
+	int zero, err;
+
+	zram->num_writes++;
+
+	src = kmap_atomic(page, KM_USER0);
+	zero = page_zero_filled(src);
+	err = zero ? 0 : crypto_comp_compress(zram->tfm, src, PAGE_SIZE,
+					      zram->buffer, &clen);
+	kunmap_atomic(src, KM_USER0);
+
+	if (zero) {
+		zram_free_slot(zram, slot);
+		slot->flags = ZRAM_ZERO;
+		zram->pages_zero++;
+		return 0;
+	}
+
+	/* A compressor may fail when the output would not fit */
+	if (err || clen > ZRAM_MAX_COMPRESSED)
+		clen = PAGE_SIZE;
+
+	mem = clen == PAGE_SIZE ? PAGE_SIZE : zram_class_size(zram_class(clen));
+	if (zram->mem_used - zram_slot_mem(slot) + mem > zram_limit_bytes(zram))
+		goto fail;
+
+	if (clen == PAGE_SIZE) {
+		struct page *store = alloc_page(GFP_NOIO | __GFP_HIGHMEM);
+		void *dst;
+
+		if (!store)
+			goto fail;
+		src = kmap_atomic(page, KM_USER0);
+		dst = kmap_atomic(store, KM_USER1);
+		memcpy(dst, src, PAGE_SIZE);
+		kunmap_atomic(dst, KM_USER1);
+		kunmap_atomic(src, KM_USER0);
+		handle = store;
+	} else {
+		handle = kmem_cache_alloc(zram_caches[zram_class(clen)],
+					  GFP_NOIO);
+		if (!handle)
+			goto fail;
+		memcpy(handle, zram->buffer, clen);
+	}
+
+	zram_free_slot(zram, slot);
+	slot->handle = handle;
+	slot->size = clen;
+	if (clen == PAGE_SIZE) {
+		slot->flags = ZRAM_UNCOMPRESSED;
+		zram->pages_uncompressed++;
+	}
+	zram->pages_stored++;
+	zram->compr_data_size += clen;
+	zram->mem_used += mem;
+	return 0;
+
+fail:
+	zram->failed_writes++;
+	return -ENOSPC;
+}
+
+static int zram_make_request(request_queue_t *q, struct bio *bio)
+{
+	struct zram *zram = q->queuedata;
+	sector_t sector = bio->bi_sector;
+	int rw = bio_data_dir(bio);
+	struct bio_vec *bvec;
+	int ret = 0, i;
+
+	if (sector + (bio->bi_size >> 9) > get_capacity(zram->disk) ||
+	    sector & (ZRAM_SECTORS_PER_PAGE - 1))
+		goto fail;
+
+	mutex_lock(&zram->lock);
+	bio_for_each_segment(bvec, bio, i) {
+		unsigned long index = sector / ZRAM_SECTORS_PER_PAGE;
+
+		if (bvec->bv_len != PAGE_SIZE || bvec->bv_offset) {
+			ret = -EINVAL;
+			break;
+		}
+		if (rw == WRITE)
+			ret = zram_write(zram, bvec->bv_page, index);
+		else
+			ret = zram_read(zram, bvec->bv_page, index);
+		if (ret)
+			break;
+		sector += ZRAM_SECTORS_PER_PAGE;
+	}
+	mutex_unlock(&zram->lock);
+	if (ret)
+		goto fail;
+
+	bio_endio(bio, bio->bi_size, 0);
+	return 0;
+fail:
+	bio_io_error(bio, bio->bi_size);
+	return 0;
+}
+
+static void zram_reset(struct zram *zram)
+{
+	unsigned long index;
+
+	mutex_lock(&zram->lock);
+	for (index = 0; index < zram->nr_pages; index++)
+		zram_free_slot(zram, &zram->table[index]);
+	mutex_unlock(&zram->lock);
+}
+
+static int zram_ioctl(struct inode *inode, struct file *file,
+			unsigned int cmd, unsigned long arg)
+{
+	struct block_device *bdev = inode->i_bdev;
+	int error;
+
+	if (cmd != BLKFLSBUF)
+		return -ENOTTY;
+
+	/* As for rd.c, this releases the memory of the whole device */
+	error = -EBUSY;
+	down(&bdev->bd_sem);
+	if (bdev->bd_openers <= 1) {
+		zram_reset(bdev->bd_disk->private_data);
+		error = 0;
+	}
+	up(&bdev->bd_sem);
+	return error;
+}
+
+static struct block_device_operations zram_fops = {
+	.owner =	THIS_MODULE,
+	.ioctl =	zram_ioctl,
+};
+
+#define ZRAM_ATTR_RO(_name, _fmt, _expr)				\
+static ssize_t zram_##_name##_show(struct gendisk *disk, char *page)	\
+{									\
+	struct zram *zram = disk->private_data;				\
+	return sprintf(page, _fmt "\n", _expr);				\
+}									\
+static struct disk_attribute zram_attr_##_name = {			\
+	.attr = {.name = #_name, .mode = S_IRUGO },			\
+	.show	= zram_##_name##_show					\
+}
+
+ZRAM_ATTR_RO(num_reads, "%lu", zram->num_reads);
+ZRAM_ATTR_RO(num_writes, "%lu", zram->num_writes);
+ZRAM_ATTR_RO(failed_writes, "%lu", zram->failed_writes);
+ZRAM_ATTR_RO(zero_pages, "%lu", zram->pages_zero);
+ZRAM_ATTR_RO(uncompressed_pages, "%lu", zram->pages_uncompressed);
+ZRAM_ATTR_RO(orig_data_size, "%lu", zram->pages_stored << PAGE_SHIFT);
+ZRAM_ATTR_RO(compr_data_size, "%lu", zram->compr_data_size);
+ZRAM_ATTR_RO(mem_used_total, "%lu", zram->mem_used);
+ZRAM_ATTR_RO(mem_limit, "%lu", zram_limit_bytes(zram));
+
+static struct attribute *zram_attrs[] = {
+	&zram_attr_num_reads.attr,
+	&zram_attr_num_writes.attr,
+	&zram_attr_failed_writes.attr,
+	&zram_attr_zero_pages.attr,
+	&zram_attr_uncompressed_pages.attr,
+	&zram_attr_orig_data_size.attr,
+	&zram_attr_compr_data_size.attr,
+	&zram_attr_mem_used_total.attr,
+	&zram_attr_mem_limit.attr,
+	NULL,
+};
+
+static struct attribute_group zram_attr_group = {
+	.attrs = zram_attrs,
+};
+
+static int __init zram_setup(struct zram *zram, int id)
+{
+	struct gendisk *disk;
+
+	mutex_init(&zram->lock);
+	zram->nr_pages = zram_disksize >> (PAGE_SHIFT - 10);
+
+	zram->table = vmalloc(zram->nr_pages * sizeof(struct zram_slot));
+	if (!zram->table)
+		goto out;
+	memset(zram->table, 0, zram->nr_pages * sizeof(struct zram_slot));
+
+	zram->buffer = (void *)__get_free_page(GFP_KERNEL);
+	if (!zram->buffer)
+		goto out_table;
+
+	zram->tfm = crypto_alloc_tfm(zram_compressor, 0);
+	if (!zram->tfm) {
+		printk(KERN_ERR "zram: no %s compressor\n", zram_compressor);
+		goto out_buffer;
+	}
+
+	zram->queue = blk_alloc_queue(GFP_KERNEL);
+	if (!zram->queue)
+		goto out_tfm;
+	zram->queue->queuedata = zram;
+	blk_queue_make_request(zram->queue, zram_make_request);
+	blk_queue_hardsect_size(zram->queue, PAGE_SIZE);
+
+	disk = zram->disk = alloc_disk(1);
+	if (!disk)
+		goto out_queue;
+	disk->major = zram_major;
+	disk->first_minor = id;
+	disk->fops = &zram_fops;
+	disk->queue = zram->queue;
+	disk->private_data = zram;
+	disk->flags |= GENHD_FL_SUPPRESS_PARTITION_INFO;
+	sprintf(disk->disk_name, "zram%d", id);
+	sprintf(disk->devfs_name, "zram/%d", id);
+	set_capacity(disk, zram->nr_pages * ZRAM_SECTORS_PER_PAGE);
+	add_disk(disk);
+
+	if (sysfs_create_group(&disk->kobj, &zram_attr_group))
+		printk(KERN_WARNING "zram: cannot register sysfs files\n");
+	return 0;
+
+out_queue:
+	blk_cleanup_queue(zram->queue);
+out_tfm:
+	crypto_free_tfm(zram->tfm);
+out_buffer:
+	free_page((unsigned long)zram->buffer);
+out_table:
+	vfree(zram->table);
+out:
+	return -ENOMEM;
+}
+
+static void zram_destroy(struct zram *zram)
+{
+	sysfs_remove_group(&zram->disk->kobj, &zram_attr_group);
+	del_gendisk(zram->disk);
+	put_disk(zram->disk);
+	blk_cleanup_queue(zram->queue);
+
+	zram_reset(zram);
+	crypto_free_tfm(zram->tfm);
+	free_page((unsigned long)zram->buffer);
+	vfree(zram->table);
+}
+
+static void zram_destroy_caches(void)
+{
+	int class;
+
+	for (class = 0; class < ZRAM_NR_CLASSES; class++)
+		if (zram_caches[class])
+			kmem_cache_destroy(zram_caches[class]);
+}
+
+static int __init zram_init(void)
+{
+	static char names[ZRAM_NR_CLASSES][16];
+	int class, i;
+	int err = -ENOMEM;
+
+	if (zram_num_devices < 1 || zram_num_devices > 256) {
+		printk(KERN_WARNING "zram: wrong number of devices %d, "
+		       "using 1\n", zram_num_devices);
+		zram_num_devices = 1;
+	}
+	if (!zram_disksize)
+		zram_disksize = totalram_pages << (PAGE_SHIFT - 10 - 2);
+
+	for (class = 0; class < ZRAM_NR_CLASSES; class++) {
+		sprintf(names[class], "zram-%u", zram_class_size(class));
+		zram_caches[class] = kmem_cache_create(names[class],
+				zram_class_size(class), 0, 0, NULL, NULL);
+		if (!zram_caches[class])
+			goto out_caches;
+	}
+
+	zram_devices = kzalloc(zram_num_devices * sizeof(struct zram),
+			       GFP_KERNEL);
+	if (!zram_devices)
+		goto out_caches;
+
+	zram_major = register_blkdev(0, "zram");
+	if (zram_major < 0) {
+		err = zram_major;
+		goto out_devices;
+	}
+	devfs_mk_dir("zram");
+
+	for (i = 0; i < zram_num_devices; i++) {
+		err = zram_setup(&zram_devices[i], i);
+		if (err)
+			goto out_setup;
+	}
+
+	printk(KERN_INFO "zram: %d devices of %luK, compressed with %s\n",
+	       zram_num_devices, zram_disksize, zram_compressor);
+	return 0;
+
+out_setup:
+	while (i--)
+		zram_destroy(&zram_devices[i]);
+	devfs_remove("zram");
+	unregister_blkdev(zram_major, "zram");
+out_devices:
+	kfree(zram_devices);
+out_caches:
+	zram_destroy_caches();
+	return err;
+}
+
+static void __exit zram_exit(void)
+{
+	int i;
+
+	for (i = 0; i < zram_num_devices; i++)
+		zram_destroy(&zram_devices[i]);
+	devfs_remove("zram");
+	unregister_blkdev(zram_major, "zram");
+	kfree(zram_devices);
+	zram_destroy_caches();
+}
+
+module_init(zram_init);
+module_exit(zram_exit);
+
+module_param(zram_num_devices, int, 0);
+MODULE_PARM_DESC(zram_num_devices, "Number of zram devices.");
+module_param(zram_disksize, ulong, 0);
+MODULE_PARM_DESC(zram_disksize, "Size of each zram device in kbytes.");
+module_param(zram_mem_limit, ulong, 0);
+MODULE_PARM_DESC(zram_mem_limit,
+		 "Memory each zram device may use, in kbytes.");
+module_param(zram_compressor, charp, 0);
+MODULE_PARM_DESC(zram_compressor, "Crypto API compressor to use.");
+
+MODULE_LICENSE("GPL");
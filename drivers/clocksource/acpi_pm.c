@@ -0,0 +1,66 @@
+/*
+ * linux/drivers/clocksource/acpi_pm.c
+ *
+ * This file contains the ACPI PM based clocksource.
+ *
+ * This code was largely moved from the x86_64 PM timer code
+ * (arch/x86_64/kernel/pmtimer.c), which in turn comes from the
+ * i386 timer_pm.c:
+ *
+ * (C) Dominik Brodowski <linux@brodo.de> 2003
+ *
+ * The PM timer is a 24 bit counter running at 3.579545 MHz in the
+ * southbridge. It is slow to read, but keeps running at a constant
+ * rate in all C-states and frequencies, so it is a good fallback
+ * when the TSC can not be trusted.
+ *
+ * This file is licensed under the GPL v2.
+ */
+
+#include <linux/clocksource.h>
+#include <linux/errno.h>
+#include <linux/init.h>
+#include <asm/io.h>
+
+/* Number of PMTMR ticks expected during calibration run */
+#define PMTMR_TICKS_PER_SEC 3579545
+
+/*
+ * The I/O port the PMTMR resides at.
+ * The location is detected during setup_arch(),
+ * in arch/i386/kernel/acpi/boot.c
+ */
+extern u32 pmtmr_ioport;
+
+#define ACPI_PM_MASK CLOCKSOURCE_MASK(24) /* limit it to 24 bits */
+
+static cycle_t acpi_pm_read(void)
+{
+	return (cycle_t)(inl(pmtmr_ioport) & ACPI_PM_MASK);
+}
+
+static struct clocksource clocksource_acpi_pm = {
+	.name		= "acpi_pm",
+	.rating		= 200,
+	.read		= acpi_pm_read,
+	.mask		= (cycle_t)ACPI_PM_MASK,
+	.mult		= 0, /* to be calculated */
+	.shift		= 22,
+	.is_continuous	= 1,
+};
+
+static int __init init_acpi_pm_clocksource(void)
+{
+	if (!pmtmr_ioport)
+		return -ENODEV;
+
+	clocksource_acpi_pm.mult = clocksource_hz2mult(PMTMR_TICKS_PER_SEC,
+						clocksource_acpi_pm.shift);
+
+	return clocksource_register(&clocksource_acpi_pm);
+}
+
+/* We use fs_initcall because we want the PCI fixups to have run
+ * but we still need to load before device_initcall
+ */
+fs_initcall(init_acpi_pm_clocksource);
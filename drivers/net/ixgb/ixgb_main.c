@@ -443,7 +443,8 @@ ixgb_probe(struct pci_dev *pdev,
 			   NETIF_F_HW_CSUM |
 			   NETIF_F_HW_VLAN_TX |
 			   NETIF_F_HW_VLAN_RX |
-			   NETIF_F_HW_VLAN_FILTER;
+			   NETIF_F_HW_VLAN_FILTER |
+			   NETIF_F_GRO;
 #ifdef NETIF_F_TSO
 	netdev->features |= NETIF_F_TSO;
 #endif
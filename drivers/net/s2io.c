@@ -6061,6 +6061,7 @@ Defaulting to INTA\n");
 #if defined(CONFIG_S2IO_NAPI)
 	dev->poll = s2io_poll;
 	dev->weight = 32;
+	dev->features |= NETIF_F_GRO;
 #endif
 
 	dev->features |= NETIF_F_SG | NETIF_F_IP_CSUM;
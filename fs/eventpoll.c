@@ -48,19 +48,24 @@
  *
  * 1) epsem (semaphore)
  * 2) ep->sem (rw_semaphore)
- * 3) ep->lock (rw_lock)
+ * 3) ep->lock (spinlock)
  *
  * The acquire order is the one listed above, from 1 to 3.
- * We need a spinlock (ep->lock) because we manipulate objects
- * from inside the poll callback, that might be triggered from
- * a wake_up() that in turn might be called from IRQ context.
- * So we can't sleep inside the poll callback and hence we need
- * a spinlock. During the event transfer loop (from kernel to
+ * The poll callback, that might be triggered from a wake_up() that
+ * in turn might be called from IRQ context, takes no lock at all: it
+ * pushes the item on the "ep->rdchain" lockless stack, so wakeups
+ * coming from many CPUs at the same time do not bounce a lock around.
+ * Only the tasks collecting events move the chain over to the ready
+ * list (ep->rdllist), which is protected by the ep->lock spinlock.
+ * The EPI_QUEUED bit of the item makes sure an item is on at most
+ * one of the chain, the ready list or a transfer list.
+ * During the event transfer loop (from kernel to
  * user space) we could end up sleeping due a copy_to_user(), so
  * we need a lock that will allow us to sleep. This lock is a
  * read-write semaphore (ep->sem). It is acquired on read during
- * the event transfer loop and in write during epoll_ctl(EPOLL_CTL_DEL)
- * and during eventpoll_release_file(). Then we also need a global
+ * the event transfer loop and in write during epoll_ctl() and
+ * during eventpoll_release_file(). It also protects the rb-tree,
+ * which is only changed by epoll_ctl(). Then we also need a global
  * semaphore to serialize eventpoll_release_file() and ep_free().
  * This semaphore is acquired by ep_free() during the epoll file
  * cleanup path and it is also acquired by eventpoll_release_file()
@@ -96,7 +101,7 @@
 #endif /* #if DEBUG_EPI != 0 */
 
 /* Epoll private bits inside the event mask */
-#define EP_PRIVATE_BITS (EPOLLONESHOT | EPOLLET)
+#define EP_PRIVATE_BITS (EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE)
 
 /* Maximum number of poll wake up nests we are allowing */
 #define EP_MAX_POLLWAKE_NESTS 4
@@ -138,8 +143,8 @@ struct poll_safewake {
  * interface.
  */
 struct eventpoll {
-	/* Protect the this structure access */
-	rwlock_t lock;
+	/* Protects the ready list */
+	spinlock_t lock;
 
 	/*
 	 * This semaphore is used to ensure that files are not removed
@@ -158,6 +163,17 @@ struct eventpoll {
 	/* List of ready file descriptors */
 	struct list_head rdllist;
 
+	/*
+	 * Items the poll callback found ready, most recent first. They
+	 * are moved to the ready list by the tasks collecting events.
+	 */
+	struct epitem *rdchain;
+
+#ifndef __HAVE_ARCH_CMPXCHG
+	/* Serializes the ready chain operations without cmpxchg() */
+	spinlock_t chain_lock;
+#endif
+
 	/* RB-Tree root used to store monitored fd structs */
 	struct rb_root rbr;
 };
@@ -188,9 +204,18 @@ struct epitem {
 	/* RB-Tree node used to link this structure to the eventpoll rb-tree */
 	struct rb_node rbn;
 
-	/* List header used to link this structure to the eventpoll ready list */
+	/*
+	 * List header used to link this structure to the eventpoll ready list
+	 * or to the transfer list of a task collecting events.
+	 */
 	struct list_head rdllink;
 
+	/* Link to the next item on the eventpoll ready chain */
+	struct epitem *next;
+
+	/* Item state bits, see EPI_QUEUED */
+	unsigned long state;
+
 	/* The file descriptor information this item refers to */
 	struct epoll_filefd ffd;
 
@@ -214,17 +239,14 @@ struct epitem {
 
 	/* List header used to link this item to the "struct file" items list */
 	struct list_head fllink;
-
-	/* List header used to link the item to the transfer list */
-	struct list_head txlink;
-
-	/*
-	 * This is used during the collection/transfer of events to userspace
-	 * to pin items empty events set.
-	 */
-	unsigned int revents;
 };
 
+/*
+ * The item is queued for event collection: it is on the ready chain, the
+ * ready list or the transfer list of a task collecting events.
+ */
+#define EPI_QUEUED 0
+
 /* Wrapper struct used by poll queueing */
 struct ep_pqueue {
 	poll_table pt;
@@ -255,11 +277,6 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi);
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key);
 static int ep_eventpoll_close(struct inode *inode, struct file *file);
 static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait);
-static int ep_collect_ready_items(struct eventpoll *ep,
-				  struct list_head *txlist, int maxevents);
-static int ep_send_events(struct eventpoll *ep, struct list_head *txlist,
-			  struct epoll_event __user *events);
-static void ep_reinject_items(struct eventpoll *ep, struct list_head *txlist);
 static int ep_events_transfer(struct eventpoll *ep,
 			      struct epoll_event __user *events,
 			      int maxevents);
@@ -387,6 +404,101 @@ static inline int ep_op_hash_event(int op)
 	return op != EPOLL_CTL_DEL;
 }
 
+#ifdef __HAVE_ARCH_CMPXCHG
+static inline void ep_rdchain_push(struct eventpoll *ep, struct epitem *epi)
+{
+	struct epitem *head;
+
+	do {
+		head = ep->rdchain;
+		epi->next = head;
+	} while (cmpxchg(&ep->rdchain, head, epi) != head);
+}
+
+static inline struct epitem *ep_rdchain_take(struct eventpoll *ep)
+{
+	return xchg(&ep->rdchain, NULL);
+}
+#else /* #ifdef __HAVE_ARCH_CMPXCHG */
+static inline void ep_rdchain_push(struct eventpoll *ep, struct epitem *epi)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&ep->chain_lock, flags);
+	epi->next = ep->rdchain;
+	ep->rdchain = epi;
+	spin_unlock_irqrestore(&ep->chain_lock, flags);
+
+	/* Pairs with the wait queue insertion in ep_poll() */
+	smp_mb();
+}
+
+static inline struct epitem *ep_rdchain_take(struct eventpoll *ep)
+{
+	unsigned long flags;
+	struct epitem *epi;
+
+	spin_lock_irqsave(&ep->chain_lock, flags);
+	epi = ep->rdchain;
+	ep->rdchain = NULL;
+	spin_unlock_irqrestore(&ep->chain_lock, flags);
+
+	return epi;
+}
+#endif /* #ifdef __HAVE_ARCH_CMPXCHG */
+
+/*
+ * Queue the item for event collection. Returns zero if it was already
+ * queued, in which case the waiters have already been woken up for it.
+ * Needs no lock, it is called from inside the poll callback.
+ */
+static inline int ep_queue_item(struct eventpoll *ep, struct epitem *epi)
+{
+	if (test_and_set_bit(EPI_QUEUED, &epi->state))
+		return 0;
+	ep_rdchain_push(ep, epi);
+	return 1;
+}
+
+/*
+ * Move the ready chain to the tail of the ready list. The chain is
+ * kept most recent first, so reverse it to deliver the events in the
+ * order they arrived. Must be called with "ep->lock" held.
+ */
+static void ep_rdchain_splice(struct eventpoll *ep)
+{
+	struct list_head *tail = ep->rdllist.prev;
+	struct epitem *epi, *next;
+
+	for (epi = ep_rdchain_take(ep); epi; epi = next) {
+		next = epi->next;
+		list_add(&epi->rdllink, tail);
+	}
+}
+
+/* Tells if there might be events to collect, no locking needed */
+static inline int ep_events_available(struct eventpoll *ep)
+{
+	return !list_empty(&ep->rdllist) || ep->rdchain != NULL;
+}
+
+/*
+ * Wake up ( if active ) both the eventpoll wait list and the ->poll()
+ * wait list. Tasks wait exclusively on the eventpoll wait list: all of
+ * them are woken up if "all" is set, only one of them otherwise.
+ */
+static void ep_wake_up(struct eventpoll *ep, int all)
+{
+	if (waitqueue_active(&ep->wq)) {
+		if (all)
+			wake_up_all(&ep->wq);
+		else
+			wake_up(&ep->wq);
+	}
+	if (waitqueue_active(&ep->poll_wait))
+		ep_poll_safewake(&psw, &ep->poll_wait);
+}
+
 /* Initialize the poll safe wake up structure */
 static void ep_poll_safewake_init(struct poll_safewake *psw)
 {
@@ -789,11 +901,15 @@ static int ep_alloc(struct eventpoll **pep)
 	if (!ep)
 		return -ENOMEM;
 
-	rwlock_init(&ep->lock);
+	spin_lock_init(&ep->lock);
+#ifndef __HAVE_ARCH_CMPXCHG
+	spin_lock_init(&ep->chain_lock);
+#endif
 	init_rwsem(&ep->sem);
 	init_waitqueue_head(&ep->wq);
 	init_waitqueue_head(&ep->poll_wait);
 	INIT_LIST_HEAD(&ep->rdllist);
+	ep->rdchain = NULL;
 	ep->rbr = RB_ROOT;
 
 	*pep = ep;
@@ -850,18 +966,17 @@ static void ep_free(struct eventpoll *ep)
 /*
  * Search the file inside the eventpoll hash. It add usage count to
  * the returned item, so the caller must call ep_release_epitem()
- * after finished using the "struct epitem".
+ * after finished using the "struct epitem". Must be called with
+ * "ep->sem" held.
  */
 static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 {
 	int kcmp;
-	unsigned long flags;
 	struct rb_node *rbp;
 	struct epitem *epi, *epir = NULL;
 	struct epoll_filefd ffd;
 
 	ep_set_ffd(&ffd, file, fd);
-	read_lock_irqsave(&ep->lock, flags);
 	for (rbp = ep->rbr.rb_node; rbp; ) {
 		epi = rb_entry(rbp, struct epitem, rbn);
 		kcmp = ep_cmp_ffd(&ffd, &epi->ffd);
@@ -875,7 +990,6 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 			break;
 		}
 	}
-	read_unlock_irqrestore(&ep->lock, flags);
 
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: ep_find(%p) -> %p\n",
 		     current, file, epir));
@@ -955,8 +1069,7 @@ static void ep_rbtree_insert(struct eventpoll *ep, struct epitem *epi)
 static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 		     struct file *tfile, int fd)
 {
-	int error, revents, pwake = 0;
-	unsigned long flags;
+	int error, revents;
 	struct epitem *epi;
 	struct ep_pqueue epq;
 
@@ -968,8 +1081,9 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	ep_rb_initnode(&epi->rbn);
 	INIT_LIST_HEAD(&epi->rdllink);
 	INIT_LIST_HEAD(&epi->fllink);
-	INIT_LIST_HEAD(&epi->txlink);
 	INIT_LIST_HEAD(&epi->pwqlist);
+	epi->next = NULL;
+	epi->state = 0;
 	epi->ep = ep;
 	ep_set_ffd(&epi->ffd, tfile, fd);
 	epi->event = *event;
@@ -1000,28 +1114,15 @@ static int ep_insert(struct eventpoll *ep, struct epoll_event *event,
 	list_add_tail(&epi->fllink, &tfile->f_ep_links);
 	spin_unlock(&tfile->f_ep_lock);
 
-	/* We have to drop the new item inside our item list to keep track of it */
-	write_lock_irqsave(&ep->lock, flags);
-
-	/* Add the current item to the rb-tree */
+	/* Add the current item to the rb-tree, "ep->sem" protects it */
 	ep_rbtree_insert(ep, epi);
 
-	/* If the file is already "ready" we drop it inside the ready list */
-	if ((revents & event->events) && !ep_is_linked(&epi->rdllink)) {
-		list_add_tail(&epi->rdllink, &ep->rdllist);
-
-		/* Notify waiting tasks that events are available */
-		if (waitqueue_active(&ep->wq))
-			wake_up(&ep->wq);
-		if (waitqueue_active(&ep->poll_wait))
-			pwake++;
-	}
-
-	write_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&psw, &ep->poll_wait);
+	/*
+	 * If the file is already "ready" we queue it and notify waiting
+	 * tasks that events are available.
+	 */
+	if ((revents & event->events) && ep_queue_item(ep, epi))
+		ep_wake_up(ep, !(event->events & EPOLLEXCLUSIVE));
 
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: ep_insert(%p, %p, %d)\n",
 		     current, ep, tfile, fd));
@@ -1035,10 +1136,11 @@ eexit_2:
 	 * We need to do this because an event could have been arrived on some
 	 * allocated wait queue.
 	 */
-	write_lock_irqsave(&ep->lock, flags);
+	spin_lock(&ep->lock);
+	ep_rdchain_splice(ep);
 	if (ep_is_linked(&epi->rdllink))
 		ep_list_del(&epi->rdllink);
-	write_unlock_irqrestore(&ep->lock, flags);
+	spin_unlock(&ep->lock);
 
 	kmem_cache_free(epi_cache, epi);
 eexit_1:
@@ -1052,9 +1154,7 @@ eexit_1:
  */
 static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_event *event)
 {
-	int pwake = 0;
 	unsigned int revents;
-	unsigned long flags;
 
 	/*
 	 * Set the new event interest mask before calling f_op->poll(), otherwise
@@ -1070,39 +1170,21 @@ static int ep_modify(struct eventpoll *ep, struct epitem *epi, struct epoll_even
 	 */
 	revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL);
 
-	write_lock_irqsave(&ep->lock, flags);
-
-	/* Copy the data member from inside the lock */
+	/*
+	 * The data member is only read by the event transfer loop, which
+	 * "ep->sem" keeps out while we are here.
+	 */
 	epi->event.data = event->data;
 
 	/*
 	 * If the item is not linked to the hash it means that it's on its
-	 * way toward the removal. Do nothing in this case.
+	 * way toward the removal. Do nothing in this case. If the item is
+	 * "hot" and it is not queued already, queue it. An item which is
+	 * not "hot" anymore is dropped by the event transfer loop.
 	 */
-	if (ep_rb_linked(&epi->rbn)) {
-		/*
-		 * If the item is "hot" and it is not registered inside the ready
-		 * list, push it inside. If the item is not "hot" and it is currently
-		 * registered inside the ready list, unlink it.
-		 */
-		if (revents & event->events) {
-			if (!ep_is_linked(&epi->rdllink)) {
-				list_add_tail(&epi->rdllink, &ep->rdllist);
-
-				/* Notify waiting tasks that events are available */
-				if (waitqueue_active(&ep->wq))
-					wake_up(&ep->wq);
-				if (waitqueue_active(&ep->poll_wait))
-					pwake++;
-			}
-		}
-	}
-
-	write_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&psw, &ep->poll_wait);
+	if (ep_rb_linked(&epi->rbn) && (revents & event->events) &&
+	    ep_queue_item(ep, epi))
+		ep_wake_up(ep, !(event->events & EPOLLEXCLUSIVE));
 
 	return 0;
 }
@@ -1136,7 +1218,8 @@ static void ep_unregister_pollwait(struct eventpoll *ep, struct epitem *epi)
 
 /*
  * Unlink the "struct epitem" from all places it might have been hooked up.
- * This function must be called with write IRQ lock on "ep->lock".
+ * This function must be called with "ep->lock" held, and after the poll
+ * callbacks have been unregistered.
  */
 static int ep_unlink(struct eventpoll *ep, struct epitem *epi)
 {
@@ -1166,8 +1249,10 @@ static int ep_unlink(struct eventpoll *ep, struct epitem *epi)
 
 	/*
 	 * If the item we are going to remove is inside the ready file descriptors
-	 * we want to remove it from this list to avoid stale events.
+	 * we want to remove it from this list to avoid stale events. It might
+	 * still sit on the ready chain, so move that over first.
 	 */
+	ep_rdchain_splice(ep);
 	if (ep_is_linked(&epi->rdllink))
 		ep_list_del(&epi->rdllink);
 
@@ -1188,7 +1273,6 @@ eexit_1:
 static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 {
 	int error;
-	unsigned long flags;
 	struct file *file = epi->ffd.file;
 
 	/*
@@ -1207,13 +1291,13 @@ static int ep_remove(struct eventpoll *ep, struct epitem *epi)
 		ep_list_del(&epi->fllink);
 	spin_unlock(&file->f_ep_lock);
 
-	/* We need to acquire the write IRQ lock before calling ep_unlink() */
-	write_lock_irqsave(&ep->lock, flags);
+	/* We need to acquire the lock before calling ep_unlink() */
+	spin_lock(&ep->lock);
 
 	/* Really unlink the item from the hash */
 	error = ep_unlink(ep, epi);
 
-	write_unlock_irqrestore(&ep->lock, flags);
+	spin_unlock(&ep->lock);
 
 	if (error)
 		goto eexit_1;
@@ -1233,20 +1317,17 @@ eexit_1:
 /*
  * This is the callback that is passed to the wait queue wakeup
  * machanism. It is called by the stored file descriptors when they
- * have events to report.
+ * have events to report. It takes no eventpoll lock, the item is pushed
+ * on the lockless ready chain.
  */
 static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *key)
 {
-	int pwake = 0;
-	unsigned long flags;
 	struct epitem *epi = ep_item_from_wait(wait);
 	struct eventpoll *ep = epi->ep;
 
 	DNPRINTK(3, (KERN_INFO "[%p] eventpoll: poll_callback(%p) epi=%p ep=%p\n",
 		     current, epi->file, epi, ep));
 
-	write_lock_irqsave(&ep->lock, flags);
-
 	/*
 	 * If the event mask does not contain any poll(2) event, we consider the
 	 * descriptor to be disabled. This condition is likely the effect of the
@@ -1254,30 +1335,16 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * until the next EPOLL_CTL_MOD will be issued.
 	 */
 	if (!(epi->event.events & ~EP_PRIVATE_BITS))
-		goto is_disabled;
+		return 1;
 
-	/* If this file is already in the ready list we exit soon */
-	if (ep_is_linked(&epi->rdllink))
-		goto is_linked;
-
-	list_add_tail(&epi->rdllink, &ep->rdllist);
-
-is_linked:
 	/*
-	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-	 * wait list.
+	 * If this file is already queued we exit soon, a waiter has been
+	 * woken up when it was queued and the event transfer loop polls the
+	 * file only after it has been unqueued. Items added with
+	 * EPOLLEXCLUSIVE wake up only one of the waiters, the others all.
 	 */
-	if (waitqueue_active(&ep->wq))
-		wake_up(&ep->wq);
-	if (waitqueue_active(&ep->poll_wait))
-		pwake++;
-
-is_disabled:
-	write_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&psw, &ep->poll_wait);
+	if (ep_queue_item(ep, epi))
+		ep_wake_up(ep, !(epi->event.events & EPOLLEXCLUSIVE));
 
 	return 1;
 }
@@ -1300,88 +1367,71 @@ static int ep_eventpoll_close(struct inode *inode, struct file *file)
 static unsigned int ep_eventpoll_poll(struct file *file, poll_table *wait)
 {
 	unsigned int pollflags = 0;
-	unsigned long flags;
 	struct eventpoll *ep = file->private_data;
 
 	/* Insert inside our poll wait queue */
 	poll_wait(file, &ep->poll_wait, wait);
 
 	/* Check our condition */
-	read_lock_irqsave(&ep->lock, flags);
-	if (!list_empty(&ep->rdllist))
+	if (ep_events_available(ep))
 		pollflags = POLLIN | POLLRDNORM;
-	read_unlock_irqrestore(&ep->lock, flags);
 
 	return pollflags;
 }
 
 
 /*
- * Since we have to release the lock during the __copy_to_user() operation and
- * during the f_op->poll() call, we try to collect the maximum number of items
- * by reducing the irqlock/irqunlock switching rate.
+ * Perform the transfer of events to user space. The ready items are cut
+ * off the ready list into a task private transfer list, and the events
+ * are delivered from it in a single pass: every item is unqueued, polled
+ * and copied to user space. Level Triggered items which still have events
+ * are queued again for the next round. Since we have to release the lock
+ * during the __put_user() operation and during the f_op->poll() call, we
+ * hold the lock only to cut the list.
  */
-static int ep_collect_ready_items(struct eventpoll *ep, struct list_head *txlist, int maxevents)
+static int ep_events_transfer(struct eventpoll *ep,
+			      struct epoll_event __user *events, int maxevents)
 {
-	int nepi;
-	unsigned long flags;
-	struct list_head *lsthead = &ep->rdllist, *lnk;
+	int eventcnt = 0, error = 0;
+	unsigned int revents;
 	struct epitem *epi;
+	struct list_head txlist;
 
-	write_lock_irqsave(&ep->lock, flags);
-
-	for (nepi = 0, lnk = lsthead->next; lnk != lsthead && nepi < maxevents;) {
-		epi = list_entry(lnk, struct epitem, rdllink);
-
-		lnk = lnk->next;
-
-		/* If this file is already in the ready list we exit soon */
-		if (!ep_is_linked(&epi->txlink)) {
-			/*
-			 * This is initialized in this way so that the default
-			 * behaviour of the reinjecting code will be to push back
-			 * the item inside the ready list.
-			 */
-			epi->revents = epi->event.events;
+	INIT_LIST_HEAD(&txlist);
 
-			/* Link the ready item into the transfer list */
-			list_add(&epi->txlink, txlist);
-			nepi++;
+	/*
+	 * We need to lock this because we could be hit by
+	 * eventpoll_release_file() and epoll_ctl().
+	 */
+	down_read(&ep->sem);
 
-			/*
-			 * Unlink the item from the ready list.
-			 */
-			ep_list_del(&epi->rdllink);
-		}
+	/* Collect/extract ready items */
+	spin_lock(&ep->lock);
+	ep_rdchain_splice(ep);
+	while (!list_empty(&ep->rdllist) && eventcnt < maxevents) {
+		list_move_tail(ep->rdllist.next, &txlist);
+		eventcnt++;
 	}
-
-	write_unlock_irqrestore(&ep->lock, flags);
-
-	return nepi;
-}
-
-
-/*
- * This function is called without holding the "ep->lock" since the call to
- * __copy_to_user() might sleep, and also f_op->poll() might reenable the IRQ
- * because of the way poll() is traditionally implemented in Linux.
- */
-static int ep_send_events(struct eventpoll *ep, struct list_head *txlist,
-			  struct epoll_event __user *events)
-{
-	int eventcnt = 0;
-	unsigned int revents;
-	struct list_head *lnk;
-	struct epitem *epi;
+	spin_unlock(&ep->lock);
 
 	/*
 	 * We can loop without lock because this is a task private list.
-	 * The test done during the collection loop will guarantee us that
-	 * another task will not try to collect this file. Also, items
-	 * cannot vanish during the loop because we are holding "sem".
+	 * The EPI_QUEUED bit guarantees us that another task will not try
+	 * to collect this file. Also, items cannot vanish during the loop
+	 * because we are holding "sem".
 	 */
-	list_for_each(lnk, txlist) {
-		epi = list_entry(lnk, struct epitem, txlink);
+	eventcnt = 0;
+	while (!list_empty(&txlist)) {
+		epi = list_entry(txlist.next, struct epitem, rdllink);
+
+		ep_list_del(&epi->rdllink);
+
+		/*
+		 * From now on a new event queues the item again, and we are
+		 * going to see everything which happened up to here.
+		 */
+		clear_bit(EPI_QUEUED, &epi->state);
+		smp_mb__after_clear_bit();
 
 		/*
 		 * Get the ready file event set. We can safely use the file
@@ -1389,111 +1439,46 @@ static int ep_send_events(struct eventpoll *ep, struct list_head *txlist,
 		 * guarantee that both the file and the item will not vanish.
 		 */
 		revents = epi->ffd.file->f_op->poll(epi->ffd.file, NULL);
-
-		/*
-		 * Set the return event set for the current file descriptor.
-		 * Note that only the task task was successfully able to link
-		 * the item to its "txlist" will write this field.
-		 */
-		epi->revents = revents & epi->event.events;
-
-		if (epi->revents) {
-			if (__put_user(epi->revents,
-				       &events[eventcnt].events) ||
-			    __put_user(epi->event.data,
-				       &events[eventcnt].data))
-				return -EFAULT;
-			if (epi->event.events & EPOLLONESHOT)
-				epi->event.events &= EP_PRIVATE_BITS;
-			eventcnt++;
+		revents &= epi->event.events;
+		if (!revents)
+			continue;
+
+		if (__put_user(revents, &events[eventcnt].events) ||
+		    __put_user(epi->event.data, &events[eventcnt].data)) {
+			ep_queue_item(ep, epi);
+			error = -EFAULT;
+			break;
 		}
-	}
-	return eventcnt;
-}
-
-
-/*
- * Walk through the transfer list we collected with ep_collect_ready_items()
- * and, if 1) the item is still "alive" 2) its event set is not empty 3) it's
- * not already linked, links it to the ready list. Same as above, we are holding
- * "sem" so items cannot vanish underneath our nose.
- */
-static void ep_reinject_items(struct eventpoll *ep, struct list_head *txlist)
-{
-	int ricnt = 0, pwake = 0;
-	unsigned long flags;
-	struct epitem *epi;
-
-	write_lock_irqsave(&ep->lock, flags);
-
-	while (!list_empty(txlist)) {
-		epi = list_entry(txlist->next, struct epitem, txlink);
-
-		/* Unlink the current item from the transfer list */
-		ep_list_del(&epi->txlink);
+		eventcnt++;
 
 		/*
-		 * If the item is no more linked to the interest set, we don't
-		 * have to push it inside the ready list because the following
-		 * ep_release_epitem() is going to drop it. Also, if the current
-		 * item is set to have an Edge Triggered behaviour, we don't have
-		 * to push it back either.
+		 * A One Shot item is disabled until the next EPOLL_CTL_MOD. A
+		 * Level Triggered one goes back to the ready list, so it is
+		 * reported again until the condition is cleared.
 		 */
-		if (ep_rb_linked(&epi->rbn) && !(epi->event.events & EPOLLET) &&
-		    (epi->revents & epi->event.events) && !ep_is_linked(&epi->rdllink)) {
-			list_add_tail(&epi->rdllink, &ep->rdllist);
-			ricnt++;
-		}
+		if (epi->event.events & EPOLLONESHOT)
+			epi->event.events &= EP_PRIVATE_BITS;
+		else if (!(epi->event.events & EPOLLET))
+			ep_queue_item(ep, epi);
 	}
 
-	if (ricnt) {
-		/*
-		 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
-		 * wait list.
-		 */
-		if (waitqueue_active(&ep->wq))
-			wake_up(&ep->wq);
-		if (waitqueue_active(&ep->poll_wait))
-			pwake++;
+	/* Items we did not get at on a fault are still queued */
+	if (!list_empty(&txlist)) {
+		spin_lock(&ep->lock);
+		list_splice(&txlist, &ep->rdllist);
+		spin_unlock(&ep->lock);
 	}
 
-	write_unlock_irqrestore(&ep->lock, flags);
-
-	/* We have to call this outside the lock */
-	if (pwake)
-		ep_poll_safewake(&psw, &ep->poll_wait);
-}
-
-
-/*
- * Perform the transfer of events to user space.
- */
-static int ep_events_transfer(struct eventpoll *ep,
-			      struct epoll_event __user *events, int maxevents)
-{
-	int eventcnt = 0;
-	struct list_head txlist;
-
-	INIT_LIST_HEAD(&txlist);
-
 	/*
-	 * We need to lock this because we could be hit by
-	 * eventpoll_release_file() and epoll_ctl(EPOLL_CTL_DEL).
+	 * Maybe only one waiter has been woken up for the events, pass
+	 * them on if we left some behind.
 	 */
-	down_read(&ep->sem);
-
-	/* Collect/extract ready items */
-	if (ep_collect_ready_items(ep, &txlist, maxevents) > 0) {
-		/* Build result set in userspace */
-		eventcnt = ep_send_events(ep, &txlist, events);
-
-		/* Reinject ready items into the ready list */
-		ep_reinject_items(ep, &txlist);
-	}
+	if (ep_events_available(ep))
+		ep_wake_up(ep, 0);
 
 	up_read(&ep->sem);
 
-	return eventcnt;
+	return error ? error : eventcnt;
 }
 
 
@@ -1501,7 +1486,6 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		   int maxevents, long timeout)
 {
 	int res, eavail;
-	unsigned long flags;
 	long jtimeout;
 	wait_queue_t wait;
 
@@ -1514,17 +1498,18 @@ static int ep_poll(struct eventpoll *ep, struct epoll_event __user *events,
 		MAX_SCHEDULE_TIMEOUT : (timeout * HZ + 999) / 1000;
 
 retry:
-	write_lock_irqsave(&ep->lock, flags);
-
 	res = 0;
-	if (list_empty(&ep->rdllist)) {
+	if (!ep_events_available(ep)) {
 		/*
 		 * We don't have any available event to return to the caller.
 		 * We need to sleep here, and we will be wake up by
-		 * ep_poll_callback() when events will become available.
+		 * ep_poll_callback() when events will become available. We
+		 * wait exclusively, so that an event of an EPOLLEXCLUSIVE
+		 * item wakes up only one of the tasks waiting on this
+		 * eventpoll, and not the whole herd.
 		 */
 		init_waitqueue_entry(&wait, current);
-		add_wait_queue(&ep->wq, &wait);
+		add_wait_queue_exclusive(&ep->wq, &wait);
 
 		for (;;) {
 			/*
@@ -1533,26 +1518,29 @@ retry:
 			 * to TASK_INTERRUPTIBLE before doing the checks.
 			 */
 			set_current_state(TASK_INTERRUPTIBLE);
-			if (!list_empty(&ep->rdllist) || !jtimeout)
+			if (ep_events_available(ep) || !jtimeout)
 				break;
 			if (signal_pending(current)) {
 				res = -EINTR;
 				break;
 			}
 
-			write_unlock_irqrestore(&ep->lock, flags);
 			jtimeout = schedule_timeout(jtimeout);
-			write_lock_irqsave(&ep->lock, flags);
 		}
 		remove_wait_queue(&ep->wq, &wait);
 
 		set_current_state(TASK_RUNNING);
+
+		/*
+		 * We may have taken the only wakeup for events we are not
+		 * going to collect now, pass it on.
+		 */
+		if (res && ep_events_available(ep))
+			ep_wake_up(ep, 0);
 	}
 
 	/* Is it worth to try to dig for events ? */
-	eavail = !list_empty(&ep->rdllist);
-
-	write_unlock_irqrestore(&ep->lock, flags);
+	eavail = ep_events_available(ep);
 
 	/*
 	 * Try to transfer events to user space. In case we get 0 events and
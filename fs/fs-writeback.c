@@ -25,6 +25,21 @@
 
 extern struct super_block *blockdev_superblock;
 
+/*
+ * The device whose flusher thread writes back this inode.  Inodes against
+ * devices without a flusher thread of their own are kept on the default
+ * device.  Called under inode_lock, which also serialises against the
+ * device being (un)registered.
+ */
+static inline struct backing_dev_info *inode_wb_bdi(struct inode *inode)
+{
+	struct backing_dev_info *bdi = inode->i_mapping->backing_dev_info;
+
+	if (!bdi_registered(bdi))
+		return &default_backing_dev_info;
+	return bdi;
+}
+
 /**
  *	__mark_inode_dirty -	internal function
  *	@inode: inode to mark
@@ -32,7 +47,7 @@ extern struct super_block *blockdev_superblock;
  *	Mark an inode as dirty. Callers should use mark_inode_dirty or
  *  	mark_inode_dirty_sync.
  *
- * Put the inode on the super block's dirty list.
+ * Put the inode on the dirty list of the device which backs its pages.
  *
  * CAREFUL! We mark it dirty unconditionally, but move it onto the
  * dirty list only if it is hashed or if it refers to a blockdev.
@@ -102,13 +117,13 @@ void __mark_inode_dirty(struct inode *inode, int flags)
 		/*
 		 * If the inode is locked, just update its dirty state. 
 		 * The unlocker will place the inode on the appropriate
-		 * superblock list, based upon its state.
+		 * device list, based upon its state.
 		 */
 		if (inode->i_state & I_LOCK)
 			goto out;
 
 		/*
-		 * Only add valid (hashed) inodes to the superblock's
+		 * Only add valid (hashed) inodes to the device's
 		 * dirty list.  Add blockdev inodes as well.
 		 */
 		if (!S_ISBLK(inode->i_mode)) {
@@ -119,12 +134,20 @@ void __mark_inode_dirty(struct inode *inode, int flags)
 			goto out;
 
 		/*
-		 * If the inode was already on s_dirty or s_io, don't
-		 * reposition it (that would break s_dirty time-ordering).
+		 * Memory-backed inodes (ramfs, tmpfs, the ramdisk driver)
+		 * are never written back, don't make the flusher threads
+		 * walk over them.
+		 */
+		if (!mapping_cap_writeback_dirty(inode->i_mapping))
+			goto out;
+
+		/*
+		 * If the inode was already on b_dirty or b_io, don't
+		 * reposition it (that would break b_dirty time-ordering).
 		 */
 		if (!was_dirty) {
 			inode->dirtied_when = jiffies;
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, &inode_wb_bdi(inode)->b_dirty);
 		}
 	}
 out:
@@ -155,7 +178,6 @@ __sync_single_inode(struct inode *inode, struct writeback_control *wbc)
 {
 	unsigned dirty;
 	struct address_space *mapping = inode->i_mapping;
-	struct super_block *sb = inode->i_sb;
 	int wait = wbc->sync_mode == WB_SYNC_ALL;
 	int ret;
 
@@ -186,40 +208,42 @@ __sync_single_inode(struct inode *inode, struct writeback_control *wbc)
 	spin_lock(&inode_lock);
 	inode->i_state &= ~I_LOCK;
 	if (!(inode->i_state & I_FREEING)) {
+		struct backing_dev_info *bdi = inode_wb_bdi(inode);
+
 		if (!(inode->i_state & I_DIRTY) &&
 		    mapping_tagged(mapping, PAGECACHE_TAG_DIRTY)) {
 			/*
 			 * We didn't write back all the pages.  nfs_writepages()
 			 * sometimes bales out without doing anything. Redirty
-			 * the inode.  It is still on sb->s_io.
+			 * the inode.  It is still on bdi->b_io.
 			 */
 			if (wbc->for_kupdate) {
 				/*
 				 * For the kupdate function we leave the inode
-				 * at the head of sb_dirty so it will get more
+				 * at the head of b_dirty so it will get more
 				 * writeout as soon as the queue becomes
 				 * uncongested.
 				 */
 				inode->i_state |= I_DIRTY_PAGES;
-				list_move_tail(&inode->i_list, &sb->s_dirty);
+				list_move_tail(&inode->i_list, &bdi->b_dirty);
 			} else {
 				/*
 				 * Otherwise fully redirty the inode so that
-				 * other inodes on this superblock will get some
+				 * other inodes on this device will get some
 				 * writeout.  Otherwise heavy writing to one
 				 * file would indefinitely suspend writeout of
 				 * all the other files.
 				 */
 				inode->i_state |= I_DIRTY_PAGES;
 				inode->dirtied_when = jiffies;
-				list_move(&inode->i_list, &sb->s_dirty);
+				list_move(&inode->i_list, &bdi->b_dirty);
 			}
 		} else if (inode->i_state & I_DIRTY) {
 			/*
 			 * Someone redirtied the inode while were writing back
 			 * the pages.
 			 */
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, &bdi->b_dirty);
 		} else if (atomic_read(&inode->i_count)) {
 			/*
 			 * The inode is clean, inuse
@@ -236,6 +260,25 @@ __sync_single_inode(struct inode *inode, struct writeback_control *wbc)
 	return ret;
 }
 
+/*
+ * Put an inode which is being skipped back at the most recently dirtied end
+ * of @bdi's b_dirty.  Its dirtied_when is moved forward if need be, so that
+ * it is not older than the inode it is put in front of: the kupdate cutoff
+ * and the livelock checks rely on b_dirty being ordered by dirtied_when.
+ * Called under inode_lock.
+ */
+static void redirty_tail(struct inode *inode, struct backing_dev_info *bdi)
+{
+	if (!list_empty(&bdi->b_dirty)) {
+		struct inode *last;
+
+		last = list_entry(bdi->b_dirty.next, struct inode, i_list);
+		if (time_before(inode->dirtied_when, last->dirtied_when))
+			inode->dirtied_when = jiffies;
+	}
+	list_move(&inode->i_list, &bdi->b_dirty);
+}
+
 /*
  * Write out an inode's dirty pages.  Called under inode_lock.  Either the
  * caller has ref on the inode (either via __iget or via syscall against an fd)
@@ -252,7 +295,7 @@ __writeback_single_inode(struct inode *inode, struct writeback_control *wbc)
 		WARN_ON(inode->i_state & I_WILL_FREE);
 
 	if ((wbc->sync_mode != WB_SYNC_ALL) && (inode->i_state & I_LOCK)) {
-		list_move(&inode->i_list, &inode->i_sb->s_dirty);
+		list_move(&inode->i_list, &inode_wb_bdi(inode)->b_dirty);
 		return 0;
 	}
 
@@ -274,83 +317,98 @@ __writeback_single_inode(struct inode *inode, struct writeback_control *wbc)
 }
 
 /*
- * Write out a superblock's list of dirty inodes.  A wait will be performed
+ * A device's dirty list holds the inodes of all the filesystems on it, and
+ * writeback may run against it without anybody holding those filesystems.
+ * Keep the superblock from being unmounted while we work on its inode.  If
+ * we can't get the readlock, there's no sense in waiting around, most of
+ * the time the fs is going to be unmounted by the time it is released.
+ *
+ * Called under inode_lock.  The inode is on our list, so its superblock
+ * can't go away under us.
+ */
+static int pin_sb_for_writeback(struct super_block *sb)
+{
+	spin_lock(&sb_lock);
+	sb->s_count++;
+	if (down_read_trylock(&sb->s_umount)) {
+		if (sb->s_root) {
+			spin_unlock(&sb_lock);
+			return 1;
+		}
+		up_read(&sb->s_umount);
+	}
+	sb->s_count--;
+	spin_unlock(&sb_lock);
+	return 0;
+}
+
+/*
+ * Write out a device's list of dirty inodes.  A wait will be performed
  * upon no inodes, all inodes or the final one, depending upon sync_mode.
  *
  * If older_than_this is non-NULL, then only write out inodes which
  * had their first dirtying at a time earlier than *older_than_this.
  *
- * If we're a pdlfush thread, then implement pdflush collision avoidance
- * against the entire list.
+ * If `bdi' is non-zero then only the inodes against that queue are written.
+ * The default device holds the inodes of all devices without a flusher
+ * thread, and the blockdev inodes of a device may be backed by other queues,
+ * so this is checked for each inode.
+ *
+ * If `sb' is non-zero then only the inodes of that superblock are written,
+ * and the caller holds the superblock.  Otherwise each inode's superblock is
+ * pinned while we write to it.
  *
- * WB_SYNC_HOLD is a hack for sys_sync(): reattach the inode to sb->s_dirty so
+ * WB_SYNC_HOLD is a hack for sys_sync(): reattach the inode to b_dirty so
  * that it can be located for waiting on in __writeback_single_inode().
  *
  * Called under inode_lock.
  *
- * If `bdi' is non-zero then we're being asked to writeback a specific queue.
- * This function assumes that the blockdev superblock's inodes are backed by
- * a variety of queues, so all inodes are searched.  For other superblocks,
- * assume that all inodes are backed by the same queue.
- *
- * FIXME: this linear search could get expensive with many fileystems.  But
- * how to fix?  We need to go from an address_space to all inodes which share
- * a queue with that address_space.  (Easy: have a global "dirty superblocks"
- * list).
- *
- * The inodes to be written are parked on sb->s_io.  They are moved back onto
- * sb->s_dirty as they are selected for writing.  This way, none can be missed
+ * The inodes to be written are parked on bdi->b_io.  They are moved back onto
+ * bdi->b_dirty as they are selected for writing.  This way, none can be missed
  * on the writer throttling path, and we get decent balancing between many
  * throttled threads: we don't want them all piling up on __wait_on_inode.
  */
 static void
-sync_sb_inodes(struct super_block *sb, struct writeback_control *wbc)
+generic_sync_bdi_inodes(struct backing_dev_info *bdi,
+			struct writeback_control *wbc)
 {
 	const unsigned long start = jiffies;	/* livelock avoidance */
 
-	if (!wbc->for_kupdate || list_empty(&sb->s_io))
-		list_splice_init(&sb->s_dirty, &sb->s_io);
+	if (!wbc->for_kupdate || list_empty(&bdi->b_io))
+		list_splice_init(&bdi->b_dirty, &bdi->b_io);
 
-	while (!list_empty(&sb->s_io)) {
-		struct inode *inode = list_entry(sb->s_io.prev,
+	while (!list_empty(&bdi->b_io)) {
+		struct inode *inode = list_entry(bdi->b_io.prev,
 						struct inode, i_list);
-		struct address_space *mapping = inode->i_mapping;
-		struct backing_dev_info *bdi = mapping->backing_dev_info;
+		struct backing_dev_info *ibdi = inode->i_mapping->backing_dev_info;
+		struct super_block *sb = inode->i_sb;
 		long pages_skipped;
 
-		if (!bdi_cap_writeback_dirty(bdi)) {
-			list_move(&inode->i_list, &sb->s_dirty);
-			if (sb == blockdev_superblock) {
-				/*
-				 * Dirty memory-backed blockdev: the ramdisk
-				 * driver does this.  Skip just this inode
-				 */
-				continue;
-			}
+		if ((wbc->sb && sb != wbc->sb) ||
+		    (wbc->bdi && ibdi != wbc->bdi)) {
+			/* Not ours: skip it, but keep b_dirty time-ordered */
+			redirty_tail(inode, bdi);
+			continue;
+		}
+
+		if (!bdi_cap_writeback_dirty(ibdi)) {
 			/*
-			 * Dirty memory-backed inode against a filesystem other
-			 * than the kernel-internal bdev filesystem.  Skip the
-			 * entire superblock.
+			 * Dirty memory-backed inode which got requeued by
+			 * fsync.  Skip just this inode.
 			 */
-			break;
+			redirty_tail(inode, bdi);
+			continue;
 		}
 
-		if (wbc->nonblocking && bdi_write_congested(bdi)) {
+		if (wbc->nonblocking && bdi_write_congested(ibdi)) {
 			wbc->encountered_congestion = 1;
-			if (sb != blockdev_superblock)
-				break;		/* Skip a congested fs */
-			list_move(&inode->i_list, &sb->s_dirty);
-			continue;		/* Skip a congested blockdev */
-		}
-
-		if (wbc->bdi && bdi != wbc->bdi) {
-			if (sb != blockdev_superblock)
-				break;		/* fs has the wrong queue */
-			list_move(&inode->i_list, &sb->s_dirty);
-			continue;		/* blockdev has wrong queue */
+			if (ibdi == bdi)
+				break;		/* Skip a congested device */
+			redirty_tail(inode, bdi);
+			continue;		/* Skip a congested foreign queue */
 		}
 
-		/* Was this inode dirtied after sync_sb_inodes was called? */
+		/* Was this inode dirtied after generic_sync_bdi_inodes was called? */
 		if (time_after(inode->dirtied_when, start))
 			break;
 
@@ -359,9 +417,10 @@ sync_sb_inodes(struct super_block *sb, struct writeback_control *wbc)
 						*wbc->older_than_this))
 			break;
 
-		/* Is another pdflush already flushing this queue? */
-		if (current_is_pdflush() && !writeback_acquire(bdi))
-			break;
+		if (!wbc->sb && !pin_sb_for_writeback(sb)) {
+			redirty_tail(inode, bdi);
+			continue;
+		}
 
 		BUG_ON(inode->i_state & I_FREEING);
 		__iget(inode);
@@ -369,87 +428,90 @@ sync_sb_inodes(struct super_block *sb, struct writeback_control *wbc)
 		__writeback_single_inode(inode, wbc);
 		if (wbc->sync_mode == WB_SYNC_HOLD) {
 			inode->dirtied_when = jiffies;
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, &inode_wb_bdi(inode)->b_dirty);
 		}
-		if (current_is_pdflush())
-			writeback_release(bdi);
 		if (wbc->pages_skipped != pages_skipped) {
 			/*
 			 * writeback is not making progress due to locked
 			 * buffers.  Skip this inode for now.
 			 */
-			list_move(&inode->i_list, &sb->s_dirty);
+			list_move(&inode->i_list, &inode_wb_bdi(inode)->b_dirty);
 		}
 		spin_unlock(&inode_lock);
 		cond_resched();
 		iput(inode);
+		if (!wbc->sb)
+			drop_super(sb);
 		spin_lock(&inode_lock);
 		if (wbc->nr_to_write <= 0)
 			break;
 	}
-	return;		/* Leave any unwritten inodes on s_io */
+	return;		/* Leave any unwritten inodes on b_io */
+}
+
+/**
+ * writeback_bdi_inodes - write back the dirty inodes of one device
+ * @bdi: the device's backing_dev_info structure
+ * @wbc: controls the writeback mode
+ *
+ * This is what the flusher thread of @bdi runs.  The caller must make sure
+ * that @bdi stays registered, or is the default device.
+ */
+void writeback_bdi_inodes(struct backing_dev_info *bdi,
+			  struct writeback_control *wbc)
+{
+	might_sleep();
+	spin_lock(&inode_lock);
+	generic_sync_bdi_inodes(bdi, wbc);
+	spin_unlock(&inode_lock);
 }
 
 /*
  * Start writeback of dirty pagecache data against all unlocked inodes.
  *
- * Note:
- * We don't need to grab a reference to superblock here. If it has non-empty
- * ->s_dirty it's hadn't been killed yet and kill_super() won't proceed
- * past sync_inodes_sb() until both the ->s_dirty and ->s_io lists are
- * empty. Since __sync_single_inode() regains inode_lock before it finally moves
- * inode from superblock lists we are OK.
- *
  * If `older_than_this' is non-zero then only flush inodes which have a
  * flushtime older than *older_than_this.
  *
- * If `bdi' is non-zero then we will scan the first inode against each
- * superblock until we find the matching ones.  One group will be the dirty
- * inodes against a filesystem.  Then when we hit the dummy blockdev superblock,
- * sync_sb_inodes will seekout the blockdev which matches `bdi'.  Maybe not
- * super-efficient but we're about to do a ton of I/O...
+ * If `bdi' is non-zero then only the dirty list of that device is searched.
+ * We don't need bdi_list_sem for this: the caller is writing to the device,
+ * so it can't go away, and if it is unregistered meanwhile its lists are
+ * handed over to the default device and we simply find them empty.
  */
 void
 writeback_inodes(struct writeback_control *wbc)
 {
-	struct super_block *sb;
+	struct backing_dev_info *bdi;
 
 	might_sleep();
-	spin_lock(&sb_lock);
-restart:
-	sb = sb_entry(super_blocks.prev);
-	for (; sb != sb_entry(&super_blocks); sb = sb_entry(sb->s_list.prev)) {
-		if (!list_empty(&sb->s_dirty) || !list_empty(&sb->s_io)) {
-			/* we're making our own get_super here */
-			sb->s_count++;
-			spin_unlock(&sb_lock);
-			/*
-			 * If we can't get the readlock, there's no sense in
-			 * waiting around, most of the time the FS is going to
-			 * be unmounted by the time it is released.
-			 */
-			if (down_read_trylock(&sb->s_umount)) {
-				if (sb->s_root) {
-					spin_lock(&inode_lock);
-					sync_sb_inodes(sb, wbc);
-					spin_unlock(&inode_lock);
-				}
-				up_read(&sb->s_umount);
-			}
-			spin_lock(&sb_lock);
-			if (__put_super_and_need_restart(sb))
-				goto restart;
-		}
+	if (wbc->bdi) {
+		spin_lock(&inode_lock);
+		bdi = wbc->bdi;
+		if (!bdi_registered(bdi))
+			bdi = &default_backing_dev_info;
+		generic_sync_bdi_inodes(bdi, wbc);
+		spin_unlock(&inode_lock);
+		return;
+	}
+
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		spin_lock(&inode_lock);
+		generic_sync_bdi_inodes(bdi, wbc);
+		spin_unlock(&inode_lock);
 		if (wbc->nr_to_write <= 0)
 			break;
 	}
-	spin_unlock(&sb_lock);
+	up_read(&bdi_list_sem);
 }
 
 /*
  * writeback and wait upon the filesystem's dirty inodes.  The caller will
  * do this in two passes - one to write, and one to wait.  WB_SYNC_HOLD is
- * used to park the written inodes on sb->s_dirty for the wait pass.
+ * used to park the written inodes on b_dirty for the wait pass.
+ *
+ * The inodes of a filesystem may be spread over the lists of several
+ * devices (its own, and those of the block special files on it), so all
+ * of them are searched.
  *
  * A finite limit is set on the number of pages which will be written.
  * To prevent infinite livelock of sys_sync().
@@ -460,18 +522,24 @@ restart:
 void sync_inodes_sb(struct super_block *sb, int wait)
 {
 	struct writeback_control wbc = {
+		.sb		= sb,
 		.sync_mode	= wait ? WB_SYNC_ALL : WB_SYNC_HOLD,
 	};
-	unsigned long nr_dirty = read_page_state(nr_dirty);
-	unsigned long nr_unstable = read_page_state(nr_unstable);
+	unsigned long nr_dirty = global_page_state(NR_FILE_DIRTY);
+	unsigned long nr_unstable = global_page_state(NR_UNSTABLE_NFS);
+	struct backing_dev_info *bdi;
 
 	wbc.nr_to_write = nr_dirty + nr_unstable +
 			(inodes_stat.nr_inodes - inodes_stat.nr_unused) +
 			nr_dirty + nr_unstable;
 	wbc.nr_to_write += wbc.nr_to_write / 2;		/* Bit more for luck */
-	spin_lock(&inode_lock);
-	sync_sb_inodes(sb, &wbc);
-	spin_unlock(&inode_lock);
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		spin_lock(&inode_lock);
+		generic_sync_bdi_inodes(bdi, &wbc);
+		spin_unlock(&inode_lock);
+	}
+	up_read(&bdi_list_sem);
 }
 
 /*
@@ -657,17 +725,13 @@ EXPORT_SYMBOL(generic_osync_inode);
  * writeback_acquire: attempt to get exclusive writeback access to a device
  * @bdi: the device's backing_dev_info structure
  *
- * It is a waste of resources to have more than one pdflush thread blocked on
- * a single request queue.  Exclusion at the request_queue level is obtained
- * via a flag in the request_queue's backing_dev_info.state.
- *
- * Non-request_queue-backed address_spaces will share default_backing_dev_info,
- * unless they implement their own.  Which is somewhat inefficient, as this
- * may prevent concurrent writeback against multiple devices.
+ * The flusher thread of a device holds this while it writes back, so that
+ * processes throttled in balance_dirty_pages() don't bother waking it up.
+ * Exclusion is obtained via a flag in the backing_dev_info.state.
  */
 int writeback_acquire(struct backing_dev_info *bdi)
 {
-	return !test_and_set_bit(BDI_pdflush, &bdi->state);
+	return !test_and_set_bit(BDI_writeback_running, &bdi->state);
 }
 
 /**
@@ -678,7 +742,7 @@ int writeback_acquire(struct backing_dev_info *bdi)
  */
 int writeback_in_progress(struct backing_dev_info *bdi)
 {
-	return test_bit(BDI_pdflush, &bdi->state);
+	return test_bit(BDI_writeback_running, &bdi->state);
 }
 
 /**
@@ -688,5 +752,5 @@ int writeback_in_progress(struct backing_dev_info *bdi)
 void writeback_release(struct backing_dev_info *bdi)
 {
 	BUG_ON(!writeback_in_progress(bdi));
-	clear_bit(BDI_pdflush, &bdi->state);
+	clear_bit(BDI_writeback_running, &bdi->state);
 }
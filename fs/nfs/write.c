@@ -461,7 +461,8 @@ nfs_mark_request_dirty(struct nfs_page *req)
 	nfs_list_add_request(req, &nfsi->dirty);
 	nfsi->ndirty++;
 	spin_unlock(&nfsi->req_lock);
-	inc_page_state(nr_dirty);
+	inc_zone_page_state(req->wb_page, NR_FILE_DIRTY);
+	inc_bdi_stat(inode->i_mapping->backing_dev_info, BDI_RECLAIMABLE);
 	mark_inode_dirty(inode);
 }
 
@@ -489,7 +490,8 @@ nfs_mark_request_commit(struct nfs_page *req)
 	nfs_list_add_request(req, &nfsi->commit);
 	nfsi->ncommit++;
 	spin_unlock(&nfsi->req_lock);
-	inc_page_state(nr_unstable);
+	inc_zone_page_state(req->wb_page, NR_UNSTABLE_NFS);
+	inc_bdi_stat(inode->i_mapping->backing_dev_info, BDI_RECLAIMABLE);
 	mark_inode_dirty(inode);
 }
 #endif
@@ -554,7 +556,8 @@ nfs_scan_dirty(struct inode *inode, struct list_head *dst, unsigned long idx_sta
 	if (nfsi->ndirty != 0) {
 		res = nfs_scan_lock_dirty(nfsi, dst, idx_start, npages);
 		nfsi->ndirty -= res;
-		sub_page_state(nr_dirty,res);
+		sub_bdi_stat(inode->i_mapping->backing_dev_info,
+				BDI_RECLAIMABLE, res);
 		if ((nfsi->ndirty == 0) != list_empty(&nfsi->dirty))
 			printk(KERN_ERR "NFS: desynchronized value of nfs_i.ndirty.\n");
 	}
@@ -1297,6 +1300,8 @@ void nfs_commit_done(struct rpc_task *task, void *calldata)
 		req = nfs_list_entry(data->pages.next);
 		nfs_list_remove_request(req);
 
+		dec_zone_page_state(req->wb_page, NR_UNSTABLE_NFS);
+
 		dprintk("NFS: commit (%s/%Ld %d@%Ld)",
 			req->wb_context->dentry->d_inode->i_sb->s_id,
 			(long long)NFS_FILEID(req->wb_context->dentry->d_inode),
@@ -1324,7 +1329,8 @@ void nfs_commit_done(struct rpc_task *task, void *calldata)
 		nfs_clear_page_writeback(req);
 		res++;
 	}
-	sub_page_state(nr_unstable,res);
+	sub_bdi_stat(data->inode->i_mapping->backing_dev_info,
+			BDI_RECLAIMABLE, res);
 }
 #endif
 
@@ -94,11 +94,15 @@ static void anon_pipe_buf_release(struct pipe_inode_info *info, struct pipe_buff
 {
 	struct page *page = buf->page;
 
-	if (info->tmp_page) {
-		__free_page(page);
+	/*
+	 * If nobody else uses this page (tee() may have handed it to
+	 * another pipe), keep it around as the next tmp_page.
+	 */
+	if (page_count(page) == 1 && !info->tmp_page) {
+		info->tmp_page = page;
 		return;
 	}
-	info->tmp_page = page;
+	put_page(page);
 }
 
 static void *anon_pipe_buf_map(struct file *file, struct pipe_inode_info *info, struct pipe_buffer *buf)
@@ -111,11 +115,17 @@ static void anon_pipe_buf_unmap(struct pipe_inode_info *info, struct pipe_buffer
 	kunmap(buf->page);
 }
 
-static struct pipe_buf_operations anon_pipe_buf_ops = {
+static void anon_pipe_buf_get(struct pipe_inode_info *info, struct pipe_buffer *buf)
+{
+	get_page(buf->page);
+}
+
+struct pipe_buf_operations anon_pipe_buf_ops = {
 	.can_merge = 1,
 	.map = anon_pipe_buf_map,
 	.unmap = anon_pipe_buf_unmap,
 	.release = anon_pipe_buf_release,
+	.get = anon_pipe_buf_get,
 };
 
 static ssize_t
@@ -152,6 +162,23 @@ pipe_readv(struct file *filp, const struct iovec *_iov,
 				chars = total_len;
 
 			addr = ops->map(filp, info, buf);
+			if (IS_ERR(addr)) {
+				/*
+				 * The page was truncated or could not be read
+				 * in, and no later read will do better: drop
+				 * the buffer rather than leave it stuck at the
+				 * head of the pipe.
+				 */
+				if (!ret)
+					ret = PTR_ERR(addr);
+				buf->ops = NULL;
+				ops->release(info, buf);
+				curbuf = (curbuf + 1) & (PIPE_BUFFERS-1);
+				info->curbuf = curbuf;
+				info->nrbufs = --bufs;
+				do_wakeup = 1;
+				break;
+			}
 			error = pipe_iov_copy_to_user(iov, addr + buf->offset, chars);
 			ops->unmap(info, buf);
 			if (unlikely(error)) {
@@ -253,7 +280,12 @@ pipe_writev(struct file *filp, const struct iovec *_iov,
 		struct pipe_buffer *buf = info->bufs + lastbuf;
 		struct pipe_buf_operations *ops = buf->ops;
 		int offset = buf->offset + buf->len;
-		if (ops->can_merge && offset + chars <= PAGE_SIZE) {
+		/*
+		 * A page shared with another pipe through tee() must
+		 * not be appended to, the other reader would see it.
+		 */
+		if (ops->can_merge && page_count(buf->page) == 1 &&
+		    offset + chars <= PAGE_SIZE) {
 			void *addr = ops->map(filp, info, buf);
 			int error = pipe_iov_copy_from_user(offset + addr, iov, chars);
 			ops->unmap(info, buf);
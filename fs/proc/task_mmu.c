@@ -245,6 +245,12 @@ static inline void smaps_pmd_range(struct vm_area_struct *vma, pud_t *pud,
 	pmd = pmd_offset(pud, addr);
 	do {
 		next = pmd_addr_end(addr, end);
+		if (pmd_trans_huge(*pmd)) {
+			/* a huge page is private, and born dirty */
+			mss->resident += next - addr;
+			mss->private_dirty += next - addr;
+			continue;
+		}
 		if (pmd_none_or_clear_bad(pmd))
 			continue;
 		smaps_pte_range(vma, pmd, addr, next, mss);
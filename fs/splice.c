@@ -0,0 +1,998 @@
+/*
+ * "splice": joining two ropes together by interweaving their strands.
+ *
+ * This is the "extended pipe" functionality, where a pipe is used as
+ * an arbitrary in-memory buffer. Think of a pipe as a small kernel
+ * buffer that you can use to transfer data from one end to the other.
+ *
+ * The traditional unix read/write is extended with a "splice()" operation
+ * that transfers data buffers to or from a pipe buffer. The buffers are
+ * moved by reference (the page cache page or the anonymous pipe page is
+ * handed over), so no data is copied between the source and the sink
+ * unless the sink itself needs a private copy (ie, the page cache of a
+ * regular file).
+ *
+ * "tee()" duplicates the buffers of one pipe into another pipe, again
+ * by taking an extra reference on each page rather than by copying.
+ */
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/pagemap.h>
+#include <linux/pipe_fs_i.h>
+#include <linux/swap.h>
+#include <linux/writeback.h>
+#include <linux/module.h>
+#include <linux/syscalls.h>
+#include <linux/security.h>
+
+#include <asm/uaccess.h>
+
+/*
+ * Page cache pages handed to a pipe. The page may still be under read
+ * I/O when it is inserted, so ->map() has to wait for it and verify
+ * that the read actually succeeded.
+ */
+static void page_cache_pipe_buf_release(struct pipe_inode_info *info,
+					struct pipe_buffer *buf)
+{
+	page_cache_release(buf->page);
+}
+
+static void *page_cache_pipe_buf_map(struct file *file,
+				     struct pipe_inode_info *info,
+				     struct pipe_buffer *buf)
+{
+	struct page *page = buf->page;
+
+	if (!PageUptodate(page)) {
+		lock_page(page);
+
+		/*
+		 * Page got truncated/unhashed. This will cause a 0-byte
+		 * splice, if this is the first page.
+		 */
+		if (!page->mapping) {
+			unlock_page(page);
+			return ERR_PTR(-ENODATA);
+		}
+
+		/*
+		 * Uh oh, read-error from disk.
+		 */
+		if (!PageUptodate(page)) {
+			unlock_page(page);
+			return ERR_PTR(-EIO);
+		}
+
+		unlock_page(page);
+	}
+
+	return kmap(page);
+}
+
+static void page_cache_pipe_buf_unmap(struct pipe_inode_info *info,
+				      struct pipe_buffer *buf)
+{
+	kunmap(buf->page);
+}
+
+static void page_cache_pipe_buf_get(struct pipe_inode_info *info,
+				    struct pipe_buffer *buf)
+{
+	page_cache_get(buf->page);
+}
+
+static struct pipe_buf_operations page_cache_pipe_buf_ops = {
+	.can_merge = 0,
+	.map = page_cache_pipe_buf_map,
+	.unmap = page_cache_pipe_buf_unmap,
+	.release = page_cache_pipe_buf_release,
+	.get = page_cache_pipe_buf_get,
+};
+
+/**
+ * splice_to_pipe - fill a pipe with page references
+ * @inode:	the pipe inode
+ * @pages:	the pages to insert, the references are owned by the pipe
+ *		afterwards
+ * @partial:	offset and length of the data within each page
+ * @nr_pages:	number of entries in @pages
+ * @flags:	splice flags
+ * @ops:	buffer operations for the inserted pages
+ *
+ * Waits for room in the pipe unless SPLICE_F_NONBLOCK is given. Pages
+ * that could not be inserted are released. Returns the number of bytes
+ * added to the pipe, or a negative error if nothing was added.
+ */
+ssize_t splice_to_pipe(struct inode *inode, struct page **pages,
+		       struct partial_page *partial, int nr_pages,
+		       unsigned int flags, struct pipe_buf_operations *ops)
+{
+	struct pipe_inode_info *info;
+	int do_wakeup = 0, i = 0;
+	ssize_t ret = 0;
+
+	mutex_lock(PIPE_MUTEX(*inode));
+	info = inode->i_pipe;
+
+	for (;;) {
+		int bufs;
+
+		if (!PIPE_READERS(*inode)) {
+			send_sig(SIGPIPE, current, 0);
+			if (!ret)
+				ret = -EPIPE;
+			break;
+		}
+
+		bufs = info->nrbufs;
+		if (bufs < PIPE_BUFFERS) {
+			int newbuf = (info->curbuf + bufs) & (PIPE_BUFFERS - 1);
+			struct pipe_buffer *buf = info->bufs + newbuf;
+
+			buf->page = pages[i];
+			buf->offset = partial[i].offset;
+			buf->len = partial[i].len;
+			buf->ops = ops;
+			info->nrbufs = ++bufs;
+			do_wakeup = 1;
+
+			ret += buf->len;
+			if (++i == nr_pages)
+				break;
+			if (bufs < PIPE_BUFFERS)
+				continue;
+		}
+
+		if (flags & SPLICE_F_NONBLOCK) {
+			if (!ret)
+				ret = -EAGAIN;
+			break;
+		}
+
+		if (signal_pending(current)) {
+			if (!ret)
+				ret = -ERESTARTSYS;
+			break;
+		}
+
+		if (do_wakeup) {
+			wake_up_interruptible_sync(PIPE_WAIT(*inode));
+			kill_fasync(PIPE_FASYNC_READERS(*inode), SIGIO, POLL_IN);
+			do_wakeup = 0;
+		}
+
+		PIPE_WAITING_WRITERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_WRITERS(*inode)--;
+	}
+
+	mutex_unlock(PIPE_MUTEX(*inode));
+
+	if (do_wakeup) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		kill_fasync(PIPE_FASYNC_READERS(*inode), SIGIO, POLL_IN);
+	}
+
+	while (i < nr_pages)
+		page_cache_release(pages[i++]);
+
+	return ret;
+}
+EXPORT_SYMBOL(splice_to_pipe);
+
+static int __generic_file_splice_read(struct file *in, loff_t *ppos,
+				      struct inode *pipe, size_t len,
+				      unsigned int flags)
+{
+	struct address_space *mapping = in->f_mapping;
+	struct inode *inode = mapping->host;
+	struct page *pages[PIPE_BUFFERS];
+	struct partial_page partial[PIPE_BUFFERS];
+	unsigned int offset;
+	unsigned long index, end_index, nr_pages;
+	loff_t isize;
+	int i, error = 0;
+
+	isize = i_size_read(inode);
+	if (*ppos >= isize)
+		return 0;
+	if (len > isize - *ppos)
+		len = isize - *ppos;
+
+	index = *ppos >> PAGE_CACHE_SHIFT;
+	offset = *ppos & ~PAGE_CACHE_MASK;
+	end_index = (isize - 1) >> PAGE_CACHE_SHIFT;
+	nr_pages = (len + offset + PAGE_CACHE_SIZE - 1) >> PAGE_CACHE_SHIFT;
+	if (nr_pages > PIPE_BUFFERS)
+		nr_pages = PIPE_BUFFERS;
+
+	for (i = 0; i < nr_pages && len; i++, index++) {
+		unsigned int this_len;
+		struct page *page;
+
+		if (index > end_index)
+			break;
+
+		this_len = PAGE_CACHE_SIZE - offset;
+		if (this_len > len)
+			this_len = len;
+find_page:
+		page = find_get_page(mapping, index);
+		if (!page) {
+			/*
+			 * Read-ahead the rest of the range, the pages are only
+			 * waited upon when the pipe reader maps them.
+			 */
+			page_cache_sync_readahead(mapping, &in->f_ra, in,
+						  index, nr_pages - i);
+			page = find_get_page(mapping, index);
+		}
+		if (!page) {
+			page = page_cache_alloc_cold(mapping);
+			if (!page) {
+				error = -ENOMEM;
+				break;
+			}
+
+			error = add_to_page_cache_lru(page, mapping, index,
+						      GFP_KERNEL);
+			if (unlikely(error)) {
+				page_cache_release(page);
+				if (error == -EEXIST)
+					goto find_page;
+				break;
+			}
+
+			/* the page is locked and not uptodate, read it */
+			goto readpage;
+		}
+
+		if (PageReadahead(page))
+			page_cache_async_readahead(mapping, &in->f_ra, in,
+						   page, index, nr_pages - i);
+
+		if (!PageUptodate(page)) {
+			lock_page(page);
+
+			/* Truncated under us? */
+			if (!page->mapping) {
+				unlock_page(page);
+				page_cache_release(page);
+				goto find_page;
+			}
+
+			if (PageUptodate(page)) {
+				unlock_page(page);
+				goto fill_it;
+			}
+readpage:
+			/* ->readpage unlocks the page once the I/O is done */
+			error = mapping->a_ops->readpage(in, page);
+			if (unlikely(error)) {
+				page_cache_release(page);
+				if (error == AOP_TRUNCATED_PAGE)
+					goto find_page;
+				break;
+			}
+		}
+fill_it:
+		mark_page_accessed(page);
+		pages[i] = page;
+		partial[i].offset = offset;
+		partial[i].len = this_len;
+		len -= this_len;
+		offset = 0;
+	}
+
+	if (i) {
+		in->f_ra.prev_index = index - 1;
+		return splice_to_pipe(pipe, pages, partial, i, flags,
+				      &page_cache_pipe_buf_ops);
+	}
+
+	return error;
+}
+
+/**
+ * generic_file_splice_read - splice data from file to a pipe
+ * @in:		file to splice from
+ * @ppos:	position in @in, updated by the amount spliced
+ * @pipe:	pipe inode to splice to
+ * @len:	number of bytes to splice
+ * @flags:	splice modifier flags
+ *
+ * Will read pages from given file and fill them into a pipe.
+ */
+ssize_t generic_file_splice_read(struct file *in, loff_t *ppos,
+				 struct inode *pipe, size_t len,
+				 unsigned int flags)
+{
+	ssize_t spliced;
+	int ret;
+
+	ret = 0;
+	spliced = 0;
+	while (len) {
+		ret = __generic_file_splice_read(in, ppos, pipe, len, flags);
+
+		if (ret <= 0)
+			break;
+
+		*ppos += ret;
+		len -= ret;
+		spliced += ret;
+
+		if (!(flags & SPLICE_F_NONBLOCK))
+			continue;
+
+		/* don't loop around for a nonblocking splice */
+		break;
+	}
+
+	if (spliced) {
+		file_accessed(in);
+		return spliced;
+	}
+
+	return ret;
+}
+
+EXPORT_SYMBOL(generic_file_splice_read);
+
+/*
+ * Send 'sd->len' bytes to socket from 'sd->file' at position 'sd->pos'
+ * using sendpage().
+ */
+static int pipe_to_sendpage(struct pipe_inode_info *info,
+			    struct pipe_buffer *buf, struct splice_desc *sd)
+{
+	struct file *file = sd->file;
+	loff_t pos = sd->pos;
+	int ret, more;
+	void *ptr;
+
+	/*
+	 * We don't need the kernel mapping, but ->map() is what makes
+	 * sure a page cache page has been read in successfully.
+	 */
+	ptr = buf->ops->map(file, info, buf);
+	if (IS_ERR(ptr))
+		return PTR_ERR(ptr);
+
+	more = (sd->flags & SPLICE_F_MORE) || sd->len < sd->total_len;
+
+	ret = file->f_op->sendpage(file, buf->page, buf->offset, sd->len,
+				   &pos, more);
+
+	buf->ops->unmap(info, buf);
+	return ret;
+}
+
+/*
+ * This is a little more tricky than the file -> pipe splicing. The pipe
+ * page may be shared with other pipes (tee) or still be part of another
+ * file's page cache, so it cannot simply be inserted into our mapping.
+ * We copy the data into the destination page cache page instead, which
+ * is the one copy a regular write() would have done too.
+ */
+static int pipe_to_file(struct pipe_inode_info *info, struct pipe_buffer *buf,
+			struct splice_desc *sd)
+{
+	struct file *file = sd->file;
+	struct address_space *mapping = file->f_mapping;
+	struct inode *inode = mapping->host;
+	unsigned int offset, this_len;
+	unsigned long index;
+	struct page *page;
+	char *src, *dst;
+	int ret;
+
+	src = buf->ops->map(file, info, buf);
+	if (IS_ERR(src))
+		return PTR_ERR(src);
+
+	index = sd->pos >> PAGE_CACHE_SHIFT;
+	offset = sd->pos & ~PAGE_CACHE_MASK;
+
+	this_len = sd->len;
+	if (this_len + offset > PAGE_CACHE_SIZE)
+		this_len = PAGE_CACHE_SIZE - offset;
+
+	mutex_lock(&inode->i_mutex);
+find_page:
+	page = find_or_create_page(mapping, index, mapping_gfp_mask(mapping));
+	if (!page) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = mapping->a_ops->prepare_write(file, page, offset,
+					    offset + this_len);
+	if (unlikely(ret)) {
+		loff_t isize = i_size_read(inode);
+
+		if (ret != AOP_TRUNCATED_PAGE)
+			unlock_page(page);
+		page_cache_release(page);
+		if (ret == AOP_TRUNCATED_PAGE)
+			goto find_page;
+
+		/*
+		 * prepare_write() may have instantiated a few blocks
+		 * outside i_size.  Trim these off again.
+		 */
+		if (sd->pos + this_len > isize)
+			vmtruncate(inode, isize);
+		goto out;
+	}
+
+	dst = kmap_atomic(page, KM_USER0);
+	memcpy(dst + offset, src + buf->offset, this_len);
+	flush_dcache_page(page);
+	kunmap_atomic(dst, KM_USER0);
+
+	ret = mapping->a_ops->commit_write(file, page, offset,
+					   offset + this_len);
+	if (ret == AOP_TRUNCATED_PAGE) {
+		page_cache_release(page);
+		goto find_page;
+	}
+	if (!ret)
+		ret = this_len;
+
+	unlock_page(page);
+	mark_page_accessed(page);
+	page_cache_release(page);
+out:
+	mutex_unlock(&inode->i_mutex);
+	buf->ops->unmap(info, buf);
+	return ret;
+}
+
+/**
+ * splice_from_pipe - feed the contents of a pipe to an actor
+ * @inode:	the pipe inode
+ * @out:	the file handed to @actor
+ * @ppos:	position in @out, updated by the amount consumed
+ * @len:	maximum number of bytes to consume
+ * @flags:	splice flags
+ * @actor:	called for each (partial) pipe buffer, returns the number
+ *		of bytes it consumed or a negative error
+ *
+ * Pipe input worker. Most of this logic works like a regular pipe, the
+ * key here is the 'actor' worker passed in that actually moves the data
+ * to the wanted destination.
+ */
+ssize_t splice_from_pipe(struct inode *inode, struct file *out, loff_t *ppos,
+			 size_t len, unsigned int flags, splice_actor *actor)
+{
+	struct pipe_inode_info *info;
+	int do_wakeup = 0;
+	ssize_t ret = 0;
+	struct splice_desc sd;
+
+	sd.total_len = len;
+	sd.flags = flags;
+	sd.file = out;
+	sd.pos = *ppos;
+
+	mutex_lock(PIPE_MUTEX(*inode));
+	info = inode->i_pipe;
+
+	for (;;) {
+		int bufs = info->nrbufs;
+
+		if (bufs) {
+			int curbuf = info->curbuf;
+			struct pipe_buffer *buf = info->bufs + curbuf;
+			struct pipe_buf_operations *ops = buf->ops;
+			int err;
+
+			sd.len = buf->len;
+			if (sd.len > sd.total_len)
+				sd.len = sd.total_len;
+
+			err = actor(info, buf, &sd);
+			if (err == -ENODATA) {
+				/* page was truncated under us, drop it */
+				buf->len = 0;
+			} else if (err <= 0) {
+				if (!ret)
+					ret = err;
+				break;
+			} else {
+				ret += err;
+				buf->offset += err;
+				buf->len -= err;
+				sd.pos += err;
+				sd.total_len -= err;
+			}
+
+			if (!buf->len) {
+				buf->ops = NULL;
+				ops->release(info, buf);
+				curbuf = (curbuf + 1) & (PIPE_BUFFERS - 1);
+				info->curbuf = curbuf;
+				info->nrbufs = --bufs;
+				do_wakeup = 1;
+			}
+
+			if (!sd.total_len)
+				break;
+
+			/* short write from the actor, stop here */
+			if (err > 0 && err < sd.len)
+				break;
+		}
+
+		if (bufs)
+			continue;
+		if (!PIPE_WRITERS(*inode))
+			break;
+		if (!PIPE_WAITING_WRITERS(*inode)) {
+			if (ret)
+				break;
+			if (flags & SPLICE_F_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+		}
+
+		if (signal_pending(current)) {
+			if (!ret)
+				ret = -ERESTARTSYS;
+			break;
+		}
+
+		if (do_wakeup) {
+			wake_up_interruptible_sync(PIPE_WAIT(*inode));
+			kill_fasync(PIPE_FASYNC_WRITERS(*inode), SIGIO, POLL_OUT);
+			do_wakeup = 0;
+		}
+
+		pipe_wait(inode);
+	}
+
+	mutex_unlock(PIPE_MUTEX(*inode));
+
+	if (do_wakeup) {
+		wake_up_interruptible(PIPE_WAIT(*inode));
+		kill_fasync(PIPE_FASYNC_WRITERS(*inode), SIGIO, POLL_OUT);
+	}
+
+	*ppos = sd.pos;
+	return ret;
+}
+EXPORT_SYMBOL(splice_from_pipe);
+
+/**
+ * generic_file_splice_write - splice data from a pipe to a file
+ * @pipe:	pipe inode
+ * @out:	file to write to
+ * @ppos:	position in @out
+ * @len:	number of bytes to splice
+ * @flags:	splice modifier flags
+ *
+ * Will either move or copy pages (determined by @flags options) from
+ * the given pipe inode to the given file.
+ */
+ssize_t generic_file_splice_write(struct inode *pipe, struct file *out,
+				  loff_t *ppos, size_t len, unsigned int flags)
+{
+	struct address_space *mapping = out->f_mapping;
+	struct inode *inode = mapping->host;
+	ssize_t ret;
+	int err;
+
+	mutex_lock(&inode->i_mutex);
+	err = generic_write_checks(out, ppos, &len, S_ISBLK(inode->i_mode));
+	if (!err && len) {
+		err = remove_suid(out->f_dentry);
+		if (!err)
+			file_update_time(out);
+	}
+	mutex_unlock(&inode->i_mutex);
+	if (unlikely(err))
+		return err;
+	if (!len)
+		return 0;
+
+	ret = splice_from_pipe(pipe, out, ppos, len, flags, pipe_to_file);
+
+	/*
+	 * If file or inode is SYNC and we actually wrote some data, sync it.
+	 */
+	if (unlikely((out->f_flags & O_SYNC) || IS_SYNC(inode)) && ret > 0) {
+		mutex_lock(&inode->i_mutex);
+		err = generic_osync_inode(inode, mapping,
+					  OSYNC_METADATA|OSYNC_DATA);
+		mutex_unlock(&inode->i_mutex);
+
+		if (err)
+			ret = err;
+	}
+
+	if (ret > 0)
+		balance_dirty_pages_ratelimited(mapping);
+
+	return ret;
+}
+
+EXPORT_SYMBOL(generic_file_splice_write);
+
+/**
+ * generic_splice_sendpage - splice data from a pipe to a socket
+ * @pipe:	pipe inode
+ * @out:	socket to write to
+ * @ppos:	position in @out
+ * @len:	number of bytes to splice
+ * @flags:	splice modifier flags
+ *
+ * Will send @len bytes from the pipe to a network socket. No data copying
+ * is involved.
+ */
+ssize_t generic_splice_sendpage(struct inode *pipe, struct file *out,
+				loff_t *ppos, size_t len, unsigned int flags)
+{
+	return splice_from_pipe(pipe, out, ppos, len, flags, pipe_to_sendpage);
+}
+
+EXPORT_SYMBOL(generic_splice_sendpage);
+
+/*
+ * Attempt to initiate a splice from pipe to file.
+ */
+static long do_splice_from(struct inode *pipe, struct file *out,
+			   loff_t *ppos, size_t len, unsigned int flags)
+{
+	int ret;
+
+	if (unlikely(!out->f_op || !out->f_op->splice_write))
+		return -EINVAL;
+
+	if (unlikely(!(out->f_mode & FMODE_WRITE)))
+		return -EBADF;
+
+	ret = rw_verify_area(WRITE, out, ppos, len);
+	if (unlikely(ret < 0))
+		return ret;
+	len = ret;
+
+	ret = security_file_permission(out, MAY_WRITE);
+	if (unlikely(ret < 0))
+		return ret;
+
+	return out->f_op->splice_write(pipe, out, ppos, len, flags);
+}
+
+/*
+ * Attempt to initiate a splice from a file to a pipe.
+ */
+static long do_splice_to(struct file *in, loff_t *ppos, struct inode *pipe,
+			 size_t len, unsigned int flags)
+{
+	int ret;
+
+	if (unlikely(!in->f_op || !in->f_op->splice_read))
+		return -EINVAL;
+
+	if (unlikely(!(in->f_mode & FMODE_READ)))
+		return -EBADF;
+
+	ret = rw_verify_area(READ, in, ppos, len);
+	if (unlikely(ret < 0))
+		return ret;
+	len = ret;
+
+	ret = security_file_permission(in, MAY_READ);
+	if (unlikely(ret < 0))
+		return ret;
+
+	return in->f_op->splice_read(in, ppos, pipe, len, flags);
+}
+
+/*
+ * Determine where to splice to/from.
+ */
+static long do_splice(struct file *in, loff_t __user *off_in,
+		      struct file *out, loff_t __user *off_out,
+		      size_t len, unsigned int flags)
+{
+	struct inode *pipe;
+	loff_t offset, *off;
+	long ret;
+
+	pipe = in->f_dentry->d_inode;
+	if (pipe->i_pipe) {
+		if (off_in)
+			return -ESPIPE;
+		if (off_out) {
+			if (!(out->f_mode & FMODE_PWRITE))
+				return -EINVAL;
+			if (copy_from_user(&offset, off_out, sizeof(loff_t)))
+				return -EFAULT;
+			off = &offset;
+		} else
+			off = &out->f_pos;
+
+		ret = do_splice_from(pipe, out, off, len, flags);
+
+		if (off_out && copy_to_user(off_out, off, sizeof(loff_t)))
+			ret = -EFAULT;
+
+		return ret;
+	}
+
+	pipe = out->f_dentry->d_inode;
+	if (pipe->i_pipe) {
+		if (off_out)
+			return -ESPIPE;
+		if (off_in) {
+			if (!(in->f_mode & FMODE_PREAD))
+				return -EINVAL;
+			if (copy_from_user(&offset, off_in, sizeof(loff_t)))
+				return -EFAULT;
+			off = &offset;
+		} else
+			off = &in->f_pos;
+
+		ret = do_splice_to(in, off, pipe, len, flags);
+
+		if (off_in && copy_to_user(off_in, off, sizeof(loff_t)))
+			ret = -EFAULT;
+
+		return ret;
+	}
+
+	return -EINVAL;
+}
+
+asmlinkage long sys_splice(int fd_in, loff_t __user *off_in,
+			   int fd_out, loff_t __user *off_out,
+			   size_t len, unsigned int flags)
+{
+	long error;
+	struct file *in, *out;
+	int fput_in, fput_out;
+
+	if (unlikely(!len))
+		return 0;
+
+	error = -EBADF;
+	in = fget_light(fd_in, &fput_in);
+	if (in) {
+		if (in->f_mode & FMODE_READ) {
+			out = fget_light(fd_out, &fput_out);
+			if (out) {
+				if (out->f_mode & FMODE_WRITE)
+					error = do_splice(in, off_in,
+							  out, off_out,
+							  len, flags);
+				fput_light(out, fput_out);
+			}
+		}
+
+		fput_light(in, fput_in);
+	}
+
+	return error;
+}
+
+/*
+ * Make sure there's data to read. Wait for input if we can, otherwise
+ * return an appropriate error.
+ */
+static int link_ipipe_prep(struct inode *inode, unsigned int flags)
+{
+	struct pipe_inode_info *info;
+	int ret = 0;
+
+	/*
+	 * Check ->nrbufs without the inode lock first. This function
+	 * is speculative anyways, so missing one is ok.
+	 */
+	if (inode->i_pipe->nrbufs)
+		return 0;
+
+	mutex_lock(PIPE_MUTEX(*inode));
+	info = inode->i_pipe;
+
+	while (!info->nrbufs) {
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		if (!PIPE_WRITERS(*inode))
+			break;
+		if (!PIPE_WAITING_WRITERS(*inode)) {
+			if (flags & SPLICE_F_NONBLOCK) {
+				ret = -EAGAIN;
+				break;
+			}
+		}
+		pipe_wait(inode);
+	}
+
+	mutex_unlock(PIPE_MUTEX(*inode));
+	return ret;
+}
+
+/*
+ * Make sure there's writeable room. Wait for room if we can, otherwise
+ * return an appropriate error.
+ */
+static int link_opipe_prep(struct inode *inode, unsigned int flags)
+{
+	struct pipe_inode_info *info;
+	int ret = 0;
+
+	/*
+	 * Check ->nrbufs without the inode lock first. This function
+	 * is speculative anyways, so missing one is ok.
+	 */
+	if (inode->i_pipe->nrbufs < PIPE_BUFFERS)
+		return 0;
+
+	mutex_lock(PIPE_MUTEX(*inode));
+	info = inode->i_pipe;
+
+	while (info->nrbufs >= PIPE_BUFFERS) {
+		if (!PIPE_READERS(*inode)) {
+			send_sig(SIGPIPE, current, 0);
+			ret = -EPIPE;
+			break;
+		}
+		if (flags & SPLICE_F_NONBLOCK) {
+			ret = -EAGAIN;
+			break;
+		}
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			break;
+		}
+		PIPE_WAITING_WRITERS(*inode)++;
+		pipe_wait(inode);
+		PIPE_WAITING_WRITERS(*inode)--;
+	}
+
+	mutex_unlock(PIPE_MUTEX(*inode));
+	return ret;
+}
+
+/*
+ * Link contents of ipipe to opipe.
+ */
+static long link_pipe(struct inode *ipipe, struct inode *opipe,
+		      size_t len, unsigned int flags)
+{
+	struct pipe_inode_info *ipi, *opi;
+	long ret = 0;
+	int i = 0;
+
+	/*
+	 * Potential ABBA deadlock, work around it by ordering lock
+	 * grabbing by inode address. Otherwise two different processes
+	 * could deadlock (one doing tee from A -> B, the other from B -> A).
+	 */
+	if (ipipe < opipe) {
+		mutex_lock(PIPE_MUTEX(*ipipe));
+		mutex_lock(PIPE_MUTEX(*opipe));
+	} else {
+		mutex_lock(PIPE_MUTEX(*opipe));
+		mutex_lock(PIPE_MUTEX(*ipipe));
+	}
+	ipi = ipipe->i_pipe;
+	opi = opipe->i_pipe;
+
+	do {
+		struct pipe_buffer *ibuf, *obuf;
+		int nbuf;
+
+		if (!PIPE_READERS(*opipe)) {
+			send_sig(SIGPIPE, current, 0);
+			if (!ret)
+				ret = -EPIPE;
+			break;
+		}
+
+		/*
+		 * If we have iterated all input buffers or ran out of
+		 * output room, break.
+		 */
+		if (i >= ipi->nrbufs || opi->nrbufs >= PIPE_BUFFERS)
+			break;
+
+		ibuf = ipi->bufs + ((ipi->curbuf + i) & (PIPE_BUFFERS - 1));
+		nbuf = (opi->curbuf + opi->nrbufs) & (PIPE_BUFFERS - 1);
+
+		/*
+		 * Get a reference to this pipe buffer,
+		 * so we can copy the contents over.
+		 */
+		ibuf->ops->get(ipi, ibuf);
+
+		obuf = opi->bufs + nbuf;
+		*obuf = *ibuf;
+
+		if (obuf->len > len)
+			obuf->len = len;
+
+		opi->nrbufs++;
+		ret += obuf->len;
+		len -= obuf->len;
+		i++;
+	} while (len);
+
+	mutex_unlock(PIPE_MUTEX(*ipipe));
+	mutex_unlock(PIPE_MUTEX(*opipe));
+
+	/*
+	 * If we put data in the output pipe, wakeup any potential readers.
+	 */
+	if (ret > 0) {
+		wake_up_interruptible(PIPE_WAIT(*opipe));
+		kill_fasync(PIPE_FASYNC_READERS(*opipe), SIGIO, POLL_IN);
+	}
+
+	return ret;
+}
+
+/*
+ * This is a tee(1) implementation that works on pipes. It doesn't copy
+ * any data, it simply references the 'in' pages on the 'out' pipe.
+ * The 'flags' used are the SPLICE_F_* variants, currently the only
+ * applicable one is SPLICE_F_NONBLOCK.
+ */
+static long do_tee(struct file *in, struct file *out, size_t len,
+		   unsigned int flags)
+{
+	struct inode *ipipe = in->f_dentry->d_inode;
+	struct inode *opipe = out->f_dentry->d_inode;
+	long ret = -EINVAL;
+
+	/*
+	 * Duplicate the contents of ipipe to opipe without actually
+	 * copying the data.
+	 */
+	if (ipipe->i_pipe && opipe->i_pipe && ipipe != opipe) {
+		/*
+		 * Keep going, unless we encounter an error. The ipipe/opipe
+		 * ordering doesn't really matter.
+		 */
+		ret = link_ipipe_prep(ipipe, flags);
+		if (!ret) {
+			ret = link_opipe_prep(opipe, flags);
+			if (!ret)
+				ret = link_pipe(ipipe, opipe, len, flags);
+		}
+	}
+
+	return ret;
+}
+
+asmlinkage long sys_tee(int fdin, int fdout, size_t len, unsigned int flags)
+{
+	struct file *in, *out;
+	int fput_in, fput_out;
+	long error;
+
+	if (unlikely(!len))
+		return 0;
+
+	error = -EBADF;
+	in = fget_light(fdin, &fput_in);
+	if (in) {
+		if (in->f_mode & FMODE_READ) {
+			out = fget_light(fdout, &fput_out);
+			if (out) {
+				if (out->f_mode & FMODE_WRITE)
+					error = do_tee(in, out, len, flags);
+				fput_light(out, fput_out);
+			}
+		}
+		fput_light(in, fput_in);
+	}
+
+	return error;
+}
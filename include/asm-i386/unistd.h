@@ -300,8 +300,10 @@
 #define __NR_inotify_add_watch	292
 #define __NR_inotify_rm_watch	293
 #define __NR_migrate_pages	294
+#define __NR_splice		295
+#define __NR_tee		296
 
-#define NR_syscalls 295
+#define NR_syscalls 297
 
 /*
  * user-visible error numbers are in the range -1 - -128: see
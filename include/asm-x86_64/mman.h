@@ -37,6 +37,10 @@
 #define MADV_WILLNEED	0x3		/* pre-fault pages */
 #define MADV_DONTNEED	0x4		/* discard these pages */
 #define MADV_REMOVE	0x5		/* remove these pages & resources */
+#define MADV_MERGEABLE	0xc		/* KSM may merge identical pages */
+#define MADV_UNMERGEABLE 0xd		/* KSM may not merge identical pages */
+#define MADV_HUGEPAGE	0xe		/* back with transparent huge pages */
+#define MADV_NOHUGEPAGE	0xf		/* never use transparent huge pages */
 
 /* compatibility flags */
 #define MAP_ANON	MAP_ANONYMOUS
@@ -317,6 +317,22 @@ static inline int pmd_large(pmd_t pte) {
 	return (pmd_val(pte) & __LARGE_PTE) == __LARGE_PTE; 
 } 	
 
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+/*
+ * A transparent huge page is mapped by a user pmd with _PAGE_PSE set.
+ * While it is being split the pmd is made non-present but keeps the
+ * _PAGE_PSE bit, so that it still reads as huge rather than as none.
+ */
+#define pmd_trans_huge(pmd)	(pmd_val(pmd) & _PAGE_PSE)
+#define pmd_pgprot(pmd)		__pgprot(pmd_val(pmd) & ~(PTE_MASK | _PAGE_PSE))
+static inline int pmd_write(pmd_t pmd)		{ return pmd_val(pmd) & _PAGE_RW; }
+static inline int pmd_dirty(pmd_t pmd)		{ return pmd_val(pmd) & _PAGE_DIRTY; }
+static inline pmd_t pmd_mkhuge(pmd_t pmd)	{ return __pmd(pmd_val(pmd) | _PAGE_PSE); }
+static inline pmd_t pmd_mkwrite(pmd_t pmd)	{ return __pmd(pmd_val(pmd) | _PAGE_RW); }
+static inline pmd_t pmd_mkdirty(pmd_t pmd)	{ return __pmd(pmd_val(pmd) | _PAGE_DIRTY); }
+static inline pmd_t pmd_mknotpresent(pmd_t pmd)	{ return __pmd(pmd_val(pmd) & ~_PAGE_PRESENT); }
+#endif
+
 
 /*
  * Conversion functions: convert a page and protection to a page entry,
@@ -347,7 +363,7 @@ static inline pud_t *__pud_offset_k(pud_t *pud, unsigned long address)
 
 /* PMD  - Level 2 access */
 #define pmd_page_kernel(pmd) ((unsigned long) __va(pmd_val(pmd) & PTE_MASK))
-#define pmd_page(pmd)		(pfn_to_page(pmd_val(pmd) >> PAGE_SHIFT))
+#define pmd_page(pmd)		(pfn_to_page(pmd_pfn(pmd)))
 
 #define pmd_index(address) (((address) >> PMD_SHIFT) & (PTRS_PER_PMD-1))
 #define pmd_offset(dir, address) ((pmd_t *) pud_page(*(dir)) + \
@@ -367,6 +383,7 @@ static inline pud_t *__pud_offset_k(pud_t *pud, unsigned long address)
 
 /* page, protection -> pte */
 #define mk_pte(page, pgprot)	pfn_pte(page_to_pfn(page), (pgprot))
+#define mk_pmd(page, pgprot)	pfn_pmd(page_to_pfn(page), (pgprot))
 #define mk_pte_huge(entry) (pte_val(entry) |= _PAGE_PRESENT | _PAGE_PSE)
  
 /* physical address -> PTE */
@@ -573,8 +573,12 @@ __SYSCALL(__NR_inotify_add_watch, sys_inotify_add_watch)
 __SYSCALL(__NR_inotify_rm_watch, sys_inotify_rm_watch)
 #define __NR_migrate_pages	256
 __SYSCALL(__NR_migrate_pages, sys_migrate_pages)
+#define __NR_splice		257
+__SYSCALL(__NR_splice, sys_splice)
+#define __NR_tee		258
+__SYSCALL(__NR_tee, sys_tee)
 
-#define __NR_syscall_max __NR_migrate_pages
+#define __NR_syscall_max __NR_tee
 #ifndef __NO_STUBS
 
 /* user-visible error numbers are in the range -1 - -4095 */
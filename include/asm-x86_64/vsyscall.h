@@ -22,6 +22,10 @@ enum vsyscall_num {
 #define __section_sysctl_vsyscall __attribute__ ((unused, __section__ (".sysctl_vsyscall"), aligned(16)))
 #define __section_xtime __attribute__ ((unused, __section__ (".xtime"), aligned(16)))
 #define __section_xtime_lock __attribute__ ((unused, __section__ (".xtime_lock"), aligned(16)))
+#define __section_vsyscall_gtod_data __attribute__ ((unused, __section__ (".vsyscall_gtod_data"), aligned(16)))
+
+/* functions called from the vsyscall page, e.g. to read a clocksource */
+#define __vsyscall_fn __attribute__ ((unused, __section__(".vsyscall_fn")))
 
 #define VXTIME_TSC	1
 #define VXTIME_HPET	2
@@ -46,9 +50,11 @@ extern volatile unsigned long __jiffies;
 extern unsigned long __wall_jiffies;
 extern struct timezone __sys_tz;
 extern seqlock_t __xtime_lock;
+extern struct vsyscall_gtod_data_t __vsyscall_gtod_data;
 
 /* kernel space (writeable) */
 extern struct vxtime_data vxtime;
+extern struct vsyscall_gtod_data_t vsyscall_gtod_data;
 extern unsigned long wall_jiffies;
 extern struct timezone sys_tz;
 extern int sysctl_vsyscall;
@@ -8,18 +8,34 @@
 #ifndef _LINUX_BACKING_DEV_H
 #define _LINUX_BACKING_DEV_H
 
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/rwsem.h>
 #include <asm/atomic.h>
 
+struct task_struct;
+
 /*
  * Bits in backing_dev_info.state
  */
 enum bdi_state {
-	BDI_pdflush,		/* A pdflush thread is working this device */
+	BDI_writeback_running,	/* The flusher thread is working this device */
 	BDI_write_congested,	/* The write queue is getting full */
 	BDI_read_congested,	/* The read queue is getting full */
+	BDI_registered,		/* Has a flusher thread and dirty inode lists */
+	BDI_wb_pending,		/* Background writeout has been requested */
 	BDI_unused,		/* Available bits start here */
 };
 
+/*
+ * Per-device page counters, the device's share of the page_state ones
+ */
+enum bdi_stat_item {
+	BDI_RECLAIMABLE,	/* Dirty and unstable pages */
+	BDI_WRITEBACK,		/* Pages under writeback */
+	NR_BDI_STAT_ITEMS
+};
+
 typedef int (congested_fn)(void *, int);
 
 struct backing_dev_info {
@@ -30,6 +46,29 @@ struct backing_dev_info {
 	void *congested_data;	/* Pointer to aux data for congested func */
 	void (*unplug_io_fn)(struct backing_dev_info *, struct page *);
 	void *unplug_io_data;
+
+	/*
+	 * Writeback state, only valid once the device has been registered
+	 * with bdi_register().  The dirty inode lists are protected by
+	 * inode_lock, see fs/fs-writeback.c.
+	 */
+	struct list_head bdi_list;	/* On bdi_list, when registered */
+	struct list_head b_dirty;	/* Dirty inodes */
+	struct list_head b_io;		/* Parked for writeback */
+	struct task_struct *wb_task;	/* The flusher thread */
+	spinlock_t wb_lock;		/* Protects wb_nr_pages */
+	long wb_nr_pages;		/* Pages requested for writeout */
+	unsigned long wb_next_kupdate;	/* When to write back old data */
+
+	/*
+	 * Dirty page accounting, see mm/page-writeback.c.  All zeroes is a
+	 * valid initial state, so that statically defined devices need no
+	 * setup.
+	 */
+	atomic_t stat[NR_BDI_STAT_ITEMS];
+	atomic_t completions;		/* Recent writeout completions */
+	unsigned int completions_period; /* Period completions was aged to */
+	int dirty_exceeded;		/* Over its share of the dirty limit */
 };
 
 
@@ -61,10 +100,62 @@ struct backing_dev_info {
 extern struct backing_dev_info default_backing_dev_info;
 void default_unplug_io_fn(struct backing_dev_info *bdi, struct page *page);
 
+/* mm/backing-dev.c */
+extern struct list_head bdi_list;
+extern struct rw_semaphore bdi_list_sem;
+
+int bdi_register(struct backing_dev_info *bdi, const char *name);
+void bdi_unregister(struct backing_dev_info *bdi);
+void bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages);
+void bdi_start_writeback_all(long nr_pages);
+void bdi_reset_kupdate(void);
+
+static inline int bdi_registered(struct backing_dev_info *bdi)
+{
+	return test_bit(BDI_registered, &bdi->state);
+}
+
 int writeback_acquire(struct backing_dev_info *bdi);
 int writeback_in_progress(struct backing_dev_info *bdi);
 void writeback_release(struct backing_dev_info *bdi);
 
+static inline void inc_bdi_stat(struct backing_dev_info *bdi,
+				enum bdi_stat_item item)
+{
+	atomic_inc(&bdi->stat[item]);
+}
+
+static inline void dec_bdi_stat(struct backing_dev_info *bdi,
+				enum bdi_stat_item item)
+{
+	atomic_dec(&bdi->stat[item]);
+}
+
+static inline void add_bdi_stat(struct backing_dev_info *bdi,
+				enum bdi_stat_item item, int delta)
+{
+	atomic_add(delta, &bdi->stat[item]);
+}
+
+static inline void sub_bdi_stat(struct backing_dev_info *bdi,
+				enum bdi_stat_item item, int delta)
+{
+	atomic_sub(delta, &bdi->stat[item]);
+}
+
+/*
+ * A page can be unaccounted against another device than the one it was
+ * accounted to, when a blockdev mapping changes its backing_dev_info on
+ * open, so don't let a counter appear to go negative.
+ */
+static inline unsigned long bdi_stat(struct backing_dev_info *bdi,
+				     enum bdi_stat_item item)
+{
+	int val = atomic_read(&bdi->stat[item]);
+
+	return val < 0 ? 0 : val;
+}
+
 static inline int bdi_congested(struct backing_dev_info *bdi, int bdi_bits)
 {
 	if (bdi->congested_fn)
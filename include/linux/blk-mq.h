@@ -0,0 +1,111 @@
+#ifndef _LINUX_BLK_MQ_H
+#define _LINUX_BLK_MQ_H
+
+/*
+ * Multi-queue block layer.  Requests are queued on a per-cpu software
+ * context and handed straight to one of the hardware dispatch queues of
+ * the device, without going through q->queue_lock or an io scheduler.
+ */
+
+#include <linux/config.h>
+#include <linux/blkdev.h>
+#include <linux/cpumask.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+struct blk_mq_hw_ctx;
+
+/*
+ * per-cpu submission queue
+ */
+struct blk_mq_ctx {
+	spinlock_t		lock;
+	struct list_head	rq_list;
+
+	unsigned int		cpu;
+	unsigned int		index_hw;	/* index in hctx->ctxs */
+	struct blk_mq_hw_ctx	*hctx;
+} ____cacheline_aligned_in_smp;
+
+/*
+ * hardware dispatch queue
+ */
+struct blk_mq_hw_ctx {
+	spinlock_t		lock;
+	struct list_head	dispatch;	/* requests the driver bounced */
+	unsigned long		state;		/* BLK_MQ_S_* bits */
+	atomic_t		nr_active;	/* requests owned by the driver */
+
+	request_queue_t		*queue;
+	unsigned int		queue_num;
+	void			*driver_data;
+	cpumask_t		cpumask;
+
+	unsigned long		*ctx_map;	/* ctxs with pending requests */
+	struct blk_mq_ctx	**ctxs;
+	unsigned int		nr_ctx;
+
+	/*
+	 * request pool, one request per tag
+	 */
+	unsigned int		queue_depth;
+	struct request		**rqs;
+	unsigned long		*tag_map;
+	wait_queue_head_t	tag_wait;
+
+	struct work_struct	run_work;
+};
+
+typedef int (queue_rq_fn)(struct blk_mq_hw_ctx *, struct request *);
+typedef struct blk_mq_hw_ctx *(map_queue_fn)(request_queue_t *, int);
+typedef int (init_hctx_fn)(struct blk_mq_hw_ctx *, void *, unsigned int);
+
+struct blk_mq_ops {
+	/*
+	 * start a request, returns one of BLK_MQ_RQ_QUEUE_*
+	 */
+	queue_rq_fn		*queue_rq;
+
+	/*
+	 * map a cpu to a hardware queue, normally blk_mq_map_queue
+	 */
+	map_queue_fn		*map_queue;
+
+	/*
+	 * optional, called as each hardware queue is set up
+	 */
+	init_hctx_fn		*init_hctx;
+};
+
+struct blk_mq_reg {
+	struct blk_mq_ops	*ops;
+	unsigned int		nr_hw_queues;
+	unsigned int		queue_depth;	/* requests per hardware queue */
+	int			numa_node;
+};
+
+enum {
+	BLK_MQ_RQ_QUEUE_OK	= 0,	/* request was started */
+	BLK_MQ_RQ_QUEUE_BUSY	= 1,	/* out of resources, retry later */
+	BLK_MQ_RQ_QUEUE_ERROR	= 2,	/* end the request with an error */
+
+	BLK_MQ_S_STOPPED	= 0,
+
+	BLK_MQ_MAX_DEPTH	= 4096,
+};
+
+extern request_queue_t *blk_mq_init_queue(struct blk_mq_reg *, void *);
+extern struct blk_mq_hw_ctx *blk_mq_map_queue(request_queue_t *, int);
+extern void blk_mq_end_io(struct request *, int);
+extern void blk_mq_run_hw_queue(struct blk_mq_hw_ctx *, int);
+extern void blk_mq_run_queues(request_queue_t *, int);
+extern void blk_mq_stop_hw_queue(struct blk_mq_hw_ctx *);
+extern void blk_mq_start_hw_queue(struct blk_mq_hw_ctx *);
+
+static inline int blk_queue_mq(request_queue_t *q)
+{
+	return q->mq_ops != NULL;
+}
+
+#endif
@@ -22,6 +22,10 @@ typedef struct request_queue request_queue_t;
 struct elevator_queue;
 typedef struct elevator_queue elevator_t;
 struct request_pm_state;
+struct blk_mq_ops;
+struct blk_trace;
+struct blk_mq_ctx;
+struct blk_mq_hw_ctx;
 
 #define BLKDEV_MIN_RQ	4
 #define BLKDEV_MAX_RQ	128	/* Default maximum */
@@ -144,6 +148,7 @@ struct request {
 	void *completion_data;
 
 	unsigned short ioprio;
+	int cpu;			/* submitting cpu, -1 if unknown */
 
 	int rq_status;	/* should split this into a few status bits */
 	struct gendisk *rq_disk;
@@ -168,6 +173,7 @@ struct request {
 	int ref_count;
 	request_queue_t *q;
 	struct request_list *rl;
+	struct blk_mq_ctx *mq_ctx;	/* submission queue, mq mode only */
 
 	struct completion *waiting;
 	void *special;
@@ -336,6 +342,17 @@ struct request_queue
 	prepare_flush_fn	*prepare_flush_fn;
 	softirq_done_fn		*softirq_done_fn;
 
+	/*
+	 * multi-queue mode, see block/blk-mq.c
+	 */
+	struct blk_mq_ops	*mq_ops;
+	struct blk_mq_ctx	*queue_ctx;	/* per-cpu, alloc_percpu */
+	struct blk_mq_hw_ctx	**queue_hw_ctx;
+	unsigned int		nr_hw_queues;
+	unsigned int		*mq_map;	/* cpu -> hw queue */
+
+	struct blk_trace	*blk_trace;
+
 	/*
 	 * Dispatch queue sorting
 	 */
@@ -441,6 +458,7 @@ struct request_queue
 #define QUEUE_FLAG_REENTER	6	/* Re-entrancy avoidance */
 #define QUEUE_FLAG_PLUGGED	7	/* queue is plugged */
 #define QUEUE_FLAG_ELVSWITCH	8	/* don't use elevator, just do FIFO */
+#define QUEUE_FLAG_SAME_COMP	9	/* complete on the submitting cpu */
 
 enum {
 	/*
@@ -484,6 +502,7 @@ enum {
 
 #define blk_queue_plugged(q)	test_bit(QUEUE_FLAG_PLUGGED, &(q)->queue_flags)
 #define blk_queue_tagged(q)	test_bit(QUEUE_FLAG_QUEUED, &(q)->queue_flags)
+#define blk_queue_same_comp(q)	test_bit(QUEUE_FLAG_SAME_COMP, &(q)->queue_flags)
 #define blk_queue_stopped(q)	test_bit(QUEUE_FLAG_STOPPED, &(q)->queue_flags)
 #define blk_queue_flushing(q)	((q)->ordseq)
 
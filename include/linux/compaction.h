@@ -0,0 +1,30 @@
+#ifndef _LINUX_COMPACTION_H
+#define _LINUX_COMPACTION_H
+
+/* Return values for compaction, see mm/compaction.c */
+#define COMPACT_SKIPPED		0	/* compaction didn't start */
+#define COMPACT_CONTINUE	1	/* compaction should continue */
+#define COMPACT_PARTIAL		2	/* a block of the wanted order may be free */
+#define COMPACT_COMPLETE	3	/* the whole zone was compacted */
+
+struct zonelist;
+struct ctl_table;
+struct file;
+
+#ifdef CONFIG_COMPACTION
+extern int sysctl_compact_memory;
+extern int sysctl_compaction_handler(struct ctl_table *table, int write,
+		struct file *file, void __user *buffer, size_t *length,
+		loff_t *ppos);
+
+extern int try_to_compact_pages(struct zonelist *zonelist, int order,
+		gfp_t gfp_mask);
+#else
+static inline int try_to_compact_pages(struct zonelist *zonelist, int order,
+		gfp_t gfp_mask)
+{
+	return COMPACT_SKIPPED;
+}
+#endif /* CONFIG_COMPACTION */
+
+#endif /* _LINUX_COMPACTION_H */
@@ -408,6 +408,10 @@ struct ethtool_ops {
 #define ETHTOOL_GPERMADDR	0x00000020 /* Get permanent hardware address */
 #define ETHTOOL_GUFO		0x00000021 /* Get UFO enable (ethtool_value) */
 #define ETHTOOL_SUFO		0x00000022 /* Set UFO enable (ethtool_value) */
+#define ETHTOOL_GGRO		0x00000023 /* Get GRO enable (ethtool_value) */
+#define ETHTOOL_SGRO		0x00000024 /* Set GRO enable (ethtool_value) */
+#define ETHTOOL_GGSO		0x00000025 /* Get GSO enable (ethtool_value) */
+#define ETHTOOL_SGSO		0x00000026 /* Set GSO enable (ethtool_value) */
 
 /* compatibility with older code */
 #define SPARC_ETH_GSET		ETHTOOL_GSET
@@ -22,6 +22,9 @@
 #define EPOLL_CTL_DEL 2
 #define EPOLL_CTL_MOD 3
 
+/* Wake up only one of the tasks in epoll_wait() on events of the target */
+#define EPOLLEXCLUSIVE (1 << 28)
+
 /* Set the One Shot behaviour for the target file descriptor */
 #define EPOLLONESHOT (1 << 30)
 
@@ -15,6 +15,7 @@
 #ifndef _LINUX_HRTIMER_H
 #define _LINUX_HRTIMER_H
 
+#include <linux/config.h>
 #include <linux/rbtree.h>
 #include <linux/ktime.h>
 #include <linux/init.h>
@@ -82,6 +83,9 @@ struct hrtimer {
  * @resolution:	the resolution of the clock, in nanoseconds
  * @get_time:	function to retrieve the current time of the clock
  * @curr_timer:	the timer which is executing a callback right now
+ * @offset:	offset of the clock to the monotonic clock, which the
+ *		clock event devices are programmed in (high resolution
+ *		mode only)
  */
 struct hrtimer_base {
 	clockid_t		index;
@@ -91,14 +95,27 @@ struct hrtimer_base {
 	unsigned long		resolution;
 	ktime_t			(*get_time)(void);
 	struct hrtimer		*curr_timer;
+#ifdef CONFIG_HIGH_RES_TIMERS
+	ktime_t			offset;
+#endif
 };
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+struct clock_event_device;
+struct pt_regs;
+
+extern void clock_was_set(void);
+extern void hrtimer_interrupt(struct clock_event_device *dev,
+			      struct pt_regs *regs);
+extern struct pt_regs *hrtimer_get_irq_regs(void);
+#else
 /*
  * clock_was_set() is a NOP for non- high-resolution systems. The
  * time-sorted order guarantees that a timer does not expire early and
  * is expired in the next softirq when the clock was advanced.
  */
 #define clock_was_set()		do { } while (0)
+#endif
 
 /* Exported timer functions: */
 
@@ -119,12 +136,22 @@ extern int hrtimer_try_to_cancel(struct hrtimer *timer);
 extern ktime_t hrtimer_get_remaining(const struct hrtimer *timer);
 extern int hrtimer_get_res(const clockid_t which_clock, struct timespec *tp);
 
+#ifdef CONFIG_NO_HZ
+extern ktime_t hrtimer_get_next_event(void);
+#endif
+
 static inline int hrtimer_active(const struct hrtimer *timer)
 {
 	return timer->state == HRTIMER_PENDING;
 }
 
-/* Forward a hrtimer so it expires after now: */
+/*
+ * Forward a hrtimer so it expires after now. Intervals shorter than
+ * HRTIMER_MIN_INTERVAL nanoseconds are raised to it, so that a timer
+ * restarting itself cannot keep the expiry code busy for good:
+ */
+#define HRTIMER_MIN_INTERVAL	10000
+
 extern unsigned long hrtimer_forward(struct hrtimer *timer,
 				     const ktime_t interval);
 
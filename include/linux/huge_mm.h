@@ -0,0 +1,91 @@
+#ifndef _LINUX_HUGE_MM_H
+#define _LINUX_HUGE_MM_H
+
+/*
+ * Transparent huge pages for anonymous memory, see mm/huge_memory.c
+ */
+
+#define HPAGE_PMD_SHIFT		PMD_SHIFT
+#define HPAGE_PMD_SIZE		(1UL << HPAGE_PMD_SHIFT)
+#define HPAGE_PMD_MASK		(~(HPAGE_PMD_SIZE - 1))
+#define HPAGE_PMD_ORDER		(HPAGE_PMD_SHIFT - PAGE_SHIFT)
+#define HPAGE_PMD_NR		(1 << HPAGE_PMD_ORDER)
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+
+/* values of /proc/sys/vm/transparent_hugepage */
+enum {
+	TRANSPARENT_HUGEPAGE_NEVER,
+	TRANSPARENT_HUGEPAGE_ALWAYS,
+	TRANSPARENT_HUGEPAGE_MADVISE,
+};
+
+extern int sysctl_transparent_hugepage;
+extern int khugepaged_pages_to_scan;
+extern int khugepaged_scan_sleep_millisecs;
+
+/*
+ * May faults in @vma be backed by huge pages at all?  Whether a given
+ * address can be depends on the vma covering its whole aligned range.
+ */
+static inline int transparent_hugepage_enabled(struct vm_area_struct *vma)
+{
+	if (vma->vm_file || vma->vm_ops)
+		return 0;
+	if (vma->vm_flags & (VM_NOHUGEPAGE | VM_SHARED | VM_HUGETLB |
+			     VM_IO | VM_PFNMAP | VM_RESERVED))
+		return 0;
+	if (sysctl_transparent_hugepage == TRANSPARENT_HUGEPAGE_ALWAYS)
+		return 1;
+	return sysctl_transparent_hugepage == TRANSPARENT_HUGEPAGE_MADVISE &&
+		(vma->vm_flags & VM_HUGEPAGE);
+}
+
+struct mmu_gather;
+
+extern int do_huge_pmd_anonymous_page(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address, pmd_t *pmd);
+extern int zap_huge_pmd(struct mmu_gather *tlb, struct vm_area_struct *vma,
+		pmd_t *pmd);
+extern struct page *follow_trans_huge_pmd(struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd, unsigned int flags);
+extern void __split_huge_page_pmd(struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd);
+extern void __split_huge_page_mm(struct mm_struct *mm,
+		unsigned long address, pmd_t *pmd);
+extern int hugepage_madvise(struct vm_area_struct *vma,
+		unsigned long *vm_flags, int advice);
+
+/*
+ * Code which only knows how to walk ptes calls these before looking
+ * below a pmd: a huge pmd is turned into a page table of its 4K pages.
+ */
+static inline void split_huge_page_vma(struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd)
+{
+	if (unlikely(pmd_trans_huge(*pmd)))
+		__split_huge_page_pmd(vma, address, pmd);
+}
+
+static inline void split_huge_page_pmd(struct mm_struct *mm,
+		unsigned long address, pmd_t *pmd)
+{
+	if (unlikely(pmd_trans_huge(*pmd)))
+		__split_huge_page_mm(mm, address, pmd);
+}
+
+#else /* !CONFIG_TRANSPARENT_HUGEPAGE */
+
+#define pmd_trans_huge(pmd)			0
+#define pmd_write(pmd)				0
+#define transparent_hugepage_enabled(vma)	0
+
+#define do_huge_pmd_anonymous_page(mm, vma, addr, pmd)	0
+#define zap_huge_pmd(tlb, vma, pmd)			0
+#define follow_trans_huge_pmd(vma, addr, pmd, flags)	NULL
+#define split_huge_page_vma(vma, addr, pmd)		do { } while (0)
+#define split_huge_page_pmd(mm, addr, pmd)		do { } while (0)
+
+#endif /* CONFIG_TRANSPARENT_HUGEPAGE */
+
+#endif /* _LINUX_HUGE_MM_H */
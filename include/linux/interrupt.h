@@ -132,6 +132,11 @@ extern void softirq_init(void);
 #define __raise_softirq_irqoff(nr) do { or_softirq_pending(1UL << (nr)); } while (0)
 extern void FASTCALL(raise_softirq_irqoff(unsigned int nr));
 extern void FASTCALL(raise_softirq(unsigned int nr));
+#ifdef CONFIG_SMP
+extern void raise_softirq_on_cpu(int cpu, unsigned int nr);
+#else
+#define raise_softirq_on_cpu(cpu, nr)	raise_softirq(nr)
+#endif
 
 
 /* Tasklets --- multithreaded analogue of BHs.
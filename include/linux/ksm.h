@@ -0,0 +1,15 @@
+#ifndef _LINUX_KSM_H
+#define _LINUX_KSM_H
+
+/*
+ * Kernel same-page merging, see mm/ksm.c
+ */
+
+struct vm_area_struct;
+
+#ifdef CONFIG_KSM
+extern int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
+		unsigned long end, int advice, unsigned long *vm_flags);
+#endif
+
+#endif /* _LINUX_KSM_H */
@@ -275,10 +275,18 @@ static inline u64 ktime_to_ns(const ktime_t kt)
 #define KTIME_REALTIME_RES	(NSEC_PER_SEC/HZ)
 #define KTIME_MONOTONIC_RES	(NSEC_PER_SEC/HZ)
 
-/* Get the monotonic time in timespec format: */
+/*
+ * The resolution of the clocks in high resolution mode: the timers
+ * expire at the precision of the clock event device.
+ */
+#define KTIME_HIGH_RES		1UL
+
+/* Get the monotonic time in ktime_t and timespec format: */
+extern ktime_t ktime_get(void);
 extern void ktime_get_ts(struct timespec *ts);
 
-/* Get the real (wall-) time in timespec format: */
+/* Get the real (wall-) time in ktime_t and timespec format: */
+extern ktime_t ktime_get_real(void);
 #define ktime_get_real_ts(ts)	getnstimeofday(ts)
 
 #endif
@@ -1,42 +1,62 @@
-
-static inline void
-add_page_to_active_list(struct zone *zone, struct page *page)
+/*
+ * page_is_file_cache - should the page be on a file LRU or anon LRU?
+ * @page: the page to test
+ *
+ * Returns LRU_FILE if @page is page cache backed by a regular filesystem,
+ * or 0 if @page is anonymous, tmpfs or otherwise ram or swap backed.
+ * Used by functions that manipulate the LRU lists, to sort a page
+ * onto the right LRU list.
+ */
+static inline int page_is_file_cache(struct page *page)
 {
-	list_add(&page->lru, &zone->active_list);
-	zone->nr_active++;
+	if (PageSwapBacked(page))
+		return 0;
+	return LRU_FILE;
 }
 
 static inline void
-add_page_to_inactive_list(struct zone *zone, struct page *page)
+add_page_to_lru_list(struct zone *zone, struct page *page, enum lru_list l)
 {
-	list_add(&page->lru, &zone->inactive_list);
-	zone->nr_inactive++;
+	list_add(&page->lru, &zone->lru[l].list);
+	zone->lru[l].nr_pages++;
 }
 
 static inline void
-del_page_from_active_list(struct zone *zone, struct page *page)
+del_page_from_lru_list(struct zone *zone, struct page *page, enum lru_list l)
 {
 	list_del(&page->lru);
-	zone->nr_active--;
+	zone->lru[l].nr_pages--;
 }
 
-static inline void
-del_page_from_inactive_list(struct zone *zone, struct page *page)
+/*
+ * page_lru - which LRU list should a page be on?
+ * @page: the page to test
+ *
+ * Returns the LRU list a page should be on, as an index
+ * into the array of LRU lists.
+ */
+static inline enum lru_list page_lru(struct page *page)
 {
-	list_del(&page->lru);
-	zone->nr_inactive--;
+	enum lru_list lru;
+
+	if (PageUnevictable(page))
+		return LRU_UNEVICTABLE;
+
+	lru = LRU_BASE + page_is_file_cache(page);
+	if (PageActive(page))
+		lru += LRU_ACTIVE;
+	return lru;
 }
 
 static inline void
 del_page_from_lru(struct zone *zone, struct page *page)
 {
+	enum lru_list l = page_lru(page);
+
 	list_del(&page->lru);
-	if (PageActive(page)) {
-		ClearPageActive(page);
-		zone->nr_active--;
-	} else {
-		zone->nr_inactive--;
-	}
+	ClearPageActive(page);
+	ClearPageUnevictable(page);
+	zone->lru[l].nr_pages--;
 }
 
 /*
@@ -0,0 +1,52 @@
+#ifndef _LINUX_MM_SCAN_H
+#define _LINUX_MM_SCAN_H
+
+/*
+ * Lists of the mms which background scanners like khugepaged and ksmd
+ * visit, see mm/mm_scan.c
+ */
+
+#include <linux/config.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+
+#ifdef CONFIG_MM_SCAN
+
+struct mm_scan {
+	spinlock_t lock;
+	struct list_head mm_list;	/* mm->scan_list[] entries */
+	struct list_head *cursor;	/* mm being scanned, NULL between passes */
+	unsigned long address;		/* where to resume in it */
+};
+
+extern struct mm_scan mm_scans[NR_MM_SCANS];
+
+extern void __mm_scan_enter(int id, struct mm_struct *mm);
+extern void mm_scan_fork(struct mm_struct *mm, struct mm_struct *oldmm);
+extern void __mm_scan_exit(struct mm_struct *mm);
+extern struct mm_struct *mm_scan_next(int id);
+extern void mm_scan_advance(int id);
+
+/* Put @mm on the list of scanner @id, if it is not there yet */
+static inline void mm_scan_enter(int id, struct mm_struct *mm)
+{
+	if (!test_bit(id, &mm->scan_flags))
+		__mm_scan_enter(id, mm);
+}
+
+/* Called from mmput() when the last user of @mm is gone */
+static inline void mm_scan_exit(struct mm_struct *mm)
+{
+	if (unlikely(mm->scan_flags))
+		__mm_scan_exit(mm);
+}
+
+#else /* !CONFIG_MM_SCAN */
+
+#define mm_scan_fork(mm, oldmm)		do { } while (0)
+#define mm_scan_exit(mm)		do { } while (0)
+
+#endif /* CONFIG_MM_SCAN */
+
+#endif /* _LINUX_MM_SCAN_H */
@@ -22,13 +22,44 @@
 #define MAX_ORDER CONFIG_FORCE_MAX_ZONEORDER
 #endif
 
+/*
+ * Free pages are grouped by how easily whatever ends up in them can be
+ * moved or freed again, so that long lived kernel allocations do not get
+ * scattered through memory and prevent higher order blocks from forming.
+ * Each pageblock (see <linux/pageblock-flags.h>) has a migrate type, and
+ * its free pages sit on the free list of that type.
+ */
+#define MIGRATE_UNMOVABLE     0
+#define MIGRATE_RECLAIMABLE   1
+#define MIGRATE_MOVABLE       2
+#define MIGRATE_TYPES         3
+
+#define for_each_migratetype_order(order, type) \
+	for (order = 0; order < MAX_ORDER; order++) \
+		for (type = 0; type < MIGRATE_TYPES; type++)
+
 struct free_area {
-	struct list_head	free_list;
+	struct list_head	free_list[MIGRATE_TYPES];
 	unsigned long		nr_free;
 };
 
 struct pglist_data;
 
+/*
+ * Counters kept per zone, see <linux/vmstat.h>.  /proc/vmstat prints them
+ * in this order, so vmstat_text[] must be kept in sync.
+ */
+enum zone_stat_item {
+	NR_FILE_DIRTY,		/* Dirty writeable pages */
+	NR_WRITEBACK,		/* Pages under writeback */
+	NR_UNSTABLE_NFS,	/* NFS unstable pages */
+	NR_PAGETABLE,		/* Pages used for pagetables */
+	NR_MAPPED,		/* Pagecache pages mapped into pagetables */
+	NR_SLAB,		/* Pages used by slab */
+	NR_BOUNCE,		/* Pages for bounce buffers */
+	NR_VM_ZONE_STAT_ITEMS
+};
+
 /*
  * zone->lock and zone->lru_lock are two of the hottest locks in the kernel.
  * So add a wild amount of padding here to ensure that they fall into separate
@@ -61,6 +92,10 @@ struct per_cpu_pageset {
 	unsigned long local_node;	/* allocation from local node */
 	unsigned long other_node;	/* allocation from other node */
 #endif
+#ifdef CONFIG_SMP
+	s8 stat_threshold;		/* fold into the zone beyond this */
+	s8 vm_stat_diff[NR_VM_ZONE_STAT_ITEMS];
+#endif
 } ____cacheline_aligned_in_smp;
 
 #ifdef CONFIG_NUMA
@@ -69,6 +104,41 @@ struct per_cpu_pageset {
 #define zone_pcp(__z, __cpu) (&(__z)->pageset[(__cpu)])
 #endif
 
+/*
+ * Each zone keeps anonymous (swap backed) and file backed pages on separate
+ * LRU lists, so that reclaim can balance between them rather than wade
+ * through pages it cannot free.  Pages reclaim can never free at all sit
+ * on the unevictable list, which is not scanned.
+ *
+ * The order matters: LRU_ACTIVE and LRU_FILE are offsets into it.
+ */
+#define LRU_BASE 0
+#define LRU_ACTIVE 1
+#define LRU_FILE 2
+
+enum lru_list {
+	LRU_INACTIVE_ANON = LRU_BASE,
+	LRU_ACTIVE_ANON = LRU_BASE + LRU_ACTIVE,
+	LRU_INACTIVE_FILE = LRU_BASE + LRU_FILE,
+	LRU_ACTIVE_FILE = LRU_BASE + LRU_FILE + LRU_ACTIVE,
+	LRU_UNEVICTABLE,
+	NR_LRU_LISTS
+};
+
+#define for_each_lru(l) for (l = 0; l < NR_LRU_LISTS; l++)
+
+#define for_each_evictable_lru(l) for (l = 0; l <= LRU_ACTIVE_FILE; l++)
+
+static inline int is_file_lru(enum lru_list l)
+{
+	return (l == LRU_INACTIVE_FILE || l == LRU_ACTIVE_FILE);
+}
+
+static inline int is_active_lru(enum lru_list l)
+{
+	return (l == LRU_ACTIVE_ANON || l == LRU_ACTIVE_FILE);
+}
+
 #define ZONE_DMA		0
 #define ZONE_DMA32		1
 #define ZONE_NORMAL		2
@@ -135,17 +205,40 @@ struct zone {
 #endif
 	struct free_area	free_area[MAX_ORDER];
 
+	/*
+	 * NR_PAGEBLOCK_BITS for each pageblock of the zone, counted from
+	 * pageblock_start_pfn.  Set up at boot, see setup_pageblock_flags().
+	 */
+	unsigned long		*pageblock_flags;
+	unsigned long		pageblock_start_pfn;
+	unsigned long		nr_pageblocks;
 
 	ZONE_PADDING(_pad1_)
 
 	/* Fields commonly accessed by the page reclaim scanner */
 	spinlock_t		lru_lock;	
-	struct list_head	active_list;
-	struct list_head	inactive_list;
-	unsigned long		nr_scan_active;
-	unsigned long		nr_scan_inactive;
-	unsigned long		nr_active;
-	unsigned long		nr_inactive;
+	struct {
+		struct list_head list;
+		unsigned long nr_pages;
+		unsigned long nr_scan;
+	} lru[NR_LRU_LISTS];
+
+	/*
+	 * The pageout code balances anon against file pages by how much
+	 * scanning each of them pays off.  recent_scanned counts pages taken
+	 * off the lists, recent_rotated those that turned out to be in use
+	 * and went (back) to the active list.  Index 0 is anon, 1 is file.
+	 * Both are decayed by get_scan_ratio().
+	 */
+	unsigned long		recent_rotated[2];
+	unsigned long		recent_scanned[2];
+
+	/*
+	 * The target ratio of active to inactive anon pages, see
+	 * setup_per_zone_inactive_ratio().
+	 */
+	unsigned int		inactive_ratio;
+
 	unsigned long		pages_scanned;	   /* since last reclaim */
 	int			all_unreclaimable; /* All pages pinned */
 
@@ -176,6 +269,9 @@ struct zone {
 	int temp_priority;
 	int prev_priority;
 
+	/* Zone statistics, without what is still in the per-cpu diffs */
+	atomic_long_t		vm_stat[NR_VM_ZONE_STAT_ITEMS];
+
 
 	ZONE_PADDING(_pad2_)
 	/* Rarely used or read-mostly fields */
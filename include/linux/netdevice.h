@@ -165,6 +165,7 @@ struct netif_rx_stats
 	unsigned dropped;
 	unsigned time_squeeze;
 	unsigned cpu_collision;
+	unsigned received_rps;	/* packets steered here by another cpu */
 };
 
 DECLARE_PER_CPU(struct netif_rx_stats, netdev_rx_stat);
@@ -233,6 +234,31 @@ enum netdev_state_t
 	__LINK_STATE_LINKWATCH_PENDING
 };
 
+enum netdev_queue_state_t
+{
+	__QUEUE_STATE_XOFF=0,
+};
+
+/*
+ * A hardware transmit queue.  When the device has more than one and
+ * runs the default pfifo_fast discipline, each queue gets its own
+ * pfifo_fast instance under its own lock, and (unless the device is
+ * LLTX) its own xmit lock; queue 0 shares dev->xmit_lock so that
+ * netpoll and drivers locking the whole device still exclude it.
+ */
+struct netdev_queue
+{
+	spinlock_t		lock;
+	struct Qdisc		*qdisc;
+	struct Qdisc		*qdisc_sleeping;
+	struct sk_buff		*gso_skb;
+	unsigned long		state;
+	struct net_device	*dev;
+
+	spinlock_t		xmit_lock;
+	int			xmit_lock_owner;
+};
+
 
 /*
  * This structure holds at boot time configured netdevice settings. They
@@ -309,6 +335,8 @@ struct net_device
 #define NETIF_F_TSO		2048	/* Can offload TCP/IP segmentation */
 #define NETIF_F_LLTX		4096	/* LockLess TX */
 #define NETIF_F_UFO             8192    /* Can offload UDP Large Send*/
+#define NETIF_F_GRO		16384	/* Coalesce received segments	*/
+#define NETIF_F_GSO		32768	/* Segment TSO packets in software */
 
 	struct net_device	*next_sched;
 
@@ -378,6 +406,11 @@ struct net_device
 	int			quota;
 	int			weight;
 	unsigned long		last_rx;	/* Time of last Rx	*/
+#ifdef CONFIG_SMP
+	/* Receive packet steering: cpus that process the backlog */
+	struct rps_map		*rps_map;
+	cpumask_t		rps_cpus;
+#endif
 	/* Interface address info used in eth_type_trans() */
 	unsigned char		dev_addr[MAX_ADDR_LEN];	/* hw address, (before bcast 
 							because most packets are unicast) */
@@ -394,6 +427,15 @@ struct net_device
 	struct list_head	qdisc_list;
 	unsigned long		tx_queue_len;	/* Max frames per queue allowed */
 
+	/* Partially transmitted GSO packet. */
+	struct sk_buff		*gso_skb;
+
+	/* Hardware transmit queues, see struct netdev_queue */
+	struct netdev_queue	*tx_queues;
+	unsigned int		num_tx_queues;
+	u16			(*select_queue)(struct net_device *dev,
+						struct sk_buff *skb);
+
 	/* ingress path synchronizer */
 	spinlock_t		ingress_lock;
 	struct Qdisc		*qdisc_ingress;
@@ -504,6 +546,18 @@ struct net_device
 	struct class_device	class_dev;
 };
 
+#ifdef CONFIG_SMP
+/*
+ * Receive packet steering map: the cpus a device's received packets
+ * are spread over by flow hash. Replaced under RCU.
+ */
+struct rps_map {
+	unsigned int		len;
+	struct rcu_head		rcu;
+	u16			cpus[0];
+};
+#endif
+
 #define	NETDEV_ALIGN		32
 #define	NETDEV_ALIGN_CONST	(NETDEV_ALIGN - 1)
 
@@ -527,10 +581,33 @@ struct packet_type {
 					 struct net_device *,
 					 struct packet_type *,
 					 struct net_device *);
+	int			(*gro_receive)(struct sk_buff **head,
+					       struct sk_buff *skb);
+	int			(*gro_complete)(struct sk_buff *skb);
+	struct sk_buff		*(*gso_segment)(struct sk_buff *skb,
+						int features);
 	void			*af_packet_priv;
 	struct list_head	list;
 };
 
+/*
+ * Generic receive offload.  While a NAPI poll is running, same-flow
+ * segments are merged into the skb held on the per-cpu gro_list and
+ * handed to the stack as one packet when the poll returns.
+ */
+struct gro_cb {
+	struct sk_buff	*last;		/* Tail of the frag_list	*/
+	int		data_offset;	/* Headers parsed so far	*/
+	int		same_flow;	/* Still a candidate for merging */
+	int		flush;		/* Deliver without holding	*/
+	int		count;		/* Segments merged		*/
+	unsigned int	mss;		/* Payload of the first segment	*/
+};
+
+#define GRO_CB(skb)	((struct gro_cb *)(skb)->cb)
+
+#define MAX_GRO_SKBS	8
+
 #include <linux/interrupt.h>
 #include <linux/notifier.h>
 
@@ -554,6 +631,8 @@ extern int		dev_alloc_name(struct net_device *dev, const char *name);
 extern int		dev_open(struct net_device *dev);
 extern int		dev_close(struct net_device *dev);
 extern int		dev_queue_xmit(struct sk_buff *skb);
+extern int		dev_hard_start_xmit(struct sk_buff *skb,
+					    struct net_device *dev);
 extern int		register_netdevice(struct net_device *dev);
 extern int		unregister_netdevice(struct net_device *dev);
 extern void		free_netdev(struct net_device *dev);
@@ -587,6 +666,10 @@ struct softnet_data
 	struct list_head	poll_list;
 	struct sk_buff		*completion_queue;
 
+	struct sk_buff		*gro_list;
+	int			gro_count;
+	int			gro_active;
+
 	struct net_device	backlog_dev;	/* Sorry. 8) */
 };
 
@@ -644,6 +727,47 @@ static inline int netif_queue_stopped(const struct net_device *dev)
 	return test_bit(__LINK_STATE_XOFF, &dev->state);
 }
 
+/*
+ * Per queue flow control for devices allocated with alloc_netdev_mq().
+ * The driver finds the queue of a packet in skb->queue_mapping.
+ */
+static inline void netif_start_subqueue(struct net_device *dev, u16 queue_index)
+{
+	clear_bit(__QUEUE_STATE_XOFF, &dev->tx_queues[queue_index].state);
+}
+
+static inline void netif_stop_subqueue(struct net_device *dev, u16 queue_index)
+{
+#ifdef CONFIG_NETPOLL_TRAP
+	if (netpoll_trap())
+		return;
+#endif
+	set_bit(__QUEUE_STATE_XOFF, &dev->tx_queues[queue_index].state);
+}
+
+static inline int __netif_subqueue_stopped(const struct net_device *dev,
+					   u16 queue_index)
+{
+	return dev->num_tx_queues > 1 &&
+	       test_bit(__QUEUE_STATE_XOFF, &dev->tx_queues[queue_index].state);
+}
+
+static inline void netif_wake_subqueue(struct net_device *dev, u16 queue_index)
+{
+#ifdef CONFIG_NETPOLL_TRAP
+	if (netpoll_trap())
+		return;
+#endif
+	if (test_and_clear_bit(__QUEUE_STATE_XOFF,
+			       &dev->tx_queues[queue_index].state))
+		__netif_schedule(dev);
+}
+
+static inline int netif_is_multiqueue(const struct net_device *dev)
+{
+	return dev->num_tx_queues > 1;
+}
+
 static inline int netif_running(const struct net_device *dev)
 {
 	return test_bit(__LINK_STATE_START, &dev->state);
@@ -912,8 +1036,11 @@ static inline void netif_tx_disable(struct net_device *dev)
 extern void		ether_setup(struct net_device *dev);
 
 /* Support for loadable net-drivers */
-extern struct net_device *alloc_netdev(int sizeof_priv, const char *name,
-				       void (*setup)(struct net_device *));
+extern struct net_device *alloc_netdev_mq(int sizeof_priv, const char *name,
+					  void (*setup)(struct net_device *),
+					  unsigned int queue_count);
+#define alloc_netdev(sizeof_priv, name, setup) \
+	alloc_netdev_mq(sizeof_priv, name, setup, 1)
 extern int		register_netdev(struct net_device *dev);
 extern void		unregister_netdev(struct net_device *dev);
 /* Functions used for multicast support */
@@ -931,7 +1058,18 @@ extern void		dev_mcast_init(void);
 extern int		netdev_max_backlog;
 extern int		weight_p;
 extern int		netdev_set_master(struct net_device *dev, struct net_device *master);
+#ifdef CONFIG_SMP
+extern int		netdev_set_rps_cpus(struct net_device *dev, cpumask_t mask);
+#endif
 extern int skb_checksum_help(struct sk_buff *skb, int inward);
+extern struct sk_buff *skb_gso_segment(struct sk_buff *skb, int features);
+
+/* A TSO packet the device cannot send as it stands. */
+static inline int netif_needs_gso(struct net_device *dev, struct sk_buff *skb)
+{
+	return skb_shinfo(skb)->tso_size && !(dev->features & NETIF_F_TSO);
+}
+
 #ifdef CONFIG_BUG
 extern void netdev_rx_csum_fault(struct net_device *dev);
 #else
@@ -40,6 +40,13 @@
  * guarantees that this bit is cleared for a page when it first is entered into
  * the page cache.
  *
+ * PG_swapbacked is set on pages whose backing store is swap rather than a
+ * filesystem: anonymous and shmem pages.  It decides whether the page goes
+ * on its zone's anon or file LRU, so it must not change while on the LRU.
+ *
+ * PG_unevictable marks pages on (or headed for) the zone's unevictable list:
+ * ramfs, SHM_LOCKed and mlocked pages which reclaim could never free.
+ *
  * PG_highmem pages are not permanently mapped into the kernel virtual address
  * space, they need to be kmapped separately for doing IO on the pages.  The
  * struct page (these bits with information) are always mapped into kernel
@@ -75,6 +82,9 @@
 #define PG_reclaim		17	/* To be reclaimed asap */
 #define PG_nosave_free		18	/* Free, should not be written */
 #define PG_uncached		19	/* Page has been mapped as uncached */
+#define PG_readahead		20	/* Reminder to do async read-ahead */
+#define PG_swapbacked		21	/* Page is backed by RAM/swap */
+#define PG_unevictable		22	/* Page is on the unevictable list */
 
 /*
  * Global page accounting.  One instance per CPU.  Only unsigned longs are
@@ -88,21 +98,11 @@
  * - The __xxx_page_state variants can be used if the field is only
  * modified from process context, or only modified from interrupt context.
  * In this case, the field should be commented here.
+ *
+ * These are event counters only, which are never read on a fast path.
+ * Counts of pages in some state are kept per zone, see <linux/vmstat.h>.
  */
 struct page_state {
-	unsigned long nr_dirty;		/* Dirty writeable pages */
-	unsigned long nr_writeback;	/* Pages under writeback */
-	unsigned long nr_unstable;	/* NFS unstable pages */
-	unsigned long nr_page_table_pages;/* Pages used for pagetables */
-	unsigned long nr_mapped;	/* mapped into pagetables.
-					 * only modified from process context */
-	unsigned long nr_slab;		/* In slab */
-#define GET_PAGE_STATE_LAST nr_slab
-
-	/*
-	 * The below are zeroed by get_page_state().  Use get_full_page_state()
-	 * to add up all these.
-	 */
 	unsigned long pgpgin;		/* Disk reads */
 	unsigned long pgpgout;		/* Disk writes */
 	unsigned long pswpin;		/* swap reads */
@@ -148,19 +148,18 @@ struct page_state {
 	unsigned long allocstall;	/* direct reclaim calls */
 
 	unsigned long pgrotated;	/* pages rotated to tail of the LRU */
-	unsigned long nr_bounce;	/* pages for bounce buffers */
+
+	unsigned long compact_pages_moved;	/* pages migrated by compaction */
+	unsigned long compact_pagemigrate_failed;
+	unsigned long compact_stall;	/* direct compaction runs */
+	unsigned long compact_fail;	/* ... which did not free a block */
+	unsigned long compact_success;	/* ... which did */
 };
 
-extern void get_page_state(struct page_state *ret);
-extern void get_page_state_node(struct page_state *ret, int node);
 extern void get_full_page_state(struct page_state *ret);
-extern unsigned long read_page_state_offset(unsigned long offset);
 extern void mod_page_state_offset(unsigned long offset, unsigned long delta);
 extern void __mod_page_state_offset(unsigned long offset, unsigned long delta);
 
-#define read_page_state(member) \
-	read_page_state_offset(offsetof(struct page_state, member))
-
 #define mod_page_state(member, delta)	\
 	mod_page_state_offset(offsetof(struct page_state, member), (delta))
 
@@ -282,7 +281,7 @@ extern void __mod_page_state_offset(unsigned long offset, unsigned long delta);
 	do {								\
 		if (!test_and_set_bit(PG_writeback,			\
 				&(page)->flags))			\
-			inc_page_state(nr_writeback);			\
+			inc_zone_page_state(page, NR_WRITEBACK);	\
 	} while (0)
 #define TestSetPageWriteback(page)					\
 	({								\
@@ -290,14 +289,14 @@ extern void __mod_page_state_offset(unsigned long offset, unsigned long delta);
 		ret = test_and_set_bit(PG_writeback,			\
 					&(page)->flags);		\
 		if (!ret)						\
-			inc_page_state(nr_writeback);			\
+			inc_zone_page_state(page, NR_WRITEBACK);	\
 		ret;							\
 	})
 #define ClearPageWriteback(page)					\
 	do {								\
 		if (test_and_clear_bit(PG_writeback,			\
 				&(page)->flags))			\
-			dec_page_state(nr_writeback);			\
+			dec_zone_page_state(page, NR_WRITEBACK);	\
 	} while (0)
 #define TestClearPageWriteback(page)					\
 	({								\
@@ -305,7 +304,7 @@ extern void __mod_page_state_offset(unsigned long offset, unsigned long delta);
 		ret = test_and_clear_bit(PG_writeback,			\
 				&(page)->flags);			\
 		if (ret)						\
-			dec_page_state(nr_writeback);			\
+			dec_zone_page_state(page, NR_WRITEBACK);	\
 		ret;							\
 	})
 
@@ -344,6 +343,18 @@ extern void __mod_page_state_offset(unsigned long offset, unsigned long delta);
 #define SetPageUncached(page)	set_bit(PG_uncached, &(page)->flags)
 #define ClearPageUncached(page)	clear_bit(PG_uncached, &(page)->flags)
 
+#define PageReadahead(page)	test_bit(PG_readahead, &(page)->flags)
+#define SetPageReadahead(page)	set_bit(PG_readahead, &(page)->flags)
+#define ClearPageReadahead(page) clear_bit(PG_readahead, &(page)->flags)
+
+#define PageSwapBacked(page)	test_bit(PG_swapbacked, &(page)->flags)
+#define SetPageSwapBacked(page)	set_bit(PG_swapbacked, &(page)->flags)
+#define ClearPageSwapBacked(page) clear_bit(PG_swapbacked, &(page)->flags)
+
+#define PageUnevictable(page)	test_bit(PG_unevictable, &(page)->flags)
+#define SetPageUnevictable(page) set_bit(PG_unevictable, &(page)->flags)
+#define ClearPageUnevictable(page) clear_bit(PG_unevictable, &(page)->flags)
+
 struct page;	/* forward declaration */
 
 int test_clear_page_dirty(struct page *page);
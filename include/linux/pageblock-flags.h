@@ -0,0 +1,31 @@
+#ifndef PAGEBLOCK_FLAGS_H
+#define PAGEBLOCK_FLAGS_H
+
+/*
+ * Flags kept for every pageblock_nr_pages aligned block of a zone, in
+ * zone->pageblock_flags.  For now that is just the migrate type the
+ * free pages of the block are grouped under, see mm/page_alloc.c.
+ */
+#define PB_migrate_bits		2
+#define NR_PAGEBLOCK_BITS	PB_migrate_bits
+
+/*
+ * A pageblock is the unit that gets handed from one migrate type to
+ * another.  Make it the huge page size where there is one, so that
+ * keeping blocks clean pays off for huge page allocations.
+ */
+#ifdef CONFIG_HUGETLB_PAGE
+#define pageblock_order		(HUGETLB_PAGE_ORDER < MAX_ORDER ? \
+					HUGETLB_PAGE_ORDER : MAX_ORDER - 1)
+#else
+#define pageblock_order		(MAX_ORDER - 1)
+#endif
+
+#define pageblock_nr_pages	(1UL << pageblock_order)
+
+struct page;
+
+extern int get_pageblock_migratetype(struct page *page);
+extern void set_pageblock_migratetype(struct page *page, int migratetype);
+
+#endif /* PAGEBLOCK_FLAGS_H */
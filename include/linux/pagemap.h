@@ -18,6 +18,24 @@
  */
 #define	AS_EIO		(__GFP_BITS_SHIFT + 0)	/* IO error on async write */
 #define AS_ENOSPC	(__GFP_BITS_SHIFT + 1)	/* ENOSPC on async write */
+#define AS_UNEVICTABLE	(__GFP_BITS_SHIFT + 2)	/* e.g., ramfs, SHM_LOCK */
+
+static inline void mapping_set_unevictable(struct address_space *mapping)
+{
+	set_bit(AS_UNEVICTABLE, &mapping->flags);
+}
+
+static inline void mapping_clear_unevictable(struct address_space *mapping)
+{
+	clear_bit(AS_UNEVICTABLE, &mapping->flags);
+}
+
+static inline int mapping_unevictable(struct address_space *mapping)
+{
+	if (likely(mapping))
+		return test_bit(AS_UNEVICTABLE, &mapping->flags);
+	return 0;
+}
 
 static inline gfp_t mapping_gfp_mask(struct address_space * mapping)
 {
@@ -51,6 +69,60 @@ static inline void mapping_set_gfp_mask(struct address_space *m, gfp_t mask)
 #define page_cache_release(page)	put_page(page)
 void release_pages(struct page **pages, int nr, int cold);
 
+/*
+ * Lockless page cache protocol:
+ *
+ * find_get_page() and friends walk mapping->page_tree under rcu_read_lock()
+ * only, so the page they find may be removed from the page cache, freed and
+ * even reused for something else at any time.  The struct page itself never
+ * goes away though, so the reader:
+ *
+ *  1. takes a reference with page_cache_get_speculative(), which fails if
+ *     the page is free (or frozen, see below) and then just retries;
+ *  2. checks that the slot it came from still holds the page.  If the page
+ *     was removed or reused before the reference was taken, it is not
+ *     there anymore: drop the reference and retry.
+ *
+ * Once both steps succeed the page was in the page cache at that index while
+ * the reader held a reference, exactly as if the lookup had been done under
+ * mapping->tree_lock.
+ *
+ * For this to work, a page must be fully set up (reference, PG_locked,
+ * ->mapping and ->index) before it is inserted into the radix tree, and
+ * code which removes a page from the page cache because it holds the only
+ * other references must freeze the refcount with page_freeze_refs(), so
+ * that no speculative reference can appear after the check.
+ */
+static inline int page_cache_get_speculative(struct page *page)
+{
+	/*
+	 * Either the page has been freed or frozen, or will be soon.  In
+	 * either case the caller retries the lookup.
+	 */
+	if (unlikely(!get_page_unless_zero(page)))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Atomically turn a refcount of @count into zero, so that speculative
+ * references fail.  Call with mapping->tree_lock held for writing.
+ */
+static inline int page_freeze_refs(struct page *page, int count)
+{
+	return likely(atomic_cmpxchg(&page->_count, count - 1, -1) == count - 1);
+}
+
+static inline void page_unfreeze_refs(struct page *page, int count)
+{
+	BUG_ON(page_count(page) != 0);
+	BUG_ON(count == 0);
+
+	smp_wmb();
+	set_page_count(page, count);
+}
+
 static inline struct page *page_cache_alloc(struct address_space *x)
 {
 	return alloc_pages(mapping_gfp_mask(x), 0);
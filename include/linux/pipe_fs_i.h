@@ -16,6 +16,7 @@ struct pipe_buf_operations {
 	void * (*map)(struct file *, struct pipe_inode_info *, struct pipe_buffer *);
 	void (*unmap)(struct pipe_inode_info *, struct pipe_buffer *);
 	void (*release)(struct pipe_inode_info *, struct pipe_buffer *);
+	void (*get)(struct pipe_inode_info *, struct pipe_buffer *);
 };
 
 struct pipe_inode_info {
@@ -53,4 +54,41 @@ void pipe_wait(struct inode * inode);
 struct inode* pipe_new(struct inode* inode);
 void free_pipe_info(struct inode* inode);
 
+extern struct pipe_buf_operations anon_pipe_buf_ops;
+
+/*
+ * splice/tee flags
+ */
+#define SPLICE_F_NONBLOCK (0x02) /* don't block on the pipe splicing (but */
+				 /* we may still block on the fd we splice */
+				 /* from/to, of course) */
+#define SPLICE_F_MORE	(0x04)	/* expect more data */
+
+/*
+ * Describes one page worth of data handed to splice_to_pipe()
+ */
+struct partial_page {
+	unsigned int offset;
+	unsigned int len;
+};
+
+/*
+ * Passed to the splice_from_pipe() actors
+ */
+struct splice_desc {
+	unsigned int len, total_len;	/* current and remaining length */
+	unsigned int flags;		/* splice flags */
+	struct file *file;		/* file to read/write */
+	loff_t pos;			/* file position */
+};
+
+typedef int (splice_actor)(struct pipe_inode_info *, struct pipe_buffer *,
+			   struct splice_desc *);
+
+extern ssize_t splice_to_pipe(struct inode *, struct page **,
+			      struct partial_page *, int, unsigned int,
+			      struct pipe_buf_operations *);
+extern ssize_t splice_from_pipe(struct inode *, struct file *, loff_t *,
+				size_t, unsigned int, splice_actor *);
+
 #endif
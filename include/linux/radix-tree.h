@@ -22,6 +22,24 @@
 #include <linux/sched.h>
 #include <linux/preempt.h>
 #include <linux/types.h>
+#include <linux/rcupdate.h>
+
+/*
+ * Concurrency:
+ *
+ * Modifications (insert, delete, tag set and clear) still need to be
+ * serialised against each other and against the tagged gang lookups by
+ * the caller, which is what mapping->tree_lock does for the page cache.
+ *
+ * radix_tree_lookup, radix_tree_lookup_slot, radix_tree_gang_lookup and
+ * radix_tree_gang_lookup_slot may instead be called under rcu_read_lock()
+ * alone: nodes are freed through RCU, a lookup walks the tree using the
+ * height stored in each node rather than in the root, and new nodes and
+ * items are published with rcu_assign_pointer.  Such a lookup sees each
+ * slot at some point during the walk, not a snapshot of the whole tree,
+ * and the items it returns may be removed (and freed, unless the caller
+ * also frees them through RCU or otherwise pins them) at any time.
+ */
 
 struct radix_tree_root {
 	unsigned int		height;
@@ -45,13 +63,45 @@ do {									\
 	(root)->rnode = NULL;						\
 } while (0)
 
+/**
+ * radix_tree_deref_slot	- dereference a slot
+ * @pslot:	pointer to slot, returned by radix_tree_lookup_slot
+ * Returns:	item that was stored in that slot, or NULL if the item was
+ *		deleted meanwhile.
+ */
+static inline void *radix_tree_deref_slot(void **pslot)
+{
+	return rcu_dereference(*pslot);
+}
+
+/**
+ * radix_tree_replace_slot	- replace item in a slot
+ * @pslot:	pointer to slot, returned by radix_tree_lookup_slot
+ * @item:	new item to store in the slot.
+ *
+ * For use with radix_tree_lookup_slot().  Caller must hold tree write locked
+ * across slot lookup and replacement.
+ */
+static inline void radix_tree_replace_slot(void **pslot, void *item)
+{
+	BUG_ON(item == NULL);
+	rcu_assign_pointer(*pslot, item);
+}
+
 int radix_tree_insert(struct radix_tree_root *, unsigned long, void *);
 void *radix_tree_lookup(struct radix_tree_root *, unsigned long);
 void **radix_tree_lookup_slot(struct radix_tree_root *, unsigned long);
 void *radix_tree_delete(struct radix_tree_root *, unsigned long);
+unsigned long radix_tree_next_hole(struct radix_tree_root *root,
+				unsigned long index, unsigned long max_scan);
+unsigned long radix_tree_prev_hole(struct radix_tree_root *root,
+				unsigned long index, unsigned long max_scan);
 unsigned int
 radix_tree_gang_lookup(struct radix_tree_root *root, void **results,
 			unsigned long first_index, unsigned int max_items);
+unsigned int
+radix_tree_gang_lookup_slot(struct radix_tree_root *root, void ***results,
+			unsigned long first_index, unsigned int max_items);
 int radix_tree_preload(gfp_t gfp_mask);
 void radix_tree_init(void);
 void *radix_tree_tag_set(struct radix_tree_root *root,
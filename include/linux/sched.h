@@ -289,6 +289,15 @@ typedef unsigned long mm_counter_t;
 		(mm)->hiwater_vm = (mm)->total_vm;	\
 } while (0)
 
+#ifdef CONFIG_MM_SCAN
+/* background scanners which keep a list of mms, see mm/mm_scan.c */
+enum {
+	MM_SCAN_HUGEPAGE,	/* khugepaged */
+	MM_SCAN_KSM,		/* ksmd */
+	NR_MM_SCANS,
+};
+#endif
+
 struct mm_struct {
 	struct vm_area_struct * mmap;		/* list of VMAs */
 	struct rb_root mm_rb;
@@ -346,6 +355,16 @@ struct mm_struct {
 	/* aio bits */
 	rwlock_t		ioctx_list_lock;
 	struct kioctx		*ioctx_list;
+
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	/* page tables set aside for splitting huge pmds, page_table_lock */
+	struct list_head pmd_huge_pte;
+#endif
+#ifdef CONFIG_MM_SCAN
+	/* on the lists of the scanners whose bits are set, see mm_scan.h */
+	unsigned long scan_flags;
+	struct list_head scan_list[NR_MM_SCANS];
+#endif
 };
 
 struct sighand_struct {
@@ -519,7 +538,6 @@ extern struct user_struct *find_user(uid_t);
 extern struct user_struct root_user;
 #define INIT_USER (&root_user)
 
-typedef struct prio_array prio_array_t;
 struct backing_dev_info;
 struct reclaim_state;
 
@@ -546,11 +564,17 @@ enum idle_type
 	MAX_IDLE_TYPES
 };
 
+/*
+ * Increase resolution of nice-level calculations and load: a nice-0
+ * task has a load weight of SCHED_LOAD_SCALE.
+ */
+#define SCHED_LOAD_SHIFT	10
+#define SCHED_LOAD_SCALE	(1UL << SCHED_LOAD_SHIFT)
+
 /*
  * sched-domains (multiprocessor balancing) declarations:
  */
 #ifdef CONFIG_SMP
-#define SCHED_LOAD_SCALE	128UL	/* increase resolution of load */
 
 #define SD_LOAD_BALANCE		1	/* Do load balancing on this domain. */
 #define SD_BALANCE_NEWIDLE	2	/* Balance when about to become idle */
@@ -633,6 +657,57 @@ extern void partition_sched_domains(cpumask_t *partition1,
 				    cpumask_t *partition2);
 #endif /* CONFIG_SMP */
 
+/*
+ * Scheduling classes.  Each policy is implemented by a sched_class;
+ * the core scheduler walks the classes from the highest priority
+ * class down and asks each one for a task to run:
+ */
+struct runqueue;
+struct sched_domain;
+
+struct sched_class {
+	const struct sched_class *next;
+
+	void (*enqueue_task) (struct runqueue *rq, struct task_struct *p,
+			      int wakeup);
+	void (*dequeue_task) (struct runqueue *rq, struct task_struct *p,
+			      int sleep);
+	void (*yield_task) (struct runqueue *rq, struct task_struct *p);
+
+	void (*check_preempt_curr) (struct runqueue *rq, struct task_struct *p);
+
+	struct task_struct * (*pick_next_task) (struct runqueue *rq);
+	void (*put_prev_task) (struct runqueue *rq, struct task_struct *p);
+
+	unsigned long (*load_balance) (struct runqueue *this_rq, int this_cpu,
+			struct runqueue *busiest, unsigned long max_nr_move,
+			struct sched_domain *sd, enum idle_type idle,
+			int *all_pinned);
+
+	void (*set_curr_task) (struct runqueue *rq);
+	void (*task_tick) (struct runqueue *rq, struct task_struct *p);
+	void (*task_new) (struct runqueue *rq, struct task_struct *p);
+};
+
+struct load_weight {
+	unsigned long weight, inv_weight;
+};
+
+/*
+ * CFS per-task state.  vruntime is the task's virtual runtime in
+ * nanoseconds: real runtime scaled by SCHED_LOAD_SCALE / load.weight.
+ * Runnable fair tasks are kept in an rbtree ordered by vruntime.
+ */
+struct sched_entity {
+	struct load_weight	load;		/* for load-balancing */
+	struct rb_node		run_node;
+	unsigned int		on_rq;
+
+	u64			exec_start;
+	u64			vruntime;
+	u64			prev_sched_time;
+};
+
 
 struct io_context;			/* See blkdev.h */
 void exit_io_context(void);
@@ -694,18 +769,16 @@ struct task_struct {
 #endif
 	int prio, static_prio;
 	struct list_head run_list;
-	prio_array_t *array;
+	const struct sched_class *sched_class;
+	struct sched_entity se;
 
 	unsigned short ioprio;
 
-	unsigned long sleep_avg;
-	unsigned long long timestamp, last_ran;
 	unsigned long long sched_time; /* sched_clock time spent running */
-	int activated;
 
 	unsigned long policy;
 	cpumask_t cpus_allowed;
-	unsigned int time_slice, first_time_slice;
+	unsigned int time_slice;	/* SCHED_RR only */
 
 #ifdef CONFIG_SCHEDSTATS
 	struct sched_info sched_info;
@@ -1040,7 +1113,6 @@ extern void FASTCALL(wake_up_new_task(struct task_struct * tsk,
  static inline void kick_process(struct task_struct *tsk) { }
 #endif
 extern void FASTCALL(sched_fork(task_t * p, int clone_flags));
-extern void FASTCALL(sched_exit(task_t * p));
 
 extern int in_group_p(gid_t);
 extern int in_egroup_p(gid_t);
@@ -1343,10 +1415,7 @@ static inline unsigned int task_cpu(const struct task_struct *p)
 	return task_thread_info(p)->cpu;
 }
 
-static inline void set_task_cpu(struct task_struct *p, unsigned int cpu)
-{
-	task_thread_info(p)->cpu = cpu;
-}
+extern void set_task_cpu(struct task_struct *p, unsigned int cpu);
 
 #else
 
@@ -193,6 +193,7 @@ enum {
  *	@fclone: skbuff clone status
  *	@ip_summed: Driver fed us an IP checksum
  *	@priority: Packet queueing priority
+ *	@queue_mapping: Hardware transmit queue chosen for this packet
  *	@users: User count - see {datagram,tcp}.c
  *	@protocol: Packet protocol from driver
  *	@truesize: Buffer size 
@@ -267,6 +268,7 @@ struct sk_buff {
 				fclone:2,
 				ipvs_property:1;
 	__be16			protocol;
+	__u16			queue_mapping;
 
 	void			(*destructor)(struct sk_buff *skb);
 #ifdef CONFIG_NETFILTER
@@ -1252,6 +1254,8 @@ extern unsigned int    skb_copy_and_csum_bits(const struct sk_buff *skb,
 extern void	       skb_copy_and_csum_dev(const struct sk_buff *skb, u8 *to);
 extern void	       skb_split(struct sk_buff *skb,
 				 struct sk_buff *skb1, const u32 len);
+extern int	       skb_gro_receive(struct sk_buff *p, struct sk_buff *skb);
+extern struct sk_buff *skb_segment(struct sk_buff *skb, int features);
 
 extern void	       skb_release_data(struct sk_buff *skb);
 
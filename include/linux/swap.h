@@ -164,6 +164,9 @@ extern unsigned int nr_free_pagecache_pages(void);
 /* linux/mm/swap.c */
 extern void FASTCALL(lru_cache_add(struct page *));
 extern void FASTCALL(lru_cache_add_active(struct page *));
+extern void lru_cache_add_active_or_unevictable(struct page *,
+						struct vm_area_struct *);
+extern void add_page_to_unevictable_list(struct page *page);
 extern void FASTCALL(activate_page(struct page *));
 extern void FASTCALL(mark_page_accessed(struct page *));
 extern void lru_add_drain(void);
@@ -174,6 +177,10 @@ extern void swap_setup(void);
 extern int try_to_free_pages(struct zone **, gfp_t);
 extern int shrink_all_memory(int);
 extern int vm_swappiness;
+extern int page_evictable(struct page *page, struct vm_area_struct *vma);
+extern void begin_unevictable_rescue(void);
+extern void rescue_unevictable_page(struct page *page);
+extern void scan_mapping_unevictable_pages(struct address_space *);
 
 #ifdef CONFIG_MIGRATION
 extern int isolate_lru_page(struct page *p);
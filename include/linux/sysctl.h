@@ -182,6 +182,10 @@ enum
 	VM_SWAP_TOKEN_TIMEOUT=28, /* default time for token time out */
 	VM_DROP_PAGECACHE=29,	/* int: nuke lots of pagecache */
 	VM_PERCPU_PAGELIST_FRACTION=30,/* int: fraction of pages in each percpu_pagelist */
+	VM_TRANSPARENT_HUGEPAGE=31, /* use huge pages for anonymous memory: never/always/madvise */
+	VM_KHUGEPAGED_PAGES_TO_SCAN=32, /* ptes khugepaged scans per pass */
+	VM_KHUGEPAGED_SCAN_SLEEP=33, /* msecs khugepaged sleeps between passes */
+	VM_COMPACT_MEMORY=34,	/* compact all of memory when written to */
 };
 
 
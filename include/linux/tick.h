@@ -0,0 +1,111 @@
+/*  linux/include/linux/tick.h
+ *
+ *  This file contains the structure definitions for tick related functions
+ *
+ */
+#ifndef _LINUX_TICK_H
+#define _LINUX_TICK_H
+
+#include <linux/config.h>
+#include <linux/clockchips.h>
+#include <linux/hrtimer.h>
+
+#ifdef CONFIG_GENERIC_CLOCKEVENTS
+
+enum tick_device_mode {
+	TICKDEV_MODE_PERIODIC,
+	TICKDEV_MODE_ONESHOT,
+};
+
+/**
+ * struct tick_device - the per cpu tick device
+ * @evtdev:	the clock event device driving the local tick
+ * @mode:	periodic or oneshot operation
+ */
+struct tick_device {
+	struct clock_event_device *evtdev;
+	enum tick_device_mode mode;
+};
+
+#ifdef CONFIG_TICK_ONESHOT
+
+enum tick_nohz_mode {
+	NOHZ_MODE_INACTIVE,
+	NOHZ_MODE_LOWRES,
+	NOHZ_MODE_HIGHRES,
+};
+
+/**
+ * struct tick_sched - sched tick emulation and no idle tick control/stats
+ * @sched_timer:	hrtimer to schedule the periodic tick in high
+ *			resolution mode, holds the expiry time of the
+ *			next tick otherwise
+ * @nohz_mode:		Mode - one state of tick_nohz_mode
+ * @check_clocks:	Notification mechanism about clocksource and clock
+ *			event device changes
+ * @idle_tick:		Store the last idle tick expiry time when the tick
+ *			timer is modified for idle sleeps. This is necessary
+ *			to resume the tick timer operation in the timeline
+ *			when the CPU returns from idle
+ * @tick_stopped:	Indicator that the idle tick has been stopped
+ * @idle_jiffies:	jiffies at the entry to idle for idle time accounting
+ * @idle_calls:		Total number of idle calls
+ * @idle_sleeps:	Number of idle calls, where the sched tick was stopped
+ * @idle_entrytime:	Time when the idle call was entered
+ * @idle_sleeptime:	Sum of the time slept in idle with sched tick stopped
+ * @last_jiffies:	Last updated value of jiffies
+ * @next_jiffies:	Next jiffie for which a timer is active
+ * @idle_expires:	Next tick in idle, for debugging purpose only
+ */
+struct tick_sched {
+	struct hrtimer			sched_timer;
+	enum tick_nohz_mode		nohz_mode;
+	unsigned long			check_clocks;
+	ktime_t				idle_tick;
+	int				tick_stopped;
+	unsigned long			idle_jiffies;
+	unsigned long			idle_calls;
+	unsigned long			idle_sleeps;
+	ktime_t				idle_entrytime;
+	ktime_t				idle_sleeptime;
+	unsigned long			last_jiffies;
+	unsigned long			next_jiffies;
+	ktime_t				idle_expires;
+};
+
+extern struct tick_sched *tick_get_tick_sched(int cpu);
+
+#endif /* CONFIG_TICK_ONESHOT */
+
+extern struct tick_device *tick_get_device(int cpu);
+extern void tick_check_new_device(struct clock_event_device *dev);
+extern void tick_cpu_dead(int cpu);
+
+#endif /* CONFIG_GENERIC_CLOCKEVENTS */
+
+#ifdef CONFIG_TICK_ONESHOT
+extern int tick_check_oneshot_change(int allow_nohz);
+extern void tick_clock_notify(void);
+#else
+static inline int tick_check_oneshot_change(int allow_nohz) { return 0; }
+static inline void tick_clock_notify(void) { }
+#endif
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+extern int tick_init_highres(void);
+extern int tick_program_event(ktime_t expires, int force);
+extern void tick_setup_sched_timer(void);
+extern void tick_cancel_sched_timer(int cpu);
+#else
+static inline void tick_cancel_sched_timer(int cpu) { }
+#endif
+
+#ifdef CONFIG_NO_HZ
+extern void tick_nohz_stop_sched_tick(void);
+extern void tick_nohz_restart_sched_tick(void);
+#else
+static inline void tick_nohz_stop_sched_tick(void) { }
+static inline void tick_nohz_restart_sched_tick(void) { }
+#endif
+
+#endif
@@ -81,6 +81,14 @@ extern int do_setitimer(int which, struct itimerval *value,
 extern int do_getitimer(int which, struct itimerval *value);
 extern void getnstimeofday(struct timespec *tv);
 
+#ifdef CONFIG_GENERIC_TIME
+extern void timekeeping_init(void);
+extern int timekeeping_is_continuous(void);
+#else
+static inline void timekeeping_init(void) { }
+static inline int timekeeping_is_continuous(void) { return 0; }
+#endif
+
 extern struct timespec timespec_trunc(struct timespec t, unsigned gran);
 
 /**
@@ -124,6 +132,21 @@ extern struct timespec ns_to_timespec(const nsec_t nsec);
  */
 extern struct timeval ns_to_timeval(const nsec_t nsec);
 
+/**
+ * timespec_add_ns - Adds nanoseconds to a timespec
+ * @a:		pointer to timespec to be incremented
+ * @ns:		unsigned nanoseconds value to be added
+ */
+static inline void timespec_add_ns(struct timespec *a, u64 ns)
+{
+	ns += a->tv_nsec;
+	while(unlikely(ns >= NSEC_PER_SEC)) {
+		ns -= NSEC_PER_SEC;
+		a->tv_sec++;
+	}
+	a->tv_nsec = ns;
+}
+
 #endif /* __KERNEL__ */
 
 #define NFDBITS			__NFDBITS
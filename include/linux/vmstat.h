@@ -0,0 +1,105 @@
+#ifndef _LINUX_VMSTAT_H
+#define _LINUX_VMSTAT_H
+
+#include <linux/config.h>
+#include <linux/mmzone.h>
+#include <asm/atomic.h>
+
+/*
+ * Zoned VM counters, see mm/vmstat.c.
+ *
+ * Every counter is kept per zone and summed up for the whole system, both
+ * in atomic_long_t so reading one is cheap.  Updates go to a small per-cpu
+ * diff in the zone's pageset first and are only folded into the atomics
+ * once the diff goes beyond the pageset's stat_threshold, or when the
+ * periodic refresh comes around.  What is read may therefore be off by up
+ * to the threshold per cpu, and briefly negative on SMP.
+ */
+extern atomic_long_t vm_stat[NR_VM_ZONE_STAT_ITEMS];
+
+static inline void zone_page_state_add(long x, struct zone *zone,
+				enum zone_stat_item item)
+{
+	atomic_long_add(x, &zone->vm_stat[item]);
+	atomic_long_add(x, &vm_stat[item]);
+}
+
+static inline unsigned long global_page_state(enum zone_stat_item item)
+{
+	long x = atomic_long_read(&vm_stat[item]);
+#ifdef CONFIG_SMP
+	if (x < 0)
+		x = 0;
+#endif
+	return x;
+}
+
+static inline unsigned long zone_page_state(struct zone *zone,
+					enum zone_stat_item item)
+{
+	long x = atomic_long_read(&zone->vm_stat[item]);
+#ifdef CONFIG_SMP
+	if (x < 0)
+		x = 0;
+#endif
+	return x;
+}
+
+#ifdef CONFIG_NUMA
+extern unsigned long node_page_state(int node, enum zone_stat_item item);
+#else
+#define node_page_state(node, item) global_page_state(item)
+#endif
+
+struct page;
+
+#ifdef CONFIG_SMP
+
+/*
+ * The __ variants are for callers which have interrupts disabled, or
+ * whose counter is never updated from interrupt context.
+ */
+extern void __mod_zone_page_state(struct zone *zone,
+			enum zone_stat_item item, int delta);
+extern void __inc_zone_page_state(struct page *page, enum zone_stat_item item);
+extern void __dec_zone_page_state(struct page *page, enum zone_stat_item item);
+
+extern void mod_zone_page_state(struct zone *zone,
+			enum zone_stat_item item, int delta);
+extern void inc_zone_page_state(struct page *page, enum zone_stat_item item);
+extern void dec_zone_page_state(struct page *page, enum zone_stat_item item);
+
+extern void refresh_cpu_vm_stats(int cpu);
+
+#else /* !CONFIG_SMP */
+
+/*
+ * Without other cpus to race with, updates go straight to the zone.
+ */
+static inline void __mod_zone_page_state(struct zone *zone,
+			enum zone_stat_item item, int delta)
+{
+	zone_page_state_add(delta, zone, item);
+}
+
+static inline void __inc_zone_page_state(struct page *page,
+			enum zone_stat_item item)
+{
+	zone_page_state_add(1, page_zone(page), item);
+}
+
+static inline void __dec_zone_page_state(struct page *page,
+			enum zone_stat_item item)
+{
+	zone_page_state_add(-1, page_zone(page), item);
+}
+
+#define mod_zone_page_state __mod_zone_page_state
+#define inc_zone_page_state __inc_zone_page_state
+#define dec_zone_page_state __dec_zone_page_state
+
+static inline void refresh_cpu_vm_stats(int cpu) { }
+
+#endif /* CONFIG_SMP */
+
+#endif /* _LINUX_VMSTAT_H */
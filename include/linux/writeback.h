@@ -5,6 +5,7 @@
 #define WRITEBACK_H
 
 struct backing_dev_info;
+struct super_block;
 
 extern spinlock_t inode_lock;
 extern struct list_head inode_in_use;
@@ -27,7 +28,7 @@ static inline int task_is_pdflush(struct task_struct *task)
 enum writeback_sync_modes {
 	WB_SYNC_NONE,	/* Don't wait on anything */
 	WB_SYNC_ALL,	/* Wait on every mapping */
-	WB_SYNC_HOLD,	/* Hold the inode on sb_dirty for sys_sync() */
+	WB_SYNC_HOLD,	/* Hold the inode on b_dirty for sys_sync() */
 };
 
 /*
@@ -38,6 +39,9 @@ enum writeback_sync_modes {
 struct writeback_control {
 	struct backing_dev_info *bdi;	/* If !NULL, only write back this
 					   queue */
+	struct super_block *sb;		/* If !NULL, only write back inodes
+					   of this fs, which the caller
+					   holds */
 	enum writeback_sync_modes sync_mode;
 	unsigned long *older_than_this;	/* If !NULL, only write back inodes
 					   older than this */
@@ -64,6 +68,8 @@ struct writeback_control {
  * fs/fs-writeback.c
  */	
 void writeback_inodes(struct writeback_control *wbc);
+void writeback_bdi_inodes(struct backing_dev_info *bdi,
+			  struct writeback_control *wbc);
 void wake_up_inode(struct inode *inode);
 int inode_wait(void *);
 void sync_inodes_sb(struct super_block *, int wait);
@@ -80,7 +86,9 @@ static inline void wait_on_inode(struct inode *inode)
 /*
  * mm/page-writeback.c
  */
-int wakeup_pdflush(long nr_pages);
+void wakeup_flusher_threads(long nr_pages);
+void bdi_writeback_background(struct backing_dev_info *bdi, long min_pages);
+void bdi_writeback_old_data(struct backing_dev_info *bdi);
 void laptop_io_completion(void);
 void laptop_sync_completion(void);
 void throttle_vm_writeout(void);
@@ -226,6 +226,17 @@ static inline void qdisc_run(struct net_device *dev)
 		/* NOTHING */;
 }
 
+extern int qdisc_restart_queue(struct netdev_queue *txq);
+extern void qdisc_run_queues(struct net_device *dev);
+
+static inline void qdisc_run_queue(struct netdev_queue *txq)
+{
+	while (!netif_queue_stopped(txq->dev) &&
+	       !test_bit(__QUEUE_STATE_XOFF, &txq->state) &&
+	       qdisc_restart_queue(txq) < 0)
+		/* NOTHING */;
+}
+
 extern int tc_classify(struct sk_buff *skb, struct tcf_proto *tp,
 	struct tcf_result *res);
 
@@ -37,6 +37,11 @@
 struct net_protocol {
 	int			(*handler)(struct sk_buff *skb);
 	void			(*err_handler)(struct sk_buff *skb, u32 info);
+	int			(*gro_receive)(struct sk_buff **head,
+					       struct sk_buff *skb);
+	int			(*gro_complete)(struct sk_buff *skb);
+	struct sk_buff		*(*gso_segment)(struct sk_buff *skb,
+						int features);
 	int			no_policy;
 };
 
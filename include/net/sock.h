@@ -1064,8 +1064,18 @@ static inline void sk_setup_caps(struct sock *sk, struct dst_entry *dst)
 {
 	__sk_dst_set(sk, dst);
 	sk->sk_route_caps = dst->dev->features;
+	/* NETIF_F_GSO in route caps means TSO is done in software. */
+	if (sk->sk_route_caps & NETIF_F_TSO)
+		sk->sk_route_caps &= ~NETIF_F_GSO;
+	else if (sk->sk_route_caps & NETIF_F_GSO)
+		sk->sk_route_caps |= NETIF_F_TSO;
 	if (sk->sk_route_caps & NETIF_F_TSO) {
-		if (sock_flag(sk, SOCK_NO_LARGESEND) || dst->header_len)
+		/*
+		 * SOCK_NO_LARGESEND (set for ECN) only rules out TSO
+		 * hardware, which mangles CWR; software GSO gets it right.
+		 */
+		if ((sock_flag(sk, SOCK_NO_LARGESEND) &&
+		     !(sk->sk_route_caps & NETIF_F_GSO)) || dst->header_len)
 			sk->sk_route_caps &= ~NETIF_F_TSO;
 	}
 }
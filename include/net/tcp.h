@@ -263,6 +263,14 @@ extern void			tcp_shutdown (struct sock *sk, int how);
 
 extern int			tcp_v4_rcv(struct sk_buff *skb);
 
+extern int			tcp4_gro_receive(struct sk_buff **head,
+						 struct sk_buff *skb);
+
+extern int			tcp4_gro_complete(struct sk_buff *skb);
+
+extern struct sk_buff		*tcp4_gso_segment(struct sk_buff *skb,
+						  int features);
+
 extern int			tcp_v4_remember_stamp(struct sock *sk);
 
 extern int		    	tcp_v4_tw_remember_stamp(struct inet_timewait_sock *tw);
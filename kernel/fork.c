@@ -44,6 +44,7 @@
 #include <linux/rmap.h>
 #include <linux/acct.h>
 #include <linux/cn_proc.h>
+#include <linux/mm_scan.h>
 
 #include <asm/pgtable.h>
 #include <asm/pgalloc.h>
@@ -324,6 +325,12 @@ static struct mm_struct * mm_init(struct mm_struct * mm)
 	spin_lock_init(&mm->page_table_lock);
 	rwlock_init(&mm->ioctx_list_lock);
 	mm->ioctx_list = NULL;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	INIT_LIST_HEAD(&mm->pmd_huge_pte);
+#endif
+#ifdef CONFIG_MM_SCAN
+	mm->scan_flags = 0;
+#endif
 	mm->free_area_cache = TASK_UNMAPPED_BASE;
 	mm->cached_hole_size = ~0UL;
 
@@ -369,6 +376,7 @@ void fastcall __mmdrop(struct mm_struct *mm)
 void mmput(struct mm_struct *mm)
 {
 	if (atomic_dec_and_test(&mm->mm_users)) {
+		mm_scan_exit(mm);
 		exit_aio(mm);
 		exit_mmap(mm);
 		if (!list_empty(&mm->mmlist)) {
@@ -488,6 +496,7 @@ static int copy_mm(unsigned long clone_flags, struct task_struct * tsk)
 	retval = dup_mmap(mm, oldmm);
 	if (retval)
 		goto free_pt;
+	mm_scan_fork(mm, oldmm);
 
 	mm->hiwater_rss = get_mm_rss(mm);
 	mm->hiwater_vm = mm->total_vm;
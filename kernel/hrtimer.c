@@ -30,6 +30,7 @@
 #include <linux/hrtimer.h>
 #include <linux/notifier.h>
 #include <linux/syscalls.h>
+#include <linux/tick.h>
 #include <linux/interrupt.h>
 
 #include <asm/uaccess.h>
@@ -39,7 +40,7 @@
  *
  * returns the time in ktime_t format
  */
-static ktime_t ktime_get(void)
+ktime_t ktime_get(void)
 {
 	struct timespec now;
 
@@ -48,12 +49,14 @@ static ktime_t ktime_get(void)
 	return timespec_to_ktime(now);
 }
 
+EXPORT_SYMBOL_GPL(ktime_get);
+
 /**
  * ktime_get_real - get the real (wall-) time in ktime_t format
  *
  * returns the time in ktime_t format
  */
-static ktime_t ktime_get_real(void)
+ktime_t ktime_get_real(void)
 {
 	struct timespec now;
 
@@ -273,13 +276,20 @@ void unlock_hrtimer_base(const struct hrtimer *timer, unsigned long *flags)
  *
  * Forward the timer expiry so it will expire in the future.
  * The number of overruns is added to the overrun field.
+ *
+ * The interval is at least HRTIMER_MIN_INTERVAL: in high resolution
+ * mode the expiry runs in hard interrupt context, and an unprivileged
+ * timer with a nanosecond interval would otherwise never let it finish.
  */
 unsigned long
-hrtimer_forward(struct hrtimer *timer, const ktime_t interval)
+hrtimer_forward(struct hrtimer *timer, ktime_t interval)
 {
 	unsigned long orun = 1;
 	ktime_t delta, now;
 
+	if (interval.tv64 < HRTIMER_MIN_INTERVAL)
+		interval = ktime_set(0, HRTIMER_MIN_INTERVAL);
+
 	now = timer->base->get_time();
 
 	delta = ktime_sub(now, timer->expires);
@@ -375,6 +385,224 @@ remove_hrtimer(struct hrtimer *timer, struct hrtimer_base *base)
 	return 0;
 }
 
+/*
+ * High resolution timer specific code
+ */
+#ifdef CONFIG_HIGH_RES_TIMERS
+
+/**
+ * struct hrtimer_hres - per cpu state of the high resolution mode
+ *
+ * @active:		the clock event device of this cpu is owned by
+ *			the hrtimer code
+ * @expires_next:	absolute time (monotonic clock) of the next event
+ *			the clock event device is programmed for
+ * @nr_events:		number of hrtimer interrupts
+ * @irq_regs:		registers of the interrupt which runs the
+ *			callbacks right now
+ */
+struct hrtimer_hres {
+	int			active;
+	ktime_t			expires_next;
+	unsigned long		nr_events;
+	struct pt_regs		*irq_regs;
+};
+
+static DEFINE_PER_CPU(struct hrtimer_hres, hrtimer_hres);
+
+/* High resolution mode enabled ? */
+static int hrtimer_hres_enabled __read_mostly = 1;
+
+/*
+ * Enable / Disable high resolution mode
+ */
+static int __init setup_hrtimer_hres(char *str)
+{
+	if (!strcmp(str, "off"))
+		hrtimer_hres_enabled = 0;
+	else if (!strcmp(str, "on"))
+		hrtimer_hres_enabled = 1;
+	else
+		return 0;
+	return 1;
+}
+
+__setup("highres=", setup_hrtimer_hres);
+
+static inline int hrtimer_hres_active(void)
+{
+	return __get_cpu_var(hrtimer_hres).active;
+}
+
+/**
+ * hrtimer_get_irq_regs - registers of the current hrtimer interrupt
+ *
+ * For callbacks which need the interrupted context, like the tick
+ * emulation. Returns NULL outside of hrtimer_interrupt().
+ */
+struct pt_regs *hrtimer_get_irq_regs(void)
+{
+	return __get_cpu_var(hrtimer_hres).irq_regs;
+}
+
+/*
+ * Update the offset of the realtime clock to the monotonic clock in
+ * the bases of this cpu. Changes on settimeofday() and leap seconds.
+ */
+static void hrtimer_update_offsets(struct hrtimer_base *base)
+{
+	struct timespec tomono;
+	unsigned long seq;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+		tomono = wall_to_monotonic;
+	} while (read_seqretry(&xtime_lock, seq));
+
+	base[CLOCK_REALTIME].offset = ktime_sub(ktime_set(0, 0),
+						timespec_to_ktime(tomono));
+}
+
+/*
+ * Reprogram the clock event device for the first expiring timer of
+ * all bases of this cpu. Called with interrupts disabled.
+ */
+static void hrtimer_force_reprogram(void)
+{
+	struct hrtimer_hres *hres = &__get_cpu_var(hrtimer_hres);
+	struct hrtimer_base *base = __get_cpu_var(hrtimer_bases);
+	ktime_t expires;
+	int i;
+
+	hres->expires_next.tv64 = KTIME_MAX;
+
+	for (i = 0; i < MAX_HRTIMER_BASES; i++, base++) {
+		struct hrtimer *timer;
+
+		spin_lock(&base->lock);
+		if (!list_empty(&base->pending)) {
+			timer = list_entry(base->pending.next,
+					   struct hrtimer, list);
+			expires = ktime_sub(timer->expires, base->offset);
+			if (expires.tv64 < hres->expires_next.tv64)
+				hres->expires_next = expires;
+		}
+		spin_unlock(&base->lock);
+	}
+
+	if (hres->expires_next.tv64 != KTIME_MAX)
+		tick_program_event(hres->expires_next, 1);
+}
+
+/*
+ * Reprogram the clock event device when the enqueued timer became
+ * the first to expire on this cpu. A timer which is already expired
+ * is handled by the next interrupt, which the device is programmed
+ * for as soon as possible.
+ *
+ * Called with the base lock held and interrupts disabled.
+ */
+static void hrtimer_reprogram(struct hrtimer *timer, struct hrtimer_base *base)
+{
+	struct hrtimer_hres *hres = &__get_cpu_var(hrtimer_hres);
+	ktime_t expires;
+
+	if (!hres->active)
+		return;
+
+	/*
+	 * The timer might be queued on another cpu, when it is
+	 * running its callback there. That cpu reprograms its
+	 * device when the callback returns.
+	 */
+	if (base != &__get_cpu_var(hrtimer_bases)[base->index])
+		return;
+
+	if (base->pending.next != &timer->list)
+		return;
+
+	expires = ktime_sub(timer->expires, base->offset);
+	if (expires.tv64 >= hres->expires_next.tv64)
+		return;
+
+	hres->expires_next = expires;
+	tick_program_event(expires, 1);
+}
+
+/*
+ * Retrigger the next event of this cpu after the realtime clock was
+ * set. Called with interrupts disabled.
+ */
+static void retrigger_next_event(void *arg)
+{
+	if (!hrtimer_hres_active())
+		return;
+
+	hrtimer_update_offsets(__get_cpu_var(hrtimer_bases));
+	hrtimer_force_reprogram();
+}
+
+/**
+ * clock_was_set - the realtime clock was set
+ *
+ * Absolute CLOCK_REALTIME timers expire at a different time on the
+ * monotonic clock now, reprogram the clock event devices of all cpus.
+ * Must not be called with interrupts disabled.
+ */
+void clock_was_set(void)
+{
+	on_each_cpu(retrigger_next_event, NULL, 0, 1);
+}
+
+/*
+ * Switch this cpu to high resolution mode. Returns 1 on success.
+ */
+static int hrtimer_switch_to_hres(void)
+{
+	struct hrtimer_hres *hres = &__get_cpu_var(hrtimer_hres);
+	struct hrtimer_base *base = __get_cpu_var(hrtimer_bases);
+	unsigned long flags;
+	int i;
+
+	if (hres->active)
+		return 1;
+
+	local_irq_save(flags);
+
+	if (tick_init_highres()) {
+		local_irq_restore(flags);
+		return 0;
+	}
+
+	hres->active = 1;
+	hres->expires_next.tv64 = KTIME_MAX;
+	for (i = 0; i < MAX_HRTIMER_BASES; i++)
+		base[i].resolution = KTIME_HIGH_RES;
+	hrtimer_update_offsets(base);
+
+	tick_setup_sched_timer();
+
+	/* "Retrigger" the interrupt to get things going */
+	hrtimer_force_reprogram();
+	local_irq_restore(flags);
+
+	printk(KERN_INFO "Switched to high resolution mode on CPU %d\n",
+	       smp_processor_id());
+	return 1;
+}
+
+#else
+
+static inline int hrtimer_hres_active(void) { return 0; }
+static inline int hrtimer_switch_to_hres(void) { return 0; }
+static inline void hrtimer_force_reprogram(void) { }
+static inline void hrtimer_reprogram(struct hrtimer *timer,
+				     struct hrtimer_base *base) { }
+
+#define hrtimer_hres_enabled	0
+
+#endif /* CONFIG_HIGH_RES_TIMERS */
+
 /**
  * hrtimer_start - (re)start an relative timer on the current CPU
  *
@@ -406,6 +634,7 @@ hrtimer_start(struct hrtimer *timer, ktime_t tim, const enum hrtimer_mode mode)
 	timer->expires = tim;
 
 	enqueue_hrtimer(timer, new_base);
+	hrtimer_reprogram(timer, new_base);
 
 	unlock_hrtimer_base(timer, &flags);
 
@@ -523,6 +752,46 @@ int hrtimer_get_res(const clockid_t which_clock, struct timespec *tp)
 	return 0;
 }
 
+#ifdef CONFIG_NO_HZ
+/**
+ * hrtimer_get_next_event - get the time until next expiry event
+ *
+ * Returns the delta to the next expiry event or KTIME_MAX if no timer
+ * is pending.
+ */
+ktime_t hrtimer_get_next_event(void)
+{
+	struct hrtimer_base *base = __get_cpu_var(hrtimer_bases);
+	ktime_t delta, mindelta = { .tv64 = KTIME_MAX };
+	unsigned long flags;
+	int i;
+
+	/* In high resolution mode the hardware takes care of them */
+	if (hrtimer_hres_active())
+		return mindelta;
+
+	for (i = 0; i < MAX_HRTIMER_BASES; i++, base++) {
+		struct hrtimer *timer;
+
+		spin_lock_irqsave(&base->lock, flags);
+		if (list_empty(&base->pending)) {
+			spin_unlock_irqrestore(&base->lock, flags);
+			continue;
+		}
+		timer = list_entry(base->pending.next, struct hrtimer, list);
+		delta = ktime_sub(timer->expires, base->get_time());
+		spin_unlock_irqrestore(&base->lock, flags);
+
+		if (delta.tv64 < mindelta.tv64)
+			mindelta.tv64 = delta.tv64;
+	}
+
+	if (mindelta.tv64 < 0)
+		mindelta.tv64 = 0;
+	return mindelta;
+}
+#endif
+
 /*
  * Expire the per base hrtimer-queue:
  */
@@ -569,6 +838,98 @@ static inline void run_hrtimer_queue(struct hrtimer_base *base)
 	spin_unlock_irq(&base->lock);
 }
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+/**
+ * hrtimer_interrupt - high resolution timer interrupt
+ * @dev:	the clock event device of this cpu
+ * @regs:	registers of the interrupted context
+ *
+ * Event handler of the clock event device in high resolution mode:
+ * expire all timers which are due and program the device for the
+ * next one. Called with interrupts disabled.
+ */
+void hrtimer_interrupt(struct clock_event_device *dev, struct pt_regs *regs)
+{
+	struct hrtimer_hres *hres = &__get_cpu_var(hrtimer_hres);
+	struct hrtimer_base *base;
+	ktime_t expires_next, now;
+	int i, retries = 0;
+
+	dev->next_event.tv64 = KTIME_MAX;
+	hres->irq_regs = regs;
+	hres->nr_events++;
+
+ retry:
+	now = ktime_get();
+	expires_next.tv64 = KTIME_MAX;
+	hres->expires_next.tv64 = KTIME_MAX;
+
+	base = __get_cpu_var(hrtimer_bases);
+	hrtimer_update_offsets(base);
+
+	for (i = 0; i < MAX_HRTIMER_BASES; i++, base++) {
+		ktime_t basenow = ktime_add(now, base->offset);
+
+		spin_lock(&base->lock);
+
+		while (!list_empty(&base->pending)) {
+			struct hrtimer *timer;
+			int (*fn)(void *);
+			int restart;
+			void *data;
+
+			timer = list_entry(base->pending.next,
+					   struct hrtimer, list);
+			if (basenow.tv64 < timer->expires.tv64) {
+				ktime_t expires;
+
+				expires = ktime_sub(timer->expires,
+						    base->offset);
+				if (expires.tv64 < expires_next.tv64)
+					expires_next = expires;
+				break;
+			}
+
+			fn = timer->function;
+			data = timer->data;
+			set_curr_timer(base, timer);
+			__remove_hrtimer(timer, base);
+			spin_unlock(&base->lock);
+
+			/* See run_hrtimer_queue() */
+			if (!fn) {
+				wake_up_process(data);
+				restart = HRTIMER_NORESTART;
+			} else
+				restart = fn(data);
+
+			spin_lock(&base->lock);
+
+			if (restart == HRTIMER_RESTART)
+				enqueue_hrtimer(timer, base);
+			else
+				timer->state = HRTIMER_EXPIRED;
+		}
+		set_curr_timer(base, NULL);
+		spin_unlock(&base->lock);
+	}
+
+	hres->expires_next = expires_next;
+
+	/*
+	 * Reprogramming necessary ? If timers keep expiring while we are
+	 * at it, give up after a few rounds and force the event at least
+	 * min_delta_ns ahead, so that we get out of hard irq context.
+	 */
+	if (expires_next.tv64 != KTIME_MAX) {
+		if (tick_program_event(expires_next, ++retries > 3))
+			goto retry;
+	}
+
+	hres->irq_regs = NULL;
+}
+#endif
+
 /*
  * Called from timer softirq every jiffy, expire hrtimers:
  */
@@ -577,6 +938,19 @@ void hrtimer_run_queues(void)
 	struct hrtimer_base *base = __get_cpu_var(hrtimer_bases);
 	int i;
 
+	/* The timers are expired from the interrupt in high resolution mode */
+	if (hrtimer_hres_active())
+		return;
+
+	/*
+	 * Switch to high resolution mode, or the tick to oneshot (nohz)
+	 * mode, once a capable clock event device and clocksource are
+	 * available:
+	 */
+	if (tick_check_oneshot_change(!hrtimer_hres_enabled) &&
+	    hrtimer_switch_to_hres())
+		return;
+
 	for (i = 0; i < MAX_HRTIMER_BASES; i++)
 		run_hrtimer_queue(&base[i]);
 }
@@ -762,6 +1136,9 @@ static void migrate_hrtimers(int cpu)
 	old_base = per_cpu(hrtimer_bases, cpu);
 	new_base = get_cpu_var(hrtimer_bases);
 
+	/* The tick emulation of the dead cpu must not move over */
+	tick_cancel_sched_timer(cpu);
+
 	local_irq_disable();
 
 	for (i = 0; i < MAX_HRTIMER_BASES; i++) {
@@ -779,6 +1156,10 @@ static void migrate_hrtimers(int cpu)
 		new_base++;
 	}
 
+	/* The migrated timers might expire before our next event */
+	if (hrtimer_hres_active())
+		hrtimer_force_reprogram();
+
 	local_irq_enable();
 	put_cpu_var(hrtimer_bases);
 }
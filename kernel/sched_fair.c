@@ -0,0 +1,582 @@
+/*
+ * Completely Fair Scheduling (CFS) Class (SCHED_NORMAL)
+ *
+ * Every SCHED_NORMAL task accumulates virtual runtime: the nanoseconds
+ * it has spent on the cpu, scaled by NICE_0_LOAD / its load weight, so
+ * that higher priority tasks age more slowly.  Runnable tasks are kept
+ * in a per-runqueue rbtree ordered by virtual runtime, and the task
+ * that has received the least service so far - the leftmost one - is
+ * the next to run.  Picking it is O(1) (the leftmost node is cached),
+ * queueing and dequeueing are O(log n).
+ *
+ * There is no notion of timeslices or interactivity bonuses: a task
+ * that sleeps simply falls behind in virtual runtime and is placed
+ * near the left of the tree when it wakes up.
+ */
+
+/*
+ * Targeted preemption latency for CPU-bound tasks: every runnable task
+ * gets to run at least once within this period (20 msecs), as long as
+ * there are no more than SCHED_NR_LATENCY of them.
+ */
+#define SCHED_LATENCY			20000000ULL
+
+/*
+ * Minimal preemption granularity for CPU-bound tasks (4 msecs).  With
+ * more than SCHED_NR_LATENCY runnable tasks the period is stretched so
+ * that no task runs for less than this.
+ */
+#define SCHED_MIN_GRANULARITY		4000000ULL
+#define SCHED_NR_LATENCY		(SCHED_LATENCY / SCHED_MIN_GRANULARITY)
+
+/*
+ * Wakeup granularity (5 msecs): a woken task preempts the current one
+ * only if it is this far (in nice-0 virtual time) behind it.  This
+ * reduces over-scheduling of wakeup-heavy workloads.
+ */
+#define SCHED_WAKEUP_GRANULARITY	5000000UL
+
+/*
+ * After fork, the child runs first (it will most likely exec, which
+ * avoids COW-ing the parent's pages).
+ */
+#define SCHED_CHILD_RUNS_FIRST		1
+
+/**************************************************************
+ * CFS operations on generic schedulable entities:
+ */
+
+static inline struct task_struct *task_of(struct sched_entity *se)
+{
+	return container_of(se, struct task_struct, se);
+}
+
+static inline struct runqueue *rq_of(struct cfs_rq *cfs_rq)
+{
+	return container_of(cfs_rq, struct runqueue, cfs);
+}
+
+static inline u64 max_vruntime(u64 min_vruntime, u64 vruntime)
+{
+	s64 delta = (s64)(vruntime - min_vruntime);
+
+	if (delta > 0)
+		min_vruntime = vruntime;
+
+	return min_vruntime;
+}
+
+static inline u64 min_vruntime(u64 min_vruntime, u64 vruntime)
+{
+	s64 delta = (s64)(vruntime - min_vruntime);
+
+	if (delta < 0)
+		min_vruntime = vruntime;
+
+	return min_vruntime;
+}
+
+static inline s64 entity_key(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	return se->vruntime - cfs_rq->min_vruntime;
+}
+
+/*
+ * Enqueue an entity into the rb-tree:
+ */
+static void __enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	struct rb_node **link = &cfs_rq->tasks_timeline.rb_node;
+	struct rb_node *parent = NULL;
+	struct sched_entity *entry;
+	s64 key = entity_key(cfs_rq, se);
+	int leftmost = 1;
+
+	/*
+	 * Find the right place in the rbtree:
+	 */
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct sched_entity, run_node);
+		/*
+		 * We dont care about collisions. Nodes with
+		 * the same key stay together.
+		 */
+		if (key < entity_key(cfs_rq, entry)) {
+			link = &parent->rb_left;
+		} else {
+			link = &parent->rb_right;
+			leftmost = 0;
+		}
+	}
+
+	/*
+	 * Maintain a cache of leftmost tree entries (it is frequently
+	 * used):
+	 */
+	if (leftmost)
+		cfs_rq->rb_leftmost = &se->run_node;
+
+	rb_link_node(&se->run_node, parent, link);
+	rb_insert_color(&se->run_node, &cfs_rq->tasks_timeline);
+}
+
+static void __dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	if (cfs_rq->rb_leftmost == &se->run_node)
+		cfs_rq->rb_leftmost = rb_next(&se->run_node);
+	if (cfs_rq->rb_load_balance_curr == &se->run_node)
+		cfs_rq->rb_load_balance_curr = rb_prev(&se->run_node);
+
+	rb_erase(&se->run_node, &cfs_rq->tasks_timeline);
+}
+
+static inline struct sched_entity *__pick_next_entity(struct cfs_rq *cfs_rq)
+{
+	return rb_entry(cfs_rq->rb_leftmost, struct sched_entity, run_node);
+}
+
+static inline struct sched_entity *__pick_last_entity(struct cfs_rq *cfs_rq)
+{
+	struct rb_node *last = rb_last(&cfs_rq->tasks_timeline);
+
+	if (!last)
+		return NULL;
+
+	return rb_entry(last, struct sched_entity, run_node);
+}
+
+/*
+ * min_vruntime only ever moves forward; it tracks the smallest
+ * vruntime of the running and the queued entities.
+ */
+static void update_min_vruntime(struct cfs_rq *cfs_rq)
+{
+	u64 vruntime = cfs_rq->min_vruntime;
+
+	if (cfs_rq->curr)
+		vruntime = cfs_rq->curr->vruntime;
+
+	if (cfs_rq->rb_leftmost) {
+		struct sched_entity *se = __pick_next_entity(cfs_rq);
+
+		if (!cfs_rq->curr)
+			vruntime = se->vruntime;
+		else
+			vruntime = min_vruntime(vruntime, se->vruntime);
+	}
+
+	cfs_rq->min_vruntime = max_vruntime(cfs_rq->min_vruntime, vruntime);
+}
+
+/**************************************************************
+ * Scheduling class statistics methods:
+ */
+
+/*
+ * delta /= w, in nice-0 units:
+ */
+static inline unsigned long
+calc_delta_fair(unsigned long delta, struct sched_entity *se)
+{
+	if (unlikely(se->load.weight != NICE_0_LOAD))
+		delta = calc_delta_mine(delta, NICE_0_LOAD, &se->load);
+
+	return delta;
+}
+
+/*
+ * The idea is to set a period in which each task runs once.
+ *
+ * When there are too many tasks (SCHED_NR_LATENCY) we have to stretch
+ * this period because otherwise the slices get too small.
+ */
+static unsigned long __sched_period(unsigned long nr_running)
+{
+	if (unlikely(nr_running > SCHED_NR_LATENCY))
+		return SCHED_MIN_GRANULARITY * nr_running;
+
+	return SCHED_LATENCY;
+}
+
+/*
+ * The wall-time slice of an entity: its weighted share of the period.
+ */
+static unsigned long sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	unsigned long period;
+	struct load_weight lw;
+
+	if (se->on_rq)
+		return calc_delta_mine(__sched_period(cfs_rq->nr_running),
+				       se->load.weight, &cfs_rq->load);
+
+	/* Not queued yet (fork): account for its own weight as well */
+	period = __sched_period(cfs_rq->nr_running + 1);
+	lw = cfs_rq->load;
+	update_load_add(&lw, se->load.weight);
+
+	return calc_delta_mine(period, se->load.weight, &lw);
+}
+
+/*
+ * Update the current task's runtime statistics: bank the time it ran
+ * since the last update in ->sched_time and advance its vruntime.
+ */
+static void update_curr(struct cfs_rq *cfs_rq)
+{
+	struct sched_entity *curr = cfs_rq->curr;
+	u64 now = rq_of(cfs_rq)->clock;
+	unsigned long delta_exec;
+
+	if (unlikely(!curr))
+		return;
+
+	/*
+	 * Get the amount of time the current task was running
+	 * since the last time we changed load (this cannot
+	 * overflow on 32 bits):
+	 */
+	delta_exec = (unsigned long)(now - curr->exec_start);
+	if (!delta_exec)
+		return;
+	curr->exec_start = now;
+
+	task_of(curr)->sched_time += delta_exec;
+	curr->vruntime += calc_delta_fair(delta_exec, curr);
+	update_min_vruntime(cfs_rq);
+}
+
+/**************************************************
+ * Scheduling class queueing methods:
+ */
+
+static void
+place_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int initial)
+{
+	u64 vruntime = cfs_rq->min_vruntime;
+
+	if (initial) {
+		/*
+		 * The 'current' period is already promised to the current
+		 * tasks, however the extra weight of the new task will slow
+		 * them down a little, place the new task so that it fits in
+		 * the slot that stays open at the end.
+		 */
+		vruntime += calc_delta_fair(sched_slice(cfs_rq, se), se);
+	} else {
+		/*
+		 * Sleeper credit: a waking task may be placed up to half
+		 * a latency period ahead of the queue, so that it runs
+		 * soon, but not indefinitely far - sleeping longer than
+		 * that does not accumulate more credit.
+		 */
+		vruntime -= SCHED_LATENCY / 2;
+	}
+
+	/* ensure we never gain time by being placed backwards. */
+	se->vruntime = max_vruntime(se->vruntime, vruntime);
+}
+
+static void
+enqueue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int wakeup)
+{
+	/*
+	 * Update run-time statistics of the 'current'.
+	 */
+	update_curr(cfs_rq);
+
+	if (wakeup)
+		place_entity(cfs_rq, se, 0);
+
+	update_load_add(&cfs_rq->load, se->load.weight);
+	cfs_rq->nr_running++;
+	if (se != cfs_rq->curr)
+		__enqueue_entity(cfs_rq, se);
+	se->on_rq = 1;
+}
+
+static void
+dequeue_entity(struct cfs_rq *cfs_rq, struct sched_entity *se, int sleep)
+{
+	/*
+	 * Update run-time statistics of the 'current'.
+	 */
+	update_curr(cfs_rq);
+
+	if (se != cfs_rq->curr)
+		__dequeue_entity(cfs_rq, se);
+	update_load_sub(&cfs_rq->load, se->load.weight);
+	cfs_rq->nr_running--;
+	se->on_rq = 0;
+
+	update_min_vruntime(cfs_rq);
+}
+
+/*
+ * Preempt the current task if it has run for longer than its slice:
+ */
+static void check_preempt_tick(struct cfs_rq *cfs_rq, struct sched_entity *curr)
+{
+	unsigned long ideal_runtime, delta_exec;
+
+	ideal_runtime = sched_slice(cfs_rq, curr);
+	delta_exec = task_of(curr)->sched_time - curr->prev_sched_time;
+	if (delta_exec > ideal_runtime)
+		resched_task(rq_of(cfs_rq)->curr);
+}
+
+static void set_next_entity(struct cfs_rq *cfs_rq, struct sched_entity *se)
+{
+	/*
+	 * 'current' is not kept within the tree:
+	 */
+	__dequeue_entity(cfs_rq, se);
+
+	se->exec_start = rq_of(cfs_rq)->clock;
+	se->prev_sched_time = task_of(se)->sched_time;
+	cfs_rq->curr = se;
+}
+
+/*
+ * The enqueue_task method is called before nr_running is
+ * increased. Here we update the fair scheduling stats and
+ * then put the task into the rbtree:
+ */
+static void enqueue_task_fair(struct runqueue *rq, struct task_struct *p,
+			      int wakeup)
+{
+	enqueue_entity(&rq->cfs, &p->se, wakeup);
+}
+
+/*
+ * The dequeue_task method is called before nr_running is
+ * decreased. We remove the task from the rbtree and
+ * update the fair scheduling stats:
+ */
+static void dequeue_task_fair(struct runqueue *rq, struct task_struct *p,
+			      int sleep)
+{
+	dequeue_entity(&rq->cfs, &p->se, sleep);
+}
+
+/*
+ * sched_yield() support: requeue the current task behind all other
+ * fair tasks by giving it the largest vruntime in the tree.
+ */
+static void yield_task_fair(struct runqueue *rq, struct task_struct *p)
+{
+	struct cfs_rq *cfs_rq = &rq->cfs;
+	struct sched_entity *rightmost, *se = &p->se;
+
+	/*
+	 * Are we the only task in the tree?
+	 */
+	if (unlikely(cfs_rq->nr_running == 1))
+		return;
+
+	update_curr(cfs_rq);
+	rightmost = __pick_last_entity(cfs_rq);
+	/*
+	 * Minimally necessary key value to be last in the tree:
+	 * Upon rescheduling, sched_class::put_prev_task() will place
+	 * 'current' within the tree based on its new key value.
+	 */
+	if (rightmost && (s64)(rightmost->vruntime - se->vruntime) > 0)
+		se->vruntime = rightmost->vruntime;
+}
+
+/*
+ * Preempt the current task with a newly woken task if needed:
+ */
+static void check_preempt_wakeup(struct runqueue *rq, struct task_struct *p)
+{
+	struct task_struct *curr = rq->curr;
+	struct cfs_rq *cfs_rq = &rq->cfs;
+	unsigned long gran;
+	s64 delta;
+
+	update_curr(cfs_rq);
+
+	if (unlikely(rt_task(p))) {
+		resched_task(curr);
+		return;
+	}
+
+	gran = calc_delta_fair(SCHED_WAKEUP_GRANULARITY, &curr->se);
+	delta = curr->se.vruntime - p->se.vruntime;
+	if (delta > (s64)gran)
+		resched_task(curr);
+}
+
+static struct task_struct *pick_next_task_fair(struct runqueue *rq)
+{
+	struct cfs_rq *cfs_rq = &rq->cfs;
+	struct sched_entity *se;
+
+	if (unlikely(!cfs_rq->nr_running))
+		return NULL;
+
+	se = __pick_next_entity(cfs_rq);
+	set_next_entity(cfs_rq, se);
+
+	return task_of(se);
+}
+
+/*
+ * Account for a descheduled task:
+ */
+static void put_prev_task_fair(struct runqueue *rq, struct task_struct *prev)
+{
+	struct cfs_rq *cfs_rq = &rq->cfs;
+	struct sched_entity *se = &prev->se;
+
+	/*
+	 * If still on the runqueue then deactivate_task()
+	 * was not called and update_curr() has to be done:
+	 */
+	if (se->on_rq) {
+		update_curr(cfs_rq);
+		/* Put 'current' back into the tree. */
+		__enqueue_entity(cfs_rq, se);
+	}
+	cfs_rq->curr = NULL;
+}
+
+#ifdef CONFIG_SMP
+/**************************************************
+ * Fair scheduling class load-balancing methods:
+ */
+
+/*
+ * Load-balancing iterator. Note: while the runqueue stays locked
+ * during the whole iteration, the current task might be
+ * dequeued so the iterator has to be dequeue-safe. Here we
+ * achieve that by always pre-iterating before returning
+ * the current task.
+ *
+ * We walk the tree from the right: the tasks that will run
+ * last are the most likely to be cache-cold.
+ */
+static struct task_struct *
+__load_balance_iterator(struct cfs_rq *cfs_rq, struct rb_node *curr)
+{
+	struct task_struct *p;
+
+	if (!curr)
+		return NULL;
+
+	p = rb_entry(curr, struct task_struct, se.run_node);
+	cfs_rq->rb_load_balance_curr = rb_prev(curr);
+
+	return p;
+}
+
+static struct task_struct *load_balance_start_fair(void *arg)
+{
+	struct cfs_rq *cfs_rq = arg;
+
+	return __load_balance_iterator(cfs_rq,
+				       rb_last(&cfs_rq->tasks_timeline));
+}
+
+static struct task_struct *load_balance_next_fair(void *arg)
+{
+	struct cfs_rq *cfs_rq = arg;
+
+	return __load_balance_iterator(cfs_rq, cfs_rq->rb_load_balance_curr);
+}
+
+static unsigned long
+load_balance_fair(struct runqueue *this_rq, int this_cpu,
+		  struct runqueue *busiest, unsigned long max_nr_move,
+		  struct sched_domain *sd, enum idle_type idle,
+		  int *all_pinned)
+{
+	struct rq_iterator cfs_rq_iterator;
+
+	cfs_rq_iterator.start = load_balance_start_fair;
+	cfs_rq_iterator.next = load_balance_next_fair;
+	cfs_rq_iterator.arg = &busiest->cfs;
+
+	return balance_tasks(this_rq, this_cpu, busiest, max_nr_move,
+			     sd, idle, all_pinned, &cfs_rq_iterator);
+}
+#endif
+
+/*
+ * scheduler tick hitting a task of our scheduling class:
+ */
+static void task_tick_fair(struct runqueue *rq, struct task_struct *curr)
+{
+	struct cfs_rq *cfs_rq = &rq->cfs;
+
+	update_curr(cfs_rq);
+	if (cfs_rq->nr_running > 1)
+		check_preempt_tick(cfs_rq, &curr->se);
+}
+
+/*
+ * A new task is placed at the end of the current period, so frequent
+ * forkers cannot monopolize the CPU.  If the parent is running here
+ * the child may take its place instead (child-runs-first).  Note: the
+ * runqueue is locked, the child is not running yet.
+ */
+static void task_new_fair(struct runqueue *rq, struct task_struct *p)
+{
+	struct cfs_rq *cfs_rq = &rq->cfs;
+	struct sched_entity *se = &p->se, *curr = cfs_rq->curr;
+	u64 vruntime;
+
+	update_curr(cfs_rq);
+	place_entity(cfs_rq, se, 1);
+
+	if (SCHED_CHILD_RUNS_FIRST && curr && rq->curr == current &&
+	    (s64)(se->vruntime - curr->vruntime) > 0) {
+		/*
+		 * Upon rescheduling, sched_class::put_prev_task() will place
+		 * 'current' within the tree based on its new key value.
+		 */
+		vruntime = se->vruntime;
+		se->vruntime = curr->vruntime;
+		curr->vruntime = vruntime;
+		resched_task(rq->curr);
+	}
+
+	enqueue_entity(cfs_rq, se, 0);
+}
+
+/*
+ * Account for a task changing its policy or nice level while running:
+ */
+static void set_curr_task_fair(struct runqueue *rq)
+{
+	struct task_struct *curr = rq->curr;
+
+	curr->se.exec_start = rq->clock;
+	curr->se.prev_sched_time = curr->sched_time;
+	rq->cfs.curr = &curr->se;
+}
+
+/*
+ * All the scheduling class methods:
+ */
+static const struct sched_class fair_sched_class = {
+	.next			= &idle_sched_class,
+	.enqueue_task		= enqueue_task_fair,
+	.dequeue_task		= dequeue_task_fair,
+	.yield_task		= yield_task_fair,
+
+	.check_preempt_curr	= check_preempt_wakeup,
+
+	.pick_next_task		= pick_next_task_fair,
+	.put_prev_task		= put_prev_task_fair,
+
+#ifdef CONFIG_SMP
+	.load_balance		= load_balance_fair,
+#endif
+
+	.set_curr_task		= set_curr_task_fair,
+	.task_tick		= task_tick_fair,
+	.task_new		= task_new_fair,
+};
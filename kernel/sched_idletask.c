@@ -0,0 +1,78 @@
+/*
+ * idle-task scheduling class: the per-cpu idle threads, which run
+ * whenever no other class has a runnable task.
+ */
+
+/*
+ * Idle tasks are unconditionally rescheduled:
+ */
+static void check_preempt_curr_idle(struct runqueue *rq, struct task_struct *p)
+{
+	resched_task(rq->idle);
+}
+
+static struct task_struct *pick_next_task_idle(struct runqueue *rq)
+{
+	schedstat_inc(rq, sched_goidle);
+
+	return rq->idle;
+}
+
+/*
+ * It is not legal to sleep in the idle task - print a warning
+ * message if some code attempts to do it:
+ */
+static void
+dequeue_task_idle(struct runqueue *rq, struct task_struct *p, int sleep)
+{
+	spin_unlock_irq(&rq->lock);
+	printk(KERN_ERR "bad: scheduling from the idle thread!\n");
+	dump_stack();
+	spin_lock_irq(&rq->lock);
+}
+
+static void put_prev_task_idle(struct runqueue *rq, struct task_struct *prev)
+{
+}
+
+#ifdef CONFIG_SMP
+static unsigned long
+load_balance_idle(struct runqueue *this_rq, int this_cpu,
+		  struct runqueue *busiest, unsigned long max_nr_move,
+		  struct sched_domain *sd, enum idle_type idle,
+		  int *all_pinned)
+{
+	return 0;
+}
+#endif
+
+static void task_tick_idle(struct runqueue *rq, struct task_struct *curr)
+{
+}
+
+static void set_curr_task_idle(struct runqueue *rq)
+{
+}
+
+/*
+ * Simple, special scheduling class for the per-CPU idle tasks:
+ */
+static const struct sched_class idle_sched_class = {
+	/* no enqueue/yield_task for idle tasks */
+
+	/* dequeue is not valid, we print a debug message there: */
+	.dequeue_task		= dequeue_task_idle,
+
+	.check_preempt_curr	= check_preempt_curr_idle,
+
+	.pick_next_task		= pick_next_task_idle,
+	.put_prev_task		= put_prev_task_idle,
+
+#ifdef CONFIG_SMP
+	.load_balance		= load_balance_idle,
+#endif
+
+	.set_curr_task		= set_curr_task_idle,
+	.task_tick		= task_tick_idle,
+	/* no .task_new for idle tasks */
+};
@@ -16,6 +16,7 @@
 #include <linux/cpu.h>
 #include <linux/kthread.h>
 #include <linux/rcupdate.h>
+#include <linux/tick.h>
 
 #include <asm/irq.h>
 /*
@@ -45,6 +46,26 @@ static struct softirq_action softirq_vec[32] __cacheline_aligned_in_smp;
 
 static DEFINE_PER_CPU(struct task_struct *, ksoftirqd);
 
+#ifdef CONFIG_SMP
+/*
+ * Softirqs raised on behalf of this cpu by other cpus. They are
+ * folded into the local pending mask the next time softirqs are
+ * run here.
+ */
+static DEFINE_PER_CPU(unsigned long, remote_softirq_pending);
+
+/* Must be called with interrupts disabled */
+static inline void fold_remote_softirqs(void)
+{
+	unsigned long *remote = &__get_cpu_var(remote_softirq_pending);
+
+	if (unlikely(*remote))
+		or_softirq_pending(xchg(remote, 0));
+}
+#else
+static inline void fold_remote_softirqs(void) { }
+#endif
+
 /*
  * we cannot loop indefinitely here to avoid userspace starvation,
  * but we also don't want to introduce a worst case 1/HZ latency
@@ -78,6 +99,7 @@ asmlinkage void __do_softirq(void)
 	int max_restart = MAX_SOFTIRQ_RESTART;
 	int cpu;
 
+	fold_remote_softirqs();
 	pending = local_softirq_pending();
 
 	local_bh_disable();
@@ -101,6 +123,7 @@ restart:
 
 	local_irq_disable();
 
+	fold_remote_softirqs();
 	pending = local_softirq_pending();
 	if (pending && --max_restart)
 		goto restart;
@@ -167,6 +190,12 @@ void irq_exit(void)
 	sub_preempt_count(IRQ_EXIT_OFFSET);
 	if (!in_interrupt() && local_softirq_pending())
 		invoke_softirq();
+
+#ifdef CONFIG_NO_HZ
+	/* Make sure that timer wheel updates are propagated */
+	if (!in_interrupt() && idle_cpu(smp_processor_id()) && !need_resched())
+		tick_nohz_stop_sched_tick();
+#endif
 	preempt_enable_no_resched();
 }
 
@@ -201,6 +230,35 @@ void fastcall raise_softirq(unsigned int nr)
 	local_irq_restore(flags);
 }
 
+#ifdef CONFIG_SMP
+/**
+ * raise_softirq_on_cpu - mark a softirq pending on another cpu
+ * @cpu: the cpu that should run the softirq
+ * @nr: the softirq number
+ *
+ * Safe to call from any context, including hard interrupts. The
+ * target's ksoftirqd is woken up so that an idle cpu notices the
+ * work right away; a busy one picks it up on its next softirq run.
+ */
+void raise_softirq_on_cpu(int cpu, unsigned int nr)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	if (cpu == smp_processor_id())
+		raise_softirq_irqoff(nr);
+	else if (!test_and_set_bit(nr, &per_cpu(remote_softirq_pending, cpu))) {
+		struct task_struct *tsk = per_cpu(ksoftirqd, cpu);
+
+		if (tsk && tsk->state != TASK_RUNNING)
+			wake_up_process(tsk);
+	}
+	local_irq_restore(flags);
+}
+
+EXPORT_SYMBOL(raise_softirq_on_cpu);
+#endif
+
 void open_softirq(int nr, void (*action)(struct softirq_action*), void *data)
 {
 	softirq_vec[nr].data = data;
@@ -356,6 +414,9 @@ static int ksoftirqd(void * __bind_cpu)
 
 	while (!kthread_should_stop()) {
 		preempt_disable();
+		local_irq_disable();
+		fold_remote_softirqs();
+		local_irq_enable();
 		if (!local_softirq_pending()) {
 			preempt_enable_no_resched();
 			schedule();
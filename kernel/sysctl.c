@@ -38,6 +38,7 @@
 #include <linux/highuid.h>
 #include <linux/writeback.h>
 #include <linux/hugetlb.h>
+#include <linux/compaction.h>
 #include <linux/security.h>
 #include <linux/initrd.h>
 #include <linux/times.h>
@@ -665,6 +666,9 @@ static ctl_table kern_table[] = {
    We use these as one-element integer vectors. */
 static int zero;
 static int one_hundred = 100;
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+static int two = 2;
+#endif
 
 
 static ctl_table vm_table[] = {
@@ -869,6 +873,50 @@ static ctl_table vm_table[] = {
 		.proc_handler	= &proc_dointvec_jiffies,
 		.strategy	= &sysctl_jiffies,
 	},
+#endif
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	{
+		.ctl_name	= VM_TRANSPARENT_HUGEPAGE,
+		.procname	= "transparent_hugepage",
+		.data		= &sysctl_transparent_hugepage,
+		.maxlen		= sizeof(sysctl_transparent_hugepage),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+		.extra2		= &two,
+	},
+	{
+		.ctl_name	= VM_KHUGEPAGED_PAGES_TO_SCAN,
+		.procname	= "khugepaged_pages_to_scan",
+		.data		= &khugepaged_pages_to_scan,
+		.maxlen		= sizeof(khugepaged_pages_to_scan),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+	{
+		.ctl_name	= VM_KHUGEPAGED_SCAN_SLEEP,
+		.procname	= "khugepaged_scan_sleep_millisecs",
+		.data		= &khugepaged_scan_sleep_millisecs,
+		.maxlen		= sizeof(khugepaged_scan_sleep_millisecs),
+		.mode		= 0644,
+		.proc_handler	= &proc_dointvec_minmax,
+		.strategy	= &sysctl_intvec,
+		.extra1		= &zero,
+	},
+#endif
+#ifdef CONFIG_COMPACTION
+	{
+		.ctl_name	= VM_COMPACT_MEMORY,
+		.procname	= "compact_memory",
+		.data		= &sysctl_compact_memory,
+		.maxlen		= sizeof(int),
+		.mode		= 0200,
+		.proc_handler	= &sysctl_compaction_handler,
+		.strategy	= &sysctl_intvec,
+	},
 #endif
 	{ .ctl_name = 0 }
 };
@@ -549,7 +549,7 @@ void do_gettimeofday (struct timeval *tv)
 EXPORT_SYMBOL(do_gettimeofday);
 
 
-#else
+#elif !defined(CONFIG_GENERIC_TIME)
 /*
  * Simulate gettimeofday using do_gettimeofday which only allows a timeval
  * and therefore only yields usec accuracy
@@ -0,0 +1,170 @@
+/*
+ * linux/kernel/time/clockevents.c
+ *
+ * This file contains functions which manage clock event devices.
+ *
+ * Clock event devices are the hardware timers which can raise an
+ * interrupt at a programmed time: the local APIC timer, the PIT,
+ * HPET comparators and friends. The architecture code registers
+ * them here and the tick code picks the device which drives the
+ * per cpu tick from them.
+ */
+
+#include <linux/clockchips.h>
+#include <linux/cpu.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/notifier.h>
+#include <linux/smp.h>
+#include <linux/tick.h>
+
+/* The registered clock event devices */
+static LIST_HEAD(clockevent_devices);
+
+/* Protection for the above */
+static DEFINE_SPINLOCK(clockevents_lock);
+
+/**
+ * clockevent_delta2ns - Convert a latch value (device ticks) to nanoseconds
+ * @latch:	value to convert
+ * @evt:	pointer to clock event device descriptor
+ *
+ * Math helper, returns latch value converted to nanoseconds (bound checked)
+ */
+unsigned long clockevent_delta2ns(unsigned long latch,
+				  struct clock_event_device *evt)
+{
+	u64 clc = ((u64) latch << evt->shift);
+
+	do_div(clc, evt->mult);
+	if (clc < 1000)
+		clc = 1000;
+	if (clc > LONG_MAX)
+		clc = LONG_MAX;
+
+	return (unsigned long) clc;
+}
+
+/**
+ * clockevents_set_mode - set the operating mode of a clock event device
+ * @dev:	device to modify
+ * @mode:	new mode
+ *
+ * Must be called with interrupts disabled !
+ */
+void clockevents_set_mode(struct clock_event_device *dev,
+			  enum clock_event_mode mode)
+{
+	if (dev->mode != mode) {
+		dev->set_mode(mode, dev);
+		dev->mode = mode;
+	}
+}
+
+/**
+ * clockevents_program_event - Reprogram the clock event device.
+ * @dev:	device to program
+ * @expires:	absolute expiry time (monotonic clock)
+ * @now:	current time (monotonic clock)
+ *
+ * Returns 0 on success, -ETIME when the event is in the past.
+ *
+ * Must be called with interrupts disabled !
+ */
+int clockevents_program_event(struct clock_event_device *dev, ktime_t expires,
+			      ktime_t now)
+{
+	unsigned long long clc;
+	s64 delta;
+
+	delta = ktime_to_ns(ktime_sub(expires, now));
+
+	if (delta <= 0)
+		return -ETIME;
+
+	dev->next_event = expires;
+
+	if (dev->mode == CLOCK_EVT_MODE_SHUTDOWN)
+		return 0;
+
+	if (delta > dev->max_delta_ns)
+		delta = dev->max_delta_ns;
+	if (delta < dev->min_delta_ns)
+		delta = dev->min_delta_ns;
+
+	clc = delta * dev->mult;
+	clc >>= dev->shift;
+
+	return dev->set_next_event((unsigned long) clc, dev);
+}
+
+/**
+ * clockevents_register_device - register a clock event device
+ * @dev:	device to register
+ *
+ * Per cpu devices have to be registered on the cpu they belong to,
+ * with interrupts disabled.
+ */
+void clockevents_register_device(struct clock_event_device *dev)
+{
+	unsigned long flags;
+
+	BUG_ON(dev->mode != CLOCK_EVT_MODE_UNUSED);
+
+	spin_lock_irqsave(&clockevents_lock, flags);
+
+	list_add(&dev->list, &clockevent_devices);
+	tick_check_new_device(dev);
+
+	spin_unlock_irqrestore(&clockevents_lock, flags);
+}
+EXPORT_SYMBOL_GPL(clockevents_register_device);
+
+/**
+ * clockevents_cpu_dead - release the devices of a dead cpu
+ * @cpu:	the cpu which went offline
+ *
+ * Called from the cpu hotplug code on an online cpu. The per cpu
+ * devices of @cpu are registered again when it comes back.
+ */
+void clockevents_cpu_dead(int cpu)
+{
+	struct clock_event_device *dev, *tmp;
+	cpumask_t mask = cpumask_of_cpu(cpu);
+	unsigned long flags;
+
+	spin_lock_irqsave(&clockevents_lock, flags);
+
+	tick_cpu_dead(cpu);
+
+	list_for_each_entry_safe(dev, tmp, &clockevent_devices, list) {
+		if (cpus_equal(dev->cpumask, mask)) {
+			list_del(&dev->list);
+			dev->mode = CLOCK_EVT_MODE_UNUSED;
+		}
+	}
+
+	spin_unlock_irqrestore(&clockevents_lock, flags);
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+static int clockevents_cpu_notify(struct notifier_block *self,
+				  unsigned long action, void *hcpu)
+{
+	if (action == CPU_DEAD)
+		clockevents_cpu_dead((long)hcpu);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block clockevents_nb = {
+	.notifier_call = clockevents_cpu_notify,
+};
+
+static int __init clockevents_init(void)
+{
+	register_cpu_notifier(&clockevents_nb);
+	return 0;
+}
+core_initcall(clockevents_init);
+#endif
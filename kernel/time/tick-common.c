@@ -0,0 +1,120 @@
+/*
+ * linux/kernel/time/tick-common.c
+ *
+ * This file contains the base functions to manage periodic tick
+ * related events.
+ *
+ * The per cpu tick (process accounting, the timer wheel, scheduler
+ * and profiling ticks) is driven by the clock event device which
+ * is local to the cpu. jiffies and the time of day are still kept
+ * by the architecture's global timer interrupt.
+ */
+#include <linux/cpu.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/percpu.h>
+#include <linux/profile.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+
+#include "tick-internal.h"
+
+/*
+ * Tick devices
+ */
+DEFINE_PER_CPU(struct tick_device, tick_cpu_device);
+
+/*
+ * Tick period, also the distance of the per cpu oneshot ticks
+ */
+ktime_t tick_period = { .tv64 = NSEC_PER_SEC / HZ };
+
+/*
+ * Debugging: see timer_list.c
+ */
+struct tick_device *tick_get_device(int cpu)
+{
+	return &per_cpu(tick_cpu_device, cpu);
+}
+
+/*
+ * Event handler for periodic ticks
+ */
+void tick_handle_periodic(struct clock_event_device *dev,
+			  struct pt_regs *regs)
+{
+	update_process_times(user_mode(regs));
+	profile_tick(CPU_PROFILING, regs);
+}
+
+/*
+ * Setup the tick device
+ */
+static void tick_setup_device(struct tick_device *td,
+			      struct clock_event_device *newdev)
+{
+	td->evtdev = newdev;
+	td->mode = TICKDEV_MODE_PERIODIC;
+
+	newdev->event_handler = tick_handle_periodic;
+	clockevents_set_mode(newdev, CLOCK_EVT_MODE_PERIODIC);
+}
+
+/*
+ * Check, if the new registered device should be used as the tick
+ * device of the current cpu.
+ *
+ * Called with clockevents_lock held and interrupts disabled.
+ */
+void tick_check_new_device(struct clock_event_device *newdev)
+{
+	struct clock_event_device *curdev;
+	struct tick_device *td;
+	cpumask_t mask;
+	int cpu;
+
+	cpu = smp_processor_id();
+	mask = cpumask_of_cpu(cpu);
+
+	/*
+	 * Only cpu local devices can drive the local tick, and we
+	 * start out in periodic mode:
+	 */
+	if (!cpus_equal(newdev->cpumask, mask))
+		return;
+	if (!(newdev->features & CLOCK_EVT_FEAT_PERIODIC))
+		return;
+
+	td = &per_cpu(tick_cpu_device, cpu);
+	curdev = td->evtdev;
+
+	if (curdev) {
+		/* Prefer the better rated device */
+		if (curdev->rating >= newdev->rating)
+			return;
+		clockevents_set_mode(curdev, CLOCK_EVT_MODE_SHUTDOWN);
+	}
+
+	tick_setup_device(td, newdev);
+
+	/*
+	 * Let the nohz and high resolution code know that it might
+	 * switch to oneshot mode
+	 */
+	tick_sched_device_changed();
+}
+
+/*
+ * Forget the tick device of a dead cpu.
+ *
+ * Called with clockevents_lock held.
+ */
+void tick_cpu_dead(int cpu)
+{
+	struct tick_device *td = &per_cpu(tick_cpu_device, cpu);
+
+	td->evtdev = NULL;
+	td->mode = TICKDEV_MODE_PERIODIC;
+
+	tick_sched_cpu_dead(cpu);
+}
@@ -0,0 +1,24 @@
+/*
+ * tick internal variable and functions used by the periodic and the
+ * oneshot/nohz tick code
+ */
+DECLARE_PER_CPU(struct tick_device, tick_cpu_device);
+extern ktime_t tick_period;
+
+extern void tick_handle_periodic(struct clock_event_device *dev,
+				 struct pt_regs *regs);
+
+#ifdef CONFIG_TICK_ONESHOT
+extern int tick_switch_to_oneshot(void (*handler)
+				  (struct clock_event_device *,
+				   struct pt_regs *));
+extern int tick_program_event(ktime_t expires, int force);
+#endif
+
+#ifdef CONFIG_TICK_ONESHOT
+extern void tick_sched_device_changed(void);
+extern void tick_sched_cpu_dead(int cpu);
+#else
+static inline void tick_sched_device_changed(void) { }
+static inline void tick_sched_cpu_dead(int cpu) { }
+#endif
@@ -0,0 +1,80 @@
+/*
+ * linux/kernel/time/tick-oneshot.c
+ *
+ * This file contains functions which manage the oneshot mode of the
+ * per cpu tick devices.
+ */
+#include <linux/cpu.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+
+#include "tick-internal.h"
+
+/**
+ * tick_program_event - program the cpu local tick device
+ * @expires:	absolute expiry time (monotonic clock)
+ * @force:	when the event is in the past, program the device for
+ *		the earliest possible event instead of failing
+ *
+ * Must be called with interrupts disabled.
+ */
+int tick_program_event(ktime_t expires, int force)
+{
+	struct clock_event_device *dev = __get_cpu_var(tick_cpu_device).evtdev;
+	ktime_t now = ktime_get();
+
+	for (;;) {
+		int ret = clockevents_program_event(dev, expires, now);
+
+		if (!ret || !force)
+			return ret;
+		now = ktime_get();
+		expires = ktime_add_ns(now, dev->min_delta_ns);
+	}
+}
+
+/**
+ * tick_switch_to_oneshot - switch the cpu local tick device to oneshot
+ * @handler:	the event handler which takes over the tick
+ *
+ * Must be called with interrupts disabled.
+ */
+int tick_switch_to_oneshot(void (*handler)(struct clock_event_device *,
+					   struct pt_regs *))
+{
+	struct tick_device *td = &__get_cpu_var(tick_cpu_device);
+	struct clock_event_device *dev = td->evtdev;
+
+	if (!dev || !(dev->features & CLOCK_EVT_FEAT_ONESHOT)) {
+		printk(KERN_INFO "Clockevents: "
+		       "could not switch to one-shot mode:");
+		if (!dev)
+			printk(" no tick device\n");
+		else
+			printk(" %s does not support one-shot mode.\n",
+			       dev->name);
+		return -EINVAL;
+	}
+
+	td->mode = TICKDEV_MODE_ONESHOT;
+	dev->event_handler = handler;
+	clockevents_set_mode(dev, CLOCK_EVT_MODE_ONESHOT);
+	dev->next_event.tv64 = KTIME_MAX;
+
+	return 0;
+}
+
+#ifdef CONFIG_HIGH_RES_TIMERS
+/**
+ * tick_init_highres - switch to high resolution mode
+ *
+ * Called with interrupts disabled.
+ */
+int tick_init_highres(void)
+{
+	return tick_switch_to_oneshot(hrtimer_interrupt);
+}
+#endif
@@ -0,0 +1,483 @@
+/*
+ *  linux/kernel/time/tick-sched.c
+ *
+ *  No idle tick implementation and sched tick emulation
+ *
+ *  Once the local clock event device is capable of oneshot operation,
+ *  the per cpu tick is emulated by programming the device for every
+ *  tick. In high resolution mode the device is owned by the hrtimer
+ *  code and the tick is a hrtimer of its own.
+ *
+ *  When a cpu goes idle we program it for the next pending timer
+ *  instead and skip all the ticks in between. The skipped ticks are
+ *  accounted to idle when the cpu resumes normal operation.
+ */
+#include <linux/cpu.h>
+#include <linux/hrtimer.h>
+#include <linux/interrupt.h>
+#include <linux/kernel_stat.h>
+#include <linux/percpu.h>
+#include <linux/profile.h>
+#include <linux/rcupdate.h>
+#include <linux/sched.h>
+#include <linux/tick.h>
+
+#include "tick-internal.h"
+
+/*
+ * Per cpu nohz control structure
+ */
+static DEFINE_PER_CPU(struct tick_sched, tick_cpu_sched);
+
+struct tick_sched *tick_get_tick_sched(int cpu)
+{
+	return &per_cpu(tick_cpu_sched, cpu);
+}
+
+#ifdef CONFIG_NO_HZ
+/*
+ * NO HZ enabled ?
+ */
+static int tick_nohz_enabled __read_mostly = 1;
+
+/*
+ * Enable / Disable tickless mode
+ */
+static int __init setup_tick_nohz(char *str)
+{
+	if (!strcmp(str, "off"))
+		tick_nohz_enabled = 0;
+	else if (!strcmp(str, "on"))
+		tick_nohz_enabled = 1;
+	else
+		return 0;
+	return 1;
+}
+
+__setup("nohz=", setup_tick_nohz);
+
+/*
+ * (Re)arm the tick at the expiry time of the sched timer. Returns
+ * nonzero when the event was in the past already.
+ */
+static int tick_nohz_program(struct tick_sched *ts)
+{
+	if (ts->nohz_mode == NOHZ_MODE_HIGHRES) {
+		hrtimer_start(&ts->sched_timer, ts->sched_timer.expires,
+			      HRTIMER_ABS);
+		return 0;
+	}
+	return tick_program_event(ts->sched_timer.expires, 0);
+}
+
+/*
+ * Move the tick timeline past now and program the next tick.
+ * Returns nonzero when the event was in the past already.
+ */
+static int tick_nohz_reprogram(struct tick_sched *ts)
+{
+	hrtimer_forward(&ts->sched_timer, tick_period);
+
+	return tick_nohz_program(ts);
+}
+
+/**
+ * tick_nohz_stop_sched_tick - stop the idle tick from the idle task
+ *
+ * When the next event is more than a tick into the future, stop the idle tick
+ * Called either from the idle loop or from irq_exit() when an idle period was
+ * just interrupted by an interrupt which did not cause a reschedule.
+ */
+void tick_nohz_stop_sched_tick(void)
+{
+	unsigned long last_jiffies, next_jiffies, delta_jiffies, max_jiffies;
+	unsigned long flags;
+	struct clock_event_device *dev;
+	struct tick_sched *ts;
+	ktime_t now;
+	int cpu;
+
+	local_irq_save(flags);
+
+	cpu = smp_processor_id();
+	ts = &per_cpu(tick_cpu_sched, cpu);
+
+	if (unlikely(ts->nohz_mode == NOHZ_MODE_INACTIVE))
+		goto end;
+
+	if (need_resched())
+		goto end;
+
+	/* Pending softirqs are run from the tick, keep it going */
+	if (unlikely(local_softirq_pending()))
+		goto end;
+
+	now = ktime_get();
+	/*
+	 * When called from irq_exit we need to account the idle sleep time
+	 * correctly.
+	 */
+	if (ts->tick_stopped) {
+		ktime_t delta = ktime_sub(now, ts->idle_entrytime);
+
+		ts->idle_sleeptime = ktime_add(ts->idle_sleeptime, delta);
+	}
+
+	ts->idle_entrytime = now;
+	ts->idle_calls++;
+
+	last_jiffies = jiffies;
+	next_jiffies = next_timer_interrupt();
+	delta_jiffies = next_jiffies - last_jiffies;
+
+	if (rcu_needs_cpu(cpu))
+		delta_jiffies = 1;
+
+	/*
+	 * Do not stop the tick, if we are only one off
+	 * or if the cpu is required for rcu
+	 */
+	if (!ts->tick_stopped && delta_jiffies == 1)
+		goto out;
+
+	/* Schedule the tick, if we are at least one jiffie off */
+	if ((long)delta_jiffies >= 1) {
+
+		if (!ts->tick_stopped) {
+			cpu_set(cpu, nohz_cpu_mask);
+			/*
+			 * The rcu core reads nohz_cpu_mask when it starts
+			 * a new batch. Recheck after setting our bit, so
+			 * a batch which started in between is not missed.
+			 */
+			smp_mb();
+			if (rcu_pending(cpu)) {
+				cpu_clear(cpu, nohz_cpu_mask);
+				goto out;
+			}
+
+			ts->idle_tick = ts->sched_timer.expires;
+			ts->tick_stopped = 1;
+			ts->idle_jiffies = last_jiffies;
+		}
+
+		/*
+		 * The device can not be programmed further into the
+		 * future anyway, and we must not overflow below:
+		 */
+		dev = __get_cpu_var(tick_cpu_device).evtdev;
+		max_jiffies = dev->max_delta_ns / (NSEC_PER_SEC / HZ) + 1;
+		if (delta_jiffies > max_jiffies)
+			delta_jiffies = max_jiffies;
+
+		/*
+		 * Stay on the timeline of the tick: wake up delta_jiffies
+		 * - 1 periods after the next regular tick. In high
+		 * resolution mode the sched timer is queued, take it
+		 * off the queue before we modify it.
+		 */
+		hrtimer_cancel(&ts->sched_timer);
+		ts->sched_timer.expires = ts->idle_tick;
+		hrtimer_forward(&ts->sched_timer, tick_period);
+		ts->sched_timer.expires =
+			ktime_add_ns(ts->sched_timer.expires,
+				     (u64)(delta_jiffies - 1) *
+				     (NSEC_PER_SEC / HZ));
+		ts->idle_expires = ts->sched_timer.expires;
+		ts->idle_sleeps++;
+
+		if (!tick_nohz_program(ts))
+			goto out;
+	}
+	/*
+	 * We are past the event already. So we crossed a jiffie
+	 * boundary. Raise the softirq so the timer wheel catches
+	 * up; this also gets us out of the idle loop.
+	 */
+	raise_softirq_irqoff(TIMER_SOFTIRQ);
+out:
+	ts->next_jiffies = next_jiffies;
+	ts->last_jiffies = last_jiffies;
+end:
+	local_irq_restore(flags);
+}
+
+/**
+ * tick_nohz_restart_sched_tick - restart the idle tick from the idle task
+ *
+ * Restart the idle tick when the CPU is woken up from idle
+ */
+void tick_nohz_restart_sched_tick(void)
+{
+	int cpu = smp_processor_id();
+	struct tick_sched *ts = &per_cpu(tick_cpu_sched, cpu);
+	unsigned long ticks;
+	ktime_t now, delta;
+
+	if (!ts->tick_stopped)
+		return;
+
+	local_irq_disable();
+
+	now = ktime_get();
+	cpu_clear(cpu, nohz_cpu_mask);
+
+	/* Account the idle time */
+	delta = ktime_sub(now, ts->idle_entrytime);
+	ts->idle_sleeptime = ktime_add(ts->idle_sleeptime, delta);
+
+	/*
+	 * We stopped the tick in idle. Update process times would miss the
+	 * time we slept as update_process_times does only a 1 tick
+	 * accounting. Enforce that this is accounted to idle !
+	 */
+	ticks = jiffies - ts->idle_jiffies;
+	/*
+	 * We might be one off. Do not randomly account a huge number of ticks!
+	 */
+	if (ticks && ticks < LONG_MAX) {
+		add_preempt_count(HARDIRQ_OFFSET);
+		account_system_time(current, HARDIRQ_OFFSET,
+				    jiffies_to_cputime(ticks));
+		sub_preempt_count(HARDIRQ_OFFSET);
+	}
+
+	touch_softlockup_watchdog();
+
+	/* Resume the tick in its timeline */
+	ts->tick_stopped  = 0;
+	hrtimer_cancel(&ts->sched_timer);
+	ts->sched_timer.expires = ts->idle_tick;
+	while (tick_nohz_reprogram(ts))
+		;
+
+	local_irq_enable();
+}
+
+/*
+ * The nohz low res interrupt handler
+ */
+static void tick_nohz_handler(struct clock_event_device *dev,
+			      struct pt_regs *regs)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+
+	dev->next_event.tv64 = KTIME_MAX;
+
+	/*
+	 * When we are idle and the tick is stopped, we have to touch
+	 * the watchdog as we might not schedule for a really long
+	 * time. This happens on complete idle SMP systems while
+	 * waiting on the login prompt. We also increment the "start
+	 * of idle" jiffy stamp so the idle accounting adjustment we
+	 * do when we go busy again does not account too much ticks.
+	 */
+	if (ts->tick_stopped) {
+		touch_softlockup_watchdog();
+		ts->idle_jiffies++;
+	}
+
+	update_process_times(user_mode(regs));
+	profile_tick(CPU_PROFILING, regs);
+
+	/* Do not restart, when we are in the idle loop */
+	if (ts->tick_stopped)
+		return;
+
+	while (tick_nohz_reprogram(ts))
+		;
+}
+
+/**
+ * tick_nohz_switch_to_nohz - switch to nohz mode
+ */
+static void tick_nohz_switch_to_nohz(void)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+
+	if (!tick_nohz_enabled)
+		return;
+
+	local_irq_disable();
+	if (tick_switch_to_oneshot(tick_nohz_handler)) {
+		local_irq_enable();
+		return;
+	}
+
+	ts->nohz_mode = NOHZ_MODE_LOWRES;
+
+	/*
+	 * The hrtimer is not enqueued, it just keeps the timeline of
+	 * the tick so we can use hrtimer_forward() on it.
+	 */
+	hrtimer_init(&ts->sched_timer, CLOCK_MONOTONIC);
+	ts->sched_timer.expires = ktime_get();
+	while (tick_nohz_reprogram(ts))
+		;
+
+	local_irq_enable();
+
+	printk(KERN_INFO "Switched to NOHz mode on CPU #%d\n",
+	       smp_processor_id());
+}
+
+#else
+
+static inline void tick_nohz_switch_to_nohz(void) { }
+
+#endif /* NO_HZ */
+
+/*
+ * High resolution timer specific code
+ */
+#ifdef CONFIG_HIGH_RES_TIMERS
+/*
+ * We rearm the timer until we get disabled by the idle code.
+ * Called with interrupts disabled, from the hrtimer interrupt.
+ */
+static int tick_sched_timer(void *data)
+{
+	struct tick_sched *ts = data;
+	struct pt_regs *regs = hrtimer_get_irq_regs();
+
+#ifdef CONFIG_NO_HZ
+	/*
+	 * See tick_nohz_handler(): keep the watchdog and the idle
+	 * accounting happy while the tick is stopped.
+	 */
+	if (ts->tick_stopped) {
+		touch_softlockup_watchdog();
+		ts->idle_jiffies++;
+	}
+#endif
+	/*
+	 * regs is NULL only when the timer was run from the softirq,
+	 * which does not happen once we are in high resolution mode.
+	 */
+	if (regs) {
+		update_process_times(user_mode(regs));
+		profile_tick(CPU_PROFILING, regs);
+	}
+
+	/* Do not restart, when we are in the idle loop */
+	if (ts->tick_stopped)
+		return HRTIMER_NORESTART;
+
+	hrtimer_forward(&ts->sched_timer, tick_period);
+
+	return HRTIMER_RESTART;
+}
+
+/**
+ * tick_setup_sched_timer - setup the tick emulation timer
+ *
+ * Called from the hrtimer code on the switch to high resolution
+ * mode, with interrupts disabled.
+ */
+void tick_setup_sched_timer(void)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+
+	hrtimer_init(&ts->sched_timer, CLOCK_MONOTONIC);
+	ts->sched_timer.function = tick_sched_timer;
+	ts->sched_timer.data = ts;
+
+	/* Get the next period */
+	ts->sched_timer.expires = ktime_add(ktime_get(), tick_period);
+	hrtimer_start(&ts->sched_timer, ts->sched_timer.expires, HRTIMER_ABS);
+
+#ifdef CONFIG_NO_HZ
+	if (tick_nohz_enabled)
+		ts->nohz_mode = NOHZ_MODE_HIGHRES;
+#endif
+}
+
+/**
+ * tick_cancel_sched_timer - stop the tick emulation of a dead cpu
+ * @cpu:	the cpu which went offline
+ */
+void tick_cancel_sched_timer(int cpu)
+{
+	struct tick_sched *ts = &per_cpu(tick_cpu_sched, cpu);
+
+	if (ts->sched_timer.base)
+		hrtimer_cancel(&ts->sched_timer);
+	ts->tick_stopped = 0;
+	ts->nohz_mode = NOHZ_MODE_INACTIVE;
+}
+#endif /* HIGH_RES_TIMERS */
+
+/**
+ * tick_clock_notify - a new clocksource was installed
+ *
+ * A continuous clocksource might allow the switch to high resolution
+ * mode now; let every cpu check at its next timer softirq.
+ */
+void tick_clock_notify(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu)
+		set_bit(0, &per_cpu(tick_cpu_sched, cpu).check_clocks);
+}
+
+/**
+ * tick_check_oneshot_change - check whether the tick can go oneshot
+ * @allow_nohz:	switch to low resolution nohz mode if possible
+ *
+ * Called from the timer softirq of each cpu. Returns 1 when the cpu
+ * can be switched to high resolution mode.
+ */
+int tick_check_oneshot_change(int allow_nohz)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+	struct clock_event_device *dev;
+
+	if (!test_and_clear_bit(0, &ts->check_clocks))
+		return 0;
+
+	if (ts->nohz_mode != NOHZ_MODE_INACTIVE)
+		return 0;
+
+	dev = __get_cpu_var(tick_cpu_device).evtdev;
+	if (!dev || !(dev->features & CLOCK_EVT_FEAT_ONESHOT))
+		return 0;
+
+	if (!allow_nohz) {
+		/*
+		 * High resolution mode needs a clocksource which keeps
+		 * running between ticks. We are notified when one gets
+		 * installed.
+		 */
+		return timekeeping_is_continuous();
+	}
+
+	tick_nohz_switch_to_nohz();
+	return 0;
+}
+
+/*
+ * A new tick device was installed on this cpu. It starts out in
+ * periodic mode; the next timer softirq checks whether we can go
+ * tickless or high resolution with it. Called with interrupts
+ * disabled.
+ */
+void tick_sched_device_changed(void)
+{
+	struct tick_sched *ts = &__get_cpu_var(tick_cpu_sched);
+
+	ts->nohz_mode = NOHZ_MODE_INACTIVE;
+	set_bit(0, &ts->check_clocks);
+}
+
+/*
+ * Reset the nohz state of a dead cpu
+ */
+void tick_sched_cpu_dead(int cpu)
+{
+	struct tick_sched *ts = &per_cpu(tick_cpu_sched, cpu);
+
+	tick_cancel_sched_timer(cpu);
+	memset(ts, 0, sizeof(*ts));
+	cpu_clear(cpu, nohz_cpu_mask);
+}
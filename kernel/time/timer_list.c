@@ -0,0 +1,136 @@
+/*
+ * kernel/time/timer_list.c
+ *
+ * List the per cpu tick devices and the state of the tickless idle
+ * code in /proc/timer_list.
+ */
+
+#include <linux/proc_fs.h>
+#include <linux/module.h>
+#include <linux/spinlock.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/kallsyms.h>
+#include <linux/tick.h>
+
+#include <asm/uaccess.h>
+
+static void print_name_offset(struct seq_file *m, void *sym)
+{
+	unsigned long addr = (unsigned long)sym;
+	char namebuf[KSYM_NAME_LEN+1];
+	unsigned long size, offset;
+	const char *sym_name;
+	char *modname;
+
+	sym_name = kallsyms_lookup(addr, &size, &offset, &modname, namebuf);
+	if (sym_name)
+		seq_printf(m, "%s", sym_name);
+	else
+		seq_printf(m, "<%p>", sym);
+}
+
+#ifdef CONFIG_TICK_ONESHOT
+static void print_tick_sched(struct seq_file *m, int cpu)
+{
+	struct tick_sched *ts = tick_get_tick_sched(cpu);
+
+#define P(x) \
+	seq_printf(m, "  .%-15s: %Lu\n", #x, (unsigned long long)(ts->x))
+#define P_ns(x) \
+	seq_printf(m, "  .%-15s: %Lu nsecs\n", #x, \
+		   (unsigned long long)(ktime_to_ns(ts->x)))
+
+	P(nohz_mode);
+	P_ns(idle_tick);
+	P(tick_stopped);
+	P(idle_jiffies);
+	P(idle_calls);
+	P(idle_sleeps);
+	P_ns(idle_entrytime);
+	P_ns(idle_sleeptime);
+	P(last_jiffies);
+	P(next_jiffies);
+	P_ns(idle_expires);
+
+#undef P
+#undef P_ns
+}
+#else
+static inline void print_tick_sched(struct seq_file *m, int cpu) { }
+#endif
+
+static void print_tickdevice(struct seq_file *m, int cpu)
+{
+	struct tick_device *td = tick_get_device(cpu);
+	struct clock_event_device *dev = td->evtdev;
+
+	seq_printf(m, "Tick Device: mode:     %d\n", td->mode);
+	seq_printf(m, "Clock Event Device: ");
+	if (!dev) {
+		seq_printf(m, "<NULL>\n");
+		return;
+	}
+	seq_printf(m, "%s\n", dev->name);
+	seq_printf(m, " max_delta_ns:   %lu\n", dev->max_delta_ns);
+	seq_printf(m, " min_delta_ns:   %lu\n", dev->min_delta_ns);
+	seq_printf(m, " mult:           %lu\n", dev->mult);
+	seq_printf(m, " shift:          %d\n", dev->shift);
+	seq_printf(m, " mode:           %d\n", dev->mode);
+	seq_printf(m, " next_event:     %Ld nsecs\n",
+		   (unsigned long long) ktime_to_ns(dev->next_event));
+
+	seq_printf(m, " set_next_event: ");
+	print_name_offset(m, dev->set_next_event);
+
+	seq_printf(m, "\n set_mode:       ");
+	print_name_offset(m, dev->set_mode);
+
+	seq_printf(m, "\n event_handler:  ");
+	print_name_offset(m, dev->event_handler);
+	seq_printf(m, "\n");
+}
+
+static int timer_list_show(struct seq_file *m, void *v)
+{
+	u64 now = ktime_to_ns(ktime_get());
+	int cpu;
+
+	seq_printf(m, "Timer List Version: v0.1\n");
+	seq_printf(m, "now at %Ld nsecs\n", (unsigned long long)now);
+
+	for_each_online_cpu(cpu) {
+		seq_printf(m, "\ncpu: %d\n", cpu);
+		print_tick_sched(m, cpu);
+		print_tickdevice(m, cpu);
+	}
+	seq_printf(m, "\njiffies: %Lu\n", (unsigned long long)jiffies);
+
+	return 0;
+}
+
+static int timer_list_open(struct inode *inode, struct file *filp)
+{
+	return single_open(filp, timer_list_show, NULL);
+}
+
+static struct file_operations timer_list_fops = {
+	.open		= timer_list_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static int __init init_timer_list_procfs(void)
+{
+	struct proc_dir_entry *pe;
+
+	pe = create_proc_entry("timer_list", 0444, NULL);
+	if (!pe)
+		return -ENOMEM;
+
+	pe->proc_fops = &timer_list_fops;
+
+	return 0;
+}
+__initcall(init_timer_list_procfs);
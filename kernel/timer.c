@@ -34,6 +34,10 @@
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
 #include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/clocksource.h>
+#include <linux/sysdev.h>
+#include <linux/tick.h>
 
 #include <asm/uaccess.h>
 #include <asm/unistd.h>
@@ -266,6 +270,14 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	timer->base = &base->t_base;
 	internal_add_timer(base, timer);
 	spin_unlock_irqrestore(&base->t_base.lock, flags);
+#if defined(CONFIG_NO_HZ) && defined(CONFIG_SMP)
+	/*
+	 * The target cpu may be idle with its tick stopped. Kick it so
+	 * that it reevaluates the timer wheel:
+	 */
+	if (cpu_isset(cpu, nohz_cpu_mask))
+		smp_send_reschedule(cpu);
+#endif
 }
 
 
@@ -477,10 +489,11 @@ static inline void __run_timers(tvec_base_t *base)
 	spin_unlock_irq(&base->t_base.lock);
 }
 
-#ifdef CONFIG_NO_IDLE_HZ
+#if defined(CONFIG_NO_IDLE_HZ) || defined(CONFIG_NO_HZ)
 /*
  * Find out when the next timer event is due to happen. This
- * is used on S/390 to stop all activity when a cpus is idle.
+ * is used on S/390 and by the dynamic tick code to stop all
+ * activity when a cpu is idle.
  * This functions needs to be called disabled.
  */
 unsigned long next_timer_interrupt(void)
@@ -489,9 +502,30 @@ unsigned long next_timer_interrupt(void)
 	struct list_head *list;
 	struct timer_list *nte;
 	unsigned long expires;
+	unsigned long hr_expires = MAX_JIFFY_OFFSET;
 	tvec_t *varray[4];
 	int i, j;
 
+#ifdef CONFIG_NO_HZ
+	/*
+	 * hrtimers are expired from the timer softirq, so the tick has
+	 * to be back in time for the first one as well:
+	 */
+	{
+		ktime_t hr_delta = hrtimer_get_next_event();
+
+		if (hr_delta.tv64 != KTIME_MAX) {
+			struct timespec tsdelta;
+
+			tsdelta = ktime_to_timespec(hr_delta);
+			hr_expires = timespec_to_jiffies(&tsdelta);
+			if (hr_expires < 3)
+				return hr_expires + jiffies;
+		}
+	}
+#endif
+	hr_expires += jiffies;
+
 	base = &__get_cpu_var(tvec_bases);
 	spin_lock(&base->t_base.lock);
 	expires = base->timer_jiffies + (LONG_MAX >> 1);
@@ -542,6 +576,10 @@ found:
 		}
 	}
 	spin_unlock(&base->t_base.lock);
+
+	if (time_before(hr_expires, expires))
+		return hr_expires;
+
 	return expires;
 }
 #endif
@@ -635,7 +673,12 @@ static void second_overflow(void)
 			 */
 			time_interpolator_update(-NSEC_PER_SEC);
 			time_state = TIME_OOP;
-			clock_was_set();
+			/*
+			 * We are in the timer interrupt, so no
+			 * clock_was_set() here: high resolution timers
+			 * pick up the new offset of the realtime clock at
+			 * their next interrupt.
+			 */
 			printk(KERN_NOTICE "Clock: inserting leap second "
 					"23:59:60 UTC\n");
 		}
@@ -650,7 +693,6 @@ static void second_overflow(void)
 			 */
 			time_interpolator_update(NSEC_PER_SEC);
 			time_state = TIME_WAIT;
-			clock_was_set();
 			printk(KERN_NOTICE "Clock: deleting leap second "
 					"23:59:59 UTC\n");
 		}
@@ -717,8 +759,16 @@ static void second_overflow(void)
 #endif
 }
 
-/* in the NTP reference this is called "hardclock()" */
-static void update_wall_time_one_tick(void)
+/*
+ * ntp_advance_tick - length of the next tick in nanoseconds
+ *
+ * Returns the length of the next tick as seen by NTP: the nominal
+ * tick length corrected by the adjtime() slew and the phase/frequency
+ * adjustment computed in second_overflow().
+ *
+ * In the NTP reference this is called "hardclock()".
+ */
+static long ntp_advance_tick(void)
 {
 	long time_adjust_step, delta_nsec;
 
@@ -748,14 +798,24 @@ static void update_wall_time_one_tick(void)
 		time_phase -= ltemp << (SHIFT_SCALE - 10);
 		delta_nsec += ltemp;
 	}
-	xtime.tv_nsec += delta_nsec;
-	time_interpolator_update(delta_nsec);
 
 	/* Changes by adjtime() do not take effect till next tick. */
 	if (time_next_adjust != 0) {
 		time_adjust = time_next_adjust;
 		time_next_adjust = 0;
 	}
+
+	return delta_nsec;
+}
+
+#ifndef CONFIG_GENERIC_TIME
+
+static void update_wall_time_one_tick(void)
+{
+	long delta_nsec = ntp_advance_tick();
+
+	xtime.tv_nsec += delta_nsec;
+	time_interpolator_update(delta_nsec);
 }
 
 /*
@@ -778,6 +838,310 @@ static void update_wall_time(unsigned long ticks)
 	} while (ticks);
 }
 
+#else /* CONFIG_GENERIC_TIME */
+
+/*
+ * The current clocksource. Wall time is accumulated from it in
+ * update_wall_time() and interpolated between two updates in
+ * getnstimeofday(). Protected by xtime_lock.
+ */
+static struct clocksource *clock = &clocksource_jiffies;
+
+/**
+ * __get_nsec_offset - Returns nanoseconds since last call to update_wall_time
+ *
+ * private function, must hold xtime_lock lock when being
+ * called. Returns the number of nanoseconds since the
+ * last call to update_wall_time() (adjusted by NTP scaling)
+ */
+static inline s64 __get_nsec_offset(void)
+{
+	cycle_t cycle_now, cycle_delta;
+	s64 ns_offset;
+
+	/* read clocksource: */
+	cycle_now = clocksource_read(clock);
+
+	/* calculate the delta since the last update_wall_time: */
+	cycle_delta = (cycle_now - clock->cycle_last) & clock->mask;
+
+	/* convert to nanoseconds: */
+	ns_offset = cyc2ns(clock, cycle_delta);
+
+	return ns_offset;
+}
+
+/**
+ * getnstimeofday - Returns the time of day in a timespec
+ * @ts:		pointer to the timespec to be set
+ *
+ * Returns the time of day in a timespec.
+ */
+void getnstimeofday(struct timespec *ts)
+{
+	unsigned long seq;
+	s64 nsecs;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+
+		*ts = xtime;
+		nsecs = __get_nsec_offset();
+
+	} while (read_seqretry(&xtime_lock, seq));
+
+	timespec_add_ns(ts, nsecs);
+}
+
+EXPORT_SYMBOL(getnstimeofday);
+
+/**
+ * do_gettimeofday - Returns the time of day in a timeval
+ * @tv:		pointer to the timeval to be set
+ *
+ * NOTE: Users should be converted to using get_realtime_clock_ts()
+ */
+void do_gettimeofday(struct timeval *tv)
+{
+	struct timespec now;
+
+	getnstimeofday(&now);
+	tv->tv_sec = now.tv_sec;
+	tv->tv_usec = now.tv_nsec/1000;
+}
+
+EXPORT_SYMBOL(do_gettimeofday);
+
+/**
+ * do_settimeofday - Sets the time of day
+ * @tv:		pointer to the timespec variable containing the new time
+ *
+ * Sets the time of day to the new time and update NTP and notify hrtimers
+ */
+int do_settimeofday(struct timespec *tv)
+{
+	unsigned long flags;
+	time_t wtm_sec, sec = tv->tv_sec;
+	long wtm_nsec, nsec = tv->tv_nsec;
+
+	if ((unsigned long)tv->tv_nsec >= NSEC_PER_SEC)
+		return -EINVAL;
+
+	write_seqlock_irqsave(&xtime_lock, flags);
+
+	nsec -= __get_nsec_offset();
+
+	wtm_sec  = wall_to_monotonic.tv_sec + (xtime.tv_sec - sec);
+	wtm_nsec = wall_to_monotonic.tv_nsec + (xtime.tv_nsec - nsec);
+
+	set_normalized_timespec(&xtime, sec, nsec);
+	set_normalized_timespec(&wall_to_monotonic, wtm_sec, wtm_nsec);
+
+	clock->error = 0;
+	ntp_clear();
+
+	update_vsyscall(&xtime, clock);
+
+	write_sequnlock_irqrestore(&xtime_lock, flags);
+
+	/* signal hrtimers about time change */
+	clock_was_set();
+
+	return 0;
+}
+
+EXPORT_SYMBOL(do_settimeofday);
+
+/**
+ * change_clocksource - Swaps clocksources if a new one is available
+ *
+ * Accumulates current time interval and initializes new clocksource
+ */
+static void change_clocksource(void)
+{
+	struct clocksource *new;
+	cycle_t now;
+	u64 nsec;
+
+	new = clocksource_get_next();
+
+	if (clock == new)
+		return;
+
+	now = clocksource_read(new);
+	nsec =  __get_nsec_offset();
+	timespec_add_ns(&xtime, nsec);
+
+	clock = new;
+	clock->cycle_last = now;
+
+	clock->error = 0;
+	clock->xtime_nsec = 0;
+	clocksource_calculate_interval(clock, tick_nsec);
+
+	tick_clock_notify();
+
+	printk(KERN_INFO "Time: %s clocksource has been installed.\n",
+	       clock->name);
+}
+
+/**
+ * timekeeping_is_continuous - check to see if timekeeping is free running
+ */
+int timekeeping_is_continuous(void)
+{
+	unsigned long seq;
+	int ret;
+
+	do {
+		seq = read_seqbegin(&xtime_lock);
+
+		ret = clock->is_continuous;
+
+	} while (read_seqretry(&xtime_lock, seq));
+
+	return ret;
+}
+
+/*
+ * timekeeping_init - Initializes the clocksource and common timekeeping values
+ */
+void __init timekeeping_init(void)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&xtime_lock, flags);
+	clock = clocksource_get_next();
+	clocksource_calculate_interval(clock, tick_nsec);
+	clock->cycle_last = clocksource_read(clock);
+	write_sequnlock_irqrestore(&xtime_lock, flags);
+}
+
+/*
+ * timekeeping_resume - Resumes the generic timekeeping subsystem.
+ * @dev:	unused
+ *
+ * This is for the generic clocksource timekeeping. xtime itself is
+ * restored by the architecture code; we only restart the counter
+ * accumulation from the current value.
+ */
+static int timekeeping_resume(struct sys_device *dev)
+{
+	unsigned long flags;
+
+	write_seqlock_irqsave(&xtime_lock, flags);
+	clock->cycle_last = clocksource_read(clock);
+	clock->error = 0;
+	write_sequnlock_irqrestore(&xtime_lock, flags);
+
+	return 0;
+}
+
+/* sysfs resume/suspend bits for timekeeping */
+static struct sysdev_class timekeeping_sysclass = {
+	.resume		= timekeeping_resume,
+	set_kset_name("timekeeping"),
+};
+
+static struct sys_device device_timer = {
+	.id		= 0,
+	.cls		= &timekeeping_sysclass,
+};
+
+static int __init timekeeping_init_device(void)
+{
+	int error = sysdev_class_register(&timekeeping_sysclass);
+	if (!error)
+		error = sysdev_register(&device_timer);
+	return error;
+}
+
+device_initcall(timekeeping_init_device);
+
+/*
+ * clocksource_adjust - adjust the clocksource multiplier
+ *
+ * The clock accumulated the error against the NTP tick length over
+ * the last intervals. Steer it back by changing the multiplier: a
+ * change of one in mult changes the length of an interval by
+ * cycle_interval (in shifted nanoseconds). Small errors are corrected
+ * one step at a time, large ones (adjtime, a new NTP frequency) with
+ * a power of two steps so they are worked off in a few intervals.
+ * The not yet accumulated offset is corrected so the time read by
+ * getnstimeofday() does not jump.
+ */
+static void clocksource_adjust(struct clocksource *clock, s64 offset)
+{
+	s64 error = clock->error, interval = clock->cycle_interval;
+	int adj = 1;
+
+	if (error < 0) {
+		error = -error;
+		adj = -1;
+	}
+	/* Not worth a step yet: */
+	if (2 * error <= interval)
+		return;
+
+	while ((interval << 3) * abs(adj) <= error && abs(adj) < (1 << 16))
+		adj <<= 1;
+
+	clock->mult += adj;
+	clock->xtime_interval += interval * adj;
+	clock->xtime_nsec -= offset * adj;
+	clock->error -= (interval - offset) * adj;
+}
+
+/*
+ * update_wall_time - Uses the current clocksource to increment the wall time
+ *
+ * Called from the timer interrupt, must hold a write on xtime_lock.
+ * Every full NTP interval (one tick) the clocksource advanced since the
+ * last call is accumulated into xtime; the error against the NTP
+ * adjusted tick length is fed back into the clock multiplier.
+ */
+static void update_wall_time(unsigned long ticks)
+{
+	cycle_t offset;
+
+	clock->xtime_nsec += (s64)xtime.tv_nsec << clock->shift;
+
+	offset = (clocksource_read(clock) - clock->cycle_last) & clock->mask;
+
+	/* normally this loop will run just once, however in the
+	 * case of lost or late ticks, it will accumulate correctly.
+	 */
+	while (offset >= clock->cycle_interval) {
+		/* accumulate one interval */
+		clock->xtime_nsec += clock->xtime_interval;
+		clock->cycle_last += clock->cycle_interval;
+		offset -= clock->cycle_interval;
+
+		if (clock->xtime_nsec >= (s64)NSEC_PER_SEC << clock->shift) {
+			clock->xtime_nsec -= (s64)NSEC_PER_SEC << clock->shift;
+			xtime.tv_sec++;
+			second_overflow();
+		}
+
+		/* accumulate error between NTP and clock interval */
+		clock->error += (s64)ntp_advance_tick() << clock->shift;
+		clock->error -= clock->xtime_interval;
+	}
+
+	/* correct the clock when NTP error is too big */
+	clocksource_adjust(clock, offset);
+
+	/* store full nanoseconds into xtime */
+	xtime.tv_nsec = clock->xtime_nsec >> clock->shift;
+	clock->xtime_nsec -= (s64)xtime.tv_nsec << clock->shift;
+
+	/* check to see if there is a new clocksource to use */
+	change_clocksource();
+	update_vsyscall(&xtime, clock);
+}
+
+#endif /* CONFIG_GENERIC_TIME */
+
 /*
  * Called from the timer interrupt handler to charge one tick to the current 
  * process.  user_tick is 1 if the tick is user time, 0 for system.
@@ -0,0 +1,250 @@
+/*
+ * mm/backing-dev.c - per-device writeback threads
+ *
+ * Every backing device which does writeback gets its own flusher thread
+ * and its own list of dirty inodes, so that a slow or congested device
+ * only ever stalls the thread which is writing to it.  Devices which are
+ * not registered (network filesystems, pseudo devices) keep their dirty
+ * inodes on default_backing_dev_info, whose thread also takes care of
+ * writing back the superblocks.
+ */
+
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/fs.h>
+#include <linux/mm.h>
+#include <linux/pagemap.h>
+#include <linux/init.h>
+#include <linux/kthread.h>
+#include <linux/writeback.h>
+#include <linux/backing-dev.h>
+
+void default_unplug_io_fn(struct backing_dev_info *bdi, struct page *page)
+{
+}
+EXPORT_SYMBOL(default_unplug_io_fn);
+
+/*
+ * Inodes can be dirtied long before the default flusher thread is started,
+ * so its lists are set up statically and it counts as registered from the
+ * beginning.
+ */
+struct backing_dev_info default_backing_dev_info = {
+	.ra_pages	= (VM_MAX_READAHEAD * 1024) / PAGE_CACHE_SIZE,
+	.state		= 1 << BDI_registered,
+	.capabilities	= BDI_CAP_MAP_COPY,
+	.unplug_io_fn	= default_unplug_io_fn,
+	.b_dirty	= LIST_HEAD_INIT(default_backing_dev_info.b_dirty),
+	.b_io		= LIST_HEAD_INIT(default_backing_dev_info.b_io),
+	.wb_lock	= SPIN_LOCK_UNLOCKED,
+};
+EXPORT_SYMBOL_GPL(default_backing_dev_info);
+
+/*
+ * All the registered devices.  Writers of bdi_list also change the
+ * BDI_registered bit, so holding bdi_list_sem for reading keeps the
+ * devices on the list and their flusher threads alive.
+ */
+LIST_HEAD(bdi_list);
+DECLARE_RWSEM(bdi_list_sem);
+
+static inline unsigned long kupdate_interval(void)
+{
+	return (dirty_writeback_centisecs * HZ) / 100;
+}
+
+/*
+ * The flusher thread.  It sleeps until either background writeout is
+ * requested through bdi_start_writeback(), or it is time to write back
+ * the old data of its device.
+ */
+static int bdi_writeback_thread(void *data)
+{
+	struct backing_dev_info *bdi = data;
+
+	current->flags |= PF_FLUSHER | PF_SWAPWRITE;
+
+	while (!kthread_should_stop()) {
+		long timeout = MAX_SCHEDULE_TIMEOUT;
+
+		if (test_and_clear_bit(BDI_wb_pending, &bdi->state)) {
+			long nr_pages;
+
+			spin_lock(&bdi->wb_lock);
+			nr_pages = bdi->wb_nr_pages;
+			bdi->wb_nr_pages = 0;
+			spin_unlock(&bdi->wb_lock);
+
+			writeback_acquire(bdi);
+			bdi_writeback_background(bdi, nr_pages);
+			writeback_release(bdi);
+		}
+
+		if (dirty_writeback_centisecs) {
+			if (time_after_eq(jiffies, bdi->wb_next_kupdate)) {
+				writeback_acquire(bdi);
+				bdi_writeback_old_data(bdi);
+				writeback_release(bdi);
+			}
+			timeout = (long)(bdi->wb_next_kupdate - jiffies);
+			if (timeout < 0)
+				timeout = 0;
+		}
+
+		set_current_state(TASK_INTERRUPTIBLE);
+		if (!test_bit(BDI_wb_pending, &bdi->state) &&
+		    !kthread_should_stop())
+			schedule_timeout(timeout);
+		__set_current_state(TASK_RUNNING);
+		try_to_freeze();
+	}
+	return 0;
+}
+
+static int bdi_start_flusher(struct backing_dev_info *bdi, const char *name)
+{
+	struct task_struct *task;
+
+	bdi->wb_next_kupdate = jiffies + kupdate_interval();
+	task = kthread_run(bdi_writeback_thread, bdi, "flush-%s", name);
+	if (IS_ERR(task))
+		return PTR_ERR(task);
+	bdi->wb_task = task;
+
+	down_write(&bdi_list_sem);
+	list_add_tail(&bdi->bdi_list, &bdi_list);
+	spin_lock(&inode_lock);
+	set_bit(BDI_registered, &bdi->state);
+	spin_unlock(&inode_lock);
+	up_write(&bdi_list_sem);
+	return 0;
+}
+
+/**
+ * bdi_register - give a backing device its own flusher thread
+ * @bdi: the device's backing_dev_info structure
+ * @name: name of the device, used to name the thread
+ *
+ * Inodes dirtied against @bdi from now on are kept on its own dirty lists
+ * and written back by its own thread.  Devices which do not write back
+ * their pages, and devices which are already registered, are left alone.
+ */
+int bdi_register(struct backing_dev_info *bdi, const char *name)
+{
+	if (!bdi_cap_writeback_dirty(bdi) || bdi_registered(bdi))
+		return 0;
+
+	INIT_LIST_HEAD(&bdi->b_dirty);
+	INIT_LIST_HEAD(&bdi->b_io);
+	spin_lock_init(&bdi->wb_lock);
+	bdi->wb_nr_pages = 0;
+	return bdi_start_flusher(bdi, name);
+}
+EXPORT_SYMBOL(bdi_register);
+
+/**
+ * bdi_unregister - stop the flusher thread of a backing device
+ * @bdi: the device's backing_dev_info structure
+ *
+ * Any inodes still dirty against @bdi are handed over to the default
+ * flusher thread.
+ */
+void bdi_unregister(struct backing_dev_info *bdi)
+{
+	struct backing_dev_info *def = &default_backing_dev_info;
+
+	if (bdi == def || !bdi_registered(bdi))
+		return;
+
+	down_write(&bdi_list_sem);
+	list_del(&bdi->bdi_list);
+	spin_lock(&inode_lock);
+	clear_bit(BDI_registered, &bdi->state);
+	spin_unlock(&inode_lock);
+	up_write(&bdi_list_sem);
+
+	kthread_stop(bdi->wb_task);
+	bdi->wb_task = NULL;
+
+	spin_lock(&inode_lock);
+	list_splice_init(&bdi->b_dirty, &def->b_dirty);
+	list_splice_init(&bdi->b_io, &def->b_dirty);
+	spin_unlock(&inode_lock);
+}
+EXPORT_SYMBOL(bdi_unregister);
+
+/*
+ * Called with bdi_list_sem held, or against the default device which never
+ * goes away.
+ */
+static void __bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages)
+{
+	if (!bdi_registered(bdi))
+		bdi = &default_backing_dev_info;
+
+	spin_lock(&bdi->wb_lock);
+	bdi->wb_nr_pages += nr_pages;
+	spin_unlock(&bdi->wb_lock);
+	set_bit(BDI_wb_pending, &bdi->state);
+	if (bdi->wb_task)
+		wake_up_process(bdi->wb_task);
+}
+
+/**
+ * bdi_start_writeback - kick background writeout against a device
+ * @bdi: the device's backing_dev_info structure
+ * @nr_pages: write back at least this many pages
+ *
+ * The flusher thread of @bdi writes back at least @nr_pages pages and then
+ * keeps going until the system is below the background dirty threshold or
+ * the device runs out of dirty data.
+ */
+void bdi_start_writeback(struct backing_dev_info *bdi, long nr_pages)
+{
+	down_read(&bdi_list_sem);
+	__bdi_start_writeback(bdi, nr_pages);
+	up_read(&bdi_list_sem);
+}
+
+/**
+ * bdi_start_writeback_all - kick background writeout against all devices
+ * @nr_pages: write back at least this many pages per device
+ *
+ * Only the devices which actually have dirty inodes are woken up.
+ */
+void bdi_start_writeback_all(long nr_pages)
+{
+	struct backing_dev_info *bdi;
+
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		if (list_empty(&bdi->b_dirty) && list_empty(&bdi->b_io))
+			continue;
+		__bdi_start_writeback(bdi, nr_pages);
+	}
+	up_read(&bdi_list_sem);
+}
+
+/*
+ * dirty_writeback_centisecs has changed: rearm the periodic writeback of
+ * all the flusher threads.
+ */
+void bdi_reset_kupdate(void)
+{
+	struct backing_dev_info *bdi;
+
+	down_read(&bdi_list_sem);
+	list_for_each_entry(bdi, &bdi_list, bdi_list) {
+		bdi->wb_next_kupdate = jiffies + kupdate_interval();
+		if (bdi->wb_task)
+			wake_up_process(bdi->wb_task);
+	}
+	up_read(&bdi_list_sem);
+}
+
+static int __init default_bdi_init(void)
+{
+	return bdi_start_flusher(&default_backing_dev_info, "default");
+}
+core_initcall(default_bdi_init);
@@ -0,0 +1,368 @@
+/*
+ *	linux/mm/compaction.c
+ *
+ * Memory compaction: put together free blocks of high order by moving
+ * pages out of the way, instead of reclaiming memory until the buddy
+ * allocator happens to merge some.
+ *
+ * Two scanners walk a zone towards each other.  The migrate scanner starts
+ * at the bottom and takes movable pages off the LRU, the free scanner
+ * starts at the top and takes free pages out of movable pageblocks.  Pages
+ * found by the first are migrated into pages found by the second, so used
+ * memory gathers at the top of the zone while the bottom drains into
+ * large free blocks.  Compaction ends when the scanners meet, or as soon
+ * as a free block of the order wanted turns up.
+ */
+
+#include <linux/mm.h>
+#include <linux/swap.h>
+#include <linux/mm_inline.h>
+#include <linux/sysctl.h>
+#include <linux/cpuset.h>
+#include <linux/compaction.h>
+#include <linux/pageblock-flags.h>
+
+#include "internal.h"
+
+/* Pages migrated in one go */
+#define COMPACT_CLUSTER_MAX	SWAP_CLUSTER_MAX
+
+/*
+ * One compaction run over one zone.
+ */
+struct compact_control {
+	struct list_head freepages;	/* Pages to migrate to */
+	struct list_head migratepages;	/* Pages being migrated */
+	unsigned long nr_freepages;
+	unsigned long nr_migratepages;
+	unsigned long free_pfn;		/* Pageblock the free scanner is at */
+	unsigned long migrate_pfn;	/* Where the migrate scanner is at */
+	int order;			/* Order wanted, -1 for the whole zone */
+	int migratetype;		/* Migrate type of that allocation */
+	struct zone *zone;
+};
+
+static unsigned long count_list_pages(struct list_head *list)
+{
+	struct list_head *curr;
+	unsigned long count = 0;
+
+	list_for_each(curr, list)
+		count++;
+	return count;
+}
+
+static void release_freepages(struct list_head *freelist)
+{
+	struct page *page, *next;
+
+	list_for_each_entry_safe(page, next, freelist, lru) {
+		list_del(&page->lru);
+		__free_page(page);
+	}
+}
+
+/*
+ * Pages migrate_pages() moved away are referenced by nothing but the
+ * isolation, and still carry the flags they had on the LRU.
+ */
+static unsigned long release_migrated_pages(struct list_head *moved)
+{
+	struct page *page, *next;
+	unsigned long count = 0;
+
+	list_for_each_entry_safe(page, next, moved, lru) {
+		list_del(&page->lru);
+		ClearPageActive(page);
+		put_page(page);
+		count++;
+	}
+	return count;
+}
+
+/*
+ * Free pages are only taken from movable pageblocks: moving movable
+ * pages into any other kind would undo the grouping by mobility.
+ */
+static int suitable_migration_target(struct page *page)
+{
+	return get_pageblock_migratetype(page) == MIGRATE_MOVABLE;
+}
+
+/*
+ * Take the free pages out of pageblocks below cc->free_pfn, one block
+ * at a time, until there are enough to migrate the isolated pages into
+ * or the free scanner meets the migrate scanner.
+ */
+static void isolate_freepages(struct zone *zone, struct compact_control *cc)
+{
+	unsigned long zone_end_pfn = zone->zone_start_pfn + zone->spanned_pages;
+	unsigned long pfn, flags;
+
+	for (pfn = cc->free_pfn;
+	     pfn > cc->migrate_pfn && cc->nr_freepages < cc->nr_migratepages;
+	     pfn -= pageblock_nr_pages) {
+		unsigned long end_pfn, block_pfn;
+		struct page *page;
+
+		if (!pfn_valid(pfn))
+			continue;
+		page = pfn_to_page(pfn);
+		if (page_zone(page) != zone || !suitable_migration_target(page))
+			continue;
+
+		end_pfn = min(pfn + pageblock_nr_pages, zone_end_pfn);
+
+		spin_lock_irqsave(&zone->lock, flags);
+		for (block_pfn = pfn; block_pfn < end_pfn; ) {
+			int isolated;
+
+#ifdef CONFIG_HOLES_IN_ZONE
+			if (!pfn_valid(block_pfn)) {
+				block_pfn++;
+				continue;
+			}
+#endif
+			page = pfn_to_page(block_pfn);
+			isolated = isolate_free_block(zone, page,
+						      &cc->freepages);
+			cc->nr_freepages += isolated;
+			block_pfn += isolated ? isolated : 1;
+		}
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+
+	cc->free_pfn = pfn;
+}
+
+/*
+ * Take the movable pages of the next pageblock above cc->migrate_pfn off
+ * the LRU, stopping early once there are COMPACT_CLUSTER_MAX of them.
+ */
+static void isolate_migratepages(struct zone *zone,
+				 struct compact_control *cc)
+{
+	unsigned long zone_end_pfn = zone->zone_start_pfn + zone->spanned_pages;
+	unsigned long low_pfn = cc->migrate_pfn;
+	unsigned long end_pfn;
+
+	end_pfn = ALIGN(low_pfn + 1, pageblock_nr_pages);
+	if (end_pfn > zone_end_pfn)
+		end_pfn = zone_end_pfn;
+
+	/* The block may start below the zone, but never in a hole */
+	if (!pfn_valid(low_pfn & ~(pageblock_nr_pages - 1))) {
+		cc->migrate_pfn = end_pfn;
+		return;
+	}
+
+	/* Pages still in a pagevec are not on the LRU yet */
+	lru_add_drain();
+
+	spin_lock_irq(&zone->lru_lock);
+	for (; low_pfn < end_pfn; low_pfn++) {
+		struct page *page;
+
+#ifdef CONFIG_HOLES_IN_ZONE
+		if (!pfn_valid(low_pfn))
+			continue;
+#endif
+		page = pfn_to_page(low_pfn);
+		if (!PageLRU(page) || PageUnevictable(page))
+			continue;
+
+		if (__isolate_lru_page(page) != 1)
+			continue;
+		del_page_from_lru_list(zone, page, page_lru(page));
+		list_add(&page->lru, &cc->migratepages);
+		if (++cc->nr_migratepages == COMPACT_CLUSTER_MAX) {
+			low_pfn++;
+			break;
+		}
+	}
+	spin_unlock_irq(&zone->lru_lock);
+
+	cc->migrate_pfn = low_pfn;
+}
+
+static int compact_finished(struct zone *zone, struct compact_control *cc)
+{
+	int order;
+
+	if (cc->free_pfn <= cc->migrate_pfn)
+		return COMPACT_COMPLETE;
+
+	/* Compacting through /proc goes all the way */
+	if (cc->order < 0)
+		return COMPACT_CONTINUE;
+
+	if (!zone_watermark_ok(zone, cc->order, zone->pages_low, 0, 0))
+		return COMPACT_CONTINUE;
+
+	/* Racy, but it only decides whether to stop early */
+	for (order = cc->order; order < MAX_ORDER; order++) {
+		struct free_area *area = &zone->free_area[order];
+
+		if (!list_empty(&area->free_list[cc->migratetype]))
+			return COMPACT_PARTIAL;
+
+		/* A free pageblock goes to whichever type asks for it */
+		if (order >= pageblock_order && area->nr_free)
+			return COMPACT_PARTIAL;
+	}
+
+	return COMPACT_CONTINUE;
+}
+
+static int compact_zone(struct zone *zone, struct compact_control *cc)
+{
+	unsigned long zone_end_pfn = zone->zone_start_pfn + zone->spanned_pages;
+	int ret;
+
+	cc->migrate_pfn = zone->zone_start_pfn;
+	cc->free_pfn = (zone_end_pfn - 1) & ~(pageblock_nr_pages - 1);
+
+	while ((ret = compact_finished(zone, cc)) == COMPACT_CONTINUE) {
+		LIST_HEAD(moved);
+		LIST_HEAD(failed);
+		unsigned long nr_moved, nr_failed;
+
+		isolate_migratepages(zone, cc);
+		if (!cc->nr_migratepages)
+			continue;
+
+		isolate_freepages(zone, cc);
+		migrate_pages(&cc->migratepages, &cc->freepages,
+			      &moved, &failed);
+
+		nr_moved = release_migrated_pages(&moved);
+		nr_failed = putback_lru_pages(&failed);
+		/* Whatever is left over ran out of pages to move to */
+		putback_lru_pages(&cc->migratepages);
+		cc->nr_migratepages = 0;
+		cc->nr_freepages = count_list_pages(&cc->freepages);
+
+		mod_page_state(compact_pages_moved, nr_moved);
+		mod_page_state(compact_pagemigrate_failed, nr_failed);
+
+		cond_resched();
+	}
+
+	release_freepages(&cc->freepages);
+	cc->nr_freepages = 0;
+	return ret;
+}
+
+/*
+ * Is compacting @zone worth a try for an allocation of @order?
+ */
+static int compaction_suitable(struct zone *zone, int order)
+{
+	/*
+	 * Migration needs free pages to move into, and the pages it frees
+	 * come out as a block only once all of them are done.
+	 */
+	if (!zone_watermark_ok(zone, 0, zone->pages_low + (2UL << order),
+			       0, 0))
+		return COMPACT_SKIPPED;
+
+	/* The allocation should succeed as it is */
+	if (zone_watermark_ok(zone, order, zone->pages_low, 0, 0))
+		return COMPACT_PARTIAL;
+
+	return COMPACT_CONTINUE;
+}
+
+static int compact_zone_order(struct zone *zone, int order, gfp_t gfp_mask)
+{
+	struct compact_control cc = {
+		.order = order,
+		.migratetype = allocflags_to_migratetype(gfp_mask),
+		.zone = zone,
+	};
+	int ret;
+
+	ret = compaction_suitable(zone, order);
+	if (ret != COMPACT_CONTINUE)
+		return ret;
+
+	INIT_LIST_HEAD(&cc.freepages);
+	INIT_LIST_HEAD(&cc.migratepages);
+	return compact_zone(zone, &cc);
+}
+
+/**
+ * try_to_compact_pages - direct compaction for a failing allocation
+ * @zonelist: the zonelist of the allocation
+ * @order: its order
+ * @gfp_mask: its gfp mask
+ *
+ * Compacts the zones of @zonelist in turn until one of them has a free
+ * block of @order.  Returns the best result of any zone, COMPACT_SKIPPED
+ * if there was nothing compaction could do.
+ */
+int try_to_compact_pages(struct zonelist *zonelist, int order, gfp_t gfp_mask)
+{
+	struct zone **z;
+	int rc = COMPACT_SKIPPED;
+
+	/*
+	 * Migration may have to release buffers and allocate swap cache,
+	 * so it needs the same freedom as reclaim.
+	 */
+	if (!order || !(gfp_mask & __GFP_FS) || !(gfp_mask & __GFP_IO))
+		return rc;
+
+	inc_page_state(compact_stall);
+
+	for (z = zonelist->zones; *z; z++) {
+		struct zone *zone = *z;
+		int status;
+
+		if (!cpuset_zone_allowed(zone, gfp_mask))
+			continue;
+
+		status = compact_zone_order(zone, order, gfp_mask);
+		rc = max(status, rc);
+
+		if (zone_watermark_ok(zone, order, zone->pages_low, 0, 0))
+			break;
+	}
+
+	return rc;
+}
+
+/* Compact every zone of the system, all the way through */
+static void compact_all_zones(void)
+{
+	struct zone *zone;
+
+	for_each_zone(zone) {
+		struct compact_control cc = {
+			.order = -1,
+			.migratetype = MIGRATE_MOVABLE,
+			.zone = zone,
+		};
+
+		if (!populated_zone(zone))
+			continue;
+
+		INIT_LIST_HEAD(&cc.freepages);
+		INIT_LIST_HEAD(&cc.migratepages);
+		compact_zone(zone, &cc);
+	}
+}
+
+/*
+ * Writing anything to /proc/sys/vm/compact_memory compacts all of memory.
+ */
+int sysctl_compact_memory;
+
+int sysctl_compaction_handler(ctl_table *table, int write,
+	struct file *file, void __user *buffer, size_t *length, loff_t *ppos)
+{
+	proc_dointvec(table, write, file, buffer, length, ppos);
+	if (write)
+		compact_all_zones();
+	return 0;
+}
@@ -0,0 +1,770 @@
+/*
+ *	linux/mm/huge_memory.c
+ *
+ * Transparent huge pages for anonymous memory.
+ *
+ * A private anonymous vma covering a whole PMD-aligned range may have that
+ * range faulted in as one compound page mapped straight from the pmd: the
+ * page walk loses a level and a single TLB entry covers 2MB.  When no
+ * huge page can be allocated the fault falls back to ordinary 4K pages.
+ *
+ * A huge page is only ever mapped by the one pmd which faulted it in, and
+ * is kept off the LRU.  Everything in the VM which only knows about ptes
+ * (fork, mprotect, mremap, get_user_pages, mbind...) splits the pmd into
+ * a page table of 4K pages first, using a page table set aside at fault
+ * time so that splitting never has to allocate.  Under memory pressure a
+ * shrinker splits huge pages so that reclaim can get at their 4K pages.
+ *
+ * khugepaged walks the address spaces in the background, collapsing
+ * ranges of 4K pages back into huge pages as memory allows.  It only
+ * visits the mms which faulted in a huge page enabled area or marked
+ * one with madvise(MADV_HUGEPAGE), see mm/mm_scan.c.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/highmem.h>
+#include <linux/mman.h>
+#include <linux/rmap.h>
+#include <linux/swap.h>
+#include <linux/mm_inline.h>
+#include <linux/kthread.h>
+#include <linux/init.h>
+#include <linux/mm_scan.h>
+
+#include <asm/pgalloc.h>
+#include <asm/tlb.h>
+#include <asm/tlbflush.h>
+
+int sysctl_transparent_hugepage = TRANSPARENT_HUGEPAGE_ALWAYS;
+int khugepaged_pages_to_scan = HPAGE_PMD_NR * 8;
+int khugepaged_scan_sleep_millisecs = 10000;
+
+/*
+ * khugepaged will fill up to this many unpopulated ptes of a range with
+ * zeroes when collapsing it, rather than wait for them all to be touched.
+ */
+#define KHUGEPAGED_MAX_PTES_NONE	(HPAGE_PMD_NR / 8)
+
+/*
+ * Huge pages currently mapped, oldest first, for the shrinker to split.
+ * Linked through the head page's lru, which is free since they never
+ * sit on the LRU.
+ */
+static LIST_HEAD(huge_page_list);
+static DEFINE_SPINLOCK(huge_page_lock);
+static unsigned long nr_huge_pages_mapped;
+
+static void huge_page_list_add(struct page *page)
+{
+	spin_lock(&huge_page_lock);
+	list_add_tail(&page->lru, &huge_page_list);
+	nr_huge_pages_mapped++;
+	spin_unlock(&huge_page_lock);
+}
+
+static void huge_page_list_del(struct page *page)
+{
+	spin_lock(&huge_page_lock);
+	if (!list_empty(&page->lru)) {
+		list_del_init(&page->lru);
+		nr_huge_pages_mapped--;
+	}
+	spin_unlock(&huge_page_lock);
+}
+
+/*
+ * The page table deposited for each huge pmd of an mm, so that splitting
+ * never needs to allocate.  Called with mm->page_table_lock held.
+ */
+static void deposit_pgtable(struct mm_struct *mm, struct page *pgtable)
+{
+	list_add(&pgtable->lru, &mm->pmd_huge_pte);
+}
+
+static struct page *withdraw_pgtable(struct mm_struct *mm)
+{
+	struct page *pgtable;
+
+	BUG_ON(list_empty(&mm->pmd_huge_pte));
+	pgtable = list_entry(mm->pmd_huge_pte.next, struct page, lru);
+	list_del(&pgtable->lru);
+	return pgtable;
+}
+
+static void free_transhuge_page(struct page *page)
+{
+	page[1].mapping = NULL;
+	page->mapping = NULL;
+	set_page_count(page, 1);
+	__free_pages(page, HPAGE_PMD_ORDER);
+}
+
+/*
+ * Don't try too hard: if the memory is too fragmented for a huge page
+ * the caller is quite happy with 4K pages instead.
+ */
+static struct page *alloc_hugepage(void)
+{
+	struct page *page;
+
+	page = alloc_pages(GFP_HIGHUSER_MOVABLE | __GFP_COMP | __GFP_NOWARN |
+			   __GFP_NORETRY, HPAGE_PMD_ORDER);
+	if (page) {
+		page[1].mapping = (void *)free_transhuge_page;
+		INIT_LIST_HEAD(&page->lru);
+	}
+	return page;
+}
+
+static void clear_huge_page(struct page *page, unsigned long haddr)
+{
+	int i;
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		cond_resched();
+		clear_user_highpage(page + i, haddr + i * PAGE_SIZE);
+	}
+}
+
+static pmd_t mk_huge_pmd(struct page *page, struct vm_area_struct *vma)
+{
+	pmd_t entry;
+
+	entry = pmd_mkhuge(pmd_mkdirty(mk_pmd(page, vma->vm_page_prot)));
+	if (vma->vm_flags & VM_WRITE)
+		entry = pmd_mkwrite(entry);
+	return entry;
+}
+
+/*
+ * Map @page, a new huge page, at @pmd.  Called with mm->page_table_lock
+ * held; the huge page counts as HPAGE_PMD_NR pages of rss and mapped.
+ */
+static void set_huge_pmd(struct mm_struct *mm, struct vm_area_struct *vma,
+		unsigned long haddr, pmd_t *pmd, struct page *page,
+		struct page *pgtable)
+{
+	deposit_pgtable(mm, pgtable);
+	page_add_new_anon_rmap(page, vma, haddr);
+	__mod_zone_page_state(page_zone(page), NR_MAPPED, HPAGE_PMD_NR - 1);
+	set_pmd(pmd, mk_huge_pmd(page, vma));
+	huge_page_list_add(page);
+}
+
+/*
+ * Try to back the aligned range around @address with a huge page.
+ * Returns 1 if the fault has been handled, 0 if the caller should fall
+ * back to mapping a 4K page.
+ *
+ * We enter with non-exclusive mmap_sem and return with it still held.
+ */
+int do_huge_pmd_anonymous_page(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address, pmd_t *pmd)
+{
+	unsigned long haddr = address & HPAGE_PMD_MASK;
+	struct page *page, *pgtable;
+
+	if (haddr < vma->vm_start || haddr + HPAGE_PMD_SIZE > vma->vm_end)
+		return 0;
+	if (unlikely(anon_vma_prepare(vma)))
+		return 0;
+
+	/* Should there be no huge page now, khugepaged may find one later */
+	mm_scan_enter(MM_SCAN_HUGEPAGE, mm);
+
+	page = alloc_hugepage();
+	if (!page)
+		return 0;
+	pgtable = pte_alloc_one(mm, haddr);
+	if (!pgtable) {
+		put_page(page);
+		return 0;
+	}
+	pte_lock_init(pgtable);
+	clear_huge_page(page, haddr);
+
+	spin_lock(&mm->page_table_lock);
+	if (unlikely(!pmd_none(*pmd))) {
+		/* Another has populated it: just retry the access */
+		spin_unlock(&mm->page_table_lock);
+		pte_lock_deinit(pgtable);
+		pte_free(pgtable);
+		put_page(page);
+		return 1;
+	}
+	mm->nr_ptes++;
+	inc_zone_page_state(pgtable, NR_PAGETABLE);
+	add_mm_counter(mm, anon_rss, HPAGE_PMD_NR);
+	set_huge_pmd(mm, vma, haddr, pmd, page, pgtable);
+	spin_unlock(&mm->page_table_lock);
+	return 1;
+}
+
+/*
+ * Unmap a whole huge pmd.  Returns 0 if it has been split meanwhile, and
+ * the caller must zap the ptes instead.
+ */
+int zap_huge_pmd(struct mmu_gather *tlb, struct vm_area_struct *vma,
+		pmd_t *pmd)
+{
+	struct mm_struct *mm = tlb->mm;
+	struct page *page, *pgtable;
+
+	spin_lock(&mm->page_table_lock);
+	if (unlikely(!pmd_trans_huge(*pmd))) {
+		spin_unlock(&mm->page_table_lock);
+		return 0;
+	}
+	page = pmd_page(*pmd);
+	pmd_clear(pmd);
+	pgtable = withdraw_pgtable(mm);
+	huge_page_list_del(page);
+	page_remove_rmap(page);
+	__mod_zone_page_state(page_zone(page), NR_MAPPED,
+			      -(HPAGE_PMD_NR - 1));
+	add_mm_counter(mm, anon_rss, -HPAGE_PMD_NR);
+	mm->nr_ptes--;
+	spin_unlock(&mm->page_table_lock);
+
+	pte_lock_deinit(pgtable);
+	pte_free_tlb(tlb, pgtable);
+	dec_zone_page_state(pgtable, NR_PAGETABLE);
+	tlb_remove_page(tlb, page);
+	return 1;
+}
+
+/*
+ * Look up the 4K page at @address within a huge pmd.  A huge page cannot
+ * be pinned without splitting it: callers wanting a reference must ask
+ * for FOLL_SPLIT, and get nothing from here if they use FOLL_GET alone.
+ */
+struct page *follow_trans_huge_pmd(struct vm_area_struct *vma,
+		unsigned long address, pmd_t *pmd, unsigned int flags)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *page = NULL;
+
+	if (flags & FOLL_GET)
+		return NULL;
+
+	spin_lock(&mm->page_table_lock);
+	if (unlikely(!pmd_trans_huge(*pmd) || !pmd_present(*pmd)))
+		goto out;
+	if ((flags & FOLL_WRITE) && !pmd_write(*pmd))
+		goto out;
+	page = pmd_page(*pmd) + ((address & ~HPAGE_PMD_MASK) >> PAGE_SHIFT);
+out:
+	spin_unlock(&mm->page_table_lock);
+	return page;
+}
+
+/*
+ * Turn the huge pmd into a page table mapping the huge page's 4K pages,
+ * and turn the compound page into HPAGE_PMD_NR ordinary anonymous pages
+ * on the LRU: onto the active list unless the split is for reclaim.
+ *
+ * Called with mm->page_table_lock held.  Since the huge page is mapped
+ * by this pmd alone, nobody else can be looking at its struct pages.
+ */
+static void __split_huge_pmd_locked(struct vm_area_struct *vma,
+		unsigned long haddr, pmd_t *pmd, int active)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	struct page *page = pmd_page(*pmd);
+	struct page *pgtable;
+	pmd_t old = *pmd, _pmd;
+	pgprot_t prot = pmd_pgprot(old);
+	pte_t *pte;
+	int i;
+
+	/*
+	 * Keep the pmd huge but non-present while we work, so that a racing
+	 * fault just retries instead of populating it behind our back.
+	 */
+	set_pmd(pmd, pmd_mknotpresent(old));
+	flush_tlb_range(vma, haddr, haddr + HPAGE_PMD_SIZE);
+	huge_page_list_del(page);
+
+	pgtable = withdraw_pgtable(mm);
+	pmd_populate(mm, &_pmd, pgtable);
+	pte = pte_offset_map(&_pmd, haddr);
+	for (i = 0; i < HPAGE_PMD_NR; i++)
+		set_pte_at(mm, haddr + i * PAGE_SIZE, pte + i,
+			   pfn_pte(page_to_pfn(page + i), prot));
+	pte_unmap(pte);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		struct page *p = page + i;
+
+		ClearPageCompound(p);
+		set_page_private(p, 0);
+		if (!i)
+			continue;
+		p->mapping = page->mapping;
+		p->index = page->index + i;
+		set_page_count(p, 1);
+		atomic_set(&p->_mapcount, 0);
+		SetPageSwapBacked(p);
+	}
+
+	smp_wmb();
+	pmd_populate(mm, pmd, pgtable);
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		if (active)
+			lru_cache_add_active_or_unevictable(page + i, vma);
+		else
+			lru_cache_add(page + i);
+	}
+}
+
+void __split_huge_page_pmd(struct vm_area_struct *vma, unsigned long address,
+		pmd_t *pmd)
+{
+	struct mm_struct *mm = vma->vm_mm;
+
+	spin_lock(&mm->page_table_lock);
+	if (likely(pmd_trans_huge(*pmd)))
+		__split_huge_pmd_locked(vma, address & HPAGE_PMD_MASK, pmd, 1);
+	spin_unlock(&mm->page_table_lock);
+}
+
+/*
+ * For walkers which only have the mm at hand; mmap_sem must be held.
+ */
+void __split_huge_page_mm(struct mm_struct *mm, unsigned long address,
+		pmd_t *pmd)
+{
+	struct vm_area_struct *vma = find_vma(mm, address);
+
+	BUG_ON(!vma || vma->vm_start > address);
+	__split_huge_page_pmd(vma, address, pmd);
+}
+
+static pmd_t *mm_find_pmd(struct mm_struct *mm, unsigned long address)
+{
+	pgd_t *pgd;
+	pud_t *pud;
+
+	pgd = pgd_offset(mm, address);
+	if (!pgd_present(*pgd))
+		return NULL;
+	pud = pud_offset(pgd, address);
+	if (!pud_present(*pud))
+		return NULL;
+	return pmd_offset(pud, address);
+}
+
+/*
+ * Split a huge page found on huge_page_list, with no mmap_sem to rely on:
+ * the anon_vma lock keeps its vma and page tables from going away.
+ */
+static void split_huge_page(struct page *page)
+{
+	struct anon_vma *anon_vma;
+	struct vm_area_struct *vma;
+
+	anon_vma = page_lock_anon_vma(page);
+	if (!anon_vma)
+		return;
+	list_for_each_entry(vma, &anon_vma->head, anon_vma_node) {
+		struct mm_struct *mm = vma->vm_mm;
+		unsigned long address;
+		pmd_t *pmd;
+
+		address = page_address_in_vma(page, vma);
+		if (address == -EFAULT)
+			continue;
+		pmd = mm_find_pmd(mm, address);
+		if (!pmd)
+			continue;
+		spin_lock(&mm->page_table_lock);
+		if (pmd_trans_huge(*pmd) && pmd_present(*pmd) &&
+		    pmd_page(*pmd) == page) {
+			if (vma->vm_flags & VM_LOCKED) {
+				/* nothing to reclaim: look again later */
+				huge_page_list_add(page);
+			} else
+				__split_huge_pmd_locked(vma, address, pmd, 0);
+			spin_unlock(&mm->page_table_lock);
+			break;
+		}
+		spin_unlock(&mm->page_table_lock);
+	}
+	spin_unlock(&anon_vma->lock);
+}
+
+/*
+ * Memory pressure: split the oldest huge pages, so that reclaim can get
+ * at their 4K pages.  Counted in base pages, to weigh a huge page the
+ * same as the LRU pages it competes with.
+ */
+static int shrink_huge_pages(int nr_to_scan, gfp_t gfp_mask)
+{
+	while (nr_to_scan > 0) {
+		struct page *page;
+
+		spin_lock(&huge_page_lock);
+		if (list_empty(&huge_page_list)) {
+			spin_unlock(&huge_page_lock);
+			break;
+		}
+		page = list_entry(huge_page_list.next, struct page, lru);
+		list_del_init(&page->lru);
+		nr_huge_pages_mapped--;
+		get_page(page);
+		spin_unlock(&huge_page_lock);
+
+		split_huge_page(page);
+		put_page(page);
+		nr_to_scan -= HPAGE_PMD_NR;
+	}
+	return nr_huge_pages_mapped * HPAGE_PMD_NR;
+}
+
+int hugepage_madvise(struct vm_area_struct *vma, unsigned long *vm_flags,
+		int advice)
+{
+	switch (advice) {
+	case MADV_HUGEPAGE:
+		if (*vm_flags & (VM_SHARED | VM_MAYSHARE | VM_HUGETLB |
+				 VM_IO | VM_PFNMAP | VM_RESERVED))
+			return -EINVAL;
+		*vm_flags &= ~VM_NOHUGEPAGE;
+		*vm_flags |= VM_HUGEPAGE;
+		mm_scan_enter(MM_SCAN_HUGEPAGE, vma->vm_mm);
+		break;
+	case MADV_NOHUGEPAGE:
+		*vm_flags &= ~VM_HUGEPAGE;
+		*vm_flags |= VM_NOHUGEPAGE;
+		break;
+	}
+	return 0;
+}
+
+static pmd_t *khugepaged_pmd(struct mm_struct *mm, unsigned long address)
+{
+	pmd_t *pmd = mm_find_pmd(mm, address);
+
+	if (!pmd || !pmd_present(*pmd) || pmd_trans_huge(*pmd))
+		return NULL;
+	return pmd;
+}
+
+/*
+ * Can this 4K page be replaced by a copy in a huge page?  Only if the one
+ * pte we are looking at is all that refers to it.
+ */
+static int collapse_page_ok(struct page *page, struct vm_area_struct *vma)
+{
+	if (!PageAnon(page) || PageCompound(page) || PageSwapCache(page))
+		return 0;
+	if ((void *)page->mapping - PAGE_MAPPING_ANON != vma->anon_vma)
+		return 0;
+	return PageLRU(page) && page_mapcount(page) == 1 &&
+		page_count(page) == 1;
+}
+
+/*
+ * Is the range at @address populated enough, with collapsible pages, to
+ * be worth collapsing?  Called with mmap_sem held for reading.
+ */
+static int khugepaged_scan_pmd(struct mm_struct *mm,
+		struct vm_area_struct *vma, unsigned long address)
+{
+	pmd_t *pmd;
+	pte_t *pte;
+	spinlock_t *ptl;
+	int i, none = 0;
+	int ret = 0;
+
+	pmd = khugepaged_pmd(mm, address);
+	if (!pmd)
+		return 0;
+	pte = pte_offset_map_lock(mm, pmd, address, &ptl);
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		unsigned long addr = address + i * PAGE_SIZE;
+		pte_t pteval = pte[i];
+		struct page *page;
+
+		if (pte_none(pteval)) {
+			if (++none > KHUGEPAGED_MAX_PTES_NONE)
+				goto out;
+			continue;
+		}
+		if (!pte_present(pteval))
+			goto out;
+		page = vm_normal_page(vma, addr, pteval);
+		if (!page)
+			goto out;
+		if (page == ZERO_PAGE(addr)) {
+			if (++none > KHUGEPAGED_MAX_PTES_NONE)
+				goto out;
+			continue;
+		}
+		if (!collapse_page_ok(page, vma))
+			goto out;
+	}
+	ret = 1;
+out:
+	pte_unmap_unlock(pte, ptl);
+	return ret;
+}
+
+static int isolate_collapse_page(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	int ret;
+
+	spin_lock_irq(&zone->lru_lock);
+	ret = __isolate_lru_page(page);
+	if (ret == 1)
+		del_page_from_lru_list(zone, page, page_lru(page));
+	spin_unlock_irq(&zone->lru_lock);
+	return ret == 1;
+}
+
+static void putback_collapse_page(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	spin_lock_irq(&zone->lru_lock);
+	SetPageLRU(page);
+	add_page_to_lru_list(zone, page, page_lru(page));
+	spin_unlock_irq(&zone->lru_lock);
+	put_page(page);
+}
+
+/*
+ * Take the pages mapped by @pte off the LRU, checking again that they can
+ * be collapsed.  Returns how many were taken, or -1 having put them back.
+ */
+static int isolate_collapse_pages(struct vm_area_struct *vma,
+		unsigned long address, pte_t *pte)
+{
+	int i, none = 0, nr = 0;
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		unsigned long addr = address + i * PAGE_SIZE;
+		struct page *page;
+
+		if (pte_none(pte[i])) {
+			if (++none > KHUGEPAGED_MAX_PTES_NONE)
+				goto fail;
+			continue;
+		}
+		if (!pte_present(pte[i]))
+			goto fail;
+		page = vm_normal_page(vma, addr, pte[i]);
+		if (!page)
+			goto fail;
+		if (page == ZERO_PAGE(addr)) {
+			if (++none > KHUGEPAGED_MAX_PTES_NONE)
+				goto fail;
+			continue;
+		}
+		if (!collapse_page_ok(page, vma) || !isolate_collapse_page(page))
+			goto fail;
+		nr++;
+	}
+	return nr;
+
+fail:
+	while (--i >= 0) {
+		unsigned long addr = address + i * PAGE_SIZE;
+		struct page *page;
+
+		if (!pte_present(pte[i]))
+			continue;
+		page = vm_normal_page(vma, addr, pte[i]);
+		if (page != ZERO_PAGE(addr))
+			putback_collapse_page(page);
+	}
+	return -1;
+}
+
+/*
+ * Copy the isolated pages into @new_page, zero filling the holes, and
+ * free them along with their ptes.
+ */
+static void copy_collapse_pages(struct page *new_page, pte_t *pte,
+		struct vm_area_struct *vma, unsigned long address)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	int i;
+
+	for (i = 0; i < HPAGE_PMD_NR; i++) {
+		unsigned long addr = address + i * PAGE_SIZE;
+		pte_t pteval = pte[i];
+		struct page *page;
+
+		if (pte_none(pteval)) {
+			clear_user_highpage(new_page + i, addr);
+			continue;
+		}
+		page = vm_normal_page(vma, addr, pteval);
+		pte_clear(mm, addr, pte + i);
+		page_remove_rmap(page);
+		if (page == ZERO_PAGE(addr)) {
+			clear_user_highpage(new_page + i, addr);
+			dec_mm_counter(mm, file_rss);
+			put_page(page);
+			continue;
+		}
+		copy_user_highpage(new_page + i, page, addr);
+		ClearPageActive(page);
+		ClearPageUnevictable(page);
+		/* drop the isolation reference and the pte's */
+		put_page(page);
+		put_page(page);
+	}
+}
+
+/*
+ * Replace the 4K pages around @address by a huge page.  Called without
+ * mmap_sem: we need it exclusively, so that no fault, get_user_pages or
+ * munmap can look at the range while it has no pmd, and the anon_vma
+ * lock, so that reclaim's rmap walks cannot either.
+ */
+static void collapse_huge_page(struct mm_struct *mm, unsigned long address)
+{
+	struct vm_area_struct *vma;
+	struct anon_vma *anon_vma;
+	struct page *new_page, *pgtable;
+	pmd_t *pmd, _pmd;
+	pte_t *pte;
+	spinlock_t *ptl;
+	int nr;
+
+	new_page = alloc_hugepage();
+	if (!new_page)
+		return;
+
+	down_write(&mm->mmap_sem);
+	vma = find_vma(mm, address);
+	if (!vma || address < vma->vm_start ||
+	    address + HPAGE_PMD_SIZE > vma->vm_end ||
+	    !transparent_hugepage_enabled(vma) || !vma->anon_vma)
+		goto out;
+	pmd = khugepaged_pmd(mm, address);
+	if (!pmd)
+		goto out;
+
+	anon_vma = vma->anon_vma;
+	spin_lock(&anon_vma->lock);
+	pte = pte_offset_map_lock(mm, pmd, address, &ptl);
+	nr = isolate_collapse_pages(vma, address, pte);
+	pte_unmap_unlock(pte, ptl);
+	if (nr < 0)
+		goto out_unlock;
+
+	/* Take the page table away from the MMU before copying */
+	spin_lock(&mm->page_table_lock);
+	_pmd = *pmd;
+	pmd_clear(pmd);
+	spin_unlock(&mm->page_table_lock);
+	flush_tlb_range(vma, address, address + HPAGE_PMD_SIZE);
+
+	pte = pte_offset_map(&_pmd, address);
+	copy_collapse_pages(new_page, pte, vma, address);
+	pte_unmap(pte);
+
+	/* The emptied page table is the one set aside for splitting */
+	pgtable = pmd_page(_pmd);
+	spin_lock(&mm->page_table_lock);
+	add_mm_counter(mm, anon_rss, HPAGE_PMD_NR - nr);
+	set_huge_pmd(mm, vma, address, pmd, new_page, pgtable);
+	spin_unlock(&mm->page_table_lock);
+	new_page = NULL;
+out_unlock:
+	spin_unlock(&anon_vma->lock);
+out:
+	up_write(&mm->mmap_sem);
+	if (new_page)
+		put_page(new_page);
+}
+
+/*
+ * Scan @mm from the cursor for up to @budget ptes.  Returns how many
+ * were looked at; the cursor moves on to the next mm once the whole
+ * address space has been covered.
+ */
+static int khugepaged_scan_mm(struct mm_struct *mm, int budget)
+{
+	struct mm_scan *scan = &mm_scans[MM_SCAN_HUGEPAGE];
+	struct vm_area_struct *vma;
+	unsigned long addr = scan->address;
+	int progress = 0;
+
+	down_read(&mm->mmap_sem);
+	for (vma = find_vma(mm, addr); vma; vma = vma->vm_next) {
+		unsigned long hstart, hend;
+
+		progress++;
+		if (!transparent_hugepage_enabled(vma))
+			continue;
+		hstart = (vma->vm_start + ~HPAGE_PMD_MASK) & HPAGE_PMD_MASK;
+		hend = vma->vm_end & HPAGE_PMD_MASK;
+		if (addr < hstart)
+			addr = hstart;
+		for (; addr < hend; addr += HPAGE_PMD_SIZE) {
+			if (progress >= budget) {
+				scan->address = addr;
+				up_read(&mm->mmap_sem);
+				return progress;
+			}
+			progress += HPAGE_PMD_NR;
+			if (khugepaged_scan_pmd(mm, vma, addr)) {
+				scan->address = addr + HPAGE_PMD_SIZE;
+				up_read(&mm->mmap_sem);
+				collapse_huge_page(mm, addr);
+				return progress;
+			}
+		}
+	}
+	up_read(&mm->mmap_sem);
+	mm_scan_advance(MM_SCAN_HUGEPAGE);
+	return progress;
+}
+
+static void khugepaged_do_scan(void)
+{
+	int progress = 0;
+
+	lru_add_drain();
+	while (progress < khugepaged_pages_to_scan) {
+		struct mm_struct *mm;
+
+		/* at the end of a pass, start over next time */
+		mm = mm_scan_next(MM_SCAN_HUGEPAGE);
+		if (!mm)
+			break;
+		progress += khugepaged_scan_mm(mm,
+				khugepaged_pages_to_scan - progress);
+		mmput(mm);
+		cond_resched();
+	}
+}
+
+static int khugepaged(void *none)
+{
+	set_user_nice(current, 19);
+	while (!kthread_should_stop()) {
+		if (sysctl_transparent_hugepage != TRANSPARENT_HUGEPAGE_NEVER)
+			khugepaged_do_scan();
+		try_to_freeze();
+		schedule_timeout_interruptible(
+			msecs_to_jiffies(khugepaged_scan_sleep_millisecs));
+	}
+	return 0;
+}
+
+static int __init hugepage_init(void)
+{
+	set_shrinker(DEFAULT_SEEKS, shrink_huge_pages);
+	kthread_run(khugepaged, NULL, "khugepaged");
+	return 0;
+}
+
+module_init(hugepage_init)
@@ -28,3 +28,10 @@ static inline void set_page_refs(struct page *page, int order)
 
 extern void fastcall __init __free_pages_bootmem(struct page *page,
 						unsigned int order);
+
+extern int isolate_free_block(struct zone *zone, struct page *page,
+			      struct list_head *list);
+
+extern void munlock_vma_pages_range(struct vm_area_struct *vma,
+				    unsigned long start, unsigned long end);
+extern void munlock_vma_pages_all(struct vm_area_struct *vma);
@@ -0,0 +1,791 @@
+/*
+ *	linux/mm/ksm.c
+ *
+ * Kernel same-page merging.
+ *
+ * ksmd scans the private anonymous areas which madvise(MADV_MERGEABLE)
+ * has marked, looking for pages with identical contents, and maps each
+ * set of them from a single write-protected KSM page.  A write to one of
+ * them faults, and do_wp_page() hands the writer a copy of its own, as it
+ * does for any page which is not anonymous.
+ *
+ * Identical pages are found through two red-black trees ordered by page
+ * contents.  The stable tree holds the KSM pages, which never change.
+ * The unstable tree holds the pages seen so far in this pass which had
+ * not changed since the last one; since they may still change under it,
+ * it is thrown away at the end of every pass.  A page matching a KSM
+ * page is merged into it, a page matching one in the unstable tree is
+ * merged with that one into a new KSM page.
+ *
+ * Whether a page changed between passes is told by a checksum of its
+ * contents, kept in page_private() of the page: that is unused for an
+ * anonymous page which is not in the swap cache.
+ *
+ * KSM pages are neither anonymous nor page cache, and are kept off the
+ * LRU: like the ZERO_PAGE, they are only reached through the ptes which
+ * map them, so they are not swapped.  The stable tree holds a reference
+ * on each, which is dropped at the end of the first pass to find that
+ * nothing maps the page any more.  Since nothing can reclaim them, ksmd
+ * creates no more than pages_max of them.
+ *
+ * ksmd only visits the mms which marked an area with MADV_MERGEABLE,
+ * resuming each pass where the last one ran out of its budget, see
+ * mm/mm_scan.c.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/highmem.h>
+#include <linux/pagemap.h>
+#include <linux/swap.h>
+#include <linux/mman.h>
+#include <linux/rmap.h>
+#include <linux/rbtree.h>
+#include <linux/jhash.h>
+#include <linux/slab.h>
+#include <linux/kthread.h>
+#include <linux/wait.h>
+#include <linux/mutex.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/ksm.h>
+#include <linux/mm_scan.h>
+
+#include <asm/tlbflush.h>
+
+/* A KSM page, in the stable tree */
+struct stable_node {
+	struct rb_node node;
+	struct page *page;		/* holds a reference */
+};
+
+/* A page seen in this pass, in the unstable tree */
+struct unstable_item {
+	struct rb_node node;
+	struct list_head list;		/* on unstable_list */
+	struct mm_struct *mm;		/* holds an mm_count reference */
+	unsigned long address;
+};
+
+static struct rb_root root_stable_tree = RB_ROOT;
+static struct rb_root root_unstable_tree = RB_ROOT;
+static LIST_HEAD(unstable_list);
+
+static kmem_cache_t *stable_node_cache;
+static kmem_cache_t *unstable_item_cache;
+
+/* Tunables, in /sys/kernel/ksm */
+static unsigned int ksm_run;
+static unsigned int ksm_pages_to_scan = 100;
+static unsigned int ksm_sleep_millisecs = 20;
+static unsigned long ksm_pages_max;	/* KSM pages ksmd may create */
+
+/* Statistics, in /sys/kernel/ksm */
+static unsigned long ksm_pages_shared;	/* KSM pages in use */
+static unsigned long ksm_pages_sharing;	/* ptes mapping them, bar one each */
+static unsigned long ksm_pages_unshared; /* pages in the unstable tree */
+static unsigned long ksm_pages_scanned;
+static unsigned long ksm_full_scans;
+
+static DEFINE_MUTEX(ksm_thread_mutex);
+static DECLARE_WAIT_QUEUE_HEAD(ksm_thread_wait);
+
+/*
+ * Mergeable areas are private and anonymous, so the only pages without
+ * an anon_vma they can map are the ZERO_PAGE, KSM pages and, under a
+ * huge pmd, the parts of a compound page.
+ */
+static inline int page_is_ksm(struct page *page, unsigned long address)
+{
+	return !PageAnon(page) && !PageCompound(page) &&
+		page != ZERO_PAGE(address);
+}
+
+/* Is @page an anonymous page ksmd may merge at all? */
+static inline int page_mergeable(struct page *page)
+{
+	return PageAnon(page) && !PageCompound(page) &&
+		!PageSwapCache(page) && !PageUnevictable(page);
+}
+
+static int memcmp_pages(struct page *page1, struct page *page2)
+{
+	char *addr1, *addr2;
+	int ret;
+
+	addr1 = kmap_atomic(page1, KM_USER0);
+	addr2 = kmap_atomic(page2, KM_USER1);
+	ret = memcmp(addr1, addr2, PAGE_SIZE);
+	kunmap_atomic(addr2, KM_USER1);
+	kunmap_atomic(addr1, KM_USER0);
+	return ret;
+}
+
+static u32 calc_checksum(struct page *page)
+{
+	u32 checksum;
+	void *addr = kmap_atomic(page, KM_USER0);
+
+	checksum = jhash2(addr, PAGE_SIZE / 4, 17);
+	kunmap_atomic(addr, KM_USER0);
+	return checksum;
+}
+
+/*
+ * Make the pte mapping @page at @address read-only, so that its contents
+ * cannot change while it is locked.  Fails if anything but the ptes and
+ * the caller holds a reference, since that might be direct I/O writing
+ * to the page.  The resulting pte is returned in @orig_pte.
+ */
+static int write_protect_page(struct vm_area_struct *vma, struct page *page,
+		unsigned long address, pte_t *orig_pte)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	spinlock_t *ptl;
+	pte_t *ptep, entry;
+	int err = -EFAULT;
+
+	ptep = page_check_address(page, mm, address, &ptl);
+	if (!ptep)
+		return err;
+
+	flush_cache_page(vma, address, page_to_pfn(page));
+	entry = ptep_clear_flush(vma, address, ptep);
+	if (page_mapcount(page) + 1 != page_count(page)) {
+		set_pte_at(mm, address, ptep, entry);
+		goto out_unlock;
+	}
+	entry = pte_wrprotect(entry);
+	set_pte_at(mm, address, ptep, entry);
+	*orig_pte = entry;
+	err = 0;
+
+out_unlock:
+	pte_unmap_unlock(ptep, ptl);
+	return err;
+}
+
+/*
+ * Point the pte which maps @page at @address to @kpage instead, provided
+ * it has not changed since write_protect_page().
+ */
+static int replace_page(struct vm_area_struct *vma, struct page *page,
+		unsigned long address, struct page *kpage, pte_t orig_pte)
+{
+	struct mm_struct *mm = vma->vm_mm;
+	spinlock_t *ptl;
+	pte_t *ptep, entry;
+
+	ptep = page_check_address(page, mm, address, &ptl);
+	if (!ptep)
+		return -EFAULT;
+	if (!pte_same(*ptep, orig_pte)) {
+		pte_unmap_unlock(ptep, ptl);
+		return -EFAULT;
+	}
+
+	get_page(kpage);
+	page_add_file_rmap(kpage);
+
+	flush_cache_page(vma, address, pte_pfn(*ptep));
+	ptep_clear_flush(vma, address, ptep);
+	entry = pte_wrprotect(mk_pte(kpage, vma->vm_page_prot));
+	set_pte_at(mm, address, ptep, entry);
+	update_mmu_cache(vma, address, entry);
+	lazy_mmu_prot_update(entry);
+
+	page_remove_rmap(page);
+	put_page(page);
+	dec_mm_counter(mm, anon_rss);
+	inc_mm_counter(mm, file_rss);
+
+	pte_unmap_unlock(ptep, ptl);
+	return 0;
+}
+
+/*
+ * Map @kpage instead of @page at @address in @mm, if @page is still
+ * mapped there and still has the same contents as @kpage.  The caller
+ * holds a reference on @page, but not mmap_sem.
+ */
+static int try_to_merge_one_page(struct mm_struct *mm, unsigned long address,
+		struct page *page, struct page *kpage)
+{
+	struct vm_area_struct *vma;
+	pte_t orig_pte;
+	int err = -EFAULT;
+
+	if (page == kpage)
+		return 0;
+	if (!atomic_inc_not_zero(&mm->mm_users))
+		return err;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, address);
+	if (!vma || vma->vm_start > address ||
+	    !(vma->vm_flags & VM_MERGEABLE) || (vma->vm_flags & VM_LOCKED))
+		goto out;
+
+	/*
+	 * Holding the page lock keeps do_wp_page() from reusing the page
+	 * once we have write protected it.
+	 */
+	if (TestSetPageLocked(page))
+		goto out;
+	if (page_mergeable(page) &&
+	    !write_protect_page(vma, page, address, &orig_pte) &&
+	    !memcmp_pages(page, kpage))
+		err = replace_page(vma, page, address, kpage, orig_pte);
+	unlock_page(page);
+out:
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+	return err;
+}
+
+/*
+ * Look up the page mapped at @address in @mm, for comparing with another.
+ * Returns it with a reference held, or NULL if it cannot be merged.
+ */
+static struct page *get_mergeable_page(struct mm_struct *mm,
+		unsigned long address)
+{
+	struct vm_area_struct *vma;
+	struct page *page = NULL;
+
+	if (!atomic_inc_not_zero(&mm->mm_users))
+		return NULL;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, address);
+	if (!vma || vma->vm_start > address || !(vma->vm_flags & VM_MERGEABLE))
+		goto out;
+	page = follow_page(vma, address, FOLL_GET);
+	if (page && !page_mergeable(page)) {
+		put_page(page);
+		page = NULL;
+	}
+out:
+	up_read(&mm->mmap_sem);
+	mmput(mm);
+	return page;
+}
+
+static struct stable_node *stable_tree_search(struct page *page)
+{
+	struct rb_node *node = root_stable_tree.rb_node;
+
+	while (node) {
+		struct stable_node *stable;
+		int ret;
+
+		stable = rb_entry(node, struct stable_node, node);
+		ret = memcmp_pages(page, stable->page);
+		if (ret < 0)
+			node = node->rb_left;
+		else if (ret > 0)
+			node = node->rb_right;
+		else
+			return stable;
+	}
+	return NULL;
+}
+
+/*
+ * Add @kpage to the stable tree, which takes a reference on it.  If a KSM
+ * page with the same contents turned up meanwhile, @kpage is left out,
+ * and is freed once it is no longer mapped.
+ */
+static void stable_tree_insert(struct page *kpage)
+{
+	struct rb_node **new = &root_stable_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct stable_node *stable;
+
+	while (*new) {
+		int ret;
+
+		stable = rb_entry(*new, struct stable_node, node);
+		ret = memcmp_pages(kpage, stable->page);
+		parent = *new;
+		if (ret < 0)
+			new = &parent->rb_left;
+		else if (ret > 0)
+			new = &parent->rb_right;
+		else
+			return;
+	}
+
+	stable = kmem_cache_alloc(stable_node_cache, GFP_KERNEL);
+	if (!stable)
+		return;
+	get_page(kpage);
+	stable->page = kpage;
+	rb_link_node(&stable->node, parent, new);
+	rb_insert_color(&stable->node, &root_stable_tree);
+	ksm_pages_shared++;
+}
+
+/*
+ * Look for a page with the same contents as @page in the unstable tree.
+ * If there is one, return its item and the page itself, with a reference
+ * held, in @tree_pagep.  Otherwise add @page to the tree and return NULL.
+ */
+static struct unstable_item *unstable_tree_search_insert(struct mm_struct *mm,
+		unsigned long address, struct page *page,
+		struct page **tree_pagep)
+{
+	struct rb_node **new = &root_unstable_tree.rb_node;
+	struct rb_node *parent = NULL;
+	struct unstable_item *item;
+
+	while (*new) {
+		struct page *tree_page;
+		int ret;
+
+		item = rb_entry(*new, struct unstable_item, node);
+		tree_page = get_mergeable_page(item->mm, item->address);
+		if (!tree_page)
+			return NULL;
+
+		/* An anonymous page shared since fork is seen twice */
+		if (page == tree_page) {
+			put_page(tree_page);
+			return NULL;
+		}
+
+		ret = memcmp_pages(page, tree_page);
+		parent = *new;
+		if (ret < 0) {
+			put_page(tree_page);
+			new = &parent->rb_left;
+		} else if (ret > 0) {
+			put_page(tree_page);
+			new = &parent->rb_right;
+		} else {
+			*tree_pagep = tree_page;
+			return item;
+		}
+	}
+
+	item = kmem_cache_alloc(unstable_item_cache, GFP_KERNEL);
+	if (!item)
+		return NULL;
+	atomic_inc(&mm->mm_count);
+	item->mm = mm;
+	item->address = address;
+	rb_link_node(&item->node, parent, new);
+	rb_insert_color(&item->node, &root_unstable_tree);
+	list_add(&item->list, &unstable_list);
+	ksm_pages_unshared++;
+	return NULL;
+}
+
+static void remove_unstable_item(struct unstable_item *item)
+{
+	rb_erase(&item->node, &root_unstable_tree);
+	list_del(&item->list);
+	mmdrop(item->mm);
+	kmem_cache_free(unstable_item_cache, item);
+	ksm_pages_unshared--;
+}
+
+/*
+ * Merge @page, mapped at @address in @mm, with whatever it is identical
+ * to.  Called with a reference held on @page, without mmap_sem.
+ */
+static void cmp_and_merge_page(struct mm_struct *mm, unsigned long address,
+		struct page *page)
+{
+	struct stable_node *stable;
+	struct unstable_item *item;
+	struct page *tree_page, *kpage;
+	u32 checksum;
+	int changed;
+
+	stable = stable_tree_search(page);
+	if (stable) {
+		if (!try_to_merge_one_page(mm, address, page, stable->page))
+			ksm_pages_sharing++;
+		return;
+	}
+
+	/* Only pages which stayed the same since the last pass go on */
+	checksum = calc_checksum(page);
+	if (TestSetPageLocked(page))
+		return;
+	if (!page_mergeable(page)) {
+		unlock_page(page);
+		return;
+	}
+	changed = page_private(page) != checksum;
+	set_page_private(page, checksum);
+	unlock_page(page);
+	if (changed)
+		return;
+
+	item = unstable_tree_search_insert(mm, address, page, &tree_page);
+	if (!item)
+		return;
+
+	if (ksm_pages_shared >= ksm_pages_max)
+		goto out;
+	kpage = alloc_page(GFP_HIGHUSER);
+	if (!kpage)
+		goto out;
+	copy_user_highpage(kpage, page, address);
+
+	if (!try_to_merge_one_page(mm, address, page, kpage)) {
+		/*
+		 * Even if the other page cannot be merged after all, the
+		 * first one has been, and the KSM page is worth keeping.
+		 */
+		if (!try_to_merge_one_page(item->mm, item->address,
+					   tree_page, kpage))
+			ksm_pages_sharing++;
+		remove_unstable_item(item);
+		stable_tree_insert(kpage);
+	}
+	put_page(kpage);
+out:
+	put_page(tree_page);
+}
+
+/*
+ * A pass is over: forget the unstable tree, and drop the KSM pages which
+ * are no longer mapped from the stable tree.  ksm_pages_sharing does not
+ * notice COW breaks as they happen, so it is recounted here.
+ */
+static void ksm_end_pass(void)
+{
+	struct unstable_item *item, *next;
+	struct rb_node *node;
+	unsigned long shared = 0, sharing = 0;
+
+	list_for_each_entry_safe(item, next, &unstable_list, list) {
+		mmdrop(item->mm);
+		kmem_cache_free(unstable_item_cache, item);
+	}
+	INIT_LIST_HEAD(&unstable_list);
+	root_unstable_tree = RB_ROOT;
+	ksm_pages_unshared = 0;
+
+	node = rb_first(&root_stable_tree);
+	while (node) {
+		struct stable_node *stable;
+		int mapcount;
+
+		stable = rb_entry(node, struct stable_node, node);
+		node = rb_next(node);
+
+		mapcount = page_mapcount(stable->page);
+		if (mapcount) {
+			shared++;
+			sharing += mapcount - 1;
+			continue;
+		}
+		rb_erase(&stable->node, &root_stable_tree);
+		put_page(stable->page);
+		kmem_cache_free(stable_node_cache, stable);
+	}
+	ksm_pages_shared = shared;
+	ksm_pages_sharing = sharing;
+	ksm_full_scans++;
+}
+
+/*
+ * Look at the pages of @mm from the cursor on, up to @budget of them,
+ * and merge the ones which can be.  Returns how many ptes and vmas it
+ * went through; once past the last vma, the cursor moves to the next mm.
+ */
+static int ksm_scan_mm(struct mm_struct *mm, int budget)
+{
+	struct mm_scan *scan = &mm_scans[MM_SCAN_KSM];
+	struct vm_area_struct *vma;
+	int progress = 0;
+
+	down_read(&mm->mmap_sem);
+	vma = find_vma(mm, scan->address);
+	while (vma) {
+		unsigned long address = max(scan->address, vma->vm_start);
+		struct page *page;
+
+		if (!(vma->vm_flags & VM_MERGEABLE) ||
+		    (vma->vm_flags & VM_LOCKED) || address >= vma->vm_end) {
+			progress++;
+			vma = vma->vm_next;
+			continue;
+		}
+		if (progress >= budget) {
+			scan->address = address;
+			up_read(&mm->mmap_sem);
+			return progress;
+		}
+		progress++;
+		scan->address = address + PAGE_SIZE;
+
+		page = follow_page(vma, address, FOLL_GET);
+		if (!page)
+			continue;
+		if (!page_mergeable(page)) {
+			put_page(page);
+			continue;
+		}
+		up_read(&mm->mmap_sem);
+
+		ksm_pages_scanned++;
+		cmp_and_merge_page(mm, address, page);
+		put_page(page);
+		cond_resched();
+
+		down_read(&mm->mmap_sem);
+		vma = find_vma(mm, scan->address);
+	}
+	up_read(&mm->mmap_sem);
+	mm_scan_advance(MM_SCAN_KSM);
+	return progress;
+}
+
+static void ksm_do_scan(void)
+{
+	int progress = 0;
+
+	lru_add_drain();
+	while (progress < ksm_pages_to_scan) {
+		struct mm_struct *mm;
+
+		mm = mm_scan_next(MM_SCAN_KSM);
+		if (!mm) {
+			ksm_end_pass();
+			break;
+		}
+		progress += ksm_scan_mm(mm, ksm_pages_to_scan - progress);
+		mmput(mm);
+	}
+}
+
+static int ksmd(void *none)
+{
+	set_user_nice(current, 5);
+	while (!kthread_should_stop()) {
+		mutex_lock(&ksm_thread_mutex);
+		if (ksm_run)
+			ksm_do_scan();
+		mutex_unlock(&ksm_thread_mutex);
+
+		try_to_freeze();
+		if (ksm_run)
+			schedule_timeout_interruptible(
+				msecs_to_jiffies(ksm_sleep_millisecs));
+		else
+			wait_event_interruptible(ksm_thread_wait,
+					ksm_run || kthread_should_stop());
+	}
+	return 0;
+}
+
+/*
+ * Give every pte of [@start, @end) which maps a KSM page its own copy,
+ * by faulting as if for a write.  Called with mmap_sem held.
+ */
+static int unmerge_ksm_pages(struct vm_area_struct *vma,
+		unsigned long start, unsigned long end)
+{
+	unsigned long address;
+
+	for (address = start; address < end; address += PAGE_SIZE) {
+		struct page *page;
+
+		if (signal_pending(current))
+			return -ERESTARTSYS;
+
+		page = follow_page(vma, address, 0);
+		if (!page || !page_is_ksm(page, address))
+			continue;
+
+		switch (handle_mm_fault(vma->vm_mm, vma, address, 1)) {
+		case VM_FAULT_OOM:
+			return -ENOMEM;
+		case VM_FAULT_SIGBUS:
+			return -EFAULT;
+		}
+		cond_resched();
+	}
+	return 0;
+}
+
+int ksm_madvise(struct vm_area_struct *vma, unsigned long start,
+		unsigned long end, int advice, unsigned long *vm_flags)
+{
+	int err;
+
+	switch (advice) {
+	case MADV_MERGEABLE:
+		if (vma->vm_file || vma->vm_ops)
+			return -EINVAL;
+		if (*vm_flags & (VM_SHARED | VM_MAYSHARE | VM_HUGETLB |
+				 VM_IO | VM_PFNMAP | VM_RESERVED |
+				 VM_INSERTPAGE | VM_NONLINEAR))
+			return -EINVAL;
+		*vm_flags |= VM_MERGEABLE;
+		mm_scan_enter(MM_SCAN_KSM, vma->vm_mm);
+		break;
+	case MADV_UNMERGEABLE:
+		if (!(*vm_flags & VM_MERGEABLE))
+			break;
+		err = unmerge_ksm_pages(vma, start, end);
+		if (err)
+			return err;
+		*vm_flags &= ~VM_MERGEABLE;
+		break;
+	}
+	return 0;
+}
+
+#define KSM_ATTR_RO(_name) \
+static struct subsys_attribute _name##_attr = __ATTR_RO(_name)
+
+#define KSM_ATTR(_name) \
+static struct subsys_attribute _name##_attr = \
+	__ATTR(_name, 0644, _name##_show, _name##_store)
+
+static ssize_t run_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%u\n", ksm_run);
+}
+static ssize_t run_store(struct subsystem *subsys, const char *page,
+		size_t count)
+{
+	char *end;
+	unsigned long val = simple_strtoul(page, &end, 10);
+
+	if (end == page || val > 1)
+		return -EINVAL;
+	ksm_run = val;
+	wake_up_interruptible(&ksm_thread_wait);
+	return count;
+}
+KSM_ATTR(run);
+
+static ssize_t pages_to_scan_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%u\n", ksm_pages_to_scan);
+}
+static ssize_t pages_to_scan_store(struct subsystem *subsys,
+		const char *page, size_t count)
+{
+	char *end;
+	unsigned long val = simple_strtoul(page, &end, 10);
+
+	if (end == page || !val || val > INT_MAX)
+		return -EINVAL;
+	ksm_pages_to_scan = val;
+	return count;
+}
+KSM_ATTR(pages_to_scan);
+
+static ssize_t sleep_millisecs_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%u\n", ksm_sleep_millisecs);
+}
+static ssize_t sleep_millisecs_store(struct subsystem *subsys,
+		const char *page, size_t count)
+{
+	char *end;
+	unsigned long val = simple_strtoul(page, &end, 10);
+
+	if (end == page || val > UINT_MAX)
+		return -EINVAL;
+	ksm_sleep_millisecs = val;
+	return count;
+}
+KSM_ATTR(sleep_millisecs);
+
+static ssize_t pages_max_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_pages_max);
+}
+static ssize_t pages_max_store(struct subsystem *subsys,
+		const char *page, size_t count)
+{
+	char *end;
+	unsigned long val = simple_strtoul(page, &end, 10);
+
+	if (end == page)
+		return -EINVAL;
+	ksm_pages_max = val;
+	return count;
+}
+KSM_ATTR(pages_max);
+
+static ssize_t pages_shared_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_pages_shared);
+}
+KSM_ATTR_RO(pages_shared);
+
+static ssize_t pages_sharing_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_pages_sharing);
+}
+KSM_ATTR_RO(pages_sharing);
+
+static ssize_t pages_unshared_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_pages_unshared);
+}
+KSM_ATTR_RO(pages_unshared);
+
+static ssize_t pages_scanned_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_pages_scanned);
+}
+KSM_ATTR_RO(pages_scanned);
+
+static ssize_t full_scans_show(struct subsystem *subsys, char *page)
+{
+	return sprintf(page, "%lu\n", ksm_full_scans);
+}
+KSM_ATTR_RO(full_scans);
+
+static struct attribute *ksm_attrs[] = {
+	&run_attr.attr,
+	&pages_to_scan_attr.attr,
+	&sleep_millisecs_attr.attr,
+	&pages_max_attr.attr,
+	&pages_shared_attr.attr,
+	&pages_sharing_attr.attr,
+	&pages_unshared_attr.attr,
+	&pages_scanned_attr.attr,
+	&full_scans_attr.attr,
+	NULL,
+};
+
+static struct attribute_group ksm_attr_group = {
+	.name = "ksm",
+	.attrs = ksm_attrs,
+};
+
+static int __init ksm_init(void)
+{
+	int err;
+
+	ksm_pages_max = totalram_pages / 4;
+	stable_node_cache = kmem_cache_create("ksm_stable_node",
+			sizeof(struct stable_node), 0, SLAB_PANIC, NULL, NULL);
+	unstable_item_cache = kmem_cache_create("ksm_unstable_item",
+			sizeof(struct unstable_item), 0, SLAB_PANIC, NULL, NULL);
+
+	err = sysfs_create_group(&kernel_subsys.kset.kobj, &ksm_attr_group);
+	if (err) {
+		printk(KERN_ERR "ksm: cannot register sysfs files\n");
+		return err;
+	}
+
+	kthread_run(ksmd, NULL, "ksmd");
+	return 0;
+}
+
+module_init(ksm_init)
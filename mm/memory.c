@@ -116,7 +116,7 @@ static void free_pte_range(struct mmu_gather *tlb, pmd_t *pmd)
 	pmd_clear(pmd);
 	pte_lock_deinit(page);
 	pte_free_tlb(tlb, page);
-	dec_page_state(nr_page_table_pages);
+	dec_zone_page_state(page, NR_PAGETABLE);
 	tlb->mm->nr_ptes--;
 }
 
@@ -302,7 +302,7 @@ int __pte_alloc(struct mm_struct *mm, pmd_t *pmd, unsigned long address)
 		pte_free(new);
 	} else {
 		mm->nr_ptes++;
-		inc_page_state(nr_page_table_pages);
+		inc_zone_page_state(new, NR_PAGETABLE);
 		pmd_populate(mm, pmd, new);
 	}
 	spin_unlock(&mm->page_table_lock);
@@ -529,6 +529,7 @@ static inline int copy_pmd_range(struct mm_struct *dst_mm, struct mm_struct *src
 	src_pmd = pmd_offset(src_pud, addr);
 	do {
 		next = pmd_addr_end(addr, end);
+		split_huge_page_vma(vma, addr, src_pmd);
 		if (pmd_none_or_clear_bad(src_pmd))
 			continue;
 		if (copy_pte_range(dst_mm, src_mm, dst_pmd, src_pmd,
@@ -688,6 +689,14 @@ static inline unsigned long zap_pmd_range(struct mmu_gather *tlb,
 	pmd = pmd_offset(pud, addr);
 	do {
 		next = pmd_addr_end(addr, end);
+		if (pmd_trans_huge(*pmd)) {
+			if (next - addr != HPAGE_PMD_SIZE)
+				split_huge_page_vma(vma, addr, pmd);
+			else if (zap_huge_pmd(tlb, vma, pmd)) {
+				(*zap_work) -= PAGE_SIZE;
+				continue;
+			}
+		}
 		if (pmd_none_or_clear_bad(pmd)) {
 			(*zap_work)--;
 			continue;
@@ -901,6 +910,13 @@ struct page *follow_page(struct vm_area_struct *vma, unsigned long address,
 		goto no_page_table;
 	
 	pmd = pmd_offset(pud, address);
+	if (pmd_trans_huge(*pmd)) {
+		if (!(flags & FOLL_SPLIT)) {
+			page = follow_trans_huge_pmd(vma, address, pmd, flags);
+			goto out;
+		}
+		split_huge_page_vma(vma, address, pmd);
+	}
 	if (pmd_none(*pmd) || unlikely(pmd_bad(*pmd)))
 		goto no_page_table;
 
@@ -1021,7 +1037,7 @@ int get_user_pages(struct task_struct *tsk, struct mm_struct *mm,
 
 		foll_flags = FOLL_TOUCH;
 		if (pages)
-			foll_flags |= FOLL_GET;
+			foll_flags |= FOLL_GET | FOLL_SPLIT;
 		if (!write && !(vma->vm_flags & VM_LOCKED) &&
 		    (!vma->vm_ops || !vma->vm_ops->nopage))
 			foll_flags |= FOLL_ANON;
@@ -1472,7 +1488,7 @@ gotten:
 		if (!new_page)
 			goto oom;
 	} else {
-		new_page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!new_page)
 			goto oom;
 		cow_user_page(new_page, old_page, address);
@@ -1489,6 +1505,14 @@ gotten:
 				dec_mm_counter(mm, file_rss);
 				inc_mm_counter(mm, anon_rss);
 			}
+			/*
+			 * The old page may have been culled as mlocked by
+			 * this vma, which no longer maps it.
+			 */
+			if (unlikely(vma->vm_flags & VM_LOCKED)) {
+				begin_unevictable_rescue();
+				rescue_unevictable_page(old_page);
+			}
 		} else
 			inc_mm_counter(mm, anon_rss);
 		flush_cache_page(vma, address, pte_pfn(orig_pte));
@@ -1497,8 +1521,8 @@ gotten:
 		ptep_establish(vma, address, page_table, entry);
 		update_mmu_cache(vma, address, entry);
 		lazy_mmu_prot_update(entry);
-		lru_cache_add_active(new_page);
 		page_add_new_anon_rmap(new_page, vma, address);
+		lru_cache_add_active_or_unevictable(new_page, vma);
 
 		/* Free the old page.. */
 		new_page = old_page;
@@ -1976,8 +2000,8 @@ static int do_anonymous_page(struct mm_struct *mm, struct vm_area_struct *vma,
 		if (!pte_none(*page_table))
 			goto release;
 		inc_mm_counter(mm, anon_rss);
-		lru_cache_add_active(page);
 		page_add_new_anon_rmap(page, vma, address);
+		lru_cache_add_active_or_unevictable(page, vma);
 	} else {
 		/* Map the ZERO_PAGE - vm_page_prot is readonly */
 		page = ZERO_PAGE(address);
@@ -2064,7 +2088,7 @@ retry:
 
 		if (unlikely(anon_vma_prepare(vma)))
 			goto oom;
-		page = alloc_page_vma(GFP_HIGHUSER, vma, address);
+		page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, address);
 		if (!page)
 			goto oom;
 		copy_user_highpage(page, new_page, address);
@@ -2107,8 +2131,8 @@ retry:
 		set_pte_at(mm, address, page_table, entry);
 		if (anon) {
 			inc_mm_counter(mm, anon_rss);
-			lru_cache_add_active(new_page);
 			page_add_new_anon_rmap(new_page, vma, address);
+			lru_cache_add_active_or_unevictable(new_page, vma);
 		} else {
 			inc_mm_counter(mm, file_rss);
 			page_add_file_rmap(new_page);
@@ -2260,9 +2284,20 @@ int __handle_mm_fault(struct mm_struct *mm, struct vm_area_struct *vma,
 	pmd = pmd_alloc(mm, pud, address);
 	if (!pmd)
 		return VM_FAULT_OOM;
-	pte = pte_alloc_map(mm, pmd, address);
-	if (!pte)
+	if (pmd_none(*pmd) && transparent_hugepage_enabled(vma)) {
+		if (do_huge_pmd_anonymous_page(mm, vma, address, pmd))
+			return VM_FAULT_MINOR;
+	} else if (pmd_trans_huge(*pmd)) {
+		if (!write_access || pmd_write(*pmd))
+			return VM_FAULT_MINOR;
+		split_huge_page_vma(vma, address, pmd);
+	}
+	if (unlikely(pmd_none(*pmd)) && __pte_alloc(mm, pmd, address))
 		return VM_FAULT_OOM;
+	/* A huge pmd may have been faulted in meanwhile: retry the access */
+	if (unlikely(pmd_trans_huge(*pmd)))
+		return VM_FAULT_MINOR;
+	pte = pte_offset_map(pmd, address);
 
 	return handle_pte_fault(mm, vma, address, pte, pmd, write_access);
 }
@@ -10,7 +10,48 @@
 #include <linux/mm.h>
 #include <linux/mempolicy.h>
 #include <linux/syscalls.h>
+#include <linux/swap.h>
 
+#include "internal.h"
+
+/*
+ * Reclaim culls the pages of an mlocked vma onto the unevictable list when
+ * it comes across them.  Once the vma is no longer locked, walk its range
+ * and hand any such pages back: if another vma still has them locked,
+ * reclaim will just cull them again.
+ *
+ * The caller holds mmap_sem and has already cleared VM_LOCKED.
+ */
+void munlock_vma_pages_range(struct vm_area_struct *vma,
+			     unsigned long start, unsigned long end)
+{
+	unsigned long addr;
+
+	if (vma->vm_flags & (VM_IO | VM_PFNMAP | VM_HUGETLB))
+		return;
+
+	begin_unevictable_rescue();
+	for (addr = start; addr < end; addr += PAGE_SIZE) {
+		struct page *page;
+
+		page = follow_page(vma, addr, FOLL_GET);
+		if (page) {
+			if (PageUnevictable(page))
+				rescue_unevictable_page(page);
+			put_page(page);
+		}
+		cond_resched();
+	}
+}
+
+/*
+ * Unlock a whole vma which is about to be unmapped.
+ */
+void munlock_vma_pages_all(struct vm_area_struct *vma)
+{
+	vma->vm_flags &= ~VM_LOCKED;
+	munlock_vma_pages_range(vma, vma->vm_start, vma->vm_end);
+}
 
 static int mlock_fixup(struct vm_area_struct *vma, struct vm_area_struct **prev,
 	unsigned long start, unsigned long end, unsigned int newflags)
@@ -63,7 +104,8 @@ success:
 		pages = -pages;
 		if (!(newflags & VM_IO))
 			ret = make_pages_present(start, end);
-	}
+	} else
+		munlock_vma_pages_range(vma, start, end);
 
 	vma->vm_mm->locked_vm -= pages;
 out:
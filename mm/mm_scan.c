@@ -0,0 +1,129 @@
+/*
+ *	linux/mm/mm_scan.c
+ *
+ * Lists of the mms which background scanners visit.
+ *
+ * An mm goes on a scanner's list when it first gets an area the scanner
+ * cares about, on a fault or a madvise(), and a child inherits that from
+ * its parent at fork.  It comes off the list again when its last user is
+ * gone.  Each scanner walks its own list, resuming every pass where the
+ * last one ran out of its budget, so the work it does is bounded by the
+ * mms which asked for it rather than by the number of processes.
+ *
+ * The list entries are embedded in the mm_struct, one per scanner, and
+ * the bits in mm->scan_flags tell which of them are in use.
+ */
+
+#include <linux/mm.h>
+#include <linux/sched.h>
+#include <linux/mm_scan.h>
+
+struct mm_scan mm_scans[NR_MM_SCANS];
+
+static inline struct mm_struct *scan_list_mm(struct list_head *entry, int id)
+{
+	return container_of(entry - id, struct mm_struct, scan_list[0]);
+}
+
+void __mm_scan_enter(int id, struct mm_struct *mm)
+{
+	struct mm_scan *scan = &mm_scans[id];
+
+	spin_lock(&scan->lock);
+	if (!test_and_set_bit(id, &mm->scan_flags))
+		list_add_tail(&mm->scan_list[id], &scan->mm_list);
+	spin_unlock(&scan->lock);
+}
+
+/*
+ * A child has the same areas as its parent, so it goes on the lists of
+ * the same scanners.  Called once @mm is fully set up.
+ */
+void mm_scan_fork(struct mm_struct *mm, struct mm_struct *oldmm)
+{
+	int id;
+
+	for (id = 0; id < NR_MM_SCANS; id++)
+		if (test_bit(id, &oldmm->scan_flags))
+			__mm_scan_enter(id, mm);
+}
+
+void __mm_scan_exit(struct mm_struct *mm)
+{
+	int id;
+
+	for (id = 0; id < NR_MM_SCANS; id++) {
+		struct mm_scan *scan = &mm_scans[id];
+
+		if (!test_bit(id, &mm->scan_flags))
+			continue;
+		spin_lock(&scan->lock);
+		if (scan->cursor == &mm->scan_list[id]) {
+			scan->cursor = mm->scan_list[id].next;
+			scan->address = 0;
+		}
+		list_del(&mm->scan_list[id]);
+		clear_bit(id, &mm->scan_flags);
+		spin_unlock(&scan->lock);
+	}
+}
+
+/**
+ * mm_scan_next - get the mm a scanner is to look at next
+ * @id:		the scanner
+ *
+ * Description:
+ *     Returns the mm under the cursor of scanner @id with a reference
+ *     held, starting a new pass if the last one is over.  The scanner
+ *     resumes at mm_scans[@id].address, and calls mm_scan_advance()
+ *     before dropping the reference once it is done with the mm.
+ *     Returns NULL at the end of a pass.
+ **/
+struct mm_struct *mm_scan_next(int id)
+{
+	struct mm_scan *scan = &mm_scans[id];
+	struct mm_struct *mm = NULL;
+
+	spin_lock(&scan->lock);
+	if (!scan->cursor) {
+		scan->cursor = scan->mm_list.next;
+		scan->address = 0;
+	}
+	while (scan->cursor != &scan->mm_list) {
+		mm = scan_list_mm(scan->cursor, id);
+		if (atomic_inc_not_zero(&mm->mm_users))
+			break;
+		/* exiting, mmput() is about to take it off the list */
+		mm = NULL;
+		scan->cursor = scan->cursor->next;
+		scan->address = 0;
+	}
+	if (!mm)
+		scan->cursor = NULL;
+	spin_unlock(&scan->lock);
+	return mm;
+}
+
+/* Move the cursor of scanner @id on to the next mm */
+void mm_scan_advance(int id)
+{
+	struct mm_scan *scan = &mm_scans[id];
+
+	spin_lock(&scan->lock);
+	scan->cursor = scan->cursor->next;
+	scan->address = 0;
+	spin_unlock(&scan->lock);
+}
+
+static int __init mm_scan_init(void)
+{
+	int id;
+
+	for (id = 0; id < NR_MM_SCANS; id++) {
+		spin_lock_init(&mm_scans[id].lock);
+		INIT_LIST_HEAD(&mm_scans[id].mm_list);
+	}
+	return 0;
+}
+
+core_initcall(mm_scan_init);
@@ -38,6 +38,7 @@ static pmd_t *get_old_pmd(struct mm_struct *mm, unsigned long addr)
 		return NULL;
 
 	pmd = pmd_offset(pud, addr);
+	split_huge_page_pmd(mm, addr, pmd);
 	if (pmd_none_or_clear_bad(pmd))
 		return NULL;
 
@@ -59,6 +60,7 @@ static pmd_t *alloc_new_pmd(struct mm_struct *mm, unsigned long addr)
 	if (!pmd)
 		return NULL;
 
+	split_huge_page_pmd(mm, addr, pmd);
 	if (!pmd_present(*pmd) && __pte_alloc(mm, pmd, addr))
 		return NULL;
 
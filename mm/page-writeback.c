@@ -30,6 +30,8 @@
 #include <linux/cpu.h>
 #include <linux/syscalls.h>
 
+#include <asm/div64.h>
+
 /*
  * The maximum number of pages to writeout in a single bdflush/kupdate
  * operation.  We do this so we don't hold I_LOCK against an inode for
@@ -46,7 +48,6 @@
 static long ratelimit_pages = 32;
 
 static long total_pages;	/* The total number of pages in the machine. */
-static int dirty_exceeded;	/* Dirty mem may be over limit */
 
 /*
  * When balance_dirty_pages decides that the caller needs to perform some
@@ -62,7 +63,7 @@ static inline long sync_writeback_pages(void)
 /* The following parameters are exported via /proc/sys/vm */
 
 /*
- * Start background writeback (via pdflush) at this percentage
+ * Start background writeback (via the flusher threads) at this percentage
  */
 int dirty_background_ratio = 10;
 
@@ -97,8 +98,6 @@ EXPORT_SYMBOL(laptop_mode);
 /* End of sysctl-exported parameters */
 
 
-static void background_writeout(unsigned long _min_pages);
-
 struct writeback_state
 {
 	unsigned long nr_dirty;
@@ -109,10 +108,10 @@ struct writeback_state
 
 static void get_writeback_state(struct writeback_state *wbs)
 {
-	wbs->nr_dirty = read_page_state(nr_dirty);
-	wbs->nr_unstable = read_page_state(nr_unstable);
-	wbs->nr_mapped = read_page_state(nr_mapped);
-	wbs->nr_writeback = read_page_state(nr_writeback);
+	wbs->nr_dirty = global_page_state(NR_FILE_DIRTY);
+	wbs->nr_unstable = global_page_state(NR_UNSTABLE_NFS);
+	wbs->nr_mapped = global_page_state(NR_MAPPED);
+	wbs->nr_writeback = global_page_state(NR_WRITEBACK);
 }
 
 /*
@@ -180,19 +179,111 @@ get_dirty_limits(struct writeback_state *wbs, long *pbackground, long *pdirty,
 	*pdirty = dirty;
 }
 
+/*
+ * Per-device dirty limits.
+ *
+ * Each device gets a share of the dirty threshold which is proportional to
+ * the rate at which it has recently been completing writeout.  So a slow
+ * device can only hold on to a small part of the dirty memory, and a fast
+ * device which needs a lot of it gets it.
+ *
+ * The writeout completions of a device are counted in bdi->completions, and
+ * all these counts are halved every writeout period, that is every
+ * 1 << writeout_period_shift completions in the system.  The halving is done
+ * lazily, the next time the count of a device is used, so that we need not
+ * track all the devices.  In the steady state the counts then add up to one
+ * period plus the completions in the current one.
+ */
+static atomic_t writeout_total;
+static int writeout_period_shift = 12;
+static DEFINE_SPINLOCK(writeout_lock);
+
+static void bdi_writeout_age(struct backing_dev_info *bdi, unsigned int total)
+{
+	unsigned int period = total >> writeout_period_shift;
+	unsigned long flags;
+	unsigned int delta;
+
+	if (bdi->completions_period == period)
+		return;
+
+	spin_lock_irqsave(&writeout_lock, flags);
+	delta = period - bdi->completions_period;
+	if (delta) {
+		if (delta < 32)
+			atomic_set(&bdi->completions,
+				   atomic_read(&bdi->completions) >> delta);
+		else
+			atomic_set(&bdi->completions, 0);
+		bdi->completions_period = period;
+	}
+	spin_unlock_irqrestore(&writeout_lock, flags);
+}
+
+/*
+ * Called with interrupts disabled, from the page writeback completion.
+ */
+static inline void bdi_writeout_inc(struct backing_dev_info *bdi)
+{
+	atomic_inc(&writeout_total);
+	bdi_writeout_age(bdi, atomic_read(&writeout_total));
+	atomic_inc(&bdi->completions);
+}
+
+/*
+ * The share of the dirty threshold which `bdi' is entitled to, adjusted
+ * for the dirty memory which the other devices are already holding.
+ */
+static long bdi_dirty_limit(struct backing_dev_info *bdi,
+			    struct writeback_state *wbs, long dirty)
+{
+	unsigned int total = atomic_read(&writeout_total);
+	unsigned long period_len = 1UL << writeout_period_shift;
+	unsigned long denominator;
+	u64 bdi_dirty;
+	long avail_dirty;
+
+	if (!total)
+		return dirty;		/* Nothing measured yet */
+
+	bdi_writeout_age(bdi, total);
+	if (total < period_len)
+		denominator = total;
+	else
+		denominator = period_len + (total & (period_len - 1));
+
+	bdi_dirty = (u64)dirty * atomic_read(&bdi->completions);
+	do_div(bdi_dirty, denominator);
+
+	/*
+	 * Don't let the device have more than what is left of the dirty
+	 * threshold, on top of what it holds already.
+	 */
+	avail_dirty = dirty - (wbs->nr_dirty + wbs->nr_unstable +
+			       wbs->nr_writeback);
+	if (avail_dirty < 0)
+		avail_dirty = 0;
+	avail_dirty += bdi_stat(bdi, BDI_RECLAIMABLE) +
+			bdi_stat(bdi, BDI_WRITEBACK);
+
+	return min((long)bdi_dirty, avail_dirty);
+}
+
 /*
  * balance_dirty_pages() must be called by processes which are generating dirty
- * data.  It looks at the number of dirty pages in the machine and will force
- * the caller to perform writeback if the system is over `vm_dirty_ratio'.
- * If we're over `background_thresh' then pdflush is woken to perform some
- * writeout.
+ * data.  It looks at the number of dirty pages against the device and will
+ * force the caller to perform writeback if the device is over its share of
+ * `vm_dirty_ratio'.  If we're over `background_thresh' then the flusher
+ * thread of the device is woken to perform some writeout.
  */
 static void balance_dirty_pages(struct address_space *mapping)
 {
 	struct writeback_state wbs;
-	long nr_reclaimable;
+	long nr_reclaimable, bdi_nr_reclaimable;
+	long nr_writeback, bdi_nr_writeback;
 	long background_thresh;
 	long dirty_thresh;
+	long bdi_thresh;
 	unsigned long pages_written = 0;
 	unsigned long write_chunk = sync_writeback_pages();
 
@@ -208,37 +299,52 @@ static void balance_dirty_pages(struct address_space *mapping)
 
 		get_dirty_limits(&wbs, &background_thresh,
 					&dirty_thresh, mapping);
-		nr_reclaimable = wbs.nr_dirty + wbs.nr_unstable;
-		if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
-			break;
-
-		dirty_exceeded = 1;
-
 		/* Note: nr_reclaimable denotes nr_dirty + nr_unstable.
 		 * Unstable writes are a feature of certain networked
 		 * filesystems (i.e. NFS) in which data may have been
 		 * written to the server's write cache, but has not yet
 		 * been flushed to permanent storage.
 		 */
-		if (nr_reclaimable) {
+		nr_reclaimable = wbs.nr_dirty + wbs.nr_unstable;
+		nr_writeback = wbs.nr_writeback;
+
+		/*
+		 * Don't throttle while the whole system is well below the
+		 * limit, the per-device limits may still be ramping up.
+		 */
+		if (nr_reclaimable + nr_writeback <=
+				(background_thresh + dirty_thresh) / 2)
+			break;
+
+		bdi_thresh = bdi_dirty_limit(bdi, &wbs, dirty_thresh);
+		bdi_nr_reclaimable = bdi_stat(bdi, BDI_RECLAIMABLE);
+		bdi_nr_writeback = bdi_stat(bdi, BDI_WRITEBACK);
+		if (bdi_nr_reclaimable + bdi_nr_writeback <= bdi_thresh)
+			break;
+
+		if (!bdi->dirty_exceeded)
+			bdi->dirty_exceeded = 1;
+
+		if (bdi_nr_reclaimable) {
 			writeback_inodes(&wbc);
-			get_dirty_limits(&wbs, &background_thresh,
-					&dirty_thresh, mapping);
-			nr_reclaimable = wbs.nr_dirty + wbs.nr_unstable;
-			if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
-				break;
 			pages_written += write_chunk - wbc.nr_to_write;
+			bdi_nr_reclaimable = bdi_stat(bdi, BDI_RECLAIMABLE);
+			bdi_nr_writeback = bdi_stat(bdi, BDI_WRITEBACK);
+			if (bdi_nr_reclaimable + bdi_nr_writeback <= bdi_thresh)
+				break;
 			if (pages_written >= write_chunk)
 				break;		/* We've done our duty */
 		}
 		blk_congestion_wait(WRITE, HZ/10);
 	}
 
-	if (nr_reclaimable + wbs.nr_writeback <= dirty_thresh)
-		dirty_exceeded = 0;
+	if (bdi->dirty_exceeded &&
+	    bdi_stat(bdi, BDI_RECLAIMABLE) + bdi_stat(bdi, BDI_WRITEBACK) <
+			bdi_dirty_limit(bdi, &wbs, dirty_thresh))
+		bdi->dirty_exceeded = 0;
 
 	if (writeback_in_progress(bdi))
-		return;		/* pdflush is already working this queue */
+		return;		/* The flusher is already working this queue */
 
 	/*
 	 * In laptop mode, we wait until hitting the higher threshold before
@@ -250,7 +356,7 @@ static void balance_dirty_pages(struct address_space *mapping)
 	 */
 	if ((laptop_mode && pages_written) ||
 	     (!laptop_mode && (nr_reclaimable > background_thresh)))
-		pdflush_operation(background_writeout, 0);
+		bdi_start_writeback(bdi, 0);
 }
 
 /**
@@ -272,7 +378,7 @@ void balance_dirty_pages_ratelimited(struct address_space *mapping)
 	long ratelimit;
 
 	ratelimit = ratelimit_pages;
-	if (dirty_exceeded)
+	if (mapping->backing_dev_info->dirty_exceeded)
 		ratelimit = 8;
 
 	/*
@@ -312,12 +418,13 @@ void throttle_vm_writeout(void)
 
 
 /*
- * writeback at least _min_pages, and keep writing until the amount of dirty
- * memory is less than the background threshold, or until we're all clean.
+ * writeback at least min_pages against a device, and keep writing until the
+ * amount of dirty memory is less than the background threshold, or until the
+ * device is all clean.  Run by the flusher thread of the device, so waiting
+ * for a congested queue here doesn't hold up writeback to any other device.
  */
-static void background_writeout(unsigned long _min_pages)
+void bdi_writeback_background(struct backing_dev_info *bdi, long min_pages)
 {
-	long min_pages = _min_pages;
 	struct writeback_control wbc = {
 		.bdi		= NULL,
 		.sync_mode	= WB_SYNC_NONE,
@@ -338,7 +445,7 @@ static void background_writeout(unsigned long _min_pages)
 		wbc.encountered_congestion = 0;
 		wbc.nr_to_write = MAX_WRITEBACK_PAGES;
 		wbc.pages_skipped = 0;
-		writeback_inodes(&wbc);
+		writeback_bdi_inodes(bdi, &wbc);
 		min_pages -= MAX_WRITEBACK_PAGES - wbc.nr_to_write;
 		if (wbc.nr_to_write > 0 || wbc.pages_skipped > 0) {
 			/* Wrote less than expected */
@@ -350,11 +457,10 @@ static void background_writeout(unsigned long _min_pages)
 }
 
 /*
- * Start writeback of `nr_pages' pages.  If `nr_pages' is zero, write back
- * the whole world.  Returns 0 if a pdflush thread was dispatched.  Returns
- * -1 if all pdflush threads were busy.
+ * Start writeback of `nr_pages' pages against every device with dirty data.
+ * If `nr_pages' is zero, write back the whole world.
  */
-int wakeup_pdflush(long nr_pages)
+void wakeup_flusher_threads(long nr_pages)
 {
 	if (nr_pages == 0) {
 		struct writeback_state wbs;
@@ -362,22 +468,22 @@ int wakeup_pdflush(long nr_pages)
 		get_writeback_state(&wbs);
 		nr_pages = wbs.nr_dirty + wbs.nr_unstable;
 	}
-	return pdflush_operation(background_writeout, nr_pages);
+	bdi_start_writeback_all(nr_pages);
 }
 
-static void wb_timer_fn(unsigned long unused);
 static void laptop_timer_fn(unsigned long unused);
 
-static DEFINE_TIMER(wb_timer, wb_timer_fn, 0, 0);
 static DEFINE_TIMER(laptop_mode_wb_timer, laptop_timer_fn, 0, 0);
 
 /*
- * Periodic writeback of "old" data.
+ * Periodic writeback of "old" data against a device, run by its flusher
+ * thread.
  *
  * Define "old": the first time one of an inode's pages is dirtied, we mark the
  * dirtying-time in the inode's address_space.  So this periodic writeback code
- * just walks the superblock inode list, writing back any inodes which are
- * older than a specific point in time.
+ * just walks the device's dirty inode list, writing back any inodes which are
+ * older than a specific point in time.  The default device's thread also
+ * writes back the superblocks.
  *
  * Try to run once per dirty_writeback_centisecs.  But if a writeback event
  * takes longer than a dirty_writeback_centisecs interval, then leave a
@@ -386,7 +492,7 @@ static DEFINE_TIMER(laptop_mode_wb_timer, laptop_timer_fn, 0, 0);
  * older_than_this takes precedence over nr_to_write.  So we'll only write back
  * all dirty pages if they are all attached to "old" mappings.
  */
-static void wb_kupdate(unsigned long arg)
+void bdi_writeback_old_data(struct backing_dev_info *bdi)
 {
 	unsigned long oldest_jif;
 	unsigned long start_jif;
@@ -402,7 +508,8 @@ static void wb_kupdate(unsigned long arg)
 		.for_kupdate	= 1,
 	};
 
-	sync_supers();
+	if (bdi == &default_backing_dev_info)
+		sync_supers();
 
 	get_writeback_state(&wbs);
 	oldest_jif = jiffies - (dirty_expire_centisecs * HZ) / 100;
@@ -413,7 +520,7 @@ static void wb_kupdate(unsigned long arg)
 	while (nr_to_write > 0) {
 		wbc.encountered_congestion = 0;
 		wbc.nr_to_write = MAX_WRITEBACK_PAGES;
-		writeback_inodes(&wbc);
+		writeback_bdi_inodes(bdi, &wbc);
 		if (wbc.nr_to_write > 0) {
 			if (wbc.encountered_congestion)
 				blk_congestion_wait(WRITE, HZ/10);
@@ -424,8 +531,7 @@ static void wb_kupdate(unsigned long arg)
 	}
 	if (time_before(next_jif, jiffies + HZ))
 		next_jif = jiffies + HZ;
-	if (dirty_writeback_centisecs)
-		mod_timer(&wb_timer, next_jif);
+	bdi->wb_next_kupdate = next_jif;
 }
 
 /*
@@ -435,21 +541,10 @@ int dirty_writeback_centisecs_handler(ctl_table *table, int write,
 		struct file *file, void __user *buffer, size_t *length, loff_t *ppos)
 {
 	proc_dointvec(table, write, file, buffer, length, ppos);
-	if (dirty_writeback_centisecs) {
-		mod_timer(&wb_timer,
-			jiffies + (dirty_writeback_centisecs * HZ) / 100);
-	} else {
-		del_timer(&wb_timer);
-	}
+	bdi_reset_kupdate();
 	return 0;
 }
 
-static void wb_timer_fn(unsigned long unused)
-{
-	if (pdflush_operation(wb_kupdate, 0) < 0)
-		mod_timer(&wb_timer, jiffies + HZ); /* delay 1 second */
-}
-
 static void laptop_flush(unsigned long unused)
 {
 	sys_sync();
@@ -543,7 +638,15 @@ void __init page_writeback_init(void)
 		if (vm_dirty_ratio <= 0)
 			vm_dirty_ratio = 1;
 	}
-	mod_timer(&wb_timer, jiffies + (dirty_writeback_centisecs * HZ) / 100);
+
+	/*
+	 * Make the writeout period a few times the dirty threshold, so that
+	 * the device shares follow the writeout rates at about the speed at
+	 * which the dirty memory turns over.
+	 */
+	writeout_period_shift = fls((vm_dirty_ratio * total_pages) / 100) + 1;
+	if (writeout_period_shift > 30)
+		writeout_period_shift = 30;
 	set_ratelimit();
 	register_cpu_notifier(&ratelimit_nb);
 }
@@ -631,8 +734,12 @@ int __set_page_dirty_nobuffers(struct page *page)
 			mapping2 = page_mapping(page);
 			if (mapping2) { /* Race with truncate? */
 				BUG_ON(mapping2 != mapping);
-				if (mapping_cap_account_dirty(mapping))
-					inc_page_state(nr_dirty);
+				if (mapping_cap_account_dirty(mapping)) {
+					__inc_zone_page_state(page,
+								NR_FILE_DIRTY);
+					inc_bdi_stat(mapping->backing_dev_info,
+							BDI_RECLAIMABLE);
+				}
 				radix_tree_tag_set(&mapping->page_tree,
 					page_index(page), PAGECACHE_TAG_DIRTY);
 			}
@@ -717,8 +824,11 @@ int test_clear_page_dirty(struct page *page)
 						page_index(page),
 						PAGECACHE_TAG_DIRTY);
 			write_unlock_irqrestore(&mapping->tree_lock, flags);
-			if (mapping_cap_account_dirty(mapping))
-				dec_page_state(nr_dirty);
+			if (mapping_cap_account_dirty(mapping)) {
+				dec_zone_page_state(page, NR_FILE_DIRTY);
+				dec_bdi_stat(mapping->backing_dev_info,
+						BDI_RECLAIMABLE);
+			}
 			return 1;
 		}
 		write_unlock_irqrestore(&mapping->tree_lock, flags);
@@ -748,8 +858,11 @@ int clear_page_dirty_for_io(struct page *page)
 
 	if (mapping) {
 		if (TestClearPageDirty(page)) {
-			if (mapping_cap_account_dirty(mapping))
-				dec_page_state(nr_dirty);
+			if (mapping_cap_account_dirty(mapping)) {
+				dec_zone_page_state(page, NR_FILE_DIRTY);
+				dec_bdi_stat(mapping->backing_dev_info,
+						BDI_RECLAIMABLE);
+			}
 			return 1;
 		}
 		return 0;
@@ -768,10 +881,18 @@ int test_clear_page_writeback(struct page *page)
 
 		write_lock_irqsave(&mapping->tree_lock, flags);
 		ret = TestClearPageWriteback(page);
-		if (ret)
+		if (ret) {
 			radix_tree_tag_clear(&mapping->page_tree,
 						page_index(page),
 						PAGECACHE_TAG_WRITEBACK);
+			if (mapping_cap_account_dirty(mapping)) {
+				struct backing_dev_info *bdi =
+						mapping->backing_dev_info;
+
+				dec_bdi_stat(bdi, BDI_WRITEBACK);
+				bdi_writeout_inc(bdi);
+			}
+		}
 		write_unlock_irqrestore(&mapping->tree_lock, flags);
 	} else {
 		ret = TestClearPageWriteback(page);
@@ -789,10 +910,14 @@ int test_set_page_writeback(struct page *page)
 
 		write_lock_irqsave(&mapping->tree_lock, flags);
 		ret = TestSetPageWriteback(page);
-		if (!ret)
+		if (!ret) {
 			radix_tree_tag_set(&mapping->page_tree,
 						page_index(page),
 						PAGECACHE_TAG_WRITEBACK);
+			if (mapping_cap_account_dirty(mapping))
+				inc_bdi_stat(mapping->backing_dev_info,
+						BDI_WRITEBACK);
+		}
 		if (!PageDirty(page))
 			radix_tree_tag_clear(&mapping->page_tree,
 						page_index(page),
@@ -37,6 +37,8 @@
 #include <linux/nodemask.h>
 #include <linux/vmalloc.h>
 #include <linux/mempolicy.h>
+#include <linux/pageblock-flags.h>
+#include <linux/compaction.h>
 
 #include <asm/tlbflush.h>
 #include "internal.h"
@@ -148,6 +150,7 @@ static void bad_page(struct page *page)
 			1 << PG_private |
 			1 << PG_locked	|
 			1 << PG_active	|
+			1 << PG_unevictable |
 			1 << PG_dirty	|
 			1 << PG_reclaim |
 			1 << PG_slab    |
@@ -313,6 +316,7 @@ static inline void __free_one_page(struct page *page,
 {
 	unsigned long page_idx;
 	int order_size = 1 << order;
+	int migratetype = get_pageblock_migratetype(page);
 
 	if (unlikely(PageCompound(page)))
 		destroy_compound_page(page, order);
@@ -342,7 +346,7 @@ static inline void __free_one_page(struct page *page,
 		order++;
 	}
 	set_page_order(page, order);
-	list_add(&page->lru, &zone->free_area[order].free_list);
+	list_add(&page->lru, &zone->free_area[order].free_list[migratetype]);
 	zone->free_area[order].nr_free++;
 }
 
@@ -356,6 +360,7 @@ static inline int free_pages_check(struct page *page)
 			1 << PG_private |
 			1 << PG_locked	|
 			1 << PG_active	|
+			1 << PG_unevictable |
 			1 << PG_reclaim	|
 			1 << PG_slab	|
 			1 << PG_swapcache |
@@ -485,7 +490,7 @@ void fastcall __init __free_pages_bootmem(struct page *page, unsigned int order)
  * -- wli
  */
 static inline void expand(struct zone *zone, struct page *page,
- 	int low, int high, struct free_area *area)
+ 	int low, int high, struct free_area *area, int migratetype)
 {
 	unsigned long size = 1 << high;
 
@@ -494,7 +499,7 @@ static inline void expand(struct zone *zone, struct page *page,
 		high--;
 		size >>= 1;
 		BUG_ON(bad_range(zone, &page[size]));
-		list_add(&page[size].lru, &area->free_list);
+		list_add(&page[size].lru, &area->free_list[migratetype]);
 		area->nr_free++;
 		set_page_order(&page[size], high);
 	}
@@ -513,6 +518,7 @@ static int prep_new_page(struct page *page, int order)
 			1 << PG_private	|
 			1 << PG_locked	|
 			1 << PG_active	|
+			1 << PG_unevictable |
 			1 << PG_dirty	|
 			1 << PG_reclaim	|
 			1 << PG_slab    |
@@ -530,18 +536,73 @@ static int prep_new_page(struct page *page, int order)
 
 	page->flags &= ~(1 << PG_uptodate | 1 << PG_error |
 			1 << PG_referenced | 1 << PG_arch_1 |
-			1 << PG_checked | 1 << PG_mappedtodisk);
+			1 << PG_checked | 1 << PG_mappedtodisk |
+			1 << PG_readahead | 1 << PG_swapbacked);
 	set_page_private(page, 0);
 	set_page_refs(page, order);
 	kernel_map_pages(page, 1 << order, 1);
 	return 0;
 }
 
-/* 
- * Do the hard work of removing an element from the buddy allocator.
+/*
+ * Pageblock flags.  A zone's bitmap covers its span at boot, rounded out
+ * to whole pageblocks; anything outside it (memory hot-added beyond the
+ * original span) is not tracked and counts as movable.
+ */
+static inline int pageblock_bitidx(struct zone *zone, struct page *page,
+				   unsigned long *bitidx)
+{
+	unsigned long pfn = page_to_pfn(page);
+	unsigned long block;
+
+	if (unlikely(pfn < zone->pageblock_start_pfn))
+		return 0;
+	block = (pfn - zone->pageblock_start_pfn) >> pageblock_order;
+	if (unlikely(block >= zone->nr_pageblocks))
+		return 0;
+	*bitidx = block * NR_PAGEBLOCK_BITS;
+	return 1;
+}
+
+int get_pageblock_migratetype(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long bitidx;
+	int migratetype = 0;
+	int i;
+
+	if (!pageblock_bitidx(zone, page, &bitidx))
+		return MIGRATE_MOVABLE;
+
+	for (i = 0; i < PB_migrate_bits; i++)
+		if (test_bit(bitidx + i, zone->pageblock_flags))
+			migratetype |= 1 << i;
+	return migratetype;
+}
+
+void set_pageblock_migratetype(struct page *page, int migratetype)
+{
+	struct zone *zone = page_zone(page);
+	unsigned long bitidx;
+	int i;
+
+	if (!pageblock_bitidx(zone, page, &bitidx))
+		return;
+
+	for (i = 0; i < PB_migrate_bits; i++) {
+		if (migratetype & (1 << i))
+			set_bit(bitidx + i, zone->pageblock_flags);
+		else
+			clear_bit(bitidx + i, zone->pageblock_flags);
+	}
+}
+
+/*
+ * Take the smallest free block of the wanted migrate type that fits.
  * Call me with the zone->lock already held.
  */
-static struct page *__rmqueue(struct zone *zone, unsigned int order)
+static struct page *__rmqueue_smallest(struct zone *zone, unsigned int order,
+						int migratetype)
 {
 	struct free_area * area;
 	unsigned int current_order;
@@ -549,36 +610,209 @@ static struct page *__rmqueue(struct zone *zone, unsigned int order)
 
 	for (current_order = order; current_order < MAX_ORDER; ++current_order) {
 		area = zone->free_area + current_order;
-		if (list_empty(&area->free_list))
+		if (list_empty(&area->free_list[migratetype]))
 			continue;
 
-		page = list_entry(area->free_list.next, struct page, lru);
+		page = list_entry(area->free_list[migratetype].next,
+							struct page, lru);
 		list_del(&page->lru);
 		rmv_page_order(page);
 		area->nr_free--;
 		zone->free_pages -= 1UL << order;
-		expand(zone, page, order, current_order, area);
+		expand(zone, page, order, current_order, area, migratetype);
 		return page;
 	}
 
 	return NULL;
 }
 
+/*
+ * The migrate types to borrow from, in order, when a type has run out.
+ * Movable allocations try reclaimable blocks before unmovable ones, as
+ * those at least have a chance of being emptied again.
+ */
+static int fallbacks[MIGRATE_TYPES][MIGRATE_TYPES - 1] = {
+	[MIGRATE_UNMOVABLE]   = { MIGRATE_RECLAIMABLE, MIGRATE_MOVABLE },
+	[MIGRATE_RECLAIMABLE] = { MIGRATE_UNMOVABLE,   MIGRATE_MOVABLE },
+	[MIGRATE_MOVABLE]     = { MIGRATE_RECLAIMABLE, MIGRATE_UNMOVABLE },
+};
+
+/*
+ * Move the free pages of the pageblock holding @page onto the free lists
+ * of @migratetype.  Blocks straddling a zone boundary are left alone.
+ * Returns the number of pages moved.  Call with zone->lock held.
+ */
+static int move_freepages_block(struct zone *zone, struct page *page,
+				int migratetype)
+{
+	unsigned long start_pfn, end_pfn;
+	struct page *end_page;
+	int pages_moved = 0;
+
+	start_pfn = page_to_pfn(page) & ~(pageblock_nr_pages - 1);
+	end_pfn = start_pfn + pageblock_nr_pages;
+	if (start_pfn < zone->zone_start_pfn ||
+	    end_pfn > zone->zone_start_pfn + zone->spanned_pages)
+		return 0;
+
+	page -= page_to_pfn(page) - start_pfn;
+	end_page = page + pageblock_nr_pages;
+	while (page < end_page) {
+		unsigned long order;
+
+#ifdef CONFIG_HOLES_IN_ZONE
+		if (!pfn_valid(page_to_pfn(page))) {
+			page++;
+			continue;
+		}
+#endif
+		/* Only the head of a free buddy block has PG_private set */
+		if (!PagePrivate(page) || page_count(page)) {
+			page++;
+			continue;
+		}
+
+		order = page_order(page);
+		list_move(&page->lru,
+			  &zone->free_area[order].free_list[migratetype]);
+		page += 1 << order;
+		pages_moved += 1 << order;
+	}
+
+	return pages_moved;
+}
+
+/*
+ * Nothing of the wanted migrate type is free: take the largest block
+ * another type has to spare, so that whatever gets borrowed is borrowed
+ * in as few pageblocks as possible.  A large enough block takes its whole
+ * pageblock along, and further allocations of this type are satisfied
+ * from there instead of from yet another block.
+ */
+static struct page *__rmqueue_fallback(struct zone *zone, unsigned int order,
+						int start_migratetype)
+{
+	struct free_area * area;
+	int current_order;
+	struct page *page;
+	int migratetype, i;
+
+	for (current_order = MAX_ORDER - 1; current_order >= (int)order;
+							--current_order) {
+		area = zone->free_area + current_order;
+		for (i = 0; i < MIGRATE_TYPES - 1; i++) {
+			migratetype = fallbacks[start_migratetype][i];
+			if (list_empty(&area->free_list[migratetype]))
+				continue;
+
+			page = list_entry(area->free_list[migratetype].next,
+							struct page, lru);
+
+			/*
+			 * Reclaimable allocations always claim the block:
+			 * they are frequent and small, and the whole point is
+			 * to keep them from seeding every block in the zone.
+			 */
+			if (current_order >= pageblock_order / 2 ||
+			    start_migratetype == MIGRATE_RECLAIMABLE) {
+				int pages;
+
+				pages = move_freepages_block(zone, page,
+							start_migratetype);
+				if (pages >= (1 << (pageblock_order - 1)))
+					set_pageblock_migratetype(page,
+							start_migratetype);
+				migratetype = start_migratetype;
+			}
+
+			list_del(&page->lru);
+			rmv_page_order(page);
+			area->nr_free--;
+			zone->free_pages -= 1UL << order;
+
+			/* A block of pageblocks changes hands outright */
+			if (current_order >= pageblock_order) {
+				int nr = 1 << (current_order - pageblock_order);
+
+				while (nr--)
+					set_pageblock_migratetype(page +
+						nr * pageblock_nr_pages,
+						start_migratetype);
+			}
+
+			expand(zone, page, order, current_order, area,
+							migratetype);
+			return page;
+		}
+	}
+
+	return NULL;
+}
+
+#ifdef CONFIG_COMPACTION
+/*
+ * If @page heads a free block, take the block out of the buddy allocator
+ * and put its pages on @list as separately allocated order-0 pages, for
+ * compaction to migrate into.  Returns the number of pages isolated.
+ * Call with zone->lock held.
+ */
+int isolate_free_block(struct zone *zone, struct page *page,
+		       struct list_head *list)
+{
+	unsigned int order;
+	int i;
+
+	if (!PagePrivate(page) || page_count(page))
+		return 0;
+
+	order = page_order(page);
+	list_del(&page->lru);
+	rmv_page_order(page);
+	zone->free_area[order].nr_free--;
+	zone->free_pages -= 1UL << order;
+
+	for (i = 0; i < (1 << order); i++)
+		if (!prep_new_page(page + i, 0))
+			list_add_tail(&page[i].lru, list);
+
+	return 1 << order;
+}
+#endif
+
+/* 
+ * Do the hard work of removing an element from the buddy allocator.
+ * Call me with the zone->lock already held.
+ */
+static struct page *__rmqueue(struct zone *zone, unsigned int order,
+						int migratetype)
+{
+	struct page *page;
+
+	page = __rmqueue_smallest(zone, order, migratetype);
+	if (unlikely(!page))
+		page = __rmqueue_fallback(zone, order, migratetype);
+
+	return page;
+}
+
 /* 
  * Obtain a specified number of elements from the buddy allocator, all under
  * a single hold of the lock, for efficiency.  Add them to the supplied list.
- * Returns the number of new pages which were placed at *list.
+ * Returns the number of new pages which were placed at *list.  They are
+ * tagged with @migratetype in page_private, for the per-cpu lists to find.
  */
 static int rmqueue_bulk(struct zone *zone, unsigned int order, 
-			unsigned long count, struct list_head *list)
+			unsigned long count, struct list_head *list,
+			int migratetype)
 {
 	int i;
 	
 	spin_lock(&zone->lock);
 	for (i = 0; i < count; ++i) {
-		struct page *page = __rmqueue(zone, order);
+		struct page *page = __rmqueue(zone, order, migratetype);
 		if (unlikely(page == NULL))
 			break;
+		set_page_private(page, migratetype);
 		list_add_tail(&page->lru, list);
 	}
 	spin_unlock(&zone->lock);
@@ -643,7 +877,7 @@ static void __drain_pages(unsigned int cpu)
 void mark_free_pages(struct zone *zone)
 {
 	unsigned long zone_pfn, flags;
-	int order;
+	int order, t;
 	struct list_head *curr;
 
 	if (!zone->spanned_pages)
@@ -653,14 +887,15 @@ void mark_free_pages(struct zone *zone)
 	for (zone_pfn = 0; zone_pfn < zone->spanned_pages; ++zone_pfn)
 		ClearPageNosaveFree(pfn_to_page(zone_pfn + zone->zone_start_pfn));
 
-	for (order = MAX_ORDER - 1; order >= 0; --order)
-		list_for_each(curr, &zone->free_area[order].free_list) {
+	for_each_migratetype_order(order, t) {
+		list_for_each(curr, &zone->free_area[order].free_list[t]) {
 			unsigned long start_pfn, i;
 
 			start_pfn = page_to_pfn(list_entry(curr, struct page, lru));
 
 			for (i=0; i < (1<<order); i++)
 				SetPageNosaveFree(pfn_to_page(start_pfn+i));
+		}
 	}
 	spin_unlock_irqrestore(&zone->lock, flags);
 }
@@ -720,6 +955,7 @@ static void fastcall free_hot_cold_page(struct page *page, int cold)
 	pcp = &zone_pcp(zone, get_cpu())->pcp[cold];
 	local_irq_save(flags);
 	__inc_page_state(pgfree);
+	set_page_private(page, get_pageblock_migratetype(page));
 	list_add(&page->lru, &pcp->list);
 	pcp->count++;
 	if (pcp->count >= pcp->high) {
@@ -760,6 +996,7 @@ static struct page *buffered_rmqueue(struct zonelist *zonelist,
 	unsigned long flags;
 	struct page *page;
 	int cold = !!(gfp_flags & __GFP_COLD);
+	int migratetype = allocflags_to_migratetype(gfp_flags);
 	int cpu;
 
 again:
@@ -769,18 +1006,28 @@ again:
 
 		pcp = &zone_pcp(zone, cpu)->pcp[cold];
 		local_irq_save(flags);
-		if (!pcp->count) {
-			pcp->count += rmqueue_bulk(zone, 0,
-						pcp->batch, &pcp->list);
-			if (unlikely(!pcp->count))
+		/* The per-cpu list mixes migrate types: find ours */
+		list_for_each_entry(page, &pcp->list, lru)
+			if (page_private(page) == migratetype)
+				break;
+
+		if (&page->lru == &pcp->list) {
+			LIST_HEAD(list);
+			int count;
+
+			count = rmqueue_bulk(zone, 0, pcp->batch, &list,
+							migratetype);
+			if (unlikely(!count))
 				goto failed;
+			pcp->count += count;
+			list_splice(&list, &pcp->list);
+			page = list_entry(pcp->list.next, struct page, lru);
 		}
-		page = list_entry(pcp->list.next, struct page, lru);
 		list_del(&page->lru);
 		pcp->count--;
 	} else {
 		spin_lock_irqsave(&zone->lock, flags);
-		page = __rmqueue(zone, order);
+		page = __rmqueue(zone, order, migratetype);
 		spin_unlock(&zone->lock);
 		if (!page)
 			goto failed;
@@ -976,6 +1223,30 @@ nofail_alloc:
 	if (!wait)
 		goto nopage;
 
+	/*
+	 * A high order allocation may only be failing because free memory
+	 * is fragmented: try moving pages out of the way before throwing
+	 * any of them out.
+	 */
+	if (order) {
+		int compact_result;
+
+		p->flags |= PF_MEMALLOC;
+		compact_result = try_to_compact_pages(zonelist, order, gfp_mask);
+		p->flags &= ~PF_MEMALLOC;
+
+		if (compact_result != COMPACT_SKIPPED) {
+			page = get_page_from_freelist(gfp_mask, order,
+						zonelist, alloc_flags);
+			if (page) {
+				inc_page_state(compact_success);
+				goto got_pg;
+			}
+			inc_page_state(compact_fail);
+			cond_resched();
+		}
+	}
+
 rebalance:
 	cond_resched();
 
@@ -1231,28 +1502,6 @@ static void __get_page_state(struct page_state *ret, int nr, cpumask_t *cpumask)
 	}
 }
 
-void get_page_state_node(struct page_state *ret, int node)
-{
-	int nr;
-	cpumask_t mask = node_to_cpumask(node);
-
-	nr = offsetof(struct page_state, GET_PAGE_STATE_LAST);
-	nr /= sizeof(unsigned long);
-
-	__get_page_state(ret, nr+1, &mask);
-}
-
-void get_page_state(struct page_state *ret)
-{
-	int nr;
-	cpumask_t mask = CPU_MASK_ALL;
-
-	nr = offsetof(struct page_state, GET_PAGE_STATE_LAST);
-	nr /= sizeof(unsigned long);
-
-	__get_page_state(ret, nr + 1, &mask);
-}
-
 void get_full_page_state(struct page_state *ret)
 {
 	cpumask_t mask = CPU_MASK_ALL;
@@ -1260,20 +1509,6 @@ void get_full_page_state(struct page_state *ret)
 	__get_page_state(ret, sizeof(*ret) / sizeof(unsigned long), &mask);
 }
 
-unsigned long read_page_state_offset(unsigned long offset)
-{
-	unsigned long ret = 0;
-	int cpu;
-
-	for_each_online_cpu(cpu) {
-		unsigned long in;
-
-		in = (unsigned long)&per_cpu(page_states, cpu) + offset;
-		ret += *((unsigned long *)in);
-	}
-	return ret;
-}
-
 void __mod_page_state_offset(unsigned long offset, unsigned long delta)
 {
 	void *ptr;
@@ -1305,8 +1540,10 @@ void __get_zone_counts(unsigned long *active, unsigned long *inactive,
 	*inactive = 0;
 	*free = 0;
 	for (i = 0; i < MAX_NR_ZONES; i++) {
-		*active += zones[i].nr_active;
-		*inactive += zones[i].nr_inactive;
+		*active += zones[i].lru[LRU_ACTIVE_ANON].nr_pages +
+			   zones[i].lru[LRU_ACTIVE_FILE].nr_pages;
+		*inactive += zones[i].lru[LRU_INACTIVE_ANON].nr_pages +
+			     zones[i].lru[LRU_INACTIVE_FILE].nr_pages;
 		*free += zones[i].free_pages;
 	}
 }
@@ -1368,7 +1605,6 @@ void si_meminfo_node(struct sysinfo *val, int nid)
  */
 void show_free_areas(void)
 {
-	struct page_state ps;
 	int cpu, temperature;
 	unsigned long active;
 	unsigned long inactive;
@@ -1400,7 +1636,6 @@ void show_free_areas(void)
 		}
 	}
 
-	get_page_state(&ps);
 	get_zone_counts(&active, &inactive, &free);
 
 	printk("Free pages: %11ukB (%ukB HighMem)\n",
@@ -1411,13 +1646,13 @@ void show_free_areas(void)
 		"unstable:%lu free:%u slab:%lu mapped:%lu pagetables:%lu\n",
 		active,
 		inactive,
-		ps.nr_dirty,
-		ps.nr_writeback,
-		ps.nr_unstable,
+		global_page_state(NR_FILE_DIRTY),
+		global_page_state(NR_WRITEBACK),
+		global_page_state(NR_UNSTABLE_NFS),
 		nr_free_pages(),
-		ps.nr_slab,
-		ps.nr_mapped,
-		ps.nr_page_table_pages);
+		global_page_state(NR_SLAB),
+		global_page_state(NR_MAPPED),
+		global_page_state(NR_PAGETABLE));
 
 	for_each_zone(zone) {
 		int i;
@@ -1428,8 +1663,11 @@ void show_free_areas(void)
 			" min:%lukB"
 			" low:%lukB"
 			" high:%lukB"
-			" active:%lukB"
-			" inactive:%lukB"
+			" active_anon:%lukB"
+			" inactive_anon:%lukB"
+			" active_file:%lukB"
+			" inactive_file:%lukB"
+			" unevictable:%lukB"
 			" present:%lukB"
 			" pages_scanned:%lu"
 			" all_unreclaimable? %s"
@@ -1439,8 +1677,11 @@ void show_free_areas(void)
 			K(zone->pages_min),
 			K(zone->pages_low),
 			K(zone->pages_high),
-			K(zone->nr_active),
-			K(zone->nr_inactive),
+			K(zone->lru[LRU_ACTIVE_ANON].nr_pages),
+			K(zone->lru[LRU_INACTIVE_ANON].nr_pages),
+			K(zone->lru[LRU_ACTIVE_FILE].nr_pages),
+			K(zone->lru[LRU_INACTIVE_FILE].nr_pages),
+			K(zone->lru[LRU_UNEVICTABLE].nr_pages),
 			K(zone->present_pages),
 			zone->pages_scanned,
 			(zone->all_unreclaimable ? "yes" : "no")
@@ -1751,6 +1992,13 @@ void __devinit memmap_init_zone(unsigned long size, int nid, unsigned long zone,
 		reset_page_mapcount(page);
 		SetPageReserved(page);
 		INIT_LIST_HEAD(&page->lru);
+		/*
+		 * Everything starts out movable: bootmem hands all of memory
+		 * to the buddy allocator at once, and kernel allocations
+		 * claim blocks for themselves as they need them.
+		 */
+		if (pfn == start_pfn || !(pfn & (pageblock_nr_pages - 1)))
+			set_pageblock_migratetype(page, MIGRATE_MOVABLE);
 #ifdef WANT_PAGE_VIRTUAL
 		/* The shift won't overflow because ZONE_NORMAL is below 4G. */
 		if (!is_highmem_idx(zone))
@@ -1762,9 +2010,9 @@ void __devinit memmap_init_zone(unsigned long size, int nid, unsigned long zone,
 void zone_init_free_lists(struct pglist_data *pgdat, struct zone *zone,
 				unsigned long size)
 {
-	int order;
-	for (order = 0; order < MAX_ORDER ; order++) {
-		INIT_LIST_HEAD(&zone->free_area[order].free_list);
+	int order, t;
+	for_each_migratetype_order(order, t) {
+		INIT_LIST_HEAD(&zone->free_area[order].free_list[t]);
 		zone->free_area[order].nr_free = 0;
 	}
 }
@@ -1915,6 +2163,9 @@ static inline void free_zone_pagesets(int cpu)
 {
 	struct zone *zone;
 
+	/* The cpu is gone, hand what it counted to the zones */
+	refresh_cpu_vm_stats(cpu);
+
 	for_each_zone(zone) {
 		struct per_cpu_pageset *pset = zone_pcp(zone, cpu);
 
@@ -2017,6 +2268,25 @@ static __devinit void init_currently_empty_zone(struct zone *zone,
 	zone_init_free_lists(pgdat, zone, zone->spanned_pages);
 }
 
+/*
+ * Allocate the zone's pageblock bitmap, covering its span rounded out to
+ * whole pageblocks.  bootmem memory comes zeroed, i.e. MIGRATE_UNMOVABLE,
+ * until memmap_init_zone() marks the blocks.
+ */
+static void __init setup_pageblock_flags(struct pglist_data *pgdat,
+		struct zone *zone, unsigned long zone_start_pfn,
+		unsigned long size)
+{
+	unsigned long start = zone_start_pfn & ~(pageblock_nr_pages - 1);
+	unsigned long end = ALIGN(zone_start_pfn + size, pageblock_nr_pages);
+
+	zone->pageblock_start_pfn = start;
+	zone->nr_pageblocks = (end - start) >> pageblock_order;
+	zone->pageblock_flags = alloc_bootmem_node(pgdat,
+			BITS_TO_LONGS(zone->nr_pageblocks * NR_PAGEBLOCK_BITS) *
+			sizeof(unsigned long));
+}
+
 /*
  * Set up the zone data structures:
  *   - mark all pages reserved
@@ -2038,6 +2308,7 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 	for (j = 0; j < MAX_NR_ZONES; j++) {
 		struct zone *zone = pgdat->node_zones + j;
 		unsigned long size, realsize;
+		enum lru_list l;
 
 		realsize = size = zones_size[j];
 		if (zholes_size)
@@ -2059,17 +2330,22 @@ static void __init free_area_init_core(struct pglist_data *pgdat,
 		zone->temp_priority = zone->prev_priority = DEF_PRIORITY;
 
 		zone_pcp_init(zone);
-		INIT_LIST_HEAD(&zone->active_list);
-		INIT_LIST_HEAD(&zone->inactive_list);
-		zone->nr_scan_active = 0;
-		zone->nr_scan_inactive = 0;
-		zone->nr_active = 0;
-		zone->nr_inactive = 0;
+		for_each_lru(l) {
+			INIT_LIST_HEAD(&zone->lru[l].list);
+			zone->lru[l].nr_pages = 0;
+			zone->lru[l].nr_scan = 0;
+		}
+		zone->recent_rotated[0] = 0;
+		zone->recent_rotated[1] = 0;
+		zone->recent_scanned[0] = 0;
+		zone->recent_scanned[1] = 0;
+		zone->inactive_ratio = 1;
 		atomic_set(&zone->reclaim_in_progress, 0);
 		if (!size)
 			continue;
 
 		zonetable_add(zone, nid, j, zone_start_pfn, size);
+		setup_pageblock_flags(pgdat, zone, zone_start_pfn, size);
 		init_currently_empty_zone(zone, zone_start_pfn, size);
 		zone_start_pfn += size;
 	}
@@ -2188,6 +2464,161 @@ struct seq_operations fragmentation_op = {
 	.show	= frag_show,
 };
 
+static char * const migratetype_names[MIGRATE_TYPES] = {
+	"Unmovable",
+	"Reclaimable",
+	"Movable",
+};
+
+/*
+ * Like buddyinfo, but split by migrate type, followed by how many
+ * pageblocks each type owns.
+ */
+static int pagetypeinfo_show(struct seq_file *m, void *arg)
+{
+	pg_data_t *pgdat = (pg_data_t *)arg;
+	struct zone *zone;
+	struct zone *node_zones = pgdat->node_zones;
+	unsigned long flags;
+	int order, mtype;
+
+	/* Print the header once, before the first node */
+	if (pgdat == pgdat_list) {
+		seq_printf(m, "Page block order: %d\n", pageblock_order);
+		seq_printf(m, "Pages per block:  %lu\n\n", pageblock_nr_pages);
+		seq_printf(m, "%-43s ", "Free pages count per migrate type at order");
+		for (order = 0; order < MAX_ORDER; ++order)
+			seq_printf(m, "%6d ", order);
+		seq_putc(m, '\n');
+	}
+
+	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		if (!populated_zone(zone))
+			continue;
+
+		spin_lock_irqsave(&zone->lock, flags);
+		for (mtype = 0; mtype < MIGRATE_TYPES; mtype++) {
+			seq_printf(m, "Node %4d, zone %8s, type %12s ",
+				pgdat->node_id, zone->name,
+				migratetype_names[mtype]);
+			for (order = 0; order < MAX_ORDER; ++order) {
+				unsigned long freecount = 0;
+				struct list_head *curr;
+
+				list_for_each(curr,
+				    &zone->free_area[order].free_list[mtype])
+					freecount++;
+				seq_printf(m, "%6lu ", freecount);
+			}
+			seq_putc(m, '\n');
+		}
+		spin_unlock_irqrestore(&zone->lock, flags);
+	}
+
+	seq_printf(m, "\n%-23s", "Number of blocks type ");
+	for (mtype = 0; mtype < MIGRATE_TYPES; mtype++)
+		seq_printf(m, "%12s ", migratetype_names[mtype]);
+	seq_putc(m, '\n');
+
+	for (zone = node_zones; zone - node_zones < MAX_NR_ZONES; ++zone) {
+		unsigned long count[MIGRATE_TYPES] = { 0, };
+		unsigned long pfn, end_pfn;
+
+		if (!populated_zone(zone))
+			continue;
+
+		end_pfn = zone->zone_start_pfn + zone->spanned_pages;
+		for (pfn = zone->zone_start_pfn; pfn < end_pfn;
+		     pfn = (pfn | (pageblock_nr_pages - 1)) + 1) {
+			struct page *page;
+
+			if (!pfn_valid(pfn))
+				continue;
+			page = pfn_to_page(pfn);
+			if (page_zone(page) != zone)
+				continue;
+			count[get_pageblock_migratetype(page)]++;
+		}
+
+		seq_printf(m, "Node %d, zone %8s ", pgdat->node_id, zone->name);
+		for (mtype = 0; mtype < MIGRATE_TYPES; mtype++)
+			seq_printf(m, "%12lu ", count[mtype]);
+		seq_putc(m, '\n');
+	}
+	return 0;
+}
+
+struct seq_operations pagetypeinfo_op = {
+	.start	= frag_start,
+	.next	= frag_next,
+	.stop	= frag_stop,
+	.show	= pagetypeinfo_show,
+};
+
+static char *vmstat_text[] = {
+	/* Zoned VM counters, in the order of enum zone_stat_item */
+	"nr_dirty",
+	"nr_writeback",
+	"nr_unstable",
+	"nr_page_table_pages",
+	"nr_mapped",
+	"nr_slab",
+	"nr_bounce",
+
+	/* Event counters, in the order of struct page_state */
+	"pgpgin",
+	"pgpgout",
+	"pswpin",
+	"pswpout",
+
+	"pgalloc_high",
+	"pgalloc_normal",
+	"pgalloc_dma32",
+	"pgalloc_dma",
+
+	"pgfree",
+	"pgactivate",
+	"pgdeactivate",
+
+	"pgfault",
+	"pgmajfault",
+
+	"pgrefill_high",
+	"pgrefill_normal",
+	"pgrefill_dma32",
+	"pgrefill_dma",
+
+	"pgsteal_high",
+	"pgsteal_normal",
+	"pgsteal_dma32",
+	"pgsteal_dma",
+
+	"pgscan_kswapd_high",
+	"pgscan_kswapd_normal",
+	"pgscan_kswapd_dma32",
+	"pgscan_kswapd_dma",
+
+	"pgscan_direct_high",
+	"pgscan_direct_normal",
+	"pgscan_direct_dma32",
+	"pgscan_direct_dma",
+
+	"pginodesteal",
+	"slabs_scanned",
+	"kswapd_steal",
+	"kswapd_inodesteal",
+	"pageoutrun",
+	"allocstall",
+
+	"pgrotated",
+
+	"compact_pages_moved",
+	"compact_pagemigrate_failed",
+	"compact_stall",
+	"compact_fail",
+	"compact_success",
+};
+
 /*
  * Output information about zones in @pgdat.
  */
@@ -2211,21 +2642,35 @@ static int zoneinfo_show(struct seq_file *m, void *arg)
 			   "\n        min      %lu"
 			   "\n        low      %lu"
 			   "\n        high     %lu"
-			   "\n        active   %lu"
-			   "\n        inactive %lu"
-			   "\n        scanned  %lu (a: %lu i: %lu)"
+			   "\n        active_anon   %lu"
+			   "\n        inactive_anon %lu"
+			   "\n        active_file   %lu"
+			   "\n        inactive_file %lu"
+			   "\n        unevictable   %lu"
+			   "\n        scanned  %lu (aa: %lu ia: %lu af: %lu if: %lu)"
 			   "\n        spanned  %lu"
 			   "\n        present  %lu",
 			   zone->free_pages,
 			   zone->pages_min,
 			   zone->pages_low,
 			   zone->pages_high,
-			   zone->nr_active,
-			   zone->nr_inactive,
+			   zone->lru[LRU_ACTIVE_ANON].nr_pages,
+			   zone->lru[LRU_INACTIVE_ANON].nr_pages,
+			   zone->lru[LRU_ACTIVE_FILE].nr_pages,
+			   zone->lru[LRU_INACTIVE_FILE].nr_pages,
+			   zone->lru[LRU_UNEVICTABLE].nr_pages,
 			   zone->pages_scanned,
-			   zone->nr_scan_active, zone->nr_scan_inactive,
+			   zone->lru[LRU_ACTIVE_ANON].nr_scan,
+			   zone->lru[LRU_INACTIVE_ANON].nr_scan,
+			   zone->lru[LRU_ACTIVE_FILE].nr_scan,
+			   zone->lru[LRU_INACTIVE_FILE].nr_scan,
 			   zone->spanned_pages,
 			   zone->present_pages);
+
+		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+			seq_printf(m, "\n    %-19s %lu", vmstat_text[i],
+				   zone_page_state(zone, i));
+
 		seq_printf(m,
 			   "\n        protection: (%lu",
 			   zone->lowmem_reserve[0]);
@@ -2270,6 +2715,10 @@ static int zoneinfo_show(struct seq_file *m, void *arg)
 				   pageset->interleave_hit,
 				   pageset->local_node,
 				   pageset->other_node);
+#endif
+#ifdef CONFIG_SMP
+			seq_printf(m, "\n  vm stats threshold: %d",
+				   pageset->stat_threshold);
 #endif
 		}
 		seq_printf(m,
@@ -2295,77 +2744,27 @@ struct seq_operations zoneinfo_op = {
 	.show	= zoneinfo_show,
 };
 
-static char *vmstat_text[] = {
-	"nr_dirty",
-	"nr_writeback",
-	"nr_unstable",
-	"nr_page_table_pages",
-	"nr_mapped",
-	"nr_slab",
-
-	"pgpgin",
-	"pgpgout",
-	"pswpin",
-	"pswpout",
-
-	"pgalloc_high",
-	"pgalloc_normal",
-	"pgalloc_dma32",
-	"pgalloc_dma",
-
-	"pgfree",
-	"pgactivate",
-	"pgdeactivate",
-
-	"pgfault",
-	"pgmajfault",
-
-	"pgrefill_high",
-	"pgrefill_normal",
-	"pgrefill_dma32",
-	"pgrefill_dma",
-
-	"pgsteal_high",
-	"pgsteal_normal",
-	"pgsteal_dma32",
-	"pgsteal_dma",
-
-	"pgscan_kswapd_high",
-	"pgscan_kswapd_normal",
-	"pgscan_kswapd_dma32",
-	"pgscan_kswapd_dma",
-
-	"pgscan_direct_high",
-	"pgscan_direct_normal",
-	"pgscan_direct_dma32",
-	"pgscan_direct_dma",
-
-	"pginodesteal",
-	"slabs_scanned",
-	"kswapd_steal",
-	"kswapd_inodesteal",
-	"pageoutrun",
-	"allocstall",
-
-	"pgrotated",
-	"nr_bounce",
-};
-
 static void *vmstat_start(struct seq_file *m, loff_t *pos)
 {
+	unsigned long *v;
 	struct page_state *ps;
+	int i;
 
 	if (*pos >= ARRAY_SIZE(vmstat_text))
 		return NULL;
 
-	ps = kmalloc(sizeof(*ps), GFP_KERNEL);
-	m->private = ps;
-	if (!ps)
+	v = kmalloc(NR_VM_ZONE_STAT_ITEMS * sizeof(unsigned long)
+			+ sizeof(*ps), GFP_KERNEL);
+	m->private = v;
+	if (!v)
 		return ERR_PTR(-ENOMEM);
+	for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+		v[i] = global_page_state(i);
+	ps = (struct page_state *)(v + NR_VM_ZONE_STAT_ITEMS);
 	get_full_page_state(ps);
 	ps->pgpgin /= 2;		/* sectors -> kbytes */
 	ps->pgpgout /= 2;
-	return (unsigned long *)ps + *pos;
+	return v + *pos;
 }
 
 static void *vmstat_next(struct seq_file *m, void *arg, loff_t *pos)
@@ -2417,6 +2816,7 @@ static int page_alloc_cpu_notify(struct notifier_block *self,
 		*count = 0;
 		local_irq_disable();
 		__drain_pages(cpu);
+		refresh_cpu_vm_stats(cpu);
 
 		/* Add dead cpu's page_states to our own. */
 		dest = (unsigned long *)&__get_cpu_var(page_states);
@@ -2526,6 +2926,37 @@ void setup_per_zone_pages_min(void)
 	}
 }
 
+/*
+ * The inactive anon list should be small enough that the VM never has to
+ * do too much work deactivating pages, but large enough that each of them
+ * has a chance to be referenced again before it is swapped out.  So the
+ * ratio of active to inactive anon pages grows with the square root of
+ * the zone size:
+ *
+ *    zone    ratio    inactive anon
+ *  ---------------------------------
+ *    1GB       3         250MB
+ *   10GB      10         0.9GB
+ *  100GB      31           3GB
+ *    1TB     101          10GB
+ */
+static void setup_per_zone_inactive_ratio(void)
+{
+	struct zone *zone;
+
+	for_each_zone(zone) {
+		unsigned int gb, ratio;
+
+		/* Zone size in gigabytes */
+		gb = zone->present_pages >> (30 - PAGE_SHIFT);
+		ratio = int_sqrt(10 * gb);
+		if (!ratio)
+			ratio = 1;
+
+		zone->inactive_ratio = ratio;
+	}
+}
+
 /*
  * Initialise min_free_kbytes.
  *
@@ -2563,6 +2994,7 @@ static int __init init_per_zone_pages_min(void)
 		min_free_kbytes = 65536;
 	setup_per_zone_pages_min();
 	setup_per_zone_lowmem_reserve();
+	setup_per_zone_inactive_ratio();
 	return 0;
 }
 module_init(init_per_zone_pages_min)
@@ -15,19 +15,6 @@
 #include <linux/backing-dev.h>
 #include <linux/pagevec.h>
 
-void default_unplug_io_fn(struct backing_dev_info *bdi, struct page *page)
-{
-}
-EXPORT_SYMBOL(default_unplug_io_fn);
-
-struct backing_dev_info default_backing_dev_info = {
-	.ra_pages	= (VM_MAX_READAHEAD * 1024) / PAGE_CACHE_SIZE,
-	.state		= 0,
-	.capabilities	= BDI_CAP_MAP_COPY,
-	.unplug_io_fn	= default_unplug_io_fn,
-};
-EXPORT_SYMBOL_GPL(default_backing_dev_info);
-
 /*
  * Initialise a struct file's readahead state.  Assumes that the caller has
  * memset *ra to zero.
@@ -36,30 +23,7 @@ void
 file_ra_state_init(struct file_ra_state *ra, struct address_space *mapping)
 {
 	ra->ra_pages = mapping->backing_dev_info->ra_pages;
-	ra->prev_page = -1;
-}
-
-/*
- * Return max readahead size for this inode in number-of-pages.
- */
-static inline unsigned long get_max_readahead(struct file_ra_state *ra)
-{
-	return ra->ra_pages;
-}
-
-static inline unsigned long get_min_readahead(struct file_ra_state *ra)
-{
-	return (VM_MIN_READAHEAD * 1024) / PAGE_CACHE_SIZE;
-}
-
-static inline void ra_off(struct file_ra_state *ra)
-{
-	ra->start = 0;
-	ra->flags = 0;
-	ra->size = 0;
-	ra->ahead_start = 0;
-	ra->ahead_size = 0;
-	return;
+	ra->prev_index = -1;
 }
 
 /*
@@ -78,29 +42,24 @@ static unsigned long get_init_ra_size(unsigned long size, unsigned long max)
 		newsize = max / 4;
 	else
 		newsize = max;
-	return newsize;
+	return min(newsize, max);
 }
 
 /*
- * Set the new window size, this is called only when I/O is to be submitted,
- * not for each call to readahead.  If a cache miss occured, reduce next I/O
- * size, else increase depending on how close to max we are.
+ * Get the previous window size, ramp it up, and
+ * return it as the new window size.
  */
-static inline unsigned long get_next_ra_size(struct file_ra_state *ra)
+static unsigned long get_next_ra_size(struct file_ra_state *ra,
+				      unsigned long max)
 {
-	unsigned long max = get_max_readahead(ra);
-	unsigned long min = get_min_readahead(ra);
 	unsigned long cur = ra->size;
 	unsigned long newsize;
 
-	if (ra->flags & RA_FLAG_MISS) {
-		ra->flags &= ~RA_FLAG_MISS;
-		newsize = max((cur - 2), min);
-	} else if (cur < max / 16) {
+	if (cur < max / 16)
 		newsize = 4 * cur;
-	} else {
+	else
 		newsize = 2 * cur;
-	}
+
 	return min(newsize, max);
 }
 
@@ -194,70 +153,65 @@ out:
  *
  * start:	Page index at which we started the readahead
  * size:	Number of pages in that read
- *              Together, these form the "current window".
- *              Together, start and size represent the `readahead window'.
- * prev_page:   The page which the readahead algorithm most-recently inspected.
- *              It is mainly used to detect sequential file reading.
- *              If page_cache_readahead sees that it is again being called for
- *              a page which it just looked at, it can return immediately without
- *              making any state changes.
- * ahead_start,
- * ahead_size:  Together, these form the "ahead window".
+ * async_size:	Number of pages at the end of the window which, when the
+ *		reader reaches the first of them, trigger the next readahead.
+ *		That page carries PG_readahead.
+ * prev_index:	The page which the reader most-recently read.  It is used
+ *		to detect sequential, backward and strided reads.
  * ra_pages:	The externally controlled max readahead for this fd.
  *
- * When readahead is in the off state (size == 0), readahead is disabled.
- * In this state, prev_page is used to detect the resumption of sequential I/O.
- *
- * The readahead code manages two windows - the "current" and the "ahead"
- * windows.  The intent is that while the application is walking the pages
- * in the current window, I/O is underway on the ahead window.  When the
- * current window is fully traversed, it is replaced by the ahead window
- * and the ahead window is invalidated.  When this copying happens, the
- * new current window's pages are probably still locked.  So
- * we submit a new batch of I/O immediately, creating a new ahead window.
- *
- * So:
+ *   |<----------------- size ------------------>|
+ *   |                   |<----- async_size ---->|
+ *   ^start              ^page marked with PG_readahead
  *
- *   ----|----------------|----------------|-----
- *       ^start           ^start+size
- *                        ^ahead_start     ^ahead_start+ahead_size
+ * Readahead is done on demand, from two places:
  *
- *         ^ When this page is read, we submit I/O for the
- *           ahead window.
+ * - page_cache_sync_readahead() when the page the reader wants is not in
+ *   the page cache.  The read has to wait for the io anyway, so the
+ *   window is submitted along with the page.
  *
- * A `readahead hit' occurs when a read request is made against a page which is
- * the next sequential page. Ahead window calculations are done only when it
- * is time to submit a new IO.  The code ramps up the size agressively at first,
- * but slow down as it approaches max_readhead.
+ * - page_cache_async_readahead() when the reader hits a PG_readahead page.
+ *   The pages up to the end of the window are hopefully in flight or
+ *   cached already, so the next window is submitted while the reader
+ *   works through them, unless the device is already read-congested.
  *
- * Any seek/ramdom IO will result in readahead being turned off.  It will resume
- * at the first sequential access.
+ * The state in file_ra_state only describes one stream.  When several
+ * streams share a struct file (many nfsd threads serving one file,
+ * several threads of one process), or when a stream is perturbed by a
+ * few out of order reads, the state no longer matches the reader.  So
+ * instead of trusting it, ondemand_readahead() falls back to looking at
+ * the page cache, which holds the traces every stream leaves behind:
  *
- * There is a special-case: if the first page which the application tries to
- * read happens to be the first page of the file, it is assumed that a linear
- * read is about to happen and the window is immediately set to the initial size
- * based on I/O request size and the max_readahead.
+ * - a reader hitting a PG_readahead page that does not match the state is
+ *   at the marker of some other stream's window, and the number of cached
+ *   pages ahead of it tells how large that window was;
+ * - a reader missing a page that has cached pages right before it is
+ *   continuing a sequential stream, and the number of those pages tells
+ *   how far along the stream is;
+ * - a reader missing a page right below its previous read walks the file
+ *   backwards;
+ * - a reader whose last two records are cached with a fixed gap between
+ *   them reads with a stride.
  *
- * This function is to be called for every read request, rather than when
- * it is time to perform readahead.  It is called only once for the entire I/O
- * regardless of size unless readahead is unable to start enough I/O to satisfy
- * the request (I/O request > max_readahead).
+ * Anything else is a random read and only reads what was asked for,
+ * leaving the readahead state alone.
  */
 
 /*
- * do_page_cache_readahead actually reads a chunk of disk.  It allocates all
- * the pages first, then submits them all for I/O. This avoids the very bad
- * behaviour which would occur if page allocations are causing VM writeback.
- * We really don't want to intermingle reads and writes like that.
+ * __do_page_cache_readahead() actually reads a chunk of disk.  It allocates
+ * all the pages first, then submits them all for I/O. This avoids the very
+ * bad behaviour which would occur if page allocations are causing VM
+ * writeback.  We really don't want to intermingle reads and writes like that.
  *
- * Returns the number of pages requested, or the maximum amount of I/O allowed.
+ * The page @lookahead_size pages before the end of the chunk is marked with
+ * PG_readahead, so that the reader comes back for more before it runs out.
  *
- * do_page_cache_readahead() returns -1 if it encountered request queue
- * congestion.
+ * Returns the number of pages requested, or the maximum amount of I/O allowed.
  */
 static int
 __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read)
+			pgoff_t offset, unsigned long nr_to_read,
+			unsigned long lookahead_size)
 {
 	struct inode *inode = mapping->host;
 	struct page *page;
@@ -278,7 +232,7 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	read_lock_irq(&mapping->tree_lock);
 	for (page_idx = 0; page_idx < nr_to_read; page_idx++) {
 		pgoff_t page_offset = offset + page_idx;
-		
+
 		if (page_offset > end_index)
 			break;
 
@@ -293,6 +247,8 @@ __do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 			break;
 		page->index = page_offset;
 		list_add(&page->lru, &page_pool);
+		if (page_idx == nr_to_read - lookahead_size)
+			SetPageReadahead(page);
 		ret++;
 	}
 	read_unlock_irq(&mapping->tree_lock);
@@ -329,7 +285,7 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 		if (this_chunk > nr_to_read)
 			this_chunk = nr_to_read;
 		err = __do_page_cache_readahead(mapping, filp,
-						offset, this_chunk);
+						offset, this_chunk, 0);
 		if (err < 0) {
 			ret = err;
 			break;
@@ -341,28 +297,6 @@ int force_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	return ret;
 }
 
-/*
- * Check how effective readahead is being.  If the amount of started IO is
- * less than expected then the file is partly or fully in pagecache and
- * readahead isn't helping.
- *
- */
-static inline int check_ra_success(struct file_ra_state *ra,
-			unsigned long nr_to_read, unsigned long actual)
-{
-	if (actual == 0) {
-		ra->cache_hit += nr_to_read;
-		if (ra->cache_hit >= VM_MAX_CACHE_HIT) {
-			ra_off(ra);
-			ra->flags |= RA_FLAG_INCACHE;
-			return 0;
-		}
-	} else {
-		ra->cache_hit=0;
-	}
-	return 1;
-}
-
 /*
  * This version skips the IO if the queue is read-congested, and will tell the
  * block layer to abandon the readahead if request allocation would block.
@@ -376,188 +310,335 @@ int do_page_cache_readahead(struct address_space *mapping, struct file *filp,
 	if (bdi_read_congested(mapping->backing_dev_info))
 		return -1;
 
-	return __do_page_cache_readahead(mapping, filp, offset, nr_to_read);
+	return __do_page_cache_readahead(mapping, filp, offset, nr_to_read, 0);
 }
 
 /*
- * Read 'nr_to_read' pages starting at page 'offset'. If the flag 'block'
- * is set wait till the read completes.  Otherwise attempt to read without
- * blocking.
- * Returns 1 meaning 'success' if read is succesfull without switching off
- * readhaead mode. Otherwise return failure.
+ * Submit IO for the read-ahead request in file_ra_state.
  */
-static int
-blockable_page_cache_readahead(struct address_space *mapping, struct file *filp,
-			pgoff_t offset, unsigned long nr_to_read,
-			struct file_ra_state *ra, int block)
+static unsigned long ra_submit(struct file_ra_state *ra,
+		       struct address_space *mapping, struct file *filp)
+{
+	return __do_page_cache_readahead(mapping, filp,
+					 ra->start, ra->size, ra->async_size);
+}
+
+/*
+ * Count the contiguously cached pages right before @offset, looking at
+ * most @max pages back.
+ */
+static pgoff_t count_history_pages(struct address_space *mapping,
+				   pgoff_t offset, unsigned long max)
 {
-	int actual;
+	pgoff_t head;
+
+	read_lock_irq(&mapping->tree_lock);
+	head = radix_tree_prev_hole(&mapping->page_tree, offset - 1, max);
+	read_unlock_irq(&mapping->tree_lock);
+
+	return offset - 1 - head;
+}
+
+/*
+ * A page cache miss with cached pages right before it: some stream got
+ * here sequentially, even if it is not the one file_ra_state remembers.
+ * Size the window after the length of that history.
+ */
+static int try_context_readahead(struct address_space *mapping,
+				 struct file_ra_state *ra, pgoff_t offset,
+				 unsigned long req_size, unsigned long max)
+{
+	pgoff_t size;
+
+	size = count_history_pages(mapping, offset, max);
 
-	if (!block && bdi_read_congested(mapping->backing_dev_info))
+	/*
+	 * no history pages: it could be a random read
+	 */
+	if (!size)
 		return 0;
 
-	actual = __do_page_cache_readahead(mapping, filp, offset, nr_to_read);
+	/*
+	 * starts from beginning of file: it is a strong indication of
+	 * long-run stream (or whole-file-read)
+	 */
+	if (size >= offset)
+		size *= 2;
+
+	ra->start = offset;
+	ra->size = get_init_ra_size(size + req_size, max);
+	ra->async_size = ra->size;
 
-	return check_ra_success(ra, nr_to_read, actual);
+	return 1;
 }
 
-static int make_ahead_window(struct address_space *mapping, struct file *filp,
-				struct file_ra_state *ra, int force)
+/*
+ * A backward reader ends each request right below the previous one.
+ * Read a window that ends with the request, and keep growing it while
+ * the reader walks off the bottom of the last backward window.  No page
+ * is marked: the reader moves away from the pages after it.
+ */
+static int try_backward_readahead(struct file_ra_state *ra, pgoff_t offset,
+				  unsigned long req_size, unsigned long max)
 {
-	int block, ret;
-
-	ra->ahead_size = get_next_ra_size(ra);
-	ra->ahead_start = ra->start + ra->size;
-
-	block = force || (ra->prev_page >= ra->ahead_start);
-	ret = blockable_page_cache_readahead(mapping, filp,
-			ra->ahead_start, ra->ahead_size, ra, block);
-
-	if (!ret && !force) {
-		/* A read failure in blocking mode, implies pages are
-		 * all cached. So we can safely assume we have taken
-		 * care of all the pages requested in this call.
-		 * A read failure in non-blocking mode, implies we are
-		 * reading more pages than requested in this call.  So
-		 * we safely assume we have taken care of all the pages
-		 * requested in this call.
-		 *
-		 * Just reset the ahead window in case we failed due to
-		 * congestion.  The ahead window will any way be closed
-		 * in case we failed due to excessive page cache hits.
-		 */
-		ra->ahead_start = 0;
-		ra->ahead_size = 0;
-	}
+	pgoff_t end = offset + req_size;
+	unsigned long size;
 
-	return ret;
+	if (ra->prev_index == -1UL || offset >= ra->prev_index ||
+	    end > ra->prev_index + 1 || ra->prev_index + 1 - end > req_size)
+		return 0;
+
+	if (ra->size && !ra->async_size &&
+	    offset < ra->start && end >= ra->start)
+		size = get_next_ra_size(ra, max);
+	else
+		size = get_init_ra_size(req_size, max);
+
+	ra->start = end > size ? end - size : 0;
+	if (ra->start > offset)
+		ra->start = offset;
+	ra->size = end - ra->start;
+	ra->async_size = 0;
+
+	return 1;
 }
 
-/**
- * page_cache_readahead - generic adaptive readahead
- * @mapping: address_space which holds the pagecache and I/O vectors
- * @ra: file_ra_state which holds the readahead state
- * @filp: passed on to ->readpage() and ->readpages()
- * @offset: start offset into @mapping, in PAGE_CACHE_SIZE units
- * @req_size: hint: total size of the read which the caller is performing in
- *            PAGE_CACHE_SIZE units
- *
- * page_cache_readahead() is the main function.  If performs the adaptive
- * readahead window size management and submits the readahead I/O.
- *
- * Note that @filp is purely used for passing on to the ->readpage[s]()
- * handler: it may refer to a different file from @mapping (so we may not use
- * @filp->f_mapping or @filp->f_dentry->d_inode here).
- * Also, @ra may not be equal to &@filp->f_ra.
- *
+/*
+ * A strided reader fetches @req_size pages every so many pages.  Take the
+ * previous read to be a record of the same size, which gives the stride,
+ * and check that the record before it is cached with a hole in between.
+ * Then read the next few records, and mark the first page of the last
+ * one so the reader comes back before it runs out of them.  This does not
+ * touch file_ra_state: everything is recomputed from prev_index and the
+ * page cache on the next round.
  */
-unsigned long
-page_cache_readahead(struct address_space *mapping, struct file_ra_state *ra,
-		     struct file *filp, pgoff_t offset, unsigned long req_size)
+static int try_stride_readahead(struct address_space *mapping,
+				struct file_ra_state *ra, struct file *filp,
+				int hit_readahead_marker, pgoff_t offset,
+				unsigned long req_size, unsigned long max)
 {
-	unsigned long max, newsize;
-	int sequential;
+	pgoff_t prev_start, index;
+	unsigned long stride, nr, i;
+	int strided;
 
-	/*
-	 * We avoid doing extra work and bogusly perturbing the readahead
-	 * window expansion logic.
-	 */
-	if (offset == ra->prev_page && --req_size)
-		++offset;
+	if (ra->prev_index == -1UL || ra->prev_index + 1 < req_size)
+		return 0;
 
-	/* Note that prev_page == -1 if it is a first read */
-	sequential = (offset == ra->prev_page + 1);
-	ra->prev_page = offset;
+	prev_start = ra->prev_index + 1 - req_size;
+	if (offset <= prev_start)
+		return 0;
 
-	max = get_max_readahead(ra);
-	newsize = min(req_size, max);
+	stride = offset - prev_start;
+	if (stride <= req_size || stride > max || prev_start < stride)
+		return 0;
 
-	/* No readahead or sub-page sized read or file already in cache */
-	if (newsize == 0 || (ra->flags & RA_FLAG_INCACHE))
-		goto out;
+	nr = get_init_ra_size(4 * req_size, max) / req_size;
+	if (nr < 2)
+		return 0;
+
+	read_lock_irq(&mapping->tree_lock);
+	strided = radix_tree_lookup(&mapping->page_tree,
+				    prev_start - stride) != NULL &&
+		  radix_tree_lookup(&mapping->page_tree,
+				    prev_start - 1) == NULL;
+	read_unlock_irq(&mapping->tree_lock);
 
-	ra->prev_page += newsize - 1;
+	if (!strided)
+		return 0;
+
+	index = offset;
+	if (hit_readahead_marker)
+		index += stride;
+
+	for (i = 0; i < nr; i++, index += stride)
+		__do_page_cache_readahead(mapping, filp, index, req_size,
+					  i == nr - 1 ? req_size : 0);
+
+	return 1;
+}
+
+/*
+ * Work out which stream @offset belongs to, set up the next window for it
+ * and submit it.  Returns the number of pages submitted.
+ */
+static unsigned long
+ondemand_readahead(struct address_space *mapping,
+		   struct file_ra_state *ra, struct file *filp,
+		   int hit_readahead_marker, pgoff_t offset,
+		   unsigned long req_size)
+{
+	unsigned long max = ra->ra_pages;
 
 	/*
-	 * Special case - first read at start of file. We'll assume it's
-	 * a whole-file read and grow the window fast.  Or detect first
-	 * sequential access
+	 * start of file
 	 */
-	if (sequential && ra->size == 0) {
-		ra->size = get_init_ra_size(newsize, max);
-		ra->start = offset;
-		if (!blockable_page_cache_readahead(mapping, filp, offset,
-							 ra->size, ra, 1))
-			goto out;
-
-		/*
-		 * If the request size is larger than our max readahead, we
-		 * at least want to be sure that we get 2 IOs in flight and
-		 * we know that we will definitly need the new I/O.
-		 * once we do this, subsequent calls should be able to overlap
-		 * IOs,* thus preventing stalls. so issue the ahead window
-		 * immediately.
-		 */
-		if (req_size >= max)
-			make_ahead_window(mapping, filp, ra, 1);
+	if (!offset)
+		goto initial_readahead;
 
-		goto out;
+	/*
+	 * It's the expected callback offset, assume sequential access.
+	 * Ramp up sizes, and push forward the readahead window.
+	 */
+	if (offset == (ra->start + ra->size - ra->async_size) ||
+	    offset == (ra->start + ra->size)) {
+		ra->start += ra->size;
+		ra->size = get_next_ra_size(ra, max);
+		ra->async_size = ra->size;
+		goto readit;
 	}
 
 	/*
-	 * Now handle the random case:
-	 * partial page reads and first access were handled above,
-	 * so this must be the next page otherwise it is random
+	 * Hit a marked page without valid readahead state.
+	 * E.g. interleaved reads.
+	 * Query the pagecache for async_size, which normally equals to
+	 * readahead size. Ramp it up and use it as the new readahead size.
 	 */
-	if (!sequential) {
-		ra_off(ra);
-		blockable_page_cache_readahead(mapping, filp, offset,
-				 newsize, ra, 1);
-		goto out;
+	if (hit_readahead_marker) {
+		pgoff_t start;
+
+		if (try_stride_readahead(mapping, ra, filp, 1, offset,
+					 req_size, max))
+			return 0;
+
+		read_lock_irq(&mapping->tree_lock);
+		start = radix_tree_next_hole(&mapping->page_tree, offset + 1,
+					     max);
+		read_unlock_irq(&mapping->tree_lock);
+
+		if (!start || start - offset > max)
+			return 0;
+
+		ra->start = start;
+		ra->size = start - offset;	/* old async_size */
+		ra->size += req_size;
+		ra->size = get_next_ra_size(ra, max);
+		ra->async_size = ra->size;
+		goto readit;
 	}
 
 	/*
-	 * If we get here we are doing sequential IO and this was not the first
-	 * occurence (ie we have an existing window)
+	 * oversize read
 	 */
+	if (req_size > max)
+		goto initial_readahead;
+
+	/*
+	 * sequential cache miss
+	 */
+	if (offset - ra->prev_index <= 1UL)
+		goto initial_readahead;
+
+	/*
+	 * Out of order reads: strided and backward streams leave their
+	 * own traces in prev_index and the page cache.
+	 */
+	if (try_stride_readahead(mapping, ra, filp, 0, offset, req_size, max))
+		return 0;
+
+	if (try_backward_readahead(ra, offset, req_size, max))
+		goto readit;
+
+	/*
+	 * Query the page cache and look for the traces (cached history
+	 * pages) that a sequential stream would leave behind.
+	 */
+	if (try_context_readahead(mapping, ra, offset, req_size, max))
+		goto readit;
 
-	if (ra->ahead_start == 0) {	 /* no ahead window yet */
-		if (!make_ahead_window(mapping, filp, ra, 0))
-			goto out;
-	}
 	/*
-	 * Already have an ahead window, check if we crossed into it.
-	 * If so, shift windows and issue a new ahead window.
-	 * Only return the #pages that are in the current window, so that
-	 * we get called back on the first page of the ahead window which
-	 * will allow us to submit more IO.
+	 * standalone, small random read
+	 * Read as is, and do not pollute the readahead state.
 	 */
-	if (ra->prev_page >= ra->ahead_start) {
-		ra->start = ra->ahead_start;
-		ra->size = ra->ahead_size;
-		make_ahead_window(mapping, filp, ra, 0);
+	return __do_page_cache_readahead(mapping, filp, offset, req_size, 0);
+
+initial_readahead:
+	ra->start = offset;
+	ra->size = get_init_ra_size(req_size, max);
+	ra->async_size = ra->size > req_size ? ra->size - req_size : ra->size;
+
+readit:
+	/*
+	 * Will this read hit the readahead marker made by itself?
+	 * If so, trigger the readahead marker hit now, and merge
+	 * the resulted next readahead window into the current one.
+	 */
+	if (offset == ra->start && ra->size == ra->async_size) {
+		ra->async_size = get_next_ra_size(ra, max);
+		ra->size += ra->async_size;
 	}
 
-out:
-	return ra->prev_page + 1;
+	return ra_submit(ra, mapping, filp);
 }
 
-/*
- * handle_ra_miss() is called when it is known that a page which should have
- * been present in the pagecache (we just did some readahead there) was in fact
- * not found.  This will happen if it was evicted by the VM (readahead
- * thrashing)
+/**
+ * page_cache_sync_readahead - generic file readahead
+ * @mapping: address_space which holds the pagecache and I/O vectors
+ * @ra: file_ra_state which holds the readahead state
+ * @filp: passed on to ->readpage() and ->readpages()
+ * @offset: start offset into @mapping, in PAGE_CACHE_SIZE units
+ * @req_size: hint: total size of the read which the caller is performing in
+ *            PAGE_CACHE_SIZE units
+ *
+ * page_cache_sync_readahead() should be called when a cache miss happened:
+ * it will submit the read.  The readahead logic may decide to piggyback more
+ * pages onto the read request if access patterns suggest it will improve
+ * performance.
+ *
+ * Note that @filp is purely used for passing on to the ->readpage[s]()
+ * handler: it may refer to a different file from @mapping (so we may not use
+ * @filp->f_mapping or @filp->f_dentry->d_inode here).
+ * Also, @ra may not be equal to &@filp->f_ra.
+ */
+void page_cache_sync_readahead(struct address_space *mapping,
+			       struct file_ra_state *ra, struct file *filp,
+			       pgoff_t offset, unsigned long req_size)
+{
+	/* no read-ahead */
+	if (!ra->ra_pages)
+		return;
+
+	/* do read-ahead */
+	ondemand_readahead(mapping, ra, filp, 0, offset, req_size);
+}
+EXPORT_SYMBOL_GPL(page_cache_sync_readahead);
+
+/**
+ * page_cache_async_readahead - file readahead for marked pages
+ * @mapping: address_space which holds the pagecache and I/O vectors
+ * @ra: file_ra_state which holds the readahead state
+ * @filp: passed on to ->readpage() and ->readpages()
+ * @page: the page at @offset which has the PG_readahead flag set
+ * @offset: start offset into @mapping, in PAGE_CACHE_SIZE units
+ * @req_size: hint: total size of the read which the caller is performing in
+ *            PAGE_CACHE_SIZE units
  *
- * Turn on the cache miss flag in the RA struct, this will cause the RA code
- * to reduce the RA size on the next read.
+ * page_cache_async_readahead() should be called when a page is used which
+ * has the PG_readahead flag: this is a marker to suggest that the application
+ * has used up enough of the readahead window that we should start pulling in
+ * more pages.
  */
-void handle_ra_miss(struct address_space *mapping,
-		struct file_ra_state *ra, pgoff_t offset)
+void
+page_cache_async_readahead(struct address_space *mapping,
+			   struct file_ra_state *ra, struct file *filp,
+			   struct page *page, pgoff_t offset,
+			   unsigned long req_size)
 {
-	ra->flags |= RA_FLAG_MISS;
-	ra->flags &= ~RA_FLAG_INCACHE;
-	ra->cache_hit = 0;
+	/* no read-ahead */
+	if (!ra->ra_pages)
+		return;
+
+	ClearPageReadahead(page);
+
+	/*
+	 * Defer asynchronous read-ahead on IO congestion.
+	 */
+	if (bdi_read_congested(mapping->backing_dev_info))
+		return;
+
+	/* do read-ahead */
+	ondemand_readahead(mapping, ra, filp, 1, offset, req_size);
 }
+EXPORT_SYMBOL_GPL(page_cache_async_readahead);
 
 /*
  * Given a desired number of PAGE_CACHE_SIZE readahead pages, return a
@@ -88,8 +88,11 @@ static inline struct page *shmem_dir_alloc(gfp_t gfp_mask)
 	 * The above definition of ENTRIES_PER_PAGE, and the use of
 	 * BLOCKS_PER_PAGE on indirect pages, assume PAGE_CACHE_SIZE:
 	 * might be reconsidered if it ever diverges from PAGE_SIZE.
+	 * Index pages are pinned for the life of the inode: whatever the
+	 * mapping's mask says, they are not movable.
 	 */
-	return alloc_pages(gfp_mask, PAGE_CACHE_SHIFT-PAGE_SHIFT);
+	return alloc_pages(gfp_mask & ~__GFP_MOVABLE,
+				PAGE_CACHE_SHIFT-PAGE_SHIFT);
 }
 
 static inline void shmem_dir_free(struct page *page)
@@ -1129,6 +1132,7 @@ repeat:
 				swap = *entry;
 				shmem_swp_unmap(entry);
 			}
+			SetPageSwapBacked(filepage);
 			if (error || swap.val || 0 != add_to_page_cache_lru(
 					filepage, mapping, idx, GFP_ATOMIC)) {
 				spin_unlock(&info->lock);
@@ -1259,10 +1263,15 @@ int shmem_lock(struct file *file, int lock, struct user_struct *user)
 		if (!user_shm_lock(inode->i_size, user))
 			goto out_nomem;
 		info->flags |= VM_LOCKED;
+		mapping_set_unevictable(file->f_mapping);
 	}
 	if (!lock && (info->flags & VM_LOCKED) && user) {
 		user_shm_unlock(inode->i_size, user);
 		info->flags &= ~VM_LOCKED;
+		mapping_clear_unevictable(file->f_mapping);
+		spin_unlock(&info->lock);
+		scan_mapping_unevictable_pages(file->f_mapping);
+		return 0;
 	}
 	retval = 0;
 out_nomem:
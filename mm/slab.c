@@ -1216,7 +1216,11 @@ static void *kmem_getpages(kmem_cache_t *cachep, gfp_t flags, int nodeid)
 	void *addr;
 	int i;
 
+	/* Slab pages are never movable, whatever the caller passed in */
+	flags &= ~__GFP_MOVABLE;
 	flags |= cachep->gfpflags;
+	if (cachep->flags & SLAB_RECLAIM_ACCOUNT)
+		flags |= __GFP_RECLAIMABLE;
 	page = alloc_pages_node(nodeid, flags, cachep->gfporder);
 	if (!page)
 		return NULL;
@@ -1225,7 +1229,7 @@ static void *kmem_getpages(kmem_cache_t *cachep, gfp_t flags, int nodeid)
 	i = (1 << cachep->gfporder);
 	if (cachep->flags & SLAB_RECLAIM_ACCOUNT)
 		atomic_add(i, &slab_reclaim_pages);
-	add_page_state(nr_slab, i);
+	mod_zone_page_state(page_zone(page), NR_SLAB, i);
 	while (i--) {
 		SetPageSlab(page);
 		page++;
@@ -1247,7 +1251,8 @@ static void kmem_freepages(kmem_cache_t *cachep, void *addr)
 			BUG();
 		page++;
 	}
-	sub_page_state(nr_slab, nr_freed);
+	mod_zone_page_state(page_zone(virt_to_page(addr)), NR_SLAB,
+			    -(int)nr_freed);
 	if (current->reclaim_state)
 		current->reclaim_state->reclaimed_slab += nr_freed;
 	free_pages((unsigned long)addr, cachep->gfporder);
@@ -0,0 +1,1309 @@
+/*
+ * SLUB: A slab allocator without per-slab metadata queues.
+ *
+ * The allocator keeps no object queues of its own. Each cpu allocates
+ * from an "active" slab page, and objects are handed out straight from
+ * a freelist that is threaded through the free objects of that page.
+ * A slab page that is not active on any cpu is on its node's partial
+ * list if it has free objects. A full slab page is on no list at all.
+ * A slab page that becomes empty is given back to the page allocator.
+ *
+ * There are no array caches, no alien caches, no shared caches and no
+ * full/free lists, so there is nothing that needs draining. The
+ * periodic cache_reap timer of the SLAB allocator has no counterpart.
+ * The metadata per cache is one active page pointer per cpu and one
+ * small kmem_cache_node per online node.
+ *
+ * struct page fields used for slab pages:
+ *	page->freelist	first free object (NULL if the slab is full)
+ *	page->inuse	number of objects handed out
+ *	page->slab	the cache this slab belongs to
+ *	page->lru	partial list linkage, or the rcu head while the slab
+ *			waits for an rcu grace period (SLAB_DESTROY_BY_RCU)
+ *	PG_locked	per slab lock (see slab_lock())
+ *	PG_active	the slab is a cpu's active slab ("frozen") and must
+ *			not be put on a partial list or freed by kfree
+ *
+ * freelist, inuse and slab overlay page->index, page->_mapcount and
+ * page->private. page->mapping stays NULL, so that page_mapping() and
+ * flush_dcache_page() see no address_space on a slab page.
+ *
+ * Only the first page of a higher order slab carries the freelist and
+ * the inuse count. page->slab is set on every page of a slab so that
+ * kfree() can find the cache from any object address.
+ *
+ * Lock order:
+ *	slab_lock(page)
+ *	  kmem_cache_node->list_lock
+ *
+ * get_partial_node() takes the locks the other way around and therefore
+ * only trylocks the slabs on the partial list.
+ *
+ * The cpu's active slab is accessed with interrupts disabled. It may
+ * also be freed into by other cpus under slab_lock().
+ */
+
+#include	<linux/config.h>
+#include	<linux/slab.h>
+#include	<linux/mm.h>
+#include	<linux/swap.h>
+#include	<linux/bit_spinlock.h>
+#include	<linux/interrupt.h>
+#include	<linux/init.h>
+#include	<linux/seq_file.h>
+#include	<linux/notifier.h>
+#include	<linux/cpu.h>
+#include	<linux/module.h>
+#include	<linux/rcupdate.h>
+#include	<linux/string.h>
+#include	<linux/nodemask.h>
+
+#include	<asm/uaccess.h>
+#include	<asm/page.h>
+
+#ifndef cache_line_size
+#define cache_line_size()	L1_CACHE_BYTES
+#endif
+
+#ifndef ARCH_KMALLOC_MINALIGN
+#define ARCH_KMALLOC_MINALIGN 0
+#endif
+
+#ifndef ARCH_SLAB_MINALIGN
+#define ARCH_SLAB_MINALIGN 0
+#endif
+
+#ifndef ARCH_KMALLOC_FLAGS
+#define ARCH_KMALLOC_FLAGS SLAB_HWCACHE_ALIGN
+#endif
+
+/*
+ * Legal flag mask for kmem_cache_create(). The debug flags are accepted
+ * for compatibility with callers written for the SLAB allocator, but
+ * they have no effect.
+ */
+#define CREATE_MASK	(SLAB_DEBUG_FREE | SLAB_DEBUG_INITIAL | \
+			 SLAB_RED_ZONE | SLAB_POISON | SLAB_STORE_USER | \
+			 SLAB_HWCACHE_ALIGN | SLAB_NO_REAP | \
+			 SLAB_CACHE_DMA | SLAB_MUST_HWCACHE_ALIGN | \
+			 SLAB_RECLAIM_ACCOUNT | SLAB_PANIC | \
+			 SLAB_DESTROY_BY_RCU)
+
+/*
+ * Try to get at least SLUB_MIN_OBJECTS objects into a slab, but do not
+ * go beyond SLUB_MAX_ORDER for that. Larger objects simply get the
+ * order they need.
+ */
+#define SLUB_MAX_ORDER		1
+#define SLUB_MIN_OBJECTS	4
+
+/*
+ * Number of empty slabs kept on a node's partial list instead of being
+ * returned to the page allocator right away.
+ */
+#define SLUB_MIN_PARTIAL	2
+
+struct kmem_cache_node {
+	spinlock_t list_lock;		/* Protects partial */
+	unsigned long nr_partial;
+	atomic_long_t nr_slabs;
+	struct list_head partial;
+};
+
+struct kmem_cache {
+	/* 1) hot: used on every allocation and free */
+	unsigned long flags;
+	int size;		/* object size including the free pointer */
+	int offset;		/* free pointer offset within the object */
+	int order;
+	int objects;		/* objects per slab */
+	gfp_t gfpflags;		/* extra page allocation flags */
+
+	/* 2) cache creation/removal */
+	int objsize;		/* size requested by the creator */
+	int align;
+	void (*ctor)(void *, kmem_cache_t *, unsigned long);
+	void (*dtor)(void *, kmem_cache_t *, unsigned long);
+	const char *name;
+	struct list_head next;
+
+	struct kmem_cache_node *node[MAX_NUMNODES];
+	struct page *cpu_slab[NR_CPUS];
+};
+
+/* Guards the cache chain */
+static DECLARE_MUTEX(slub_sem);
+static LIST_HEAD(slab_caches);
+
+atomic_t slab_reclaim_pages;
+
+/*
+ * The caches holding kmem_cache and kmem_cache_node structures cannot
+ * be allocated from themselves. They are static, and so are the node
+ * structures of the kmem_cache_node cache.
+ */
+static struct kmem_cache kmem_cache_cache;
+static struct kmem_cache kmem_node_cache;
+static struct kmem_cache_node kmem_node_cache_nodes[MAX_NUMNODES];
+
+/*
+ * Per slab locking using the page lock bit. Slab pages are never in the
+ * page cache, so PG_locked is free for our use.
+ */
+static inline void slab_lock(struct page *page)
+{
+	bit_spin_lock(PG_locked, &page->flags);
+}
+
+static inline void slab_unlock(struct page *page)
+{
+	bit_spin_unlock(PG_locked, &page->flags);
+}
+
+static inline int slab_trylock(struct page *page)
+{
+	return bit_spin_trylock(PG_locked, &page->flags);
+}
+
+#define SlabFrozen(page)	PageActive(page)
+#define SetSlabFrozen(page)	SetPageActive(page)
+#define ClearSlabFrozen(page)	ClearPageActive(page)
+
+static inline void *get_freepointer(struct kmem_cache *s, void *object)
+{
+	return *(void **)(object + s->offset);
+}
+
+static inline void set_freepointer(struct kmem_cache *s, void *object,
+				   void *fp)
+{
+	*(void **)(object + s->offset) = fp;
+}
+
+/*
+ * Find the first page of the slab that contains @x. Slabs are allocated
+ * naturally aligned by the page allocator.
+ */
+static inline struct page *virt_to_slab(struct kmem_cache *s, const void *x)
+{
+	unsigned long addr = (unsigned long)x;
+
+	return virt_to_page(addr & ~((PAGE_SIZE << s->order) - 1));
+}
+
+/*
+ * Interface to system's page allocator.
+ */
+static struct page *allocate_slab(struct kmem_cache *s, gfp_t flags, int node)
+{
+	struct page *page;
+	int i;
+
+	/* Slab pages are never movable, whatever the caller passed in */
+	flags &= ~__GFP_MOVABLE;
+	flags |= s->gfpflags;
+	if (s->flags & SLAB_RECLAIM_ACCOUNT)
+		flags |= __GFP_RECLAIMABLE;
+	if (node == -1)
+		page = alloc_pages(flags, s->order);
+	else
+		page = alloc_pages_node(node, flags, s->order);
+	if (!page)
+		return NULL;
+
+	i = 1 << s->order;
+	if (s->flags & SLAB_RECLAIM_ACCOUNT)
+		atomic_add(i, &slab_reclaim_pages);
+	mod_zone_page_state(page_zone(page), NR_SLAB, i);
+	while (i--) {
+		page[i].slab = s;
+		SetPageSlab(page + i);
+	}
+	return page;
+}
+
+static struct page *new_slab(struct kmem_cache *s, gfp_t flags, int node)
+{
+	struct kmem_cache_node *n;
+	struct page *page;
+	unsigned long ctor_flags = SLAB_CTOR_CONSTRUCTOR;
+	void *start, *p, *last;
+
+	if (flags & __GFP_WAIT)
+		local_irq_enable();
+	else
+		ctor_flags |= SLAB_CTOR_ATOMIC;
+
+	page = allocate_slab(s, flags & SLAB_LEVEL_MASK, node);
+	if (!page)
+		goto out;
+
+	n = s->node[page_to_nid(page)];
+	if (n)
+		atomic_long_inc(&n->nr_slabs);
+
+	start = page_address(page);
+	last = start;
+	for (p = start + s->size; p < start + s->objects * s->size;
+	     p += s->size) {
+		if (s->ctor)
+			s->ctor(last, s, ctor_flags);
+		set_freepointer(s, last, p);
+		last = p;
+	}
+	if (s->ctor)
+		s->ctor(last, s, ctor_flags);
+	set_freepointer(s, last, NULL);
+
+	page->freelist = start;
+	page->inuse = 0;
+out:
+	if (flags & __GFP_WAIT)
+		local_irq_disable();
+	return page;
+}
+
+static void __free_slab(struct kmem_cache *s, struct page *page)
+{
+	int pages = 1 << s->order;
+	int i;
+
+	if (s->dtor) {
+		void *start = page_address(page);
+		void *p;
+
+		for (p = start; p < start + s->objects * s->size; p += s->size)
+			s->dtor(p, s, 0);
+	}
+
+	for (i = 0; i < pages; i++) {
+		if (!TestClearPageSlab(page + i))
+			BUG();
+		page[i].slab = NULL;
+	}
+	page->freelist = NULL;
+	reset_page_mapcount(page);	/* page->inuse */
+
+	mod_zone_page_state(page_zone(page), NR_SLAB, -pages);
+	if (current->reclaim_state)
+		current->reclaim_state->reclaimed_slab += pages;
+	__free_pages(page, s->order);
+	if (s->flags & SLAB_RECLAIM_ACCOUNT)
+		atomic_sub(pages, &slab_reclaim_pages);
+}
+
+static void rcu_free_slab(struct rcu_head *h)
+{
+	struct page *page;
+
+	page = container_of((struct list_head *)h, struct page, lru);
+	__free_slab(page->slab, page);
+}
+
+static void discard_slab(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_node *n = s->node[page_to_nid(page)];
+
+	if (n)
+		atomic_long_dec(&n->nr_slabs);
+
+	if (unlikely(s->flags & SLAB_DESTROY_BY_RCU)) {
+		/*
+		 * The slab is on no list anymore: page->lru is free
+		 * to hold the rcu head.
+		 */
+		struct rcu_head *head = (void *)&page->lru;
+
+		call_rcu(head, rcu_free_slab);
+	} else
+		__free_slab(s, page);
+}
+
+/*
+ * Management of the per node partial lists.
+ */
+static void add_partial(struct kmem_cache *s, struct page *page, int tail)
+{
+	struct kmem_cache_node *n = s->node[page_to_nid(page)];
+
+	spin_lock(&n->list_lock);
+	n->nr_partial++;
+	if (tail)
+		list_add_tail(&page->lru, &n->partial);
+	else
+		list_add(&page->lru, &n->partial);
+	spin_unlock(&n->list_lock);
+}
+
+static void remove_partial(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_node *n = s->node[page_to_nid(page)];
+
+	spin_lock(&n->list_lock);
+	list_del(&page->lru);
+	n->nr_partial--;
+	spin_unlock(&n->list_lock);
+}
+
+/*
+ * Take a slab off a node's partial list, lock it and freeze it.
+ */
+static struct page *get_partial_node(struct kmem_cache_node *n)
+{
+	struct page *page;
+
+	/*
+	 * Racy check. If we mistakenly see no partial slabs then we just
+	 * allocate a new slab.
+	 */
+	if (!n || !n->nr_partial)
+		return NULL;
+
+	spin_lock(&n->list_lock);
+	list_for_each_entry(page, &n->partial, lru)
+		if (slab_trylock(page)) {
+			list_del(&page->lru);
+			n->nr_partial--;
+			SetSlabFrozen(page);
+			spin_unlock(&n->list_lock);
+			return page;
+		}
+	spin_unlock(&n->list_lock);
+	return NULL;
+}
+
+static struct page *get_partial(struct kmem_cache *s, int node)
+{
+	struct page *page;
+	int searchnode = (node == -1) ? numa_node_id() : node;
+
+	page = get_partial_node(s->node[searchnode]);
+	if (page || node != -1)
+		return page;
+
+#ifdef CONFIG_NUMA
+	/*
+	 * Take a remote partial slab rather than grow the cache. This
+	 * keeps the number of partial slabs on other nodes low.
+	 */
+	for_each_online_node(searchnode) {
+		page = get_partial_node(s->node[searchnode]);
+		if (page)
+			return page;
+	}
+#endif
+	return NULL;
+}
+
+/*
+ * Move a slab that is no longer a cpu's active slab to where it belongs.
+ * The slab must be locked; it is unlocked on return.
+ */
+static void unfreeze_slab(struct kmem_cache *s, struct page *page)
+{
+	struct kmem_cache_node *n = s->node[page_to_nid(page)];
+
+	ClearSlabFrozen(page);
+	if (page->inuse) {
+		if (page->freelist)
+			add_partial(s, page, 0);
+		slab_unlock(page);
+	} else if (n->nr_partial < SLUB_MIN_PARTIAL) {
+		/*
+		 * Keep a few empty slabs around. They go to the tail so
+		 * that partially used slabs are filled up first.
+		 */
+		add_partial(s, page, 1);
+		slab_unlock(page);
+	} else {
+		slab_unlock(page);
+		discard_slab(s, page);
+	}
+}
+
+static void deactivate_slab(struct kmem_cache *s, struct page *page, int cpu)
+{
+	s->cpu_slab[cpu] = NULL;
+	unfreeze_slab(s, page);
+}
+
+static void flush_slab(struct kmem_cache *s, struct page *page, int cpu)
+{
+	slab_lock(page);
+	deactivate_slab(s, page, cpu);
+}
+
+/*
+ * Flush the active slab of @cpu. Called with interrupts off from the
+ * cpu itself, or for a cpu that is gone.
+ */
+static void __flush_cpu_slab(struct kmem_cache *s, int cpu)
+{
+	struct page *page = s->cpu_slab[cpu];
+
+	if (page)
+		flush_slab(s, page, cpu);
+}
+
+static void flush_cpu_slab(void *d)
+{
+	struct kmem_cache *s = d;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__flush_cpu_slab(s, smp_processor_id());
+	local_irq_restore(flags);
+}
+
+static void flush_all(struct kmem_cache *s)
+{
+	on_each_cpu(flush_cpu_slab, s, 1, 1);
+}
+
+/*
+ * Slow path: the active slab is exhausted, missing or on the wrong
+ * node. Get a partial slab or a new slab and make it the active slab.
+ * Interrupts are disabled; the active slab (if any) is locked.
+ */
+static void *__slab_alloc(struct kmem_cache *s, gfp_t gfpflags, int node,
+			  struct page *page)
+{
+	void **object;
+	int cpu = smp_processor_id();
+
+	if (page)
+		deactivate_slab(s, page, cpu);
+
+	page = get_partial(s, node);
+	if (!page) {
+		page = new_slab(s, gfpflags, node);
+		if (!page)
+			return NULL;
+
+		/*
+		 * We may have been rescheduled, and another allocation on
+		 * this cpu may have installed an active slab meanwhile.
+		 */
+		cpu = smp_processor_id();
+		if (s->cpu_slab[cpu])
+			__flush_cpu_slab(s, cpu);
+		slab_lock(page);
+		SetSlabFrozen(page);
+	}
+	s->cpu_slab[cpu] = page;
+
+	object = page->freelist;
+	page->freelist = get_freepointer(s, object);
+	page->inuse++;
+	slab_unlock(page);
+	return object;
+}
+
+/*
+ * Allocation fast path: pull an object off the freelist of the active
+ * slab of this cpu.
+ */
+static __always_inline void *slab_alloc(struct kmem_cache *s,
+					gfp_t gfpflags, int node)
+{
+	struct page *page;
+	void **object;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	page = s->cpu_slab[smp_processor_id()];
+	if (unlikely(!page)) {
+		object = __slab_alloc(s, gfpflags, node, NULL);
+		goto out;
+	}
+
+	slab_lock(page);
+	object = page->freelist;
+	if (unlikely(!object ||
+		     (node != -1 && page_to_nid(page) != node))) {
+		object = __slab_alloc(s, gfpflags, node, page);
+		goto out;
+	}
+	page->freelist = get_freepointer(s, object);
+	page->inuse++;
+	slab_unlock(page);
+out:
+	local_irq_restore(flags);
+	return object;
+}
+
+/*
+ * Free an object. Frees into a cpu's active slab only touch the
+ * freelist. Otherwise the slab may have to go onto the partial list
+ * (it was full) or back to the page allocator (it is now empty).
+ */
+static __always_inline void slab_free(struct kmem_cache *s,
+				      struct page *page, void *x)
+{
+	void *prior;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	slab_lock(page);
+
+	prior = page->freelist;
+	set_freepointer(s, x, prior);
+	page->freelist = x;
+	page->inuse--;
+
+	if (unlikely(SlabFrozen(page)))
+		goto out_unlock;
+
+	if (unlikely(!page->inuse))
+		goto slab_empty;
+
+	/*
+	 * Objects left in the slab. If it was not on the partial list
+	 * before then add it.
+	 */
+	if (unlikely(!prior))
+		add_partial(s, page, 0);
+
+out_unlock:
+	slab_unlock(page);
+	local_irq_restore(flags);
+	return;
+
+slab_empty:
+	if (prior)
+		remove_partial(s, page);
+	slab_unlock(page);
+	discard_slab(s, page);
+	local_irq_restore(flags);
+}
+
+/**
+ * kmem_cache_alloc - Allocate an object
+ * @cachep: The cache to allocate from.
+ * @flags: See kmalloc().
+ *
+ * Allocate an object from this cache.  The flags are only relevant
+ * if the cache has no available objects.
+ */
+void *kmem_cache_alloc(kmem_cache_t *cachep, gfp_t flags)
+{
+	return slab_alloc(cachep, flags, -1);
+}
+EXPORT_SYMBOL(kmem_cache_alloc);
+
+#ifdef CONFIG_NUMA
+/**
+ * kmem_cache_alloc_node - Allocate an object on the specified node
+ * @cachep: The cache to allocate from.
+ * @flags: See kmalloc().
+ * @nodeid: node number of the target node.
+ *
+ * Identical to kmem_cache_alloc, except that the object is taken from
+ * a slab on the given node.
+ */
+void *kmem_cache_alloc_node(kmem_cache_t *cachep, gfp_t flags, int nodeid)
+{
+	if (nodeid != -1 && unlikely(!cachep->node[nodeid]))
+		nodeid = -1;
+	return slab_alloc(cachep, flags, nodeid);
+}
+EXPORT_SYMBOL(kmem_cache_alloc_node);
+#endif
+
+/**
+ * kmem_cache_free - Deallocate an object
+ * @cachep: The cache the allocation was from.
+ * @objp: The previously allocated object.
+ *
+ * Free an object which was previously allocated from this
+ * cache.
+ */
+void kmem_cache_free(kmem_cache_t *cachep, void *objp)
+{
+	slab_free(cachep, virt_to_slab(cachep, objp), objp);
+}
+EXPORT_SYMBOL(kmem_cache_free);
+
+/**
+ * kmem_ptr_validate - check if an untrusted pointer might
+ *	be a slab entry.
+ * @cachep: the cache we're checking against
+ * @ptr: pointer to validate
+ *
+ * This verifies that the untrusted pointer looks sane:
+ * it is _not_ a guarantee that the pointer is actually
+ * part of the slab cache in question, but it at least
+ * validates that the pointer can be dereferenced and
+ * looks half-way sane.
+ *
+ * Currently only used for dentry validation.
+ */
+int fastcall kmem_ptr_validate(kmem_cache_t *cachep, void *ptr)
+{
+	unsigned long addr = (unsigned long)ptr;
+	unsigned long size = cachep->objsize;
+	struct page *page;
+
+	if (unlikely(addr < PAGE_OFFSET))
+		return 0;
+	if (unlikely(addr > (unsigned long)high_memory - size))
+		return 0;
+	if (unlikely(addr & (sizeof(void *) - 1)))
+		return 0;
+	if (unlikely(!kern_addr_valid(addr)))
+		return 0;
+	if (unlikely(!kern_addr_valid(addr + size - 1)))
+		return 0;
+	page = virt_to_page(ptr);
+	if (unlikely(!PageSlab(page)))
+		return 0;
+	if (unlikely(page->slab != cachep))
+		return 0;
+	return 1;
+}
+
+/*
+ * Pick the slab order: the smallest order that fits SLUB_MIN_OBJECTS
+ * objects while wasting at most 1/8 of the slab.
+ */
+static int calculate_order(int size)
+{
+	int order;
+
+	for (order = get_order(size); order < SLUB_MAX_ORDER; order++) {
+		unsigned long slab_size = PAGE_SIZE << order;
+
+		if (slab_size / size >= SLUB_MIN_OBJECTS &&
+		    (slab_size % size) * 8 <= slab_size)
+			break;
+	}
+	return order;
+}
+
+static int calculate_sizes(struct kmem_cache *s)
+{
+	unsigned long flags = s->flags;
+	int size = ALIGN(s->objsize, sizeof(void *));
+	int align = s->align;
+
+	if (flags & (SLAB_HWCACHE_ALIGN | SLAB_MUST_HWCACHE_ALIGN)) {
+		int ralign = cache_line_size();
+
+		/*
+		 * Small objects are only aligned to the largest power of
+		 * two that they fit in, as in the SLAB allocator.
+		 */
+		if (!(flags & SLAB_MUST_HWCACHE_ALIGN))
+			while (size <= ralign / 2)
+				ralign /= 2;
+		if (ralign > align)
+			align = ralign;
+	}
+	if (align < ARCH_SLAB_MINALIGN)
+		align = ARCH_SLAB_MINALIGN;
+	if (align < sizeof(void *))
+		align = sizeof(void *);
+	s->align = align;
+
+	/*
+	 * The free pointer is stored in the first word of a free object,
+	 * unless the object must keep its contents while free: objects
+	 * that have a constructor and objects that rcu readers may still
+	 * look at. Those get an extra word behind the object.
+	 */
+	if (s->ctor || (flags & SLAB_DESTROY_BY_RCU)) {
+		s->offset = size;
+		size += sizeof(void *);
+	} else
+		s->offset = 0;
+
+	size = ALIGN(size, align);
+	s->size = size;
+	s->order = calculate_order(size);
+	if (s->order >= MAX_ORDER)
+		return 0;
+	s->objects = (PAGE_SIZE << s->order) / size;
+	return s->objects != 0;
+}
+
+static void init_kmem_cache_node(struct kmem_cache_node *n)
+{
+	spin_lock_init(&n->list_lock);
+	n->nr_partial = 0;
+	atomic_long_set(&n->nr_slabs, 0);
+	INIT_LIST_HEAD(&n->partial);
+}
+
+static void free_kmem_cache_nodes(struct kmem_cache *s)
+{
+	int node;
+
+	for_each_online_node(node) {
+		struct kmem_cache_node *n = s->node[node];
+
+		if (n && s != &kmem_node_cache)
+			kmem_cache_free(&kmem_node_cache, n);
+		s->node[node] = NULL;
+	}
+}
+
+static int init_kmem_cache_nodes(struct kmem_cache *s, gfp_t gfpflags)
+{
+	int node;
+
+	for_each_online_node(node) {
+		struct kmem_cache_node *n;
+
+		if (s == &kmem_node_cache)
+			n = &kmem_node_cache_nodes[node];
+		else {
+			n = kmem_cache_alloc_node(&kmem_node_cache,
+						  gfpflags, node);
+			if (!n) {
+				free_kmem_cache_nodes(s);
+				return 0;
+			}
+		}
+		init_kmem_cache_node(n);
+		s->node[node] = n;
+	}
+	return 1;
+}
+
+static int kmem_cache_open(struct kmem_cache *s, gfp_t gfpflags,
+		const char *name, size_t size, size_t align,
+		unsigned long flags,
+		void (*ctor)(void *, kmem_cache_t *, unsigned long),
+		void (*dtor)(void *, kmem_cache_t *, unsigned long))
+{
+	memset(s, 0, sizeof(*s));
+	s->name = name;
+	s->ctor = ctor;
+	s->dtor = dtor;
+	s->objsize = size;
+	s->align = align;
+	s->flags = flags;
+	if (flags & SLAB_CACHE_DMA)
+		s->gfpflags = GFP_DMA;
+
+	if (!calculate_sizes(s))
+		return 0;
+	return init_kmem_cache_nodes(s, gfpflags);
+}
+
+/**
+ * kmem_cache_create - Create a cache.
+ * @name: A string which is used in /proc/slabinfo to identify this cache.
+ * @size: The size of objects to be created in this cache.
+ * @align: The required alignment for the objects.
+ * @flags: SLAB flags
+ * @ctor: A constructor for the objects.
+ * @dtor: A destructor for the objects.
+ *
+ * Returns a ptr to the cache on success, NULL on failure.
+ * Cannot be called within a int, but can be interrupted.
+ * The @ctor is run when new pages are allocated by the cache
+ * and the @dtor is run before the pages are handed back.
+ *
+ * @name must be valid until the cache is destroyed. This implies that
+ * the module calling this has to destroy the cache before getting
+ * unloaded.
+ *
+ * The debug flags (%SLAB_POISON, %SLAB_RED_ZONE, ...) are accepted
+ * but ignored. %SLAB_NO_REAP is meaningless: nothing is ever reaped.
+ */
+kmem_cache_t *
+kmem_cache_create (const char *name, size_t size, size_t align,
+	unsigned long flags, void (*ctor)(void*, kmem_cache_t *, unsigned long),
+	void (*dtor)(void*, kmem_cache_t *, unsigned long))
+{
+	struct kmem_cache *s;
+
+	if (!name || in_interrupt() || size < sizeof(void *) ||
+	    (dtor && !ctor) || (flags & ~CREATE_MASK)) {
+		printk(KERN_ERR "%s: Early error in slab %s\n",
+		       __FUNCTION__, name);
+		BUG();
+	}
+	if (flags & SLAB_DESTROY_BY_RCU)
+		BUG_ON(dtor);
+
+	down(&slub_sem);
+	list_for_each_entry(s, &slab_caches, next) {
+		if (!strcmp(s->name, name)) {
+			printk("kmem_cache_create: duplicate cache %s\n", name);
+			dump_stack();
+			s = NULL;
+			goto out;
+		}
+	}
+
+	s = kmem_cache_alloc(&kmem_cache_cache, GFP_KERNEL);
+	if (s) {
+		if (kmem_cache_open(s, GFP_KERNEL, name, size, align, flags,
+				    ctor, dtor))
+			list_add(&s->next, &slab_caches);
+		else {
+			kmem_cache_free(&kmem_cache_cache, s);
+			s = NULL;
+		}
+	}
+out:
+	up(&slub_sem);
+	if (!s && (flags & SLAB_PANIC))
+		panic("kmem_cache_create(): failed to create slab `%s'\n", name);
+	return s;
+}
+EXPORT_SYMBOL(kmem_cache_create);
+
+/*
+ * Give all empty slabs on the partial lists back to the page allocator.
+ * Returns the number of slabs still in use.
+ */
+static unsigned long __kmem_cache_shrink(struct kmem_cache *s)
+{
+	unsigned long slabs = 0;
+	int node;
+
+	flush_all(s);
+
+	for_each_online_node(node) {
+		struct kmem_cache_node *n = s->node[node];
+		struct page *page, *t;
+		unsigned long flags;
+		LIST_HEAD(empty);
+
+		if (!n)
+			continue;
+
+		spin_lock_irqsave(&n->list_lock, flags);
+		list_for_each_entry_safe(page, t, &n->partial, lru)
+			if (!page->inuse && slab_trylock(page)) {
+				list_move(&page->lru, &empty);
+				n->nr_partial--;
+				slab_unlock(page);
+			}
+		spin_unlock_irqrestore(&n->list_lock, flags);
+
+		list_for_each_entry_safe(page, t, &empty, lru) {
+			list_del(&page->lru);
+			discard_slab(s, page);
+		}
+		slabs += atomic_long_read(&n->nr_slabs);
+	}
+	return slabs;
+}
+
+/**
+ * kmem_cache_shrink - Shrink a cache.
+ * @cachep: The cache to shrink.
+ *
+ * Releases as many slabs as possible for a cache.
+ * To help debugging, a zero exit status indicates all slabs were released.
+ */
+int kmem_cache_shrink(kmem_cache_t *cachep)
+{
+	if (!cachep || in_interrupt())
+		BUG();
+
+	return __kmem_cache_shrink(cachep) != 0;
+}
+EXPORT_SYMBOL(kmem_cache_shrink);
+
+/**
+ * kmem_cache_destroy - delete a cache
+ * @cachep: the cache to destroy
+ *
+ * Remove a kmem_cache_t object from the slab cache.
+ * Returns 0 on success.
+ *
+ * The cache must be empty before calling this function.
+ *
+ * The caller must guarantee that noone will allocate memory from the cache
+ * during the kmem_cache_destroy().
+ */
+int kmem_cache_destroy(kmem_cache_t *cachep)
+{
+	if (!cachep || in_interrupt())
+		BUG();
+
+	down(&slub_sem);
+	list_del(&cachep->next);
+	up(&slub_sem);
+
+	if (__kmem_cache_shrink(cachep)) {
+		printk(KERN_ERR "slab error in %s(): cache `%s': "
+		       "Can't free all objects\n", __FUNCTION__, cachep->name);
+		dump_stack();
+		down(&slub_sem);
+		list_add(&cachep->next, &slab_caches);
+		up(&slub_sem);
+		return 1;
+	}
+
+	if (unlikely(cachep->flags & SLAB_DESTROY_BY_RCU))
+		synchronize_rcu();
+
+	free_kmem_cache_nodes(cachep);
+	kmem_cache_free(&kmem_cache_cache, cachep);
+	return 0;
+}
+EXPORT_SYMBOL(kmem_cache_destroy);
+
+unsigned int kmem_cache_size(kmem_cache_t *cachep)
+{
+	return cachep->objsize;
+}
+EXPORT_SYMBOL(kmem_cache_size);
+
+const char *kmem_cache_name(kmem_cache_t *cachep)
+{
+	return cachep->name;
+}
+EXPORT_SYMBOL_GPL(kmem_cache_name);
+
+/*
+ * The general caches, used by kmalloc().
+ */
+struct cache_sizes malloc_sizes[] = {
+#define CACHE(x) { .cs_size = (x) },
+#include <linux/kmalloc_sizes.h>
+	CACHE(ULONG_MAX)
+#undef CACHE
+};
+EXPORT_SYMBOL(malloc_sizes);
+
+/* Must match cache_sizes above. */
+static struct {
+	char *name;
+	char *name_dma;
+} cache_names[] __initdata = {
+#define CACHE(x) { .name = "size-" #x, .name_dma = "size-" #x "(DMA)" },
+#include <linux/kmalloc_sizes.h>
+	{NULL,}
+#undef CACHE
+};
+
+static inline kmem_cache_t *__find_general_cachep(size_t size, gfp_t gfpflags)
+{
+	struct cache_sizes *csizep = malloc_sizes;
+
+	while (size > csizep->cs_size)
+		csizep++;
+
+	/*
+	 * The last entry with cs->cs_size==ULONG_MAX has
+	 * cs_{dma,}cachep==NULL, so large kmalloc calls fail here.
+	 */
+	if (unlikely(gfpflags & GFP_DMA))
+		return csizep->cs_dmacachep;
+	return csizep->cs_cachep;
+}
+
+kmem_cache_t *kmem_find_general_cachep(size_t size, gfp_t gfpflags)
+{
+	return __find_general_cachep(size, gfpflags);
+}
+EXPORT_SYMBOL(kmem_find_general_cachep);
+
+void *__kmalloc(size_t size, gfp_t flags)
+{
+	kmem_cache_t *cachep = __find_general_cachep(size, flags);
+
+	if (unlikely(cachep == NULL))
+		return NULL;
+	return slab_alloc(cachep, flags, -1);
+}
+EXPORT_SYMBOL(__kmalloc);
+
+#ifdef CONFIG_NUMA
+void *kmalloc_node(size_t size, gfp_t flags, int node)
+{
+	kmem_cache_t *cachep = __find_general_cachep(size, flags);
+
+	if (unlikely(cachep == NULL))
+		return NULL;
+	return kmem_cache_alloc_node(cachep, flags, node);
+}
+EXPORT_SYMBOL(kmalloc_node);
+#endif
+
+/**
+ * kfree - free previously allocated memory
+ * @objp: pointer returned by kmalloc.
+ *
+ * If @objp is NULL, no operation is performed.
+ *
+ * Don't free memory not originally allocated by kmalloc()
+ * or you will run into trouble.
+ */
+void kfree(const void *objp)
+{
+	struct kmem_cache *s;
+
+	if (unlikely(!objp))
+		return;
+	s = virt_to_page(objp)->slab;
+	mutex_debug_check_no_locks_freed(objp, s->objsize);
+	slab_free(s, virt_to_slab(s, objp), (void *)objp);
+}
+EXPORT_SYMBOL(kfree);
+
+/**
+ * ksize - get the actual amount of memory allocated for a given object
+ * @objp: Pointer to the object
+ *
+ * kmalloc may internally round up allocations and return more memory
+ * than requested. ksize() can be used to determine the actual amount of
+ * memory allocated. The caller must guarantee that objp points to a valid
+ * object previously allocated with either kmalloc() or kmem_cache_alloc().
+ */
+unsigned int ksize(const void *objp)
+{
+	if (unlikely(objp == NULL))
+		return 0;
+
+	return virt_to_page(objp)->slab->objsize;
+}
+
+#ifdef CONFIG_SMP
+/**
+ * __alloc_percpu - allocate one copy of the object for every present
+ * cpu in the system, zeroing them.
+ * Objects should be dereferenced using the per_cpu_ptr macro only.
+ *
+ * @size: how many bytes of memory are required.
+ */
+void *__alloc_percpu(size_t size)
+{
+	int i;
+	struct percpu_data *pdata = kmalloc(sizeof(*pdata), GFP_KERNEL);
+
+	if (!pdata)
+		return NULL;
+
+	for_each_cpu(i) {
+		int node = cpu_to_node(i);
+
+		if (node_online(node))
+			pdata->ptrs[i] = kmalloc_node(size, GFP_KERNEL, node);
+		else
+			pdata->ptrs[i] = kmalloc(size, GFP_KERNEL);
+
+		if (!pdata->ptrs[i])
+			goto unwind_oom;
+		memset(pdata->ptrs[i], 0, size);
+	}
+
+	/* Catch derefs w/o wrappers */
+	return (void *)(~(unsigned long)pdata);
+
+unwind_oom:
+	while (--i >= 0) {
+		if (!cpu_possible(i))
+			continue;
+		kfree(pdata->ptrs[i]);
+	}
+	kfree(pdata);
+	return NULL;
+}
+EXPORT_SYMBOL(__alloc_percpu);
+
+/**
+ * free_percpu - free previously allocated percpu memory
+ * @objp: pointer returned by alloc_percpu.
+ *
+ * Don't free memory not originally allocated by alloc_percpu()
+ * The complemented objp is to check for that.
+ */
+void free_percpu(const void *objp)
+{
+	int i;
+	struct percpu_data *p = (struct percpu_data *)(~(unsigned long)objp);
+
+	for_each_cpu(i)
+		kfree(p->ptrs[i]);
+	kfree(p);
+}
+EXPORT_SYMBOL(free_percpu);
+#endif
+
+#ifdef CONFIG_HOTPLUG_CPU
+/*
+ * A dead cpu's active slabs would otherwise stay frozen forever.
+ */
+static int __devinit slab_cpuup_callback(struct notifier_block *nfb,
+					 unsigned long action, void *hcpu)
+{
+	long cpu = (long)hcpu;
+	struct kmem_cache *s;
+	unsigned long flags;
+
+	switch (action) {
+	case CPU_UP_CANCELED:
+	case CPU_DEAD:
+		down(&slub_sem);
+		list_for_each_entry(s, &slab_caches, next) {
+			local_irq_save(flags);
+			__flush_cpu_slab(s, cpu);
+			local_irq_restore(flags);
+		}
+		up(&slub_sem);
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block __devinitdata slab_notifier =
+	{ &slab_cpuup_callback, NULL, 0 };
+#endif
+
+void __init kmem_cache_init(void)
+{
+	struct cache_sizes *sizes = malloc_sizes;
+	int i;
+
+	/*
+	 * Bootstrap: the kmem_cache_node cache gets static node structures,
+	 * then the kmem_cache cache can take its node structures from it.
+	 * Both cache descriptors are static.
+	 */
+	if (!kmem_cache_open(&kmem_node_cache, GFP_KERNEL, "kmem_cache_node",
+			     sizeof(struct kmem_cache_node), 0,
+			     SLAB_HWCACHE_ALIGN, NULL, NULL) ||
+	    !kmem_cache_open(&kmem_cache_cache, GFP_KERNEL, "kmem_cache",
+			     sizeof(struct kmem_cache), 0,
+			     SLAB_HWCACHE_ALIGN, NULL, NULL))
+		panic("kmem_cache_init(): cannot create bootstrap caches\n");
+	list_add(&kmem_node_cache.next, &slab_caches);
+	list_add(&kmem_cache_cache.next, &slab_caches);
+
+	for (i = 0; sizes[i].cs_size != ULONG_MAX; i++) {
+		sizes[i].cs_cachep = kmem_cache_create(cache_names[i].name,
+					sizes[i].cs_size,
+					ARCH_KMALLOC_MINALIGN,
+					ARCH_KMALLOC_FLAGS | SLAB_PANIC,
+					NULL, NULL);
+		sizes[i].cs_dmacachep = kmem_cache_create(
+					cache_names[i].name_dma,
+					sizes[i].cs_size,
+					ARCH_KMALLOC_MINALIGN,
+					ARCH_KMALLOC_FLAGS | SLAB_CACHE_DMA |
+					SLAB_PANIC,
+					NULL, NULL);
+	}
+
+#ifdef CONFIG_HOTPLUG_CPU
+	register_cpu_notifier(&slab_notifier);
+#endif
+}
+
+#ifdef CONFIG_PROC_FS
+
+static void print_slabinfo_header(struct seq_file *m)
+{
+	seq_puts(m, "slabinfo - version: 2.1\n");
+	seq_puts(m, "# name            <active_objs> <num_objs> <objsize> "
+		 "<objperslab> <pagesperslab>");
+	seq_puts(m, " : tunables <limit> <batchcount> <sharedfactor>");
+	seq_puts(m, " : slabdata <active_slabs> <num_slabs> <sharedavail>");
+	seq_putc(m, '\n');
+}
+
+static void *s_start(struct seq_file *m, loff_t *pos)
+{
+	loff_t n = *pos;
+	struct list_head *p;
+
+	down(&slub_sem);
+	if (!n)
+		print_slabinfo_header(m);
+	p = slab_caches.next;
+	while (n--) {
+		p = p->next;
+		if (p == &slab_caches)
+			return NULL;
+	}
+	return list_entry(p, struct kmem_cache, next);
+}
+
+static void *s_next(struct seq_file *m, void *p, loff_t *pos)
+{
+	struct kmem_cache *s = p;
+
+	++*pos;
+	return s->next.next == &slab_caches ? NULL
+	    : list_entry(s->next.next, struct kmem_cache, next);
+}
+
+static void s_stop(struct seq_file *m, void *p)
+{
+	up(&slub_sem);
+}
+
+/*
+ * Free objects are counted on the partial lists and in the active
+ * slabs. The numbers are racy, which is fine for statistics.
+ */
+static int s_show(struct seq_file *m, void *p)
+{
+	struct kmem_cache *s = p;
+	unsigned long nr_slabs = 0, nr_empty = 0, nr_free = 0;
+	int node, cpu;
+
+	for_each_online_node(node) {
+		struct kmem_cache_node *n = s->node[node];
+		struct page *page;
+		unsigned long flags;
+
+		if (!n)
+			continue;
+		nr_slabs += atomic_long_read(&n->nr_slabs);
+		spin_lock_irqsave(&n->list_lock, flags);
+		list_for_each_entry(page, &n->partial, lru) {
+			nr_free += s->objects - page->inuse;
+			if (!page->inuse)
+				nr_empty++;
+		}
+		spin_unlock_irqrestore(&n->list_lock, flags);
+	}
+	for_each_online_cpu(cpu) {
+		struct page *page = s->cpu_slab[cpu];
+
+		if (page)
+			nr_free += s->objects - page->inuse;
+	}
+
+	seq_printf(m, "%-17s %6lu %6lu %6u %4u %4d",
+		   s->name, nr_slabs * s->objects - nr_free,
+		   nr_slabs * s->objects, s->size, s->objects,
+		   (1 << s->order));
+	seq_printf(m, " : tunables %4u %4u %4u", 0, 0, 0);
+	seq_printf(m, " : slabdata %6lu %6lu %6u", nr_slabs - nr_empty,
+		   nr_slabs, 0);
+	seq_putc(m, '\n');
+	return 0;
+}
+
+/*
+ * slabinfo_op - iterator that generates /proc/slabinfo
+ *
+ * The layout is that of the SLAB allocator, with the tunables and
+ * the shared counts reported as zero.
+ */
+struct seq_operations slabinfo_op = {
+	.start = s_start,
+	.next = s_next,
+	.stop = s_stop,
+	.show = s_show,
+};
+
+/*
+ * There are no per-cpu queues to tune.
+ */
+ssize_t slabinfo_write(struct file *file, const char __user * buffer,
+		       size_t count, loff_t *ppos)
+{
+	return -EINVAL;
+}
+#endif
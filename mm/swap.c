@@ -75,16 +75,15 @@ int rotate_reclaimable_page(struct page *page)
 		return 1;
 	if (PageDirty(page))
 		return 1;
-	if (PageActive(page))
+	if (PageActive(page) || PageUnevictable(page))
 		return 1;
 	if (!PageLRU(page))
 		return 1;
 
 	zone = page_zone(page);
 	spin_lock_irqsave(&zone->lru_lock, flags);
-	if (PageLRU(page) && !PageActive(page)) {
-		list_del(&page->lru);
-		list_add_tail(&page->lru, &zone->inactive_list);
+	if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
+		list_move_tail(&page->lru, &zone->lru[page_lru(page)].list);
 		inc_page_state(pgrotated);
 	}
 	if (!test_clear_page_writeback(page))
@@ -101,11 +100,17 @@ void fastcall activate_page(struct page *page)
 	struct zone *zone = page_zone(page);
 
 	spin_lock_irq(&zone->lru_lock);
-	if (PageLRU(page) && !PageActive(page)) {
-		del_page_from_inactive_list(zone, page);
+	if (PageLRU(page) && !PageActive(page) && !PageUnevictable(page)) {
+		int file = page_is_file_cache(page);
+		int lru = LRU_BASE + file;
+
+		del_page_from_lru_list(zone, page, lru);
 		SetPageActive(page);
-		add_page_to_active_list(zone, page);
+		add_page_to_lru_list(zone, page, lru + LRU_ACTIVE);
 		inc_page_state(pgactivate);
+
+		zone->recent_rotated[!!file]++;
+		zone->recent_scanned[!!file]++;
 	}
 	spin_unlock_irq(&zone->lru_lock);
 }
@@ -119,7 +124,8 @@ void fastcall activate_page(struct page *page)
  */
 void fastcall mark_page_accessed(struct page *page)
 {
-	if (!PageActive(page) && PageReferenced(page) && PageLRU(page)) {
+	if (!PageActive(page) && !PageUnevictable(page) &&
+			PageReferenced(page) && PageLRU(page)) {
 		activate_page(page);
 		ClearPageReferenced(page);
 	} else if (!PageReferenced(page)) {
@@ -132,6 +138,9 @@ EXPORT_SYMBOL(mark_page_accessed);
 /**
  * lru_cache_add: add a page to the page lists
  * @page: the page to add
+ *
+ * The page goes on the anon or the file list according to PageSwapBacked,
+ * which must already be set up.
  */
 static DEFINE_PER_CPU(struct pagevec, lru_add_pvecs) = { 0, };
 static DEFINE_PER_CPU(struct pagevec, lru_add_active_pvecs) = { 0, };
@@ -156,6 +165,43 @@ void fastcall lru_cache_add_active(struct page *page)
 	put_cpu_var(lru_add_active_pvecs);
 }
 
+/**
+ * lru_cache_add_active_or_unevictable
+ * @page: the page to be added to the LRU
+ * @vma: vma in which the page is mapped, for determining reclaimability
+ *
+ * Place a newly faulted page on the active list, or straight onto the
+ * unevictable list if the vma is mlocked.
+ */
+void lru_cache_add_active_or_unevictable(struct page *page,
+					 struct vm_area_struct *vma)
+{
+	if (page_evictable(page, vma))
+		lru_cache_add_active(page);
+	else
+		add_page_to_unevictable_list(page);
+}
+
+/**
+ * add_page_to_unevictable_list - add a page to the unevictable list
+ * @page: the page to be added
+ *
+ * This bypasses the per-cpu pagevecs so that PG_unevictable is visible
+ * at once to anybody trying to rescue the page, see mm/mlock.c.
+ */
+void add_page_to_unevictable_list(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	spin_lock_irq(&zone->lru_lock);
+	BUG_ON(PageActive(page));
+	SetPageUnevictable(page);
+	if (TestSetPageLRU(page))
+		BUG();
+	add_page_to_lru_list(zone, page, LRU_UNEVICTABLE);
+	spin_unlock_irq(&zone->lru_lock);
+}
+
 static void __lru_add_drain(int cpu)
 {
 	struct pagevec *pvec = &per_cpu(lru_add_pvecs, cpu);
@@ -203,9 +249,10 @@ EXPORT_SYMBOL(__page_cache_release);
  * Avoid taking zone->lru_lock if possible, but if it is taken, retain it
  * for the remainder of the operation.
  *
- * The locking in this function is against shrink_cache(): we recheck the
- * page count inside the lock to see whether shrink_cache grabbed the page
- * via the LRU.  If it did, give up: shrink_cache will free it.
+ * The locking in this function is against shrink_inactive_list(): we recheck
+ * the page count inside the lock to see whether shrink_inactive_list grabbed
+ * the page via the LRU.  If it did, give up: shrink_inactive_list will free
+ * it.
  */
 void release_pages(struct page **pages, int nr, int cold)
 {
@@ -218,6 +265,15 @@ void release_pages(struct page **pages, int nr, int cold)
 		struct page *page = pages[i];
 		struct zone *pagezone;
 
+		if (unlikely(PageCompound(page))) {
+			if (zone) {
+				spin_unlock_irq(&zone->lru_lock);
+				zone = NULL;
+			}
+			put_page(page);
+			continue;
+		}
+
 		if (!put_page_testzero(page))
 			continue;
 
@@ -287,10 +343,14 @@ void __pagevec_release_nonlru(struct pagevec *pvec)
 }
 
 /*
- * Add the passed pages to the LRU, then drop the caller's refcount
- * on them.  Reinitialises the caller's pagevec.
+ * Add the passed pages to the anon or file LRU lists, then drop the
+ * caller's refcount on them.  Reinitialises the caller's pagevec.
+ *
+ * Every page added counts as scanned for the balancing in get_scan_ratio(),
+ * and every page added straight to the active list as rotated: the
+ * latter are pages faulted back in, which reclaim should not have let go.
  */
-void __pagevec_lru_add(struct pagevec *pvec)
+static void ____pagevec_lru_add(struct pagevec *pvec, int active)
 {
 	int i;
 	struct zone *zone = NULL;
@@ -298,6 +358,7 @@ void __pagevec_lru_add(struct pagevec *pvec)
 	for (i = 0; i < pagevec_count(pvec); i++) {
 		struct page *page = pvec->pages[i];
 		struct zone *pagezone = page_zone(page);
+		int file;
 
 		if (pagezone != zone) {
 			if (zone)
@@ -307,7 +368,14 @@ void __pagevec_lru_add(struct pagevec *pvec)
 		}
 		if (TestSetPageLRU(page))
 			BUG();
-		add_page_to_inactive_list(zone, page);
+		file = page_is_file_cache(page);
+		zone->recent_scanned[!!file]++;
+		if (active) {
+			if (TestSetPageActive(page))
+				BUG();
+			zone->recent_rotated[!!file]++;
+		}
+		add_page_to_lru_list(zone, page, LRU_BASE + file + active);
 	}
 	if (zone)
 		spin_unlock_irq(&zone->lru_lock);
@@ -315,33 +383,16 @@ void __pagevec_lru_add(struct pagevec *pvec)
 	pagevec_reinit(pvec);
 }
 
+void __pagevec_lru_add(struct pagevec *pvec)
+{
+	____pagevec_lru_add(pvec, 0);
+}
+
 EXPORT_SYMBOL(__pagevec_lru_add);
 
 void __pagevec_lru_add_active(struct pagevec *pvec)
 {
-	int i;
-	struct zone *zone = NULL;
-
-	for (i = 0; i < pagevec_count(pvec); i++) {
-		struct page *page = pvec->pages[i];
-		struct zone *pagezone = page_zone(page);
-
-		if (pagezone != zone) {
-			if (zone)
-				spin_unlock_irq(&zone->lru_lock);
-			zone = pagezone;
-			spin_lock_irq(&zone->lru_lock);
-		}
-		if (TestSetPageLRU(page))
-			BUG();
-		if (TestSetPageActive(page))
-			BUG();
-		add_page_to_active_list(zone, page);
-	}
-	if (zone)
-		spin_unlock_irq(&zone->lru_lock);
-	release_pages(pvec->pages, pvec->nr, pvec->cold);
-	pagevec_reinit(pvec);
+	____pagevec_lru_add(pvec, LRU_ACTIVE);
 }
 
 /*
@@ -76,19 +76,33 @@ static int __add_to_swap_cache(struct page *page, swp_entry_t entry,
 	BUG_ON(PagePrivate(page));
 	error = radix_tree_preload(gfp_mask);
 	if (!error) {
+		/*
+		 * Set the page up before lockless lookups can see it,
+		 * as in add_to_page_cache.
+		 */
+		int was_locked = TestSetPageLocked(page);
+
+		page_cache_get(page);
+		SetPageSwapCache(page);
+		set_page_private(page, entry.val);
+
 		write_lock_irq(&swapper_space.tree_lock);
 		error = radix_tree_insert(&swapper_space.page_tree,
 						entry.val, page);
 		if (!error) {
-			page_cache_get(page);
-			SetPageLocked(page);
-			SetPageSwapCache(page);
-			set_page_private(page, entry.val);
 			total_swapcache_pages++;
 			pagecache_acct(1);
 		}
 		write_unlock_irq(&swapper_space.tree_lock);
 		radix_tree_preload_end();
+
+		if (unlikely(error)) {
+			set_page_private(page, 0UL);
+			ClearPageSwapCache(page);
+			if (!was_locked)
+				ClearPageLocked(page);
+			page_cache_release(page);
+		}
 	}
 	return error;
 }
@@ -333,7 +347,7 @@ struct page *read_swap_cache_async(swp_entry_t entry,
 		 * Get a new page to read into from swap.
 		 */
 		if (!new_page) {
-			new_page = alloc_page_vma(GFP_HIGHUSER, vma, addr);
+			new_page = alloc_page_vma(GFP_HIGHUSER_MOVABLE, vma, addr);
 			if (!new_page)
 				break;		/* Out of memory */
 		}
@@ -348,6 +362,7 @@ struct page *read_swap_cache_async(swp_entry_t entry,
 		 * the just freed swap entry for an existing page.
 		 * May fail (-ENOMEM) if radix-tree node allocation failed.
 		 */
+		SetPageSwapBacked(new_page);
 		err = add_to_swap_cache(new_page, entry);
 		if (!err) {
 			/*
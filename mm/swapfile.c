@@ -27,6 +27,9 @@
 #include <linux/backing-dev.h>
 #include <linux/capability.h>
 #include <linux/syscalls.h>
+#include <linux/mutex.h>
+#include <linux/notifier.h>
+#include <linux/cpu.h>
 
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -171,17 +174,24 @@ no_page:
 	return 0;
 }
 
-swp_entry_t get_swap_page(void)
+/*
+ * Allocate up to @nr swap slots into @slots, all from the same area while
+ * it has room, and return how many there were.
+ */
+static int get_swap_pages(int nr, swp_entry_t *slots)
 {
 	struct swap_info_struct *si;
 	pgoff_t offset;
 	int type, next;
 	int wrapped = 0;
+	int n = 0;
 
 	spin_lock(&swap_lock);
 	if (nr_swap_pages <= 0)
 		goto noswap;
-	nr_swap_pages--;
+	if (nr > nr_swap_pages)
+		nr = nr_swap_pages;
+	nr_swap_pages -= nr;
 
 	for (type = swap_list.next; type >= 0 && wrapped < 2; type = next) {
 		si = swap_info + type;
@@ -198,18 +208,17 @@ swp_entry_t get_swap_page(void)
 			continue;
 
 		swap_list.next = next;
-		offset = scan_swap_map(si);
-		if (offset) {
-			spin_unlock(&swap_lock);
-			return swp_entry(type, offset);
-		}
+		while (n < nr && (offset = scan_swap_map(si)))
+			slots[n++] = swp_entry(type, offset);
+		if (n == nr)
+			break;
 		next = swap_list.next;
 	}
 
-	nr_swap_pages++;
+	nr_swap_pages += nr - n;
 noswap:
 	spin_unlock(&swap_lock);
-	return (swp_entry_t) {0};
+	return n;
 }
 
 swp_entry_t get_swap_page_of_type(int type)
@@ -232,7 +241,7 @@ swp_entry_t get_swap_page_of_type(int type)
 	return (swp_entry_t) {0};
 }
 
-static struct swap_info_struct * swap_info_get(swp_entry_t entry)
+static struct swap_info_struct * __swap_info_get(swp_entry_t entry)
 {
 	struct swap_info_struct * p;
 	unsigned long offset, type;
@@ -250,7 +259,6 @@ static struct swap_info_struct * swap_info_get(swp_entry_t entry)
 		goto bad_offset;
 	if (!p->swap_map[offset])
 		goto bad_free;
-	spin_lock(&swap_lock);
 	return p;
 
 bad_free:
@@ -268,6 +276,16 @@ out:
 	return NULL;
 }	
 
+static struct swap_info_struct * swap_info_get(swp_entry_t entry)
+{
+	struct swap_info_struct * p;
+
+	p = __swap_info_get(entry);
+	if (p)
+		spin_lock(&swap_lock);
+	return p;
+}
+
 static int swap_entry_free(struct swap_info_struct *p, unsigned long offset)
 {
 	int count = p->swap_map[offset];
@@ -368,9 +386,10 @@ int remove_exclusive_swap_page(struct page *page)
 	if (p->swap_map[swp_offset(entry)] == 1) {
 		/* Recheck the page count with the swapcache lock held.. */
 		write_lock_irq(&swapper_space.tree_lock);
-		if ((page_count(page) == 2) && !PageWriteback(page)) {
+		if (!PageWriteback(page) && page_freeze_refs(page, 2)) {
 			__delete_from_swap_cache(page);
 			SetPageDirty(page);
+			page_unfreeze_refs(page, 2);
 			retval = 1;
 		}
 		write_unlock_irq(&swapper_space.tree_lock);
@@ -385,6 +404,147 @@ int remove_exclusive_swap_page(struct page *page)
 	return retval;
 }
 
+/*
+ * @page, locked by the caller, is in the swap cache for an entry nothing
+ * else refers to any more.  Free it if the swap cache is its only user.
+ */
+static void free_swap_cache_page(struct page *page)
+{
+	int one_user;
+
+	BUG_ON(PagePrivate(page));
+	page_cache_get(page);
+	one_user = (page_count(page) == 2);
+	/* Only cache user (+us), or swap space full? Free it! */
+	if (!PageWriteback(page) && (one_user || vm_swap_full())) {
+		delete_from_swap_cache(page);
+		SetPageDirty(page);
+	}
+	unlock_page(page);
+	page_cache_release(page);
+}
+
+/*
+ * Swap slots are allocated through a small per-cpu cache, and the frees
+ * of free_swap_and_cache() are queued on one, so that swapping out and
+ * unmapping swapped out memory mostly take a per-cpu lock instead of
+ * swap_lock.  A CPU refills its cache with SWAP_SLOTS_BATCH slots at a
+ * time, which scan_swap_map() hands out as a run of the cluster: each
+ * CPU writes out to its own stretch of swap, rather than all reclaiming
+ * CPUs interleaving their pages in the shared cluster.
+ *
+ * Slots in a cache are still in use as far as swap_map is concerned, and
+ * queued frees are not done yet: swapoff drains all the caches once the
+ * area is no longer WRITEOK, and so does an allocation failing for want
+ * of free slots.  When swap is nearly full, the caches are bypassed.
+ */
+#define SWAP_SLOTS_BATCH	64
+
+struct swap_slots_cache {
+	struct mutex alloc_lock;
+	int cur;			/* next slot to hand out */
+	int nr;				/* slots in slots[] */
+	swp_entry_t slots[SWAP_SLOTS_BATCH];
+
+	spinlock_t free_lock;
+	int nr_free;			/* entries queued in free[] */
+	swp_entry_t free[SWAP_SLOTS_BATCH];
+	struct page *pages[SWAP_SLOTS_BATCH];	/* used to flush free[] */
+};
+
+static DEFINE_PER_CPU(struct swap_slots_cache, swap_slots);
+
+static inline int swap_slots_enabled(void)
+{
+	return nr_swap_pages > num_online_cpus() * SWAP_SLOTS_BATCH * 2;
+}
+
+/*
+ * Do the frees queued on @cache, taking swap_lock once for all of them.
+ * Called with cache->free_lock held.
+ */
+static void flush_free_slots(struct swap_slots_cache *cache)
+{
+	int i, nr_pages = 0;
+
+	spin_lock(&swap_lock);
+	for (i = 0; i < cache->nr_free; i++) {
+		swp_entry_t entry = cache->free[i];
+		struct swap_info_struct *p = __swap_info_get(entry);
+		struct page *page;
+
+		if (!p || swap_entry_free(p, swp_offset(entry)) != 1)
+			continue;
+		page = find_trylock_page(&swapper_space, entry.val);
+		if (page)
+			cache->pages[nr_pages++] = page;
+	}
+	spin_unlock(&swap_lock);
+	cache->nr_free = 0;
+
+	for (i = 0; i < nr_pages; i++)
+		free_swap_cache_page(cache->pages[i]);
+}
+
+/* Give back the slots cached by @cpu and do its queued frees */
+static void drain_swap_slots_cpu(int cpu)
+{
+	struct swap_slots_cache *cache = &per_cpu(swap_slots, cpu);
+
+	mutex_lock(&cache->alloc_lock);
+	if (cache->cur < cache->nr) {
+		spin_lock(&swap_lock);
+		for (; cache->cur < cache->nr; cache->cur++) {
+			swp_entry_t entry = cache->slots[cache->cur];
+
+			swap_entry_free(swap_info + swp_type(entry),
+					swp_offset(entry));
+		}
+		spin_unlock(&swap_lock);
+	}
+	cache->cur = cache->nr = 0;
+	mutex_unlock(&cache->alloc_lock);
+
+	spin_lock(&cache->free_lock);
+	flush_free_slots(cache);
+	spin_unlock(&cache->free_lock);
+}
+
+static void drain_swap_slots(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu)
+		drain_swap_slots_cpu(cpu);
+}
+
+swp_entry_t get_swap_page(void)
+{
+	struct swap_slots_cache *cache;
+	swp_entry_t entry = { 0 };
+
+	if (!swap_slots_enabled()) {
+		/* The free slots may all be sitting in caches */
+		if (!get_swap_pages(1, &entry)) {
+			drain_swap_slots();
+			get_swap_pages(1, &entry);
+		}
+		return entry;
+	}
+
+	/* Being moved to another CPU meanwhile does no harm */
+	cache = &per_cpu(swap_slots, raw_smp_processor_id());
+	mutex_lock(&cache->alloc_lock);
+	if (cache->cur == cache->nr) {
+		cache->cur = 0;
+		cache->nr = get_swap_pages(SWAP_SLOTS_BATCH, cache->slots);
+	}
+	if (cache->cur < cache->nr)
+		entry = cache->slots[cache->cur++];
+	mutex_unlock(&cache->alloc_lock);
+	return entry;
+}
+
 /*
  * Free the swap entry like above, but also try to
  * free the page cache entry if it is the last user.
@@ -392,29 +552,67 @@ int remove_exclusive_swap_page(struct page *page)
 void free_swap_and_cache(swp_entry_t entry)
 {
 	struct swap_info_struct * p;
+	struct swap_slots_cache *cache;
+	unsigned long type = swp_type(entry);
 	struct page *page = NULL;
 
+	/*
+	 * Queue the free, unless swapoff is emptying the area: that needs
+	 * its entries freed as they go, and drains the caches after
+	 * clearing SWP_WRITEOK, which free_lock orders against.
+	 */
+	if (entry.val && type < nr_swapfiles) {
+		int queued = 0;
+
+		cache = &get_cpu_var(swap_slots);
+		spin_lock(&cache->free_lock);
+		if (swap_info[type].flags & SWP_WRITEOK) {
+			cache->free[cache->nr_free++] = entry;
+			if (cache->nr_free == SWAP_SLOTS_BATCH)
+				flush_free_slots(cache);
+			queued = 1;
+		}
+		spin_unlock(&cache->free_lock);
+		put_cpu_var(swap_slots);
+		if (queued)
+			return;
+	}
+
 	p = swap_info_get(entry);
 	if (p) {
 		if (swap_entry_free(p, swp_offset(entry)) == 1)
 			page = find_trylock_page(&swapper_space, entry.val);
 		spin_unlock(&swap_lock);
 	}
-	if (page) {
-		int one_user;
-
-		BUG_ON(PagePrivate(page));
-		page_cache_get(page);
-		one_user = (page_count(page) == 2);
-		/* Only cache user (+us), or swap space full? Free it! */
-		if (!PageWriteback(page) && (one_user || vm_swap_full())) {
-			delete_from_swap_cache(page);
-			SetPageDirty(page);
-		}
-		unlock_page(page);
-		page_cache_release(page);
+	if (page)
+		free_swap_cache_page(page);
+}
+
+#ifdef CONFIG_HOTPLUG_CPU
+static int swap_slots_cpu_callback(struct notifier_block *nfb,
+				   unsigned long action,
+				   void *hcpu)
+{
+	if (action == CPU_DEAD)
+		drain_swap_slots_cpu((long)hcpu);
+	return NOTIFY_OK;
+}
+#endif
+
+static int __init swap_slots_init(void)
+{
+	int cpu;
+
+	for_each_cpu(cpu) {
+		struct swap_slots_cache *cache = &per_cpu(swap_slots, cpu);
+
+		mutex_init(&cache->alloc_lock);
+		spin_lock_init(&cache->free_lock);
 	}
+	hotcpu_notifier(swap_slots_cpu_callback, 0);
+	return 0;
 }
+__initcall(swap_slots_init);
 
 /*
  * No need to decide whether this PTE shares the swap entry with others,
@@ -472,6 +670,8 @@ static inline int unuse_pmd_range(struct vm_area_struct *vma, pud_t *pud,
 	pmd = pmd_offset(pud, addr);
 	do {
 		next = pmd_addr_end(addr, end);
+		if (pmd_trans_huge(*pmd))	/* holds no swap entries */
+			continue;
 		if (pmd_none_or_clear_bad(pmd))
 			continue;
 		if (unuse_pte_range(vma, pmd, addr, next, entry, page))
@@ -1134,6 +1334,9 @@ asmlinkage long sys_swapoff(const char __user * specialfile)
 	p->flags &= ~SWP_WRITEOK;
 	spin_unlock(&swap_lock);
 
+	/* Cached slots and queued frees would keep entries in use */
+	drain_swap_slots();
+
 	current->flags |= PF_SWAPOFF;
 	err = try_to_unuse(type);
 	current->flags &= ~PF_SWAPOFF;
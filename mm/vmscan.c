@@ -52,17 +52,12 @@ typedef enum {
 } pageout_t;
 
 struct scan_control {
-	/* Ask refill_inactive_zone, or shrink_cache to scan this many pages */
-	unsigned long nr_to_scan;
-
 	/* Incremented by the number of inactive pages that were scanned */
 	unsigned long nr_scanned;
 
 	/* Incremented by the number of pages reclaimed */
 	unsigned long nr_reclaimed;
 
-	unsigned long nr_mapped;	/* From page_state */
-
 	/* Ask shrink_caches, or shrink_zone to scan at this priority */
 	unsigned int priority;
 
@@ -123,7 +118,14 @@ struct shrinker {
  * From 0 .. 100.  Higher means more swappy.
  */
 int vm_swappiness = 60;
-static long total_memory;
+
+/*
+ * Reclaim culls pages onto the unevictable list while it has them isolated,
+ * where a concurrent munlock or SHM_UNLOCK cannot find them.  Those bump
+ * this count before they go looking, and a reclaimer which sees it change
+ * under it does not trust its culling decisions.
+ */
+static atomic_t unevictable_rescues = ATOMIC_INIT(0);
 
 static LIST_HEAD(shrinker_list);
 static DECLARE_RWSEM(shrinker_rwsem);
@@ -303,7 +305,7 @@ static void handle_write_error(struct address_space *mapping,
 }
 
 /*
- * pageout is called by shrink_list() for each dirty page. Calls ->writepage().
+ * pageout is called by shrink_page_list() for each dirty page. Calls ->writepage().
  */
 static pageout_t pageout(struct page *page, struct address_space *mapping)
 {
@@ -384,25 +386,30 @@ static int remove_mapping(struct address_space *mapping, struct page *page)
 	 * The non-racy check for busy page.  It is critical to check
 	 * PageDirty _after_ making sure that the page is freeable and
 	 * not in use by anybody. 	(pagecache + us == 2)
+	 *
+	 * Lockless page cache lookups can take a reference at any time,
+	 * so freeze the count rather than just looking at it: they fail
+	 * while it is frozen.  The cmpxchg orders the PageDirty check.
 	 */
-	if (unlikely(page_count(page) != 2))
+	if (!page_freeze_refs(page, 2))
 		goto cannot_free;
-	smp_rmb();
-	if (unlikely(PageDirty(page)))
+	if (unlikely(PageDirty(page))) {
+		page_unfreeze_refs(page, 2);
 		goto cannot_free;
+	}
 
 	if (PageSwapCache(page)) {
 		swp_entry_t swap = { .val = page_private(page) };
 		__delete_from_swap_cache(page);
 		write_unlock_irq(&mapping->tree_lock);
 		swap_free(swap);
-		__put_page(page);	/* The pagecache ref */
+		page_unfreeze_refs(page, 1);	/* drop the pagecache ref */
 		return 1;
 	}
 
 	__remove_from_page_cache(page);
 	write_unlock_irq(&mapping->tree_lock);
-	__put_page(page);
+	page_unfreeze_refs(page, 1);	/* drop the pagecache ref */
 	return 1;
 
 cannot_free:
@@ -411,9 +418,10 @@ cannot_free:
 }
 
 /*
- * shrink_list adds the number of reclaimed pages to sc->nr_reclaimed
+ * shrink_page_list adds the number of reclaimed pages to sc->nr_reclaimed
  */
-static int shrink_list(struct list_head *page_list, struct scan_control *sc)
+static int shrink_page_list(struct list_head *page_list,
+			    struct scan_control *sc)
 {
 	LIST_HEAD(ret_pages);
 	struct pagevec freed_pvec;
@@ -428,6 +436,7 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		struct page *page;
 		int may_enter_fs;
 		int referenced;
+		unsigned long vm_flags;
 
 		cond_resched();
 
@@ -447,7 +456,12 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 		if (PageWriteback(page))
 			goto keep_locked;
 
-		referenced = page_referenced(page, 1);
+		if (unlikely(!page_evictable(page, NULL)))
+			goto cull_unevictable;
+
+		referenced = page_referenced(page, 1, &vm_flags);
+		if (vm_flags & VM_LOCKED)
+			goto cull_unevictable;
 		/* In active use or really unfreeable?  Activate it. */
 		if (referenced && page_mapping_inuse(page))
 			goto activate_locked;
@@ -477,6 +491,8 @@ static int shrink_list(struct list_head *page_list, struct scan_control *sc)
 				goto activate_locked;
 			case SWAP_AGAIN:
 				goto keep_locked;
+			case SWAP_MLOCK:
+				goto cull_unevictable;
 			case SWAP_SUCCESS:
 				; /* try to free the page below */
 			}
@@ -551,6 +567,14 @@ free_it:
 			__pagevec_release_nonlru(&freed_pvec);
 		continue;
 
+cull_unevictable:
+		/*
+		 * Reclaim can never free this page: park it on the
+		 * unevictable list where nobody will scan it again.
+		 */
+		SetPageUnevictable(page);
+		goto keep_locked;
+
 activate_locked:
 		SetPageActive(page);
 		pgactivate++;
@@ -572,7 +596,14 @@ keep:
 static inline void move_to_lru(struct page *page)
 {
 	list_del(&page->lru);
-	if (PageActive(page)) {
+	if (PageUnevictable(page)) {
+		/*
+		 * add_page_to_unevictable_list sets PG_unevictable
+		 * itself and checks that PG_active is off.
+		 */
+		ClearPageUnevictable(page);
+		add_page_to_unevictable_list(page);
+	} else if (PageActive(page)) {
 		/*
 		 * lru_cache_add_active checks that
 		 * the PG_active bit is off.
@@ -648,6 +679,105 @@ unlock_retry:
 retry:
 	return -EAGAIN;
 }
+
+/*
+ * Move a page into newpage instead of swapping it out: unmap it, copy
+ * it and put newpage in its place in the page cache or swap cache.
+ * Mapped anonymous pages thus come back as swap cache pages, which fault
+ * in again without I/O.  On success newpage is off its list and on the
+ * LRU, and the old page holds nothing but the caller's reference.
+ *
+ * page is locked upon entry, unlocked on exit
+ */
+static int migrate_page_to(struct page *newpage, struct page *page)
+{
+	struct address_space *mapping = page_mapping(page);
+	void **pslot;
+
+	if (PageUnevictable(page)) {
+		unlock_page(page);
+		return -EBUSY;
+	}
+
+	if (!mapping)
+		goto unlock_retry;	/* truncate got there first */
+
+	if (page_mapped(page) && try_to_unmap(page) != SWAP_SUCCESS)
+		goto unlock_retry;
+
+	if (PagePrivate(page) && !try_to_release_page(page, GFP_KERNEL))
+		goto unlock_retry;
+
+	/* newpage is ours alone until it goes into the tree */
+	copy_highpage(newpage, page);
+
+	write_lock_irq(&mapping->tree_lock);
+	pslot = radix_tree_lookup_slot(&mapping->page_tree, page_index(page));
+
+	/* Nobody else may hold the page: pagecache + us == 2 */
+	if (!pslot || radix_tree_deref_slot(pslot) != page ||
+	    !page_freeze_refs(page, 2)) {
+		write_unlock_irq(&mapping->tree_lock);
+		goto unlock_retry;
+	}
+
+	/*
+	 * Only now that the move can no longer fail does newpage take on
+	 * the state of page: on failure it goes back to the caller's list
+	 * and is reused as the target for the next page.  It is complete
+	 * before it goes into the tree, so lookups never see it half done.
+	 */
+	SetPageLocked(newpage);
+	if (PageUptodate(page))
+		SetPageUptodate(newpage);
+	if (PageError(page))
+		SetPageError(newpage);
+	if (PageReferenced(page))
+		SetPageReferenced(newpage);
+	if (PageChecked(page))
+		SetPageChecked(newpage);
+	if (PageMappedToDisk(page))
+		SetPageMappedToDisk(newpage);
+	if (PageSwapBacked(page))
+		SetPageSwapBacked(newpage);
+	newpage->index = page->index;
+	newpage->mapping = page->mapping;
+	if (PageSwapCache(page)) {
+		SetPageSwapCache(newpage);
+		set_page_private(newpage, page_private(page));
+	}
+
+	/* The dirty tag stays with the slot, the dirty count with the data */
+	if (PageDirty(page)) {
+		ClearPageDirty(page);
+		SetPageDirty(newpage);
+	}
+	get_page(newpage);	/* the cache reference */
+	radix_tree_replace_slot(pslot, newpage);
+	page_unfreeze_refs(page, 1);	/* drop the pagecache ref */
+	write_unlock_irq(&mapping->tree_lock);
+
+	ClearPageSwapCache(page);
+	set_page_private(page, 0);
+	page->mapping = NULL;
+
+	list_del(&newpage->lru);
+	if (PageActive(page)) {
+		ClearPageActive(page);
+		lru_cache_add_active(newpage);
+	} else {
+		lru_cache_add(newpage);
+	}
+	unlock_page(newpage);
+	put_page(newpage);
+	unlock_page(page);
+	return 0;
+
+unlock_retry:
+	unlock_page(page);
+	return -EAGAIN;
+}
+
 /*
  * migrate_pages
  *
@@ -661,12 +791,13 @@ retry:
  * are movable anymore because t has become empty
  * or no retryable pages exist anymore.
  *
- * SIMPLIFIED VERSION: This implementation of migrate_pages
- * is only swapping out pages and never touches the second
- * list. The direct migration patchset
- * extends this function to avoid the use of swap.
+ * Pages swapped out are left on the moved list to be put back on
+ * the LRU.  Pages moved to a new page are only referenced by the
+ * caller on the moved list, and should be freed.  Direct migration
+ * runs from allocation paths, so it never sleeps on a page lock or
+ * on writeback; pages left over when "to" ran empty stay on "from".
  *
- * Return: Number of pages not migrated when "to" ran empty.
+ * Return: Number of pages not migrated.
  */
 int migrate_pages(struct list_head *from, struct list_head *to,
 		  struct list_head *moved, struct list_head *failed)
@@ -688,6 +819,9 @@ redo:
 	list_for_each_entry_safe(page, page2, from, lru) {
 		cond_resched();
 
+		if (to && list_empty(to))
+			break;
+
 		rc = 0;
 		if (page_count(page) == 1)
 			/* page was freed from under us. So we are done. */
@@ -700,7 +834,7 @@ redo:
 		 * lock.
 		 */
 		rc = -EAGAIN;
-		if (pass > 2)
+		if (pass > 2 && !to)
 			lock_page(page);
 		else
 			if (TestSetPageLocked(page))
@@ -710,7 +844,7 @@ redo:
 		 * Only wait on writeback if we have already done a pass where
 		 * we we may have triggered writeouts for lots of pages.
 		 */
-		if (pass > 0) {
+		if (pass > 0 && !to) {
 			wait_on_page_writeback(page);
 		} else {
 			if (PageWriteback(page))
@@ -733,7 +867,11 @@ redo:
 		 * Page is properly locked and writeback is complete.
 		 * Try to migrate the page.
 		 */
-		rc = swap_page(page);
+		if (to)
+			rc = migrate_page_to(list_entry(to->next,
+						struct page, lru), page);
+		else
+			rc = swap_page(page);
 		goto next;
 
 unlock_page:
@@ -751,7 +889,7 @@ next:
 			list_move(&page->lru, moved);
 		}
 	}
-	if (retry && pass++ < 10)
+	if (retry && pass++ < 10 && !(to && list_empty(to)))
 		goto redo;
 
 	if (!swapwrite)
@@ -783,12 +921,8 @@ int isolate_lru_page(struct page *page)
 redo:
 	spin_lock_irq(&zone->lru_lock);
 	rc = __isolate_lru_page(page);
-	if (rc == 1) {
-		if (PageActive(page))
-			del_page_from_active_list(zone, page);
-		else
-			del_page_from_inactive_list(zone, page);
-	}
+	if (rc == 1)
+		del_page_from_lru_list(zone, page, page_lru(page));
 	spin_unlock_irq(&zone->lru_lock);
 	if (rc == 0) {
 		/*
@@ -851,36 +985,43 @@ static int isolate_lru_pages(int nr_to_scan, struct list_head *src,
 }
 
 /*
- * shrink_cache() adds the number of pages reclaimed to sc->nr_reclaimed
+ * shrink_inactive_list() is a helper for shrink_zone().  It adds the number
+ * of pages reclaimed to sc->nr_reclaimed
  */
-static void shrink_cache(struct zone *zone, struct scan_control *sc)
+static void shrink_inactive_list(unsigned long max_scan, struct zone *zone,
+				 struct scan_control *sc, int file)
 {
 	LIST_HEAD(page_list);
 	struct pagevec pvec;
-	int max_scan = sc->nr_to_scan;
+	enum lru_list lru = LRU_BASE + LRU_FILE * file;
+	long nr_left = max_scan;
 
 	pagevec_init(&pvec, 1);
 
 	lru_add_drain();
 	spin_lock_irq(&zone->lru_lock);
-	while (max_scan > 0) {
+	while (nr_left > 0) {
 		struct page *page;
 		int nr_taken;
 		int nr_scan;
 		int nr_freed;
+		int rescues;
 
 		nr_taken = isolate_lru_pages(sc->swap_cluster_max,
-					     &zone->inactive_list,
+					     &zone->lru[lru].list,
 					     &page_list, &nr_scan);
-		zone->nr_inactive -= nr_taken;
+		zone->lru[lru].nr_pages -= nr_taken;
 		zone->pages_scanned += nr_scan;
+		zone->recent_scanned[file] += nr_taken;
 		spin_unlock_irq(&zone->lru_lock);
 
 		if (nr_taken == 0)
 			goto done;
 
-		max_scan -= nr_scan;
-		nr_freed = shrink_list(&page_list, sc);
+		nr_left -= nr_scan;
+		rescues = atomic_read(&unevictable_rescues);
+		smp_rmb();
+		nr_freed = shrink_page_list(&page_list, sc);
 
 		local_irq_disable();
 		if (current_is_kswapd()) {
@@ -891,18 +1032,29 @@ static void shrink_cache(struct zone *zone, struct scan_control *sc)
 		__mod_page_state_zone(zone, pgsteal, nr_freed);
 
 		spin_lock(&zone->lru_lock);
+		/*
+		 * A munlock or SHM_UNLOCK which ran while we had the pages
+		 * isolated could not see the ones we have just culled: give
+		 * those another trip round the inactive list instead.
+		 */
+		if (rescues != atomic_read(&unevictable_rescues))
+			rescues = -1;
 		/*
 		 * Put back any unfreeable pages.
 		 */
 		while (!list_empty(&page_list)) {
+			enum lru_list l;
+
 			page = lru_to_page(&page_list);
 			if (TestSetPageLRU(page))
 				BUG();
 			list_del(&page->lru);
-			if (PageActive(page))
-				add_page_to_active_list(zone, page);
-			else
-				add_page_to_inactive_list(zone, page);
+			if (unlikely(rescues < 0))
+				ClearPageUnevictable(page);
+			l = page_lru(page);
+			add_page_to_lru_list(zone, page, l);
+			if (is_active_lru(l))
+				zone->recent_rotated[file]++;
 			if (!pagevec_add(&pvec, page)) {
 				spin_unlock_irq(&zone->lru_lock);
 				__pagevec_release(&pvec);
@@ -916,7 +1068,7 @@ done:
 }
 
 /*
- * This moves pages from the active list to the inactive list.
+ * This moves pages from an active list to the corresponding inactive list.
  *
  * We move them the other way if the page is referenced by one or more
  * processes, from rmap.
@@ -932,73 +1084,41 @@ done:
  * The downside is that we have to touch page->_count against each page.
  * But we had to alter page->flags anyway.
  */
-static void
-refill_inactive_zone(struct zone *zone, struct scan_control *sc)
+static void shrink_active_list(unsigned long nr_pages, struct zone *zone,
+			       struct scan_control *sc, int file)
 {
 	int pgmoved;
 	int pgdeactivate = 0;
 	int pgscanned;
-	int nr_pages = sc->nr_to_scan;
 	LIST_HEAD(l_hold);	/* The pages which were snipped off */
-	LIST_HEAD(l_inactive);	/* Pages to go onto the inactive_list */
-	LIST_HEAD(l_active);	/* Pages to go onto the active_list */
+	LIST_HEAD(l_inactive);	/* Pages to go onto the inactive list */
+	LIST_HEAD(l_active);	/* Pages to go onto the active list */
 	struct page *page;
 	struct pagevec pvec;
-	int reclaim_mapped = 0;
-	long mapped_ratio;
-	long distress;
-	long swap_tendency;
+	unsigned long vm_flags;
+	enum lru_list lru = LRU_BASE + LRU_FILE * file;
 
 	lru_add_drain();
 	spin_lock_irq(&zone->lru_lock);
-	pgmoved = isolate_lru_pages(nr_pages, &zone->active_list,
+	pgmoved = isolate_lru_pages(nr_pages, &zone->lru[lru + LRU_ACTIVE].list,
 				    &l_hold, &pgscanned);
 	zone->pages_scanned += pgscanned;
-	zone->nr_active -= pgmoved;
+	zone->lru[lru + LRU_ACTIVE].nr_pages -= pgmoved;
+	zone->recent_scanned[file] += pgmoved;
 	spin_unlock_irq(&zone->lru_lock);
 
 	/*
-	 * `distress' is a measure of how much trouble we're having reclaiming
-	 * pages.  0 -> no problems.  100 -> great trouble.
+	 * Whether to deactivate mapped pages at all used to be decided
+	 * here; now get_scan_ratio() decides how hard each list is
+	 * scanned, and only recently referenced pages stay active.
 	 */
-	distress = 100 >> zone->prev_priority;
-
-	/*
-	 * The point of this algorithm is to decide when to start reclaiming
-	 * mapped memory instead of just pagecache.  Work out how much memory
-	 * is mapped.
-	 */
-	mapped_ratio = (sc->nr_mapped * 100) / total_memory;
-
-	/*
-	 * Now decide how much we really want to unmap some pages.  The mapped
-	 * ratio is downgraded - just because there's a lot of mapped memory
-	 * doesn't necessarily mean that page reclaim isn't succeeding.
-	 *
-	 * The distress ratio is important - we don't want to start going oom.
-	 *
-	 * A 100% value of vm_swappiness overrides this algorithm altogether.
-	 */
-	swap_tendency = mapped_ratio / 2 + distress + vm_swappiness;
-
-	/*
-	 * Now use this metric to decide whether to start moving mapped memory
-	 * onto the inactive list.
-	 */
-	if (swap_tendency >= 100)
-		reclaim_mapped = 1;
-
 	while (!list_empty(&l_hold)) {
 		cond_resched();
 		page = lru_to_page(&l_hold);
 		list_del(&page->lru);
-		if (page_mapped(page)) {
-			if (!reclaim_mapped ||
-			    (total_swap_pages == 0 && PageAnon(page)) ||
-			    page_referenced(page, 0)) {
-				list_add(&page->lru, &l_active);
-				continue;
-			}
+		if (page_mapped(page) && page_referenced(page, 0, &vm_flags)) {
+			list_add(&page->lru, &l_active);
+			continue;
 		}
 		list_add(&page->lru, &l_inactive);
 	}
@@ -1013,10 +1133,10 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 			BUG();
 		if (!TestClearPageActive(page))
 			BUG();
-		list_move(&page->lru, &zone->inactive_list);
+		list_move(&page->lru, &zone->lru[lru].list);
 		pgmoved++;
 		if (!pagevec_add(&pvec, page)) {
-			zone->nr_inactive += pgmoved;
+			zone->lru[lru].nr_pages += pgmoved;
 			spin_unlock_irq(&zone->lru_lock);
 			pgdeactivate += pgmoved;
 			pgmoved = 0;
@@ -1026,7 +1146,7 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 			spin_lock_irq(&zone->lru_lock);
 		}
 	}
-	zone->nr_inactive += pgmoved;
+	zone->lru[lru].nr_pages += pgmoved;
 	pgdeactivate += pgmoved;
 	if (buffer_heads_over_limit) {
 		spin_unlock_irq(&zone->lru_lock);
@@ -1041,17 +1161,18 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 		if (TestSetPageLRU(page))
 			BUG();
 		BUG_ON(!PageActive(page));
-		list_move(&page->lru, &zone->active_list);
+		list_move(&page->lru, &zone->lru[lru + LRU_ACTIVE].list);
 		pgmoved++;
+		zone->recent_rotated[file]++;
 		if (!pagevec_add(&pvec, page)) {
-			zone->nr_active += pgmoved;
+			zone->lru[lru + LRU_ACTIVE].nr_pages += pgmoved;
 			pgmoved = 0;
 			spin_unlock_irq(&zone->lru_lock);
 			__pagevec_release(&pvec);
 			spin_lock_irq(&zone->lru_lock);
 		}
 	}
-	zone->nr_active += pgmoved;
+	zone->lru[lru + LRU_ACTIVE].nr_pages += pgmoved;
 	spin_unlock(&zone->lru_lock);
 
 	__mod_page_state_zone(zone, pgrefill, pgscanned);
@@ -1061,56 +1182,185 @@ refill_inactive_zone(struct zone *zone, struct scan_control *sc)
 	pagevec_release(&pvec);
 }
 
+/*
+ * The inactive anon list should be small enough that the VM never has to
+ * do too much work deactivating, but large enough that each page on it
+ * gets a chance to be referenced again before it is swapped out.
+ */
+static int inactive_anon_is_low(struct zone *zone)
+{
+	unsigned long active = zone->lru[LRU_ACTIVE_ANON].nr_pages;
+	unsigned long inactive = zone->lru[LRU_INACTIVE_ANON].nr_pages;
+
+	return inactive * zone->inactive_ratio < active;
+}
+
+static void shrink_list(enum lru_list l, unsigned long nr_to_scan,
+			struct zone *zone, struct scan_control *sc)
+{
+	int file = is_file_lru(l);
+
+	if (l == LRU_ACTIVE_FILE) {
+		shrink_active_list(nr_to_scan, zone, sc, file);
+		return;
+	}
+
+	if (l == LRU_ACTIVE_ANON) {
+		if (inactive_anon_is_low(zone))
+			shrink_active_list(nr_to_scan, zone, sc, file);
+		return;
+	}
+
+	shrink_inactive_list(nr_to_scan, zone, sc, file);
+}
+
+/*
+ * Determine how aggressively the anon and file LRU lists should be
+ * scanned.  The relative value of each set of LRU lists is determined
+ * by looking at the fraction of the pages scanned we did rotate back
+ * onto the active list instead of evict.
+ *
+ * percent[0] specifies how much pressure to put on ram/swap backed
+ * memory, while percent[1] determines pressure on the file LRUs.
+ */
+static void get_scan_ratio(struct zone *zone, struct scan_control *sc,
+			   unsigned long *percent)
+{
+	unsigned long anon, file, free;
+	unsigned long anon_prio, file_prio;
+	unsigned long ap, fp;
+
+	anon  = zone->lru[LRU_ACTIVE_ANON].nr_pages +
+		zone->lru[LRU_INACTIVE_ANON].nr_pages;
+	file  = zone->lru[LRU_ACTIVE_FILE].nr_pages +
+		zone->lru[LRU_INACTIVE_FILE].nr_pages;
+	free  = zone->free_pages;
+
+	/* If we have very few page cache pages, force-scan anon pages. */
+	if (unlikely(file + free <= zone->pages_high)) {
+		percent[0] = 100;
+		percent[1] = 0;
+		return;
+	}
+
+	/*
+	 * OK, so we have swap space and a fair amount of page cache
+	 * pages.  We use the recently rotated / recently scanned
+	 * ratios to determine how valuable each cache is.
+	 *
+	 * Because workloads change over time (and to avoid overflow)
+	 * we keep these statistics as a floating average, which ends
+	 * up weighing recent references more than old ones.
+	 */
+	if (unlikely(zone->recent_scanned[0] > anon / 4)) {
+		spin_lock_irq(&zone->lru_lock);
+		zone->recent_scanned[0] /= 2;
+		zone->recent_rotated[0] /= 2;
+		spin_unlock_irq(&zone->lru_lock);
+	}
+
+	if (unlikely(zone->recent_scanned[1] > file / 4)) {
+		spin_lock_irq(&zone->lru_lock);
+		zone->recent_scanned[1] /= 2;
+		zone->recent_rotated[1] /= 2;
+		spin_unlock_irq(&zone->lru_lock);
+	}
+
+	/*
+	 * With swappiness at 100, anonymous and file have the same priority.
+	 * This scanning priority is essentially the inverse of IO cost.
+	 */
+	anon_prio = vm_swappiness;
+	file_prio = 200 - vm_swappiness;
+
+	/*
+	 * The amount of pressure on anon vs file pages is inversely
+	 * proportional to the fraction of recently scanned pages on
+	 * each list that were recently referenced and in active use.
+	 */
+	ap = (anon_prio + 1) * (zone->recent_scanned[0] + 1);
+	ap /= zone->recent_rotated[0] + 1;
+
+	fp = (file_prio + 1) * (zone->recent_scanned[1] + 1);
+	fp /= zone->recent_rotated[1] + 1;
+
+	/* Normalize to percentages */
+	percent[0] = 100 * ap / (ap + fp + 1);
+	percent[1] = 100 - percent[0];
+}
+
 /*
  * This is a basic per-zone page freer.  Used by both kswapd and direct reclaim.
  */
 static void
 shrink_zone(struct zone *zone, struct scan_control *sc)
 {
-	unsigned long nr_active;
-	unsigned long nr_inactive;
+	unsigned long nr[NR_LRU_LISTS];
+	unsigned long percent[2];	/* anon @ 0; file @ 1 */
+	int noswap = 0;
+	enum lru_list l;
 
 	atomic_inc(&zone->reclaim_in_progress);
 
-	/*
-	 * Add one to `nr_to_scan' just to make sure that the kernel will
-	 * slowly sift through the active list.
-	 */
-	zone->nr_scan_active += (zone->nr_active >> sc->priority) + 1;
-	nr_active = zone->nr_scan_active;
-	if (nr_active >= sc->swap_cluster_max)
-		zone->nr_scan_active = 0;
-	else
-		nr_active = 0;
-
-	zone->nr_scan_inactive += (zone->nr_inactive >> sc->priority) + 1;
-	nr_inactive = zone->nr_scan_inactive;
-	if (nr_inactive >= sc->swap_cluster_max)
-		zone->nr_scan_inactive = 0;
-	else
-		nr_inactive = 0;
-
-	while (nr_active || nr_inactive) {
-		if (nr_active) {
-			sc->nr_to_scan = min(nr_active,
-					(unsigned long)sc->swap_cluster_max);
-			nr_active -= sc->nr_to_scan;
-			refill_inactive_zone(zone, sc);
+	/* If we have no swap space, do not bother scanning anon pages. */
+	if (nr_swap_pages <= 0) {
+		noswap = 1;
+		percent[0] = 0;
+		percent[1] = 100;
+	} else
+		get_scan_ratio(zone, sc, percent);
+
+	for_each_evictable_lru(l) {
+		int file = is_file_lru(l);
+		unsigned long scan;
+
+		scan = zone->lru[l].nr_pages;
+		if (sc->priority || noswap) {
+			scan >>= sc->priority;
+			scan = (scan * percent[file]) / 100;
 		}
+		zone->lru[l].nr_scan += scan;
+		nr[l] = zone->lru[l].nr_scan;
+		if (nr[l] >= sc->swap_cluster_max)
+			zone->lru[l].nr_scan = 0;
+		else
+			nr[l] = 0;
+	}
+
+	while (nr[LRU_INACTIVE_ANON] || nr[LRU_ACTIVE_FILE] ||
+					nr[LRU_INACTIVE_FILE]) {
+		for_each_evictable_lru(l) {
+			unsigned long nr_to_scan;
 
-		if (nr_inactive) {
-			sc->nr_to_scan = min(nr_inactive,
+			if (!nr[l])
+				continue;
+			nr_to_scan = min(nr[l],
 					(unsigned long)sc->swap_cluster_max);
-			nr_inactive -= sc->nr_to_scan;
-			shrink_cache(zone, sc);
+			nr[l] -= nr_to_scan;
+			shrink_list(l, nr_to_scan, zone, sc);
 		}
 	}
 
+	/*
+	 * Even if we did not try to evict anon pages at all, we want to
+	 * rebalance the anon lru active/inactive ratio.
+	 */
+	if (!noswap && inactive_anon_is_low(zone))
+		shrink_active_list(SWAP_CLUSTER_MAX, zone, sc, 0);
+
 	throttle_vm_writeout();
 
 	atomic_dec(&zone->reclaim_in_progress);
 }
 
+static unsigned long zone_lru_pages(struct zone *zone)
+{
+	return zone->lru[LRU_ACTIVE_ANON].nr_pages
+		+ zone->lru[LRU_INACTIVE_ANON].nr_pages
+		+ zone->lru[LRU_ACTIVE_FILE].nr_pages
+		+ zone->lru[LRU_INACTIVE_FILE].nr_pages;
+}
+
 /*
  * This is the direct reclaim path, for page-allocating processes.  We only
  * try to reclaim pages from zones which will satisfy the caller's allocation
@@ -1160,10 +1410,10 @@ shrink_caches(struct zone **zones, struct scan_control *sc)
  *
  * If the caller is !__GFP_FS then the probability of a failure is reasonably
  * high - the zone may be full of dirty or under-writeback pages, which this
- * caller can't do much about.  We kick pdflush and take explicit naps in the
- * hope that some of these pages can be written.  But if the allocating task
- * holds filesystem locks which prevent writeout this might not work, and the
- * allocation attempt will fail.
+ * caller can't do much about.  We kick the flusher threads and take explicit
+ * naps in the hope that some of these pages can be written.  But if the
+ * allocating task holds filesystem locks which prevent writeout this might
+ * not work, and the allocation attempt will fail.
  */
 int try_to_free_pages(struct zone **zones, gfp_t gfp_mask)
 {
@@ -1187,11 +1437,10 @@ int try_to_free_pages(struct zone **zones, gfp_t gfp_mask)
 			continue;
 
 		zone->temp_priority = DEF_PRIORITY;
-		lru_pages += zone->nr_active + zone->nr_inactive;
+		lru_pages += zone_lru_pages(zone);
 	}
 
 	for (priority = DEF_PRIORITY; priority >= 0; priority--) {
-		sc.nr_mapped = read_page_state(nr_mapped);
 		sc.nr_scanned = 0;
 		sc.nr_reclaimed = 0;
 		sc.priority = priority;
@@ -1219,7 +1468,7 @@ int try_to_free_pages(struct zone **zones, gfp_t gfp_mask)
 		 * writeout.  So in laptop mode, write out the whole world.
 		 */
 		if (total_scanned > sc.swap_cluster_max + sc.swap_cluster_max/2) {
-			wakeup_pdflush(laptop_mode ? 0 : total_scanned);
+			wakeup_flusher_threads(laptop_mode ? 0 : total_scanned);
 			sc.may_writepage = 1;
 		}
 
@@ -1279,7 +1528,6 @@ loop_again:
 	total_reclaimed = 0;
 	sc.gfp_mask = GFP_KERNEL;
 	sc.may_writepage = 0;
-	sc.nr_mapped = read_page_state(nr_mapped);
 
 	inc_page_state(pageoutrun);
 
@@ -1328,7 +1576,7 @@ scan:
 		for (i = 0; i <= end_zone; i++) {
 			struct zone *zone = pgdat->node_zones + i;
 
-			lru_pages += zone->nr_active + zone->nr_inactive;
+			lru_pages += zone_lru_pages(zone);
 		}
 
 		/*
@@ -1374,7 +1622,7 @@ scan:
 			if (zone->all_unreclaimable)
 				continue;
 			if (nr_slab == 0 && zone->pages_scanned >=
-				    (zone->nr_active + zone->nr_inactive) * 4)
+					zone_lru_pages(zone) * 4)
 				zone->all_unreclaimable = 1;
 			/*
 			 * If we've done a decent amount of scanning and
@@ -1539,6 +1787,86 @@ int shrink_all_memory(int nr_pages)
 }
 #endif
 
+/**
+ * page_evictable - test whether a page is evictable
+ * @page: the page to test
+ * @vma: the VMA in which the page is or will be mapped, may be NULL
+ *
+ * Test whether page is evictable--i.e., should be placed on active/inactive
+ * lists vs unevictable list.  Pages mapped by an mlocked vma are only seen
+ * when that vma is passed in; reclaim finds the rest through rmap.
+ */
+int page_evictable(struct page *page, struct vm_area_struct *vma)
+{
+	if (mapping_unevictable(page_mapping(page)))
+		return 0;
+
+	if (vma && (vma->vm_flags & VM_LOCKED))
+		return 0;
+
+	return 1;
+}
+
+/*
+ * Must be called by anyone about to rescue pages from the unevictable list,
+ * after making them evictable and before looking for them.
+ */
+void begin_unevictable_rescue(void)
+{
+	atomic_inc(&unevictable_rescues);
+	smp_mb();
+}
+
+/**
+ * rescue_unevictable_page - move a page back to the evictable lists
+ * @page: the page, which the caller holds a reference on
+ *
+ * If @page sits on the unevictable list but is no longer unevictable, move
+ * it to the inactive list.  If it is still mlocked by another vma, reclaim
+ * will simply cull it again.
+ */
+void rescue_unevictable_page(struct page *page)
+{
+	struct zone *zone = page_zone(page);
+
+	spin_lock_irq(&zone->lru_lock);
+	if (PageLRU(page) && PageUnevictable(page) &&
+				page_evictable(page, NULL)) {
+		del_page_from_lru_list(zone, page, LRU_UNEVICTABLE);
+		ClearPageUnevictable(page);
+		add_page_to_lru_list(zone, page, page_lru(page));
+	}
+	spin_unlock_irq(&zone->lru_lock);
+}
+
+/**
+ * scan_mapping_unevictable_pages - rescue a mapping's unevictable pages
+ * @mapping: the address_space, which has just stopped being unevictable
+ */
+void scan_mapping_unevictable_pages(struct address_space *mapping)
+{
+	struct pagevec pvec;
+	pgoff_t next = 0;
+
+	begin_unevictable_rescue();
+	pagevec_init(&pvec, 0);
+	while (pagevec_lookup(&pvec, mapping, next, PAGEVEC_SIZE)) {
+		int i;
+
+		for (i = 0; i < pagevec_count(&pvec); i++) {
+			struct page *page = pvec.pages[i];
+
+			if (page->index > next)
+				next = page->index;
+			next++;
+			if (PageUnevictable(page))
+				rescue_unevictable_page(page);
+		}
+		pagevec_release(&pvec);
+		cond_resched();
+	}
+}
+
 #ifdef CONFIG_HOTPLUG_CPU
 /* It's optimal to keep kswapds on the same CPUs as their memory, but
    not required for correctness.  So if the last cpu in a node goes
@@ -1570,7 +1898,6 @@ static int __init kswapd_init(void)
 	for_each_pgdat(pgdat)
 		pgdat->kswapd
 		= find_task_by_pid(kernel_thread(kswapd, pgdat, CLONE_KERNEL));
-	total_memory = nr_free_pagecache_pages();
 	hotcpu_notifier(cpu_callback, 0);
 	return 0;
 }
@@ -0,0 +1,240 @@
+/*
+ *	linux/mm/vmstat.c
+ *
+ * Zoned VM counters.
+ *
+ * Each zone counts the pages it has in a number of states (dirty, under
+ * writeback, mapped, ...) in atomic_long_t, and so does the system as a
+ * whole, so that a counter can be read without looking at every cpu.
+ * To keep updates off the shared cachelines, each cpu gathers its updates
+ * in a small signed diff in its pageset of the zone, and adds that to the
+ * zone and global counters only once it grows beyond the pageset's
+ * stat_threshold.  A delayed work folds what is left over every second.
+ */
+
+#include <linux/config.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/cpu.h>
+#include <linux/workqueue.h>
+
+atomic_long_t vm_stat[NR_VM_ZONE_STAT_ITEMS];
+EXPORT_SYMBOL(vm_stat);
+
+#ifdef CONFIG_NUMA
+/*
+ * Sum up one counter over the zones of a node.
+ */
+unsigned long node_page_state(int node, enum zone_stat_item item)
+{
+	struct zone *zones = NODE_DATA(node)->node_zones;
+	unsigned long x = 0;
+	int i;
+
+	for (i = 0; i < MAX_NR_ZONES; i++)
+		x += zone_page_state(&zones[i], item);
+	return x;
+}
+EXPORT_SYMBOL(node_page_state);
+#endif
+
+#ifdef CONFIG_SMP
+
+/*
+ * The diffs are s8, so the threshold has to stay below 128.  More cpus
+ * and more memory in the zone mean more updates, but also more room for
+ * the counters to be off by, so let it grow with both.
+ */
+static int calculate_threshold(struct zone *zone)
+{
+	int threshold;
+	int mem;	/* memory in 128 MB units */
+
+	mem = zone->present_pages >> (27 - PAGE_SHIFT);
+	threshold = 2 * fls(num_online_cpus()) * (1 + fls(mem));
+
+	return min(125, threshold);
+}
+
+/*
+ * Set the stat_threshold of every online cpu's pagesets.  Pagesets start
+ * out with a threshold of 0, so every update goes straight to the zone
+ * until this has run.
+ */
+static void refresh_zone_stat_thresholds(void)
+{
+	struct zone *zone;
+	int cpu;
+
+	for_each_zone(zone) {
+		int threshold;
+
+		if (!populated_zone(zone))
+			continue;
+
+		threshold = calculate_threshold(zone);
+		for_each_online_cpu(cpu)
+			zone_pcp(zone, cpu)->stat_threshold = threshold;
+	}
+}
+
+void __mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
+				int delta)
+{
+	struct per_cpu_pageset *pcp = zone_pcp(zone, smp_processor_id());
+	s8 *p = pcp->vm_stat_diff + item;
+	long x;
+
+	x = delta + *p;
+
+	if (unlikely(x > pcp->stat_threshold || x < -pcp->stat_threshold)) {
+		zone_page_state_add(x, zone, item);
+		x = 0;
+	}
+	*p = x;
+}
+EXPORT_SYMBOL(__mod_zone_page_state);
+
+void mod_zone_page_state(struct zone *zone, enum zone_stat_item item,
+				int delta)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__mod_zone_page_state(zone, item, delta);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(mod_zone_page_state);
+
+void __inc_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	__mod_zone_page_state(page_zone(page), item, 1);
+}
+EXPORT_SYMBOL(__inc_zone_page_state);
+
+void __dec_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	__mod_zone_page_state(page_zone(page), item, -1);
+}
+EXPORT_SYMBOL(__dec_zone_page_state);
+
+void inc_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__inc_zone_page_state(page, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(inc_zone_page_state);
+
+void dec_zone_page_state(struct page *page, enum zone_stat_item item)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	__dec_zone_page_state(page, item);
+	local_irq_restore(flags);
+}
+EXPORT_SYMBOL(dec_zone_page_state);
+
+/**
+ * refresh_cpu_vm_stats - fold the diffs of a cpu into the zones
+ * @cpu: the cpu
+ *
+ * Called periodically on @cpu itself, and on another cpu once @cpu is
+ * dead.  Pagesets which have already been freed are skipped.
+ */
+void refresh_cpu_vm_stats(int cpu)
+{
+	struct zone *zone;
+	unsigned long flags;
+	int i;
+
+	for_each_zone(zone) {
+		struct per_cpu_pageset *pcp;
+
+		if (!populated_zone(zone))
+			continue;
+
+		pcp = zone_pcp(zone, cpu);
+		if (!pcp)
+			continue;
+
+		for (i = 0; i < NR_VM_ZONE_STAT_ITEMS; i++)
+			if (pcp->vm_stat_diff[i]) {
+				local_irq_save(flags);
+				zone_page_state_add(pcp->vm_stat_diff[i],
+						    zone, i);
+				pcp->vm_stat_diff[i] = 0;
+				local_irq_restore(flags);
+			}
+	}
+}
+
+static DEFINE_PER_CPU(struct work_struct, vmstat_work);
+
+/*
+ * The work of a cpu which went offline gets run by some other cpu.  It
+ * must not touch the diffs there, but should come back home once its
+ * cpu does.
+ */
+static void vmstat_update(void *data)
+{
+	int cpu = (long)data;
+
+	if (cpu == smp_processor_id())
+		refresh_cpu_vm_stats(cpu);
+	if (cpu_online(cpu))
+		schedule_delayed_work_on(cpu, &per_cpu(vmstat_work, cpu), HZ);
+}
+
+/*
+ * Start the periodic refresh on @cpu.  Stagger the cpus a little, like
+ * the slab reaper does, so they do not all hit the counters at once.
+ */
+static void __devinit start_cpu_timer(int cpu)
+{
+	struct work_struct *vmstat = &per_cpu(vmstat_work, cpu);
+
+	if (vmstat->func == NULL)
+		INIT_WORK(vmstat, vmstat_update, (void *)(long)cpu);
+	schedule_delayed_work_on(cpu, vmstat, HZ + cpu);
+}
+
+static int __devinit vmstat_cpuup_callback(struct notifier_block *nfb,
+		unsigned long action, void *hcpu)
+{
+	int cpu = (long)hcpu;
+
+	switch (action) {
+	case CPU_ONLINE:
+		start_cpu_timer(cpu);
+		refresh_zone_stat_thresholds();
+		break;
+	case CPU_DEAD:
+		refresh_zone_stat_thresholds();
+		break;
+	default:
+		break;
+	}
+	return NOTIFY_OK;
+}
+
+static struct notifier_block vmstat_notifier =
+	{ &vmstat_cpuup_callback, NULL, 0 };
+
+static int __init setup_vmstat(void)
+{
+	int cpu;
+
+	refresh_zone_stat_thresholds();
+	register_cpu_notifier(&vmstat_notifier);
+
+	for_each_online_cpu(cpu)
+		start_cpu_timer(cpu);
+	return 0;
+}
+module_init(setup_vmstat)
+
+#endif /* CONFIG_SMP */
@@ -110,6 +110,12 @@
 #include <linux/netpoll.h>
 #include <linux/rcupdate.h>
 #include <linux/delay.h>
+#include <linux/jhash.h>
+#include <linux/random.h>
+#include <linux/ip.h>
+#include <net/ip.h>
+#include <linux/ipv6.h>
+#include <linux/in.h>
 #ifdef CONFIG_NET_RADIO
 #include <linux/wireless.h>		/* Note : will define WIRELESS_EXT */
 #include <net/iw_handler.h>
@@ -1200,6 +1206,210 @@ int __skb_linearize(struct sk_buff *skb, gfp_t gfp_mask)
 	return 0;
 }
 
+/**
+ *	skb_gso_segment - segment a TSO packet in software
+ *	@skb: packet to segment, data pointing at the mac header
+ *	@features: features of the output device
+ *
+ *	Hands @skb to the gso_segment hook of its protocol and returns
+ *	the list of segments, or an ERR_PTR.  @skb itself is not freed.
+ */
+struct sk_buff *skb_gso_segment(struct sk_buff *skb, int features)
+{
+	struct sk_buff *segs = ERR_PTR(-EPROTONOSUPPORT);
+	struct packet_type *ptype;
+	unsigned short type = skb->protocol;
+
+	skb->mac.raw = skb->data;
+	skb->mac_len = skb->nh.raw - skb->data;
+	__skb_pull(skb, skb->mac_len);
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ptype, &ptype_base[ntohs(type)&15], list) {
+		if (ptype->type == type && !ptype->dev && ptype->gso_segment) {
+			segs = ptype->gso_segment(skb, features);
+			break;
+		}
+	}
+	rcu_read_unlock();
+
+	__skb_push(skb, skb->data - skb->mac.raw);
+
+	return segs;
+}
+
+/*
+ * While its segments are being transmitted the original packet keeps
+ * them on its ->next list and its own destructor in the control block.
+ */
+struct dev_gso_cb {
+	void (*destructor)(struct sk_buff *skb);
+};
+
+#define DEV_GSO_CB(skb) ((struct dev_gso_cb *)(skb)->cb)
+
+static void dev_gso_skb_destructor(struct sk_buff *skb)
+{
+	struct dev_gso_cb *cb;
+
+	while (skb->next) {
+		struct sk_buff *nskb = skb->next;
+
+		skb->next = nskb->next;
+		nskb->next = NULL;
+		kfree_skb(nskb);
+	}
+
+	cb = DEV_GSO_CB(skb);
+	if (cb->destructor)
+		cb->destructor(skb);
+}
+
+static int dev_gso_segment(struct sk_buff *skb)
+{
+	struct net_device *dev = skb->dev;
+	struct sk_buff *segs;
+	int features = dev->features;
+
+	/* Segments share the pages of the original packet. */
+	if (illegal_highdma(dev, skb))
+		features &= ~NETIF_F_SG;
+
+	segs = skb_gso_segment(skb, features);
+	if (IS_ERR(segs))
+		return PTR_ERR(segs);
+
+	skb->next = segs;
+	DEV_GSO_CB(skb)->destructor = skb->destructor;
+	skb->destructor = dev_gso_skb_destructor;
+
+	return 0;
+}
+
+/**
+ *	dev_hard_start_xmit - hand a packet to the driver
+ *	@skb: packet to transmit
+ *	@dev: output device
+ *
+ *	Called with the xmit lock held (unless the device is LLTX).  TSO
+ *	packets the device cannot handle are segmented here and the
+ *	segments passed to the driver one by one.  If the driver stops
+ *	part way, the remaining segments stay linked to @skb and a
+ *	non-zero value is returned; calling again resumes where it
+ *	stopped.
+ */
+int dev_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
+{
+	if (likely(!skb->next)) {
+		if (netdev_nit)
+			dev_queue_xmit_nit(skb, dev);
+
+		if (netif_needs_gso(dev, skb)) {
+			if (unlikely(dev_gso_segment(skb)))
+				goto out_kfree_skb;
+			if (skb->next)
+				goto gso;
+		}
+
+		return dev->hard_start_xmit(skb, dev);
+	}
+
+gso:
+	do {
+		struct sk_buff *nskb = skb->next;
+		int rc;
+
+		skb->next = nskb->next;
+		nskb->next = NULL;
+		rc = dev->hard_start_xmit(nskb, dev);
+		if (unlikely(rc)) {
+			nskb->next = skb->next;
+			skb->next = nskb;
+			return rc;
+		}
+		if (unlikely(netif_queue_stopped(dev) && skb->next))
+			return NETDEV_TX_BUSY;
+	} while (skb->next);
+
+	skb->destructor = DEV_GSO_CB(skb)->destructor;
+
+out_kfree_skb:
+	kfree_skb(skb);
+	return NETDEV_TX_OK;
+}
+
+/*
+ *	Transmit queue selection.
+ *
+ *	Packets of one socket always use the same queue, so they stay in
+ *	order; anything else (forwarded traffic) is spread by a hash over
+ *	the addresses and ports of its flow.
+ */
+static u32 tx_hashrnd;
+
+static u16 simple_tx_hash(struct net_device *dev, struct sk_buff *skb)
+{
+	u32 addr1, addr2, ports = 0, hash;
+	unsigned int poff;
+	u8 ip_proto;
+
+	if (skb->sk) {
+		hash = jhash_1word((u32)(unsigned long)skb->sk, tx_hashrnd);
+		goto out;
+	}
+
+	switch (skb->protocol) {
+	case __constant_htons(ETH_P_IP):
+		addr1 = skb->nh.iph->saddr;
+		addr2 = skb->nh.iph->daddr;
+		ip_proto = skb->nh.iph->protocol;
+		poff = skb->nh.iph->ihl * 4;
+		if (skb->nh.iph->frag_off & htons(IP_MF | IP_OFFSET))
+			ip_proto = 0;
+		break;
+	case __constant_htons(ETH_P_IPV6):
+		addr1 = skb->nh.ipv6h->saddr.s6_addr32[3];
+		addr2 = skb->nh.ipv6h->daddr.s6_addr32[3];
+		ip_proto = skb->nh.ipv6h->nexthdr;
+		poff = sizeof(struct ipv6hdr);
+		break;
+	default:
+		return 0;
+	}
+
+	switch (ip_proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+	case IPPROTO_DCCP:
+	case IPPROTO_SCTP:
+		if (skb->nh.raw + poff + 4 <= skb->tail)
+			ports = *(u32 *)(skb->nh.raw + poff);
+		break;
+	}
+
+	hash = jhash_3words(addr1, addr2, ports, tx_hashrnd ^ ip_proto);
+out:
+	return ((u64) hash * dev->num_tx_queues) >> 32;
+}
+
+static struct netdev_queue *dev_pick_tx(struct net_device *dev,
+					struct sk_buff *skb)
+{
+	u16 queue_index = 0;
+
+	if (netif_is_multiqueue(dev)) {
+		if (dev->select_queue)
+			queue_index = dev->select_queue(dev, skb);
+		else
+			queue_index = simple_tx_hash(dev, skb);
+		if (unlikely(queue_index >= dev->num_tx_queues))
+			queue_index %= dev->num_tx_queues;
+	}
+
+	skb->queue_mapping = queue_index;
+	return dev->tx_queues ? &dev->tx_queues[queue_index] : NULL;
+}
+
 #define HARD_TX_LOCK(dev, cpu) {			\
 	if ((dev->features & NETIF_F_LLTX) == 0) {	\
 		spin_lock(&dev->xmit_lock);		\
@@ -1243,9 +1453,14 @@ int __skb_linearize(struct sk_buff *skb, gfp_t gfp_mask)
 int dev_queue_xmit(struct sk_buff *skb)
 {
 	struct net_device *dev = skb->dev;
+	struct netdev_queue *txq;
 	struct Qdisc *q;
 	int rc = -ENOMEM;
 
+	/* GSO will handle the following emulations directly. */
+	if (netif_needs_gso(dev, skb))
+		goto gso;
+
 	if (skb_shinfo(skb)->frag_list &&
 	    !(dev->features & NETIF_F_FRAGLIST) &&
 	    __skb_linearize(skb, GFP_ATOMIC))
@@ -1270,6 +1485,7 @@ int dev_queue_xmit(struct sk_buff *skb)
 	      	if (skb_checksum_help(skb, 0))
 	      		goto out_kfree_skb;
 
+gso:
 	spin_lock_prefetch(&dev->queue_lock);
 
 	/* Disable soft irqs for various locks below. Also 
@@ -1289,10 +1505,25 @@ int dev_queue_xmit(struct sk_buff *skb)
 	 * also serializes access to the device queue.
 	 */
 
-	q = rcu_dereference(dev->qdisc);
 #ifdef CONFIG_NET_CLS_ACT
 	skb->tc_verd = SET_TC_AT(skb->tc_verd,AT_EGRESS);
 #endif
+	txq = dev_pick_tx(dev, skb);
+
+	/* Multiqueue device with a discipline per hardware queue */
+	if (txq && (q = rcu_dereference(txq->qdisc)) != NULL) {
+		spin_lock(&txq->lock);
+
+		rc = q->enqueue(skb, q);
+
+		qdisc_run_queue(txq);
+
+		spin_unlock(&txq->lock);
+		rc = rc == NET_XMIT_BYPASS ? NET_XMIT_SUCCESS : rc;
+		goto out;
+	}
+
+	q = rcu_dereference(dev->qdisc);
 	if (q->enqueue) {
 		/* Grab device queue */
 		spin_lock(&dev->queue_lock);
@@ -1326,11 +1557,8 @@ int dev_queue_xmit(struct sk_buff *skb)
 			HARD_TX_LOCK(dev, cpu);
 
 			if (!netif_queue_stopped(dev)) {
-				if (netdev_nit)
-					dev_queue_xmit_nit(skb, dev);
-
 				rc = 0;
-				if (!dev->hard_start_xmit(skb, dev)) {
+				if (!dev_hard_start_xmit(skb, dev)) {
 					HARD_TX_UNLOCK(dev);
 					goto out;
 				}
@@ -1389,46 +1617,191 @@ DEFINE_PER_CPU(struct netif_rx_stats, netdev_rx_stat) = { 0, };
  *
  */
 
-int netif_rx(struct sk_buff *skb)
+#ifdef CONFIG_SMP
+/*
+ *	Receive packet steering.
+ *
+ *	A device may name a set of cpus (rps_cpus in sysfs) over which the
+ *	protocol processing of its received packets is spread.  The target
+ *	cpu is picked by a hash over the addresses and ports of the flow,
+ *	so all packets of one flow are processed in order on one cpu.
+ */
+static u32 rps_hashrnd;
+
+static void rps_map_release(struct rcu_head *rcu)
 {
-	struct softnet_data *queue;
-	unsigned long flags;
+	kfree(container_of(rcu, struct rps_map, rcu));
+}
 
-	/* if netpoll wants it, pretend we never saw it */
-	if (netpoll_rx(skb))
-		return NET_RX_DROP;
+/**
+ *	netdev_set_rps_cpus	-	set receive packet steering cpus
+ *	@dev: device
+ *	@mask: cpus to spread received packets over, empty to disable
+ *
+ *	The caller must hold the rtnl semaphore.
+ */
+int netdev_set_rps_cpus(struct net_device *dev, cpumask_t mask)
+{
+	struct rps_map *map = NULL, *old;
+	int cpu, i = 0;
 
-	if (!skb->tstamp.off_sec)
-		net_timestamp(skb);
+	ASSERT_RTNL();
 
-	/*
-	 * The code is rearranged so that the path is the most
-	 * short when CPU is congested, but is still operating.
-	 */
-	local_irq_save(flags);
-	queue = &__get_cpu_var(softnet_data);
+	cpus_and(mask, mask, cpu_possible_map);
+	if (!cpus_empty(mask)) {
+		map = kmalloc(sizeof(*map) + cpus_weight(mask) * sizeof(u16),
+			      GFP_KERNEL);
+		if (!map)
+			return -ENOMEM;
+		for_each_cpu_mask(cpu, mask)
+			map->cpus[i++] = cpu;
+		map->len = i;
+	}
+
+	old = dev->rps_map;
+	rcu_assign_pointer(dev->rps_map, map);
+	dev->rps_cpus = mask;
+	if (old)
+		call_rcu(&old->rcu, rps_map_release);
+	return 0;
+}
+
+/*
+ * Returns the cpu whose backlog should process this packet, or -1 to
+ * keep it on the current cpu.
+ */
+static int get_rps_cpu(struct net_device *dev, struct sk_buff *skb)
+{
+	struct rps_map *map;
+	u32 addr1, addr2, ports = 0, hash;
+	unsigned int poff;
+	u8 ip_proto;
+	int cpu = -1;
+
+	rcu_read_lock();
+	map = rcu_dereference(dev->rps_map);
+	if (!map)
+		goto out;
+
+	switch (skb->protocol) {
+	case __constant_htons(ETH_P_IP): {
+		struct iphdr *iph;
+
+		if (!pskb_may_pull(skb, sizeof(*iph)))
+			goto out;
+		iph = (struct iphdr *)skb->data;
+		addr1 = iph->saddr;
+		addr2 = iph->daddr;
+		ip_proto = iph->protocol;
+		poff = iph->ihl * 4;
+		/* fragments carry no ports, only the first one would */
+		if (iph->frag_off & htons(IP_MF | IP_OFFSET))
+			ip_proto = 0;
+		break;
+	}
+	case __constant_htons(ETH_P_IPV6): {
+		struct ipv6hdr *ip6h;
+
+		if (!pskb_may_pull(skb, sizeof(*ip6h)))
+			goto out;
+		ip6h = (struct ipv6hdr *)skb->data;
+		addr1 = ip6h->saddr.s6_addr32[3];
+		addr2 = ip6h->daddr.s6_addr32[3];
+		ip_proto = ip6h->nexthdr;
+		poff = sizeof(*ip6h);
+		break;
+	}
+	default:
+		goto out;
+	}
+
+	switch (ip_proto) {
+	case IPPROTO_TCP:
+	case IPPROTO_UDP:
+	case IPPROTO_DCCP:
+	case IPPROTO_SCTP:
+		if (pskb_may_pull(skb, poff + 4))
+			ports = *(u32 *)(skb->data + poff);
+		break;
+	}
+
+	hash = jhash_3words(addr1, addr2, ports, rps_hashrnd ^ ip_proto);
+	cpu = map->cpus[((u64) hash * map->len) >> 32];
+	if (unlikely(!cpu_online(cpu)))
+		cpu = -1;
+out:
+	rcu_read_unlock();
+	return cpu;
+}
+#endif /* CONFIG_SMP */
+
+/*
+ * Queue a packet onto the backlog of @cpu, which may be a remote one.
+ * Called with interrupts disabled.
+ */
+static int enqueue_to_backlog(struct sk_buff *skb, int cpu)
+{
+	struct softnet_data *queue = &per_cpu(softnet_data, cpu);
+	int this_cpu = smp_processor_id();
+	int kick = 0;
 
 	__get_cpu_var(netdev_rx_stat).total++;
+
+	spin_lock(&queue->input_pkt_queue.lock);
 	if (queue->input_pkt_queue.qlen <= netdev_max_backlog) {
-		if (queue->input_pkt_queue.qlen) {
-enqueue:
-			dev_hold(skb->dev);
-			__skb_queue_tail(&queue->input_pkt_queue, skb);
-			local_irq_restore(flags);
-			return NET_RX_SUCCESS;
+		if (!queue->input_pkt_queue.qlen) {
+			if (cpu == this_cpu)
+				netif_rx_schedule(&queue->backlog_dev);
+			else
+				kick = 1;
 		}
-
-		netif_rx_schedule(&queue->backlog_dev);
-		goto enqueue;
+		/* only ever updated under the target's queue lock */
+		if (cpu != this_cpu)
+			per_cpu(netdev_rx_stat, cpu).received_rps++;
+
+		dev_hold(skb->dev);
+		__skb_queue_tail(&queue->input_pkt_queue, skb);
+		spin_unlock(&queue->input_pkt_queue.lock);
+
+		/* the remote cpu schedules its backlog in net_rx_action */
+		if (kick)
+			raise_softirq_on_cpu(cpu, NET_RX_SOFTIRQ);
+		return NET_RX_SUCCESS;
 	}
 
+	spin_unlock(&queue->input_pkt_queue.lock);
 	__get_cpu_var(netdev_rx_stat).dropped++;
-	local_irq_restore(flags);
 
 	kfree_skb(skb);
 	return NET_RX_DROP;
 }
 
+int netif_rx(struct sk_buff *skb)
+{
+	unsigned long flags;
+	int cpu, ret;
+
+	/* if netpoll wants it, pretend we never saw it */
+	if (netpoll_rx(skb))
+		return NET_RX_DROP;
+
+	if (!skb->tstamp.off_sec)
+		net_timestamp(skb);
+
+	local_irq_save(flags);
+#ifdef CONFIG_SMP
+	cpu = get_rps_cpu(skb->dev, skb);
+	if (cpu < 0)
+		cpu = smp_processor_id();
+#else
+	cpu = smp_processor_id();
+#endif
+	ret = enqueue_to_backlog(skb, cpu);
+	local_irq_restore(flags);
+
+	return ret;
+}
+
 int netif_rx_ni(struct sk_buff *skb)
 {
 	int err;
@@ -1496,6 +1869,9 @@ static void net_tx_action(struct softirq_action *h)
 			} else {
 				netif_schedule(dev);
 			}
+
+			if (netif_is_multiqueue(dev))
+				qdisc_run_queues(dev);
 		}
 	}
 }
@@ -1574,20 +1950,13 @@ static int ing_filter(struct sk_buff *skb)
 }
 #endif
 
-int netif_receive_skb(struct sk_buff *skb)
+static int __netif_receive_skb(struct sk_buff *skb)
 {
 	struct packet_type *ptype, *pt_prev;
 	struct net_device *orig_dev;
 	int ret = NET_RX_DROP;
 	unsigned short type;
 
-	/* if we've gotten here through NAPI, check netpoll */
-	if (skb->dev->poll && netpoll_rx(skb))
-		return NET_RX_DROP;
-
-	if (!skb->tstamp.off_sec)
-		net_timestamp(skb);
-
 	if (!skb->input_dev)
 		skb->input_dev = skb->dev;
 
@@ -1666,6 +2035,176 @@ out:
 	return ret;
 }
 
+static int netif_steer_skb(struct sk_buff *skb)
+{
+#ifdef CONFIG_SMP
+	/* NAPI drivers bypass netif_rx(), steer their packets here */
+	int cpu = get_rps_cpu(skb->dev, skb);
+
+	if (cpu >= 0 && cpu != smp_processor_id()) {
+		unsigned long flags;
+		int ret;
+
+		local_irq_save(flags);
+		ret = enqueue_to_backlog(skb, cpu);
+		local_irq_restore(flags);
+		return ret;
+	}
+#endif
+	return __netif_receive_skb(skb);
+}
+
+static void dev_gro_complete(struct sk_buff *skb)
+{
+	struct packet_type *ptype;
+	unsigned short type = skb->protocol;
+	int err = -ENOENT;
+
+	if (GRO_CB(skb)->count == 1)
+		goto out;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ptype, &ptype_base[ntohs(type)&15], list) {
+		if (ptype->type != type || ptype->dev || !ptype->gro_complete)
+			continue;
+
+		err = ptype->gro_complete(skb);
+		break;
+	}
+	rcu_read_unlock();
+
+	if (err) {
+		kfree_skb(skb);
+		return;
+	}
+
+out:
+	/* The stack expects a clean control block. */
+	memset(skb->cb, 0, sizeof(skb->cb));
+	netif_steer_skb(skb);
+}
+
+/*
+ * Hand everything held on this cpu's gro_list to the stack.  Called
+ * with interrupts enabled once a dev->poll has returned.
+ */
+static void dev_gro_flush(struct softnet_data *sd)
+{
+	struct sk_buff *skb, *next;
+
+	skb = sd->gro_list;
+	sd->gro_list = NULL;
+	sd->gro_count = 0;
+
+	for (; skb; skb = next) {
+		next = skb->next;
+		skb->next = NULL;
+		dev_gro_complete(skb);
+	}
+}
+
+static int dev_gro_receive(struct softnet_data *sd, struct sk_buff *skb)
+{
+	struct packet_type *ptype;
+	struct sk_buff **pp, *p;
+	unsigned short type = skb->protocol;
+	int maclen = skb->data - skb->mac.raw;
+	int merged = -1;
+
+	if (!(skb->dev->features & NETIF_F_GRO) || skb->dev->br_port ||
+	    skb_shinfo(skb)->frag_list || skb_cloned(skb))
+		goto normal;
+
+	rcu_read_lock();
+	list_for_each_entry_rcu(ptype, &ptype_base[ntohs(type)&15], list) {
+		if (ptype->type != type || ptype->dev || !ptype->gro_receive)
+			continue;
+
+		for (p = sd->gro_list; p; p = p->next)
+			GRO_CB(p)->same_flow =
+				p->dev == skb->dev &&
+				p->protocol == skb->protocol &&
+				p->data - p->mac.raw == maclen &&
+				!memcmp(p->mac.raw, skb->mac.raw, maclen);
+
+		GRO_CB(skb)->last = skb;
+		GRO_CB(skb)->data_offset = 0;
+		GRO_CB(skb)->same_flow = 0;
+		GRO_CB(skb)->flush = 0;
+		GRO_CB(skb)->count = 1;
+		GRO_CB(skb)->mss = 0;
+
+		merged = ptype->gro_receive(&sd->gro_list, skb);
+		break;
+	}
+	rcu_read_unlock();
+
+	if (merged < 0)
+		goto normal;
+
+	/*
+	 * Deliver whatever the protocol asked to be flushed, and if the
+	 * segment was not merged, every held packet of its flow, so that
+	 * the flow stays in order.
+	 */
+	for (pp = &sd->gro_list; (p = *pp) != NULL; ) {
+		if (GRO_CB(p)->flush || (!merged && GRO_CB(p)->same_flow)) {
+			*pp = p->next;
+			p->next = NULL;
+			sd->gro_count--;
+			dev_gro_complete(p);
+		} else
+			pp = &p->next;
+	}
+
+	if (merged)
+		return NET_RX_SUCCESS;
+	if (GRO_CB(skb)->flush)
+		goto normal;
+
+	if (sd->gro_count >= MAX_GRO_SKBS) {
+		/* Oldest packet is at the tail. */
+		for (pp = &sd->gro_list; (*pp)->next; pp = &(*pp)->next)
+			;
+		p = *pp;
+		*pp = NULL;
+		sd->gro_count--;
+		dev_gro_complete(p);
+	}
+
+	skb->next = sd->gro_list;
+	sd->gro_list = skb;
+	sd->gro_count++;
+	return NET_RX_SUCCESS;
+
+normal:
+	memset(skb->cb, 0, sizeof(skb->cb));
+	return netif_steer_skb(skb);
+}
+
+int netif_receive_skb(struct sk_buff *skb)
+{
+	struct softnet_data *sd;
+
+	/* if we've gotten here through NAPI, check netpoll */
+	if (skb->dev->poll && netpoll_rx(skb))
+		return NET_RX_DROP;
+
+	if (!skb->tstamp.off_sec)
+		net_timestamp(skb);
+
+	/*
+	 * Segments are only held while net_rx_action() runs the poll of
+	 * a real device; coalescing happens before steering, so a merged
+	 * packet costs the remote cpu a single enqueue.
+	 */
+	sd = &__get_cpu_var(softnet_data);
+	if (sd->gro_active && !in_irq() && !irqs_disabled())
+		return dev_gro_receive(sd, skb);
+
+	return netif_steer_skb(skb);
+}
+
 static int process_backlog(struct net_device *backlog_dev, int *budget)
 {
 	int work = 0;
@@ -1679,9 +2218,11 @@ static int process_backlog(struct net_device *backlog_dev, int *budget)
 		struct net_device *dev;
 
 		local_irq_disable();
+		spin_lock(&queue->input_pkt_queue.lock);
 		skb = __skb_dequeue(&queue->input_pkt_queue);
 		if (!skb)
 			goto job_done;
+		spin_unlock(&queue->input_pkt_queue.lock);
 		local_irq_enable();
 
 		dev = skb->dev;
@@ -1709,6 +2250,7 @@ job_done:
 	smp_mb__before_clear_bit();
 	netif_poll_enable(backlog_dev);
 
+	spin_unlock(&queue->input_pkt_queue.lock);
 	local_irq_enable();
 	return 0;
 }
@@ -1722,6 +2264,12 @@ static void net_rx_action(struct softirq_action *h)
 
 	local_irq_disable();
 
+#ifdef CONFIG_SMP
+	/* Packets may have been steered to our backlog by other cpus. */
+	if (queue->input_pkt_queue.qlen)
+		netif_rx_schedule(&queue->backlog_dev);
+#endif
+
 	while (!list_empty(&queue->poll_list)) {
 		struct net_device *dev;
 
@@ -1734,7 +2282,11 @@ static void net_rx_action(struct softirq_action *h)
 				 struct net_device, poll_list);
 		have = netpoll_poll_lock(dev);
 
+		/* process_backlog() drops its device reference per packet */
+		queue->gro_active = dev != &queue->backlog_dev;
 		if (dev->quota <= 0 || dev->poll(dev, &budget)) {
+			queue->gro_active = 0;
+			dev_gro_flush(queue);
 			netpoll_poll_unlock(have);
 			local_irq_disable();
 			list_del(&dev->poll_list);
@@ -1744,6 +2296,8 @@ static void net_rx_action(struct softirq_action *h)
 			else
 				dev->quota = dev->weight;
 		} else {
+			queue->gro_active = 0;
+			dev_gro_flush(queue);
 			netpoll_poll_unlock(have);
 			dev_put(dev);
 			local_irq_disable();
@@ -1981,10 +2535,10 @@ static int softnet_seq_show(struct seq_file *seq, void *v)
 {
 	struct netif_rx_stats *s = v;
 
-	seq_printf(seq, "%08x %08x %08x %08x %08x %08x %08x %08x %08x\n",
+	seq_printf(seq, "%08x %08x %08x %08x %08x %08x %08x %08x %08x %08x\n",
 		   s->total, s->dropped, s->time_squeeze, 0,
 		   0, 0, 0, 0, /* was fastroute */
-		   s->cpu_collision );
+		   s->cpu_collision, s->received_rps);
 	return 0;
 }
 
@@ -2728,6 +3282,11 @@ int register_netdevice(struct net_device *dev)
 		       dev->name);
 		dev->features &= ~NETIF_F_TSO;
 	}
+
+	/* Software TSO needs SG just like the real thing. */
+	if (dev->features & NETIF_F_SG)
+		dev->features |= NETIF_F_GSO;
+
 	if (dev->features & NETIF_F_UFO) {
 		if (!(dev->features & NETIF_F_HW_CSUM)) {
 			printk(KERN_ERR "%s: Dropping NETIF_F_UFO since no "
@@ -2970,24 +3529,31 @@ out:
 }
 
 /**
- *	alloc_netdev - allocate network device
+ *	alloc_netdev_mq - allocate network device
  *	@sizeof_priv:	size of private data to allocate space for
  *	@name:		device name format string
  *	@setup:		callback to initialize device
+ *	@queue_count:	the number of hardware transmit queues
  *
  *	Allocates a struct net_device with private data area for driver use
- *	and performs basic initialization.
+ *	and performs basic initialization.  The transmit queues are
+ *	allocated along with the device.
  */
-struct net_device *alloc_netdev(int sizeof_priv, const char *name,
-		void (*setup)(struct net_device *))
+struct net_device *alloc_netdev_mq(int sizeof_priv, const char *name,
+		void (*setup)(struct net_device *), unsigned int queue_count)
 {
 	void *p;
 	struct net_device *dev;
-	int alloc_size;
+	int alloc_size, queue_offset;
+	unsigned int i;
+
+	BUG_ON(!queue_count);
 
 	/* ensure 32-byte alignment of both the device and private area */
 	alloc_size = (sizeof(*dev) + NETDEV_ALIGN_CONST) & ~NETDEV_ALIGN_CONST;
 	alloc_size += sizeof_priv + NETDEV_ALIGN_CONST;
+	queue_offset = (alloc_size + NETDEV_ALIGN_CONST) & ~NETDEV_ALIGN_CONST;
+	alloc_size = queue_offset + queue_count * sizeof(struct netdev_queue);
 
 	p = kmalloc(alloc_size, GFP_KERNEL);
 	if (!p) {
@@ -3003,11 +3569,22 @@ struct net_device *alloc_netdev(int sizeof_priv, const char *name,
 	if (sizeof_priv)
 		dev->priv = netdev_priv(dev);
 
+	dev->tx_queues = (struct netdev_queue *)((char *)p + queue_offset);
+	dev->num_tx_queues = queue_count;
+	for (i = 0; i < queue_count; i++) {
+		struct netdev_queue *txq = &dev->tx_queues[i];
+
+		spin_lock_init(&txq->lock);
+		spin_lock_init(&txq->xmit_lock);
+		txq->xmit_lock_owner = -1;
+		txq->dev = dev;
+	}
+
 	setup(dev);
 	strcpy(dev->name, name);
 	return dev;
 }
-EXPORT_SYMBOL(alloc_netdev);
+EXPORT_SYMBOL(alloc_netdev_mq);
 
 /**
  *	free_netdev - free network device
@@ -3019,6 +3596,9 @@ EXPORT_SYMBOL(alloc_netdev);
  */
 void free_netdev(struct net_device *dev)
 {
+#ifdef CONFIG_SMP
+	kfree(dev->rps_map);
+#endif
 #ifdef CONFIG_SYSFS
 	/*  Compatiablity with error handling in drivers */
 	if (dev->reg_state == NETREG_UNINITIALIZED) {
@@ -3189,7 +3769,7 @@ static int dev_cpu_callback(struct notifier_block *nfb,
 	local_irq_enable();
 
 	/* Process offline CPU's input_pkt_queue */
-	while ((skb = __skb_dequeue(&oldsd->input_pkt_queue)))
+	while ((skb = skb_dequeue(&oldsd->input_pkt_queue)))
 		netif_rx(skb);
 
 	return NOTIFY_OK;
@@ -3215,6 +3795,10 @@ static int __init net_dev_init(void)
 	BUG_ON(!dev_boot_phase);
 
 	net_random_init();
+#ifdef CONFIG_SMP
+	get_random_bytes(&rps_hashrnd, sizeof(rps_hashrnd));
+#endif
+	get_random_bytes(&tx_hashrnd, sizeof(tx_hashrnd));
 
 	if (dev_proc_init())
 		goto out;
@@ -3242,6 +3826,8 @@ static int __init net_dev_init(void)
 		queue = &per_cpu(softnet_data, i);
 		skb_queue_head_init(&queue->input_pkt_queue);
 		queue->completion_queue = NULL;
+		queue->gro_list = NULL;
+		queue->gro_count = 0;
 		INIT_LIST_HEAD(&queue->poll_list);
 		set_bit(__LINK_STATE_START, &queue->backlog_dev.state);
 		queue->backlog_dev.weight = weight_p;
@@ -3277,6 +3863,8 @@ EXPORT_SYMBOL(dev_get_by_index);
 EXPORT_SYMBOL(dev_get_by_name);
 EXPORT_SYMBOL(dev_open);
 EXPORT_SYMBOL(dev_queue_xmit);
+EXPORT_SYMBOL(dev_hard_start_xmit);
+EXPORT_SYMBOL(skb_gso_segment);
 EXPORT_SYMBOL(dev_remove_pack);
 EXPORT_SYMBOL(dev_set_allmulti);
 EXPORT_SYMBOL(dev_set_promiscuity);
@@ -184,6 +184,44 @@ static ssize_t store_weight(struct class_device *dev, const char *buf, size_t le
 	return netdev_store(dev, buf, len, change_weight);
 }
 
+#ifdef CONFIG_SMP
+static ssize_t format_rps_cpus(const struct net_device *net, char *buf)
+{
+	int len = cpulist_scnprintf(buf, PAGE_SIZE - 1, net->rps_cpus);
+
+	buf[len++] = '\n';
+	return len;
+}
+
+static ssize_t show_rps_cpus(struct class_device *cd, char *buf)
+{
+	return netdev_show(cd, buf, format_rps_cpus);
+}
+
+/* takes a cpu list ("0-3,6"), an empty string turns steering off */
+static ssize_t store_rps_cpus(struct class_device *dev, const char *buf,
+			      size_t len)
+{
+	struct net_device *net = to_net_dev(dev);
+	cpumask_t mask;
+	int ret = -EINVAL;
+
+	if (!capable(CAP_NET_ADMIN))
+		return -EPERM;
+
+	cpus_clear(mask);
+	if (*buf && *buf != '\n' && cpulist_parse(buf, mask))
+		return -EINVAL;
+
+	rtnl_lock();
+	if (dev_isalive(net))
+		ret = netdev_set_rps_cpus(net, mask);
+	rtnl_unlock();
+
+	return ret ? ret : len;
+}
+#endif
+
 static struct class_device_attribute net_class_attributes[] = {
 	__ATTR(addr_len, S_IRUGO, show_addr_len, NULL),
 	__ATTR(iflink, S_IRUGO, show_iflink, NULL),
@@ -198,6 +236,9 @@ static struct class_device_attribute net_class_attributes[] = {
 	__ATTR(tx_queue_len, S_IRUGO | S_IWUSR, show_tx_queue_len,
 	       store_tx_queue_len),
 	__ATTR(weight, S_IRUGO | S_IWUSR, show_weight, store_weight),
+#ifdef CONFIG_SMP
+	__ATTR(rps_cpus, S_IRUGO | S_IWUSR, show_rps_cpus, store_rps_cpus),
+#endif
 	{}
 };
 
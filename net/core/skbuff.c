@@ -409,6 +409,7 @@ struct sk_buff *skb_clone(struct sk_buff *skb, gfp_t gfp_mask)
 	C(pkt_type);
 	C(ip_summed);
 	C(priority);
+	C(queue_mapping);
 	C(protocol);
 	n->destructor = NULL;
 #ifdef CONFIG_NETFILTER
@@ -465,6 +466,7 @@ static void copy_skb_header(struct sk_buff *new, const struct sk_buff *old)
 	new->sk		= NULL;
 	new->dev	= old->dev;
 	new->priority	= old->priority;
+	new->queue_mapping = old->queue_mapping;
 	new->protocol	= old->protocol;
 	new->dst	= dst_clone(old->dst);
 #ifdef CONFIG_INET
@@ -1554,6 +1556,171 @@ void skb_split(struct sk_buff *skb, struct sk_buff *skb1, const u32 len)
 		skb_split_no_header(skb, skb1, len, pos);
 }
 
+/**
+ *	skb_gro_receive - merge a segment into a held GRO packet
+ *	@p: packet held on the gro_list
+ *	@skb: segment to append
+ *
+ *	The headers of @skb, up to GRO_CB(skb)->data_offset, are pulled
+ *	and the remaining payload is chained onto the frag_list of @p.
+ *	The caller has already checked that @skb continues the flow of @p.
+ *	Returns -E2BIG if the merged packet would exceed 64K.
+ */
+int skb_gro_receive(struct sk_buff *p, struct sk_buff *skb)
+{
+	unsigned int len = skb->len - GRO_CB(skb)->data_offset;
+
+	if (p->len + len >= 65536)
+		return -E2BIG;
+
+	__skb_pull(skb, GRO_CB(skb)->data_offset);
+
+	if (GRO_CB(p)->last == p)
+		skb_shinfo(p)->frag_list = skb;
+	else
+		GRO_CB(p)->last->next = skb;
+	GRO_CB(p)->last = skb;
+	skb->next = NULL;
+
+	p->len += len;
+	p->data_len += len;
+	p->truesize += skb->truesize;
+	GRO_CB(p)->count++;
+	return 0;
+}
+
+/**
+ *	skb_segment - cut a TSO packet into MSS sized segments
+ *	@skb: packet to segment, data pointing past all protocol headers
+ *	@features: features of the output device
+ *
+ *	Each segment gets a copy of the headers in front of @skb->data
+ *	(starting at the mac header) followed by at most tso_size bytes of
+ *	payload.  With NETIF_F_SG the payload pages are shared with @skb
+ *	and the checksum is left to the device, otherwise the payload is
+ *	copied and its checksum stored in the segment's csum field.
+ *	The protocols fix up their own headers afterwards.
+ *
+ *	Returns the list of segments linked through ->next, or an ERR_PTR.
+ */
+struct sk_buff *skb_segment(struct sk_buff *skb, int features)
+{
+	struct sk_buff *segs = NULL;
+	struct sk_buff *tail = NULL;
+	unsigned int mss = skb_shinfo(skb)->tso_size;
+	unsigned int doffset = skb->data - skb->mac.raw;
+	unsigned int offset = doffset;
+	unsigned int headroom;
+	unsigned int len;
+	int sg = (features & NETIF_F_SG) && skb->ip_summed == CHECKSUM_HW &&
+		 !skb_shinfo(skb)->frag_list;
+	int nfrags = skb_shinfo(skb)->nr_frags;
+	int i = 0;
+	int pos;
+
+	__skb_push(skb, doffset);
+	headroom = skb_headroom(skb);
+	pos = skb_headlen(skb);
+
+	do {
+		struct sk_buff *nskb;
+		skb_frag_t *frag;
+		int hsize, nsize;
+		int k;
+
+		len = skb->len - offset;
+		if (len > mss)
+			len = mss;
+
+		hsize = skb_headlen(skb) - offset;
+		if (hsize < 0)
+			hsize = 0;
+		if (hsize > len || !sg)
+			hsize = len;
+		nsize = hsize + doffset;
+
+		nskb = alloc_skb(nsize + headroom, GFP_ATOMIC);
+		if (unlikely(!nskb))
+			goto err;
+
+		if (segs)
+			tail->next = nskb;
+		else
+			segs = nskb;
+		tail = nskb;
+
+		nskb->dev = skb->dev;
+		nskb->priority = skb->priority;
+		nskb->queue_mapping = skb->queue_mapping;
+		nskb->protocol = skb->protocol;
+		nskb->dst = dst_clone(skb->dst);
+		memcpy(nskb->cb, skb->cb, sizeof(skb->cb));
+		nskb->pkt_type = skb->pkt_type;
+		nskb->mac_len = skb->mac_len;
+
+		skb_reserve(nskb, headroom);
+		nskb->mac.raw = nskb->data;
+		nskb->nh.raw = nskb->data + (skb->nh.raw - skb->mac.raw);
+		nskb->h.raw = nskb->data + (skb->h.raw - skb->mac.raw);
+		memcpy(skb_put(nskb, doffset), skb->data, doffset);
+
+		if (!sg) {
+			nskb->csum = skb_copy_and_csum_bits(skb, offset,
+							    skb_put(nskb, len),
+							    len, 0);
+			continue;
+		}
+
+		nskb->ip_summed = CHECKSUM_HW;
+		nskb->csum = skb->csum;
+		memcpy(skb_put(nskb, hsize), skb->data + offset, hsize);
+
+		frag = skb_shinfo(nskb)->frags;
+		k = 0;
+
+		while (pos < offset + len) {
+			BUG_ON(i >= nfrags);
+
+			*frag = skb_shinfo(skb)->frags[i];
+			get_page(frag->page);
+
+			if (pos < offset) {
+				frag->page_offset += offset - pos;
+				frag->size -= offset - pos;
+			}
+
+			k++;
+
+			if (pos + skb_shinfo(skb)->frags[i].size <=
+			    offset + len) {
+				pos += skb_shinfo(skb)->frags[i].size;
+				i++;
+			} else {
+				frag->size -= pos +
+					      skb_shinfo(skb)->frags[i].size -
+					      (offset + len);
+				break;
+			}
+
+			frag++;
+		}
+
+		skb_shinfo(nskb)->nr_frags = k;
+		nskb->data_len = len - hsize;
+		nskb->len += nskb->data_len;
+		nskb->truesize += nskb->data_len;
+	} while ((offset += len) < skb->len);
+
+	return segs;
+
+err:
+	while ((skb = segs) != NULL) {
+		segs = skb->next;
+		kfree_skb(skb);
+	}
+	return ERR_PTR(-ENOMEM);
+}
+
 /**
  * skb_prepare_seq_read - Prepare a sequential read of skb data
  * @skb: the buffer to read
@@ -1826,6 +1993,8 @@ EXPORT_SYMBOL(skb_queue_tail);
 EXPORT_SYMBOL(skb_unlink);
 EXPORT_SYMBOL(skb_append);
 EXPORT_SYMBOL(skb_split);
+EXPORT_SYMBOL(skb_gro_receive);
+EXPORT_SYMBOL(skb_segment);
 EXPORT_SYMBOL(skb_prepare_seq_read);
 EXPORT_SYMBOL(skb_seq_read);
 EXPORT_SYMBOL(skb_abort_seq_read);
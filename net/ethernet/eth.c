@@ -284,9 +284,10 @@ void ether_setup(struct net_device *dev)
 EXPORT_SYMBOL(ether_setup);
 
 /**
- * alloc_etherdev - Allocates and sets up an ethernet device
+ * alloc_etherdev_mq - Allocates and sets up an ethernet device
  * @sizeof_priv: Size of additional driver-private structure to be allocated
  *	for this ethernet device
+ * @queue_count: The number of hardware transmit queues of the device
  *
  * Fill in the fields of the device structure with ethernet-generic
  * values. Basically does everything except registering the device.
@@ -296,8 +297,8 @@ EXPORT_SYMBOL(ether_setup);
  * this private data area.
  */
 
-struct net_device *alloc_etherdev(int sizeof_priv)
+struct net_device *alloc_etherdev_mq(int sizeof_priv, unsigned int queue_count)
 {
-	return alloc_netdev(sizeof_priv, "eth%d", ether_setup);
+	return alloc_netdev_mq(sizeof_priv, "eth%d", ether_setup, queue_count);
 }
-EXPORT_SYMBOL(alloc_etherdev);
+EXPORT_SYMBOL(alloc_etherdev_mq);
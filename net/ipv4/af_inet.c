@@ -1084,6 +1084,130 @@ int inet_sk_rebuild_header(struct sock *sk)
 
 EXPORT_SYMBOL(inet_sk_rebuild_header);
 
+static int inet_gro_receive(struct sk_buff **head, struct sk_buff *skb)
+{
+	struct net_protocol *ops;
+	struct in_device *in_dev;
+	struct sk_buff *p;
+	struct iphdr *iph;
+	int proto;
+
+	if (!pskb_may_pull(skb, sizeof(*iph)))
+		goto out_flush;
+
+	iph = skb->nh.iph = (struct iphdr *)skb->data;
+	proto = iph->protocol & (MAX_INET_PROTOS - 1);
+
+	for (p = *head; p; p = p->next) {
+		struct iphdr *iph2;
+
+		if (!GRO_CB(p)->same_flow)
+			continue;
+
+		iph2 = p->nh.iph;
+		if (iph->saddr != iph2->saddr || iph->daddr != iph2->daddr ||
+		    iph->protocol != iph2->protocol) {
+			GRO_CB(p)->same_flow = 0;
+			continue;
+		}
+
+		/* Header fields that would be lost by merging. */
+		if (iph->tos != iph2->tos || iph->ttl != iph2->ttl)
+			goto out_flush;
+	}
+
+	if (*(u8 *)iph != 0x45 ||
+	    skb->ip_summed != CHECKSUM_UNNECESSARY ||
+	    ntohs(iph->tot_len) != skb->len ||
+	    (iph->frag_off & htons(IP_MF | IP_OFFSET)) ||
+	    ip_fast_csum((u8 *)iph, iph->ihl))
+		goto out_flush;
+
+	/* A merged packet cannot be forwarded as it stands. */
+	in_dev = __in_dev_get_rcu(skb->dev);
+	if (!in_dev || IN_DEV_FORWARD(in_dev))
+		goto out_flush;
+
+	ops = rcu_dereference(inet_protos[proto]);
+	if (!ops || !ops->gro_receive)
+		goto out_flush;
+
+	GRO_CB(skb)->data_offset = sizeof(*iph);
+	return ops->gro_receive(head, skb);
+
+out_flush:
+	GRO_CB(skb)->flush = 1;
+	return 0;
+}
+
+static int inet_gro_complete(struct sk_buff *skb)
+{
+	struct iphdr *iph = skb->nh.iph;
+	struct net_protocol *ops;
+	int proto = iph->protocol & (MAX_INET_PROTOS - 1);
+	int err = -ENOSYS;
+
+	iph->tot_len = htons(skb->len);
+	ip_send_check(iph);
+
+	rcu_read_lock();
+	ops = rcu_dereference(inet_protos[proto]);
+	if (ops && ops->gro_complete)
+		err = ops->gro_complete(skb);
+	rcu_read_unlock();
+
+	return err;
+}
+
+static struct sk_buff *inet_gso_segment(struct sk_buff *skb, int features)
+{
+	struct sk_buff *segs = ERR_PTR(-EINVAL);
+	struct net_protocol *ops;
+	struct iphdr *iph;
+	int proto;
+	int ihl;
+	int id;
+
+	if (!pskb_may_pull(skb, sizeof(*iph)))
+		goto out;
+
+	iph = skb->nh.iph;
+	ihl = iph->ihl * 4;
+	if (ihl < sizeof(*iph))
+		goto out;
+
+	if (!pskb_may_pull(skb, ihl))
+		goto out;
+
+	iph = skb->nh.iph;
+	id = ntohs(iph->id);
+	proto = iph->protocol & (MAX_INET_PROTOS - 1);
+	segs = ERR_PTR(-EPROTONOSUPPORT);
+
+	__skb_pull(skb, ihl);
+	skb->h.raw = skb->data;
+
+	rcu_read_lock();
+	ops = rcu_dereference(inet_protos[proto]);
+	if (ops && ops->gso_segment)
+		segs = ops->gso_segment(skb, features);
+	rcu_read_unlock();
+
+	if (IS_ERR(segs))
+		goto out;
+
+	/* ip_queue_xmit() reserved an id for every segment */
+	for (skb = segs; skb; skb = skb->next) {
+		iph = skb->nh.iph;
+		iph->id = htons(id++);
+		iph->tot_len = htons(skb->len - skb->mac_len);
+		ip_send_check(iph);
+	}
+
+out:
+	return segs;
+}
+
 #ifdef CONFIG_IP_MULTICAST
 static struct net_protocol igmp_protocol = {
 	.handler =	igmp_rcv,
@@ -1093,6 +1217,9 @@ static struct net_protocol igmp_protocol = {
 static struct net_protocol tcp_protocol = {
 	.handler =	tcp_v4_rcv,
 	.err_handler =	tcp_v4_err,
+	.gro_receive =	tcp4_gro_receive,
+	.gro_complete =	tcp4_gro_complete,
+	.gso_segment =	tcp4_gso_segment,
 	.no_policy =	1,
 };
 
@@ -1138,6 +1265,9 @@ static int ipv4_proc_init(void);
 static struct packet_type ip_packet_type = {
 	.type = __constant_htons(ETH_P_IP),
 	.func = ip_rcv,
+	.gro_receive = inet_gro_receive,
+	.gro_complete = inet_gro_complete,
+	.gso_segment = inet_gso_segment,
 };
 
 static int __init inet_init(void)
@@ -125,9 +125,10 @@ static void tcp_measure_rcv_mss(struct sock *sk,
 	icsk->icsk_ack.last_seg_size = 0; 
 
 	/* skb->len may jitter because of SACKs, even if peer
-	 * sends good full-sized frames.
+	 * sends good full-sized frames.  Coalesced packets carry the
+	 * size of the original segments in tso_size.
 	 */
-	len = skb->len;
+	len = skb_shinfo(skb)->tso_size ? : skb->len;
 	if (len >= icsk->icsk_ack.rcv_mss) {
 		icsk->icsk_ack.rcv_mss = len;
 	} else {
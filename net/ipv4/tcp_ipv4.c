@@ -1157,6 +1157,150 @@ do_time_wait:
 	goto discard_it;
 }
 
+/*
+ * Generic receive offload.  In-order data segments of one connection
+ * that carry identical headers apart from the sequence number are
+ * merged; anything else is delivered on its own after the segments
+ * already held for that connection.
+ */
+int tcp4_gro_receive(struct sk_buff **head, struct sk_buff *skb)
+{
+	unsigned int off = GRO_CB(skb)->data_offset;
+	struct tcphdr *th, *th2;
+	struct sk_buff *p;
+	unsigned int thlen, len, plen, i;
+	u32 flags;
+
+	if (!pskb_may_pull(skb, off + sizeof(*th)))
+		goto out_flush;
+
+	th = (struct tcphdr *)(skb->data + off);
+	thlen = th->doff * 4;
+	if (thlen < sizeof(*th) || !pskb_may_pull(skb, off + thlen))
+		goto out_flush;
+
+	/* pskb_may_pull() may have moved the header */
+	th = skb->h.th = (struct tcphdr *)(skb->data + off);
+	len = skb->len - off - thlen;
+	flags = tcp_flag_word(th);
+
+	for (p = *head; p; p = p->next) {
+		if (!GRO_CB(p)->same_flow)
+			continue;
+
+		th2 = p->h.th;
+		if (th->source != th2->source || th->dest != th2->dest) {
+			GRO_CB(p)->same_flow = 0;
+			continue;
+		}
+		goto found;
+	}
+	goto out_check;
+
+found:
+	if (!len || (flags & ~(TCP_FLAG_ACK | TCP_FLAG_PSH)) ||
+	    th->ack_seq != th2->ack_seq || th->window != th2->window ||
+	    th->doff != th2->doff || len > GRO_CB(p)->mss)
+		goto out_flush;
+
+	for (i = sizeof(*th); i < thlen; i += 4)
+		if (*(u32 *)((u8 *)th + i) != *(u32 *)((u8 *)th2 + i))
+			goto out_flush;
+
+	plen = p->len - (p->h.raw + thlen - p->data);
+	if (ntohl(th->seq) != ntohl(th2->seq) + plen)
+		goto out_flush;
+
+	GRO_CB(skb)->data_offset = off + thlen;
+	if (skb_gro_receive(p, skb))
+		goto out_flush;
+
+	/* A short or pushed segment ends the burst. */
+	if (len < GRO_CB(p)->mss || (flags & TCP_FLAG_PSH)) {
+		th2->psh |= th->psh;
+		GRO_CB(p)->flush = 1;
+	}
+	return 1;
+
+out_check:
+	GRO_CB(skb)->mss = len;
+	if (!len || (flags & ~TCP_FLAG_ACK))
+		goto out_flush;
+	return 0;
+
+out_flush:
+	GRO_CB(skb)->flush = 1;
+	return 0;
+}
+
+int tcp4_gro_complete(struct sk_buff *skb)
+{
+	skb_shinfo(skb)->tso_size = GRO_CB(skb)->mss;
+	skb_shinfo(skb)->tso_segs = GRO_CB(skb)->count;
+	return 0;
+}
+
+/*
+ * Software TSO.  Every segment gets the sequence number of its first
+ * byte and its own checksum; FIN and PSH stay on the last segment
+ * only and CWR on the first, as a TSO capable NIC would do it.
+ */
+struct sk_buff *tcp4_gso_segment(struct sk_buff *skb, int features)
+{
+	struct sk_buff *segs = ERR_PTR(-EINVAL);
+	struct tcphdr *th;
+	struct iphdr *iph;
+	unsigned int thlen;
+	unsigned int len;
+	u32 seq;
+
+	if (!pskb_may_pull(skb, sizeof(*th)))
+		goto out;
+
+	th = skb->h.th;
+	thlen = th->doff * 4;
+	if (thlen < sizeof(*th))
+		goto out;
+
+	if (!pskb_may_pull(skb, thlen))
+		goto out;
+
+	seq = ntohl(skb->h.th->seq);
+	__skb_pull(skb, thlen);
+
+	segs = skb_segment(skb, features);
+	if (IS_ERR(segs))
+		goto out;
+
+	for (skb = segs; skb; skb = skb->next) {
+		th = skb->h.th;
+		iph = skb->nh.iph;
+		len = skb->len - (skb->h.raw - skb->data);
+
+		th->seq = htonl(seq);
+		seq += len - thlen;
+		if (skb != segs)
+			th->cwr = 0;
+		if (skb->next)
+			th->fin = th->psh = 0;
+
+		if (skb->ip_summed == CHECKSUM_HW)
+			th->check = ~tcp_v4_check(th, len, iph->saddr,
+						  iph->daddr, 0);
+		else {
+			th->check = 0;
+			th->check = tcp_v4_check(th, len, iph->saddr,
+						 iph->daddr,
+						 csum_partial((char *)th,
+							      thlen,
+							      skb->csum));
+		}
+	}
+
+out:
+	return segs;
+}
+
 /* VJ's idea. Save last timestamp seen from this destination
  * and hold it at least for normal timewait interval to use for duplicate
  * segment detection in subsequent connections, before they enter synchronized
@@ -95,9 +95,22 @@ int qdisc_restart(struct net_device *dev)
 	struct Qdisc *q = dev->qdisc;
 	struct sk_buff *skb;
 
-	/* Dequeue packet */
-	if ((skb = q->dequeue(q)) != NULL) {
+	/* Dequeue packet, finishing a partially sent GSO packet first */
+	if ((skb = dev->gso_skb) != NULL || (skb = q->dequeue(q)) != NULL) {
 		unsigned nolock = (dev->features & NETIF_F_LLTX);
+
+		dev->gso_skb = NULL;
+
+		/* Its hardware queue is full; netif_wake_subqueue() will
+		 * reschedule us. */
+		if (__netif_subqueue_stopped(dev, skb->queue_mapping)) {
+			if (skb->next)
+				dev->gso_skb = skb;
+			else
+				q->ops->requeue(skb, q);
+			return 0;
+		}
+
 		/*
 		 * When the driver has LLTX set it does its own locking
 		 * in start_xmit. No need to add additional overhead by
@@ -136,10 +149,8 @@ int qdisc_restart(struct net_device *dev)
 
 			if (!netif_queue_stopped(dev)) {
 				int ret;
-				if (netdev_nit)
-					dev_queue_xmit_nit(skb, dev);
 
-				ret = dev->hard_start_xmit(skb, dev);
+				ret = dev_hard_start_xmit(skb, dev);
 				if (ret == NETDEV_TX_OK) { 
 					if (!nolock) {
 						dev->xmit_lock_owner = -1;
@@ -175,7 +186,10 @@ int qdisc_restart(struct net_device *dev)
 		 */
 
 requeue:
-		q->ops->requeue(skb, q);
+		if (skb->next)
+			dev->gso_skb = skb;
+		else
+			q->ops->requeue(skb, q);
 		netif_schedule(dev);
 		return 1;
 	}
@@ -183,6 +197,113 @@ requeue:
 	return q->q.qlen;
 }
 
+/*
+ * Queue 0 shares the device xmit lock with netpoll and with drivers
+ * that lock the whole device.
+ */
+static inline spinlock_t *txq_xmit_lock(struct netdev_queue *txq, int **owner)
+{
+	struct net_device *dev = txq->dev;
+
+	if (txq == dev->tx_queues) {
+		*owner = &dev->xmit_lock_owner;
+		return &dev->xmit_lock;
+	}
+	*owner = &txq->xmit_lock_owner;
+	return &txq->xmit_lock;
+}
+
+/*
+ * qdisc_restart() for one hardware queue of a multiqueue device, see
+ * above.  Called with txq->lock held; the per queue locks replace
+ * dev->queue_lock and dev->xmit_lock.
+ */
+int qdisc_restart_queue(struct netdev_queue *txq)
+{
+	struct net_device *dev = txq->dev;
+	struct Qdisc *q = txq->qdisc;
+	struct sk_buff *skb;
+	spinlock_t *xmit_lock;
+	int *owner;
+
+	if ((skb = txq->gso_skb) == NULL && (skb = q->dequeue(q)) == NULL) {
+		BUG_ON((int) q->q.qlen < 0);
+		return q->q.qlen;
+	}
+
+	txq->gso_skb = NULL;
+	xmit_lock = txq_xmit_lock(txq, &owner);
+
+	if (!(dev->features & NETIF_F_LLTX)) {
+		if (!spin_trylock(xmit_lock)) {
+			if (*owner == smp_processor_id()) {
+				kfree_skb(skb);
+				if (net_ratelimit())
+					printk(KERN_DEBUG "Dead loop on netdevice %s, fix it urgently!\n", dev->name);
+				return -1;
+			}
+			__get_cpu_var(netdev_rx_stat).cpu_collision++;
+			goto requeue;
+		}
+		*owner = smp_processor_id();
+	}
+
+	spin_unlock(&txq->lock);
+
+	if (!netif_queue_stopped(dev) &&
+	    !test_bit(__QUEUE_STATE_XOFF, &txq->state)) {
+		int ret = dev_hard_start_xmit(skb, dev);
+
+		if (ret == NETDEV_TX_OK) {
+			if (!(dev->features & NETIF_F_LLTX)) {
+				*owner = -1;
+				spin_unlock(xmit_lock);
+			}
+			spin_lock(&txq->lock);
+			return -1;
+		}
+		if (ret == NETDEV_TX_LOCKED && (dev->features & NETIF_F_LLTX)) {
+			spin_lock(&txq->lock);
+			__get_cpu_var(netdev_rx_stat).cpu_collision++;
+			goto requeue;
+		}
+	}
+
+	if (!(dev->features & NETIF_F_LLTX)) {
+		*owner = -1;
+		spin_unlock(xmit_lock);
+	}
+	spin_lock(&txq->lock);
+	q = txq->qdisc;
+
+requeue:
+	if (skb->next)
+		txq->gso_skb = skb;
+	else
+		q->ops->requeue(skb, q);
+	netif_schedule(dev);
+	return 1;
+}
+
+/*
+ * Run every hardware queue of @dev that has its own discipline.  A
+ * queue whose lock is taken is being run by its owner already.
+ */
+void qdisc_run_queues(struct net_device *dev)
+{
+	unsigned int i;
+
+	for (i = 0; i < dev->num_tx_queues; i++) {
+		struct netdev_queue *txq = &dev->tx_queues[i];
+
+		if (!txq->qdisc || !spin_trylock(&txq->lock))
+			continue;
+		if (txq->qdisc)
+			qdisc_run_queue(txq);
+		spin_unlock(&txq->lock);
+	}
+}
+
 static void dev_watchdog(unsigned long arg)
 {
 	struct net_device *dev = (struct net_device *)arg;
@@ -523,6 +644,44 @@ void qdisc_destroy(struct Qdisc *qdisc)
 	call_rcu(&qdisc->q_rcu, __qdisc_destroy);
 }
 
+/*
+ * A multiqueue device running pfifo_fast gets one pfifo_fast instance
+ * per hardware queue; with any other discipline all queues share the
+ * root one.
+ */
+static void dev_activate_queues(struct net_device *dev)
+{
+	int mq = netif_is_multiqueue(dev) &&
+		 dev->qdisc_sleeping->ops == &pfifo_fast_ops;
+	unsigned int i;
+
+	for (i = 0; i < dev->num_tx_queues; i++) {
+		struct netdev_queue *txq = &dev->tx_queues[i];
+		struct Qdisc *qdisc = txq->qdisc_sleeping;
+
+		if (mq && !qdisc) {
+			qdisc = qdisc_create_dflt(dev, &pfifo_fast_ops);
+			if (qdisc == NULL) {
+				printk(KERN_INFO "%s: queue %u activation failed\n",
+				       dev->name, i);
+				continue;
+			}
+			qdisc->stats_lock = &txq->lock;
+			txq->qdisc_sleeping = qdisc;
+		} else if (!mq && qdisc) {
+			spin_lock_bh(&txq->lock);
+			txq->qdisc = NULL;
+			txq->qdisc_sleeping = NULL;
+			qdisc_destroy(qdisc);
+			spin_unlock_bh(&txq->lock);
+		}
+
+		spin_lock_bh(&txq->lock);
+		rcu_assign_pointer(txq->qdisc, txq->qdisc_sleeping);
+		spin_unlock_bh(&txq->lock);
+	}
+}
+
 void dev_activate(struct net_device *dev)
 {
 	/* No queueing discipline is attached to device;
@@ -561,11 +720,15 @@ void dev_activate(struct net_device *dev)
 		dev_watchdog_up(dev);
 	}
 	spin_unlock_bh(&dev->queue_lock);
+
+	dev_activate_queues(dev);
 }
 
 void dev_deactivate(struct net_device *dev)
 {
 	struct Qdisc *qdisc;
+	struct sk_buff *skb;
+	unsigned int i;
 
 	spin_lock_bh(&dev->queue_lock);
 	qdisc = dev->qdisc;
@@ -573,14 +736,38 @@ void dev_deactivate(struct net_device *dev)
 
 	qdisc_reset(qdisc);
 
+	skb = dev->gso_skb;
+	dev->gso_skb = NULL;
 	spin_unlock_bh(&dev->queue_lock);
 
+	if (skb)
+		kfree_skb(skb);
+
+	for (i = 0; i < dev->num_tx_queues; i++) {
+		struct netdev_queue *txq = &dev->tx_queues[i];
+
+		spin_lock_bh(&txq->lock);
+		qdisc = txq->qdisc;
+		if (qdisc) {
+			rcu_assign_pointer(txq->qdisc, &noop_qdisc);
+			qdisc_reset(qdisc);
+		}
+		skb = txq->gso_skb;
+		txq->gso_skb = NULL;
+		spin_unlock_bh(&txq->lock);
+
+		if (skb)
+			kfree_skb(skb);
+	}
+
 	dev_watchdog_down(dev);
 
 	while (test_bit(__LINK_STATE_SCHED, &dev->state))
 		yield();
 
 	spin_unlock_wait(&dev->xmit_lock);
+	for (i = 1; i < dev->num_tx_queues; i++)
+		spin_unlock_wait(&dev->tx_queues[i].xmit_lock);
 }
 
 void dev_init_scheduler(struct net_device *dev)
@@ -597,6 +784,19 @@ void dev_init_scheduler(struct net_device *dev)
 void dev_shutdown(struct net_device *dev)
 {
 	struct Qdisc *qdisc;
+	unsigned int i;
+
+	for (i = 0; i < dev->num_tx_queues; i++) {
+		struct netdev_queue *txq = &dev->tx_queues[i];
+
+		spin_lock_bh(&txq->lock);
+		qdisc = txq->qdisc_sleeping;
+		txq->qdisc = NULL;
+		txq->qdisc_sleeping = NULL;
+		if (qdisc)
+			qdisc_destroy(qdisc);
+		spin_unlock_bh(&txq->lock);
+	}
 
 	qdisc_lock_tree(dev);
 	qdisc = dev->qdisc_sleeping;
@@ -623,5 +823,7 @@ EXPORT_SYMBOL(qdisc_alloc);
 EXPORT_SYMBOL(qdisc_destroy);
 EXPORT_SYMBOL(qdisc_reset);
 EXPORT_SYMBOL(qdisc_restart);
+EXPORT_SYMBOL(qdisc_restart_queue);
+EXPORT_SYMBOL(qdisc_run_queues);
 EXPORT_SYMBOL(qdisc_lock_tree);
 EXPORT_SYMBOL(qdisc_unlock_tree);
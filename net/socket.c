@@ -79,6 +79,7 @@
 #include <linux/highmem.h>
 #include <linux/divert.h>
 #include <linux/mount.h>
+#include <linux/pipe_fs_i.h>
 #include <linux/security.h>
 #include <linux/syscalls.h>
 #include <linux/compat.h>
@@ -116,6 +117,9 @@ static ssize_t sock_writev(struct file *file, const struct iovec *vector,
 			  unsigned long count, loff_t *ppos);
 static ssize_t sock_sendpage(struct file *file, struct page *page,
 			     int offset, size_t size, loff_t *ppos, int more);
+static ssize_t sock_splice_read(struct file *file, loff_t *ppos,
+				struct inode *pipe, size_t len,
+				unsigned int flags);
 
 
 /*
@@ -136,7 +140,9 @@ static struct file_operations socket_file_ops = {
 	.fasync =	sock_fasync,
 	.readv =	sock_readv,
 	.writev =	sock_writev,
-	.sendpage =	sock_sendpage
+	.sendpage =	sock_sendpage,
+	.splice_write =	generic_splice_sendpage,
+	.splice_read =	sock_splice_read,
 };
 
 /*
@@ -655,6 +661,119 @@ static ssize_t sock_sendpage(struct file *file, struct page *page,
 	return sock->ops->sendpage(sock, page, offset, size, flags);
 }
 
+/*
+ * Receive straight into freshly allocated pages and hand them to the
+ * pipe. The data is copied once out of the skbs, but never through
+ * user space; the pages go out again via sendpage() without a copy.
+ *
+ * Whatever is taken off the socket has to end up in the pipe, so the
+ * receive is done with the pipe locked and limited to the free slots.
+ * The pipe is not held while waiting for data though: that is done
+ * with a peek first, and the receive under the lock never blocks.
+ */
+static ssize_t sock_splice_read(struct file *file, loff_t *ppos,
+				struct inode *pipe, size_t len,
+				unsigned int flags)
+{
+	struct socket *sock = file->private_data;
+	struct pipe_inode_info *info;
+	struct page *pages[PIPE_BUFFERS];
+	struct kvec iov[PIPE_BUFFERS];
+	struct msghdr msg;
+	int i, nr_pages, room;
+	ssize_t ret;
+
+again:
+	if (!(file->f_flags & O_NONBLOCK) && !(flags & SPLICE_F_NONBLOCK)) {
+		char c;
+		struct kvec peek = { .iov_base = &c, .iov_len = 1 };
+
+		memset(&msg, 0, sizeof(msg));
+		ret = kernel_recvmsg(sock, &msg, &peek, 1, 1, MSG_PEEK);
+		if (ret <= 0)
+			return ret;
+	}
+
+	mutex_lock(PIPE_MUTEX(*pipe));
+	info = pipe->i_pipe;
+	for (;;) {
+		if (!PIPE_READERS(*pipe)) {
+			send_sig(SIGPIPE, current, 0);
+			ret = -EPIPE;
+			goto out_unlock;
+		}
+		room = PIPE_BUFFERS - info->nrbufs;
+		if (room > 0)
+			break;
+		if (flags & SPLICE_F_NONBLOCK) {
+			ret = -EAGAIN;
+			goto out_unlock;
+		}
+		if (signal_pending(current)) {
+			ret = -ERESTARTSYS;
+			goto out_unlock;
+		}
+		PIPE_WAITING_WRITERS(*pipe)++;
+		pipe_wait(pipe);
+		PIPE_WAITING_WRITERS(*pipe)--;
+	}
+
+	nr_pages = (len + PAGE_SIZE - 1) >> PAGE_SHIFT;
+	if (nr_pages > room)
+		nr_pages = room;
+
+	for (i = 0; i < nr_pages; i++) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i])
+			break;
+		iov[i].iov_base = page_address(pages[i]);
+		iov[i].iov_len = min_t(size_t, len - i * PAGE_SIZE, PAGE_SIZE);
+	}
+	nr_pages = i;
+	if (!nr_pages) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	memset(&msg, 0, sizeof(msg));
+	ret = kernel_recvmsg(sock, &msg, iov, nr_pages,
+			     min_t(size_t, len, nr_pages * PAGE_SIZE),
+			     MSG_DONTWAIT);
+
+	/* the pipe cannot have filled up meanwhile, all of it fits */
+	len = ret > 0 ? ret : 0;
+	for (i = 0; i < nr_pages; i++) {
+		int newbuf = (info->curbuf + info->nrbufs) & (PIPE_BUFFERS - 1);
+		struct pipe_buffer *buf = info->bufs + newbuf;
+
+		if (!len) {
+			__free_page(pages[i]);
+			continue;
+		}
+		buf->page = pages[i];
+		buf->offset = 0;
+		buf->len = min_t(size_t, len, PAGE_SIZE);
+		buf->ops = &anon_pipe_buf_ops;
+		info->nrbufs++;
+		len -= buf->len;
+	}
+	mutex_unlock(PIPE_MUTEX(*pipe));
+
+	if (ret > 0) {
+		wake_up_interruptible(PIPE_WAIT(*pipe));
+		kill_fasync(PIPE_FASYNC_READERS(*pipe), SIGIO, POLL_IN);
+	} else if (ret == -EAGAIN && !(file->f_flags & O_NONBLOCK) &&
+		   !(flags & SPLICE_F_NONBLOCK)) {
+		/* someone else took the data we peeked at */
+		goto again;
+	}
+	return ret;
+
+out_unlock:
+	mutex_unlock(PIPE_MUTEX(*pipe));
+	return ret;
+}
+
 static struct sock_iocb *alloc_sock_iocb(struct kiocb *iocb,
 		char __user *ubuf, size_t size, struct sock_iocb *siocb)
 {